@@ -304,10 +304,55 @@
  * and you have the XRandR headers and library installed
  */
 
-#ifdef DOXRANDR
+#if defined(DOXRANDR) && !defined(XV_HEADLESS)
 #  define HAVE_XRR
 #endif
 
+/***************************************************************************
+ * MIT Shared Memory Extension Support
+ *
+ * if you want XV to pass large images to a local X server through shared
+ * memory (XShmPutImage) rather than through the socket, and you have the
+ * XShm headers and the Xext library installed
+ */
+
+#if defined(DOXSHM) && !defined(XV_HEADLESS)
+#  define HAVE_XSHM
+#endif
+
+/***************************************************************************
+ * Multithreading Support
+ *
+ * if you want XV to split the slower image processing operations (such as
+ * smoothing) across several CPUs, using POSIX threads
+ */
+
+#ifdef DOPTHREAD
+#  define HAVE_PTHREAD
+#endif
+
+/***************************************************************************
+ * In-Process Decompression
+ *
+ * if you have zlib, libbz2 and/or liblzma (and their headers) installed, XV
+ * can uncompress gzip'd, bzip2'd and xz'd files itself, and usually hand
+ * the result straight to the loader, rather than running the programs
+ * above and reading their output back from a temp file.  The programs are
+ * still used for 'compress'd files, and if anything goes wrong
+ */
+
+#ifdef DOZLIB
+#  define HAVE_ZLIB
+#endif
+
+#ifdef DOBZIP2
+#  define HAVE_BZLIB
+#endif
+
+#ifdef DOLZMA
+#  define HAVE_LZMA
+#endif
+
 /***************************************************************************
  * User definable filter support:
  *
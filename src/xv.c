@@ -41,8 +41,8 @@ static int    randomShow = 0;   /* do a 'random' slideshow */
 static int    startIconic = 0;  /* '-iconic' option */
 static int    defaultVis  = 0;  /* true if using DefaultVisual */
 #ifdef HAVE_G3
-int           lowresfax = 0;    /* temporary(?) kludge */
-int           highresfax = 0;
+extern int    lowresfax;        /* in xvload.c */
+extern int    highresfax;
 #endif
 static double hexpand = 1.0;    /* '-expand' argument */
 static double vexpand = 1.0;    /* '-expand' argument */
@@ -64,16 +64,12 @@ static int    mfontsize[] = { TV_FONTSIZE, 0 };
 static char   mfontset[256];
 #endif
 
-#ifdef HAVE_JP2K
-static byte jp2k_magic[12] =
-  { 0, 0, 0, 0x0c, 'j', 'P', ' ', ' ', 0x0d, 0x0a, 0x87, 0x0a };
-#endif
-
 
 /* things to do upon successfully loading an image */
 static int    autoraw    = 0;   /* force raw if using stdcmap */
 static int    autodither = 0;   /* dither */
 static int    autosmooth = 0;   /* smooth */
+static int    autoresamp = 0;   /* resample, rather than smooth */
 static int    auto4x3    = 0;   /* do a 4x3 */
 static int    autorotate = 0;   /* rotate 0, +-90, +-180, +-270 */
 static int    autohflip  = 0;   /* Flip Horizontally */
@@ -84,10 +80,13 @@ static int    acropX, acropY, acropW, acropH;
 static int    autonorm   = 0;   /* normalize */
 static int    autohisteq = 0;   /* Histogram equalization */
 
+static int    reducedPic = 0;   /* pic was decoded at 1/reducedPic size */
+static char   reducedName[MAXPATHLEN];   /* ... from this file */
+
 static int    force8     = 0;   /* force 8-bit mode */
 static int    force24    = 0;   /* force 24-bit mode */
 #ifdef HAVE_PCD
-static int    PcdSize    = -1;  /* force dialog to ask */
+extern int    PcdSize;          /* in xvload.c */
 #endif
 
 static float  waitsec_nonfinal = -1;  /* "normal" waitsec value */
@@ -111,6 +110,7 @@ static void printoption              PARM((const char *));
 static void cmdSyntax                PARM((int));
 static void rmodeSyntax              PARM((void));
 static int  openPic                  PARM((int));
+static int  doOpenPic                PARM((int));
 static int  readpipe                 PARM((char *, char *));
 static void openFirstPic             PARM((void));
 static void openNextPic              PARM((void));
@@ -141,7 +141,8 @@ static const char *histr, *lostr, *fgstr, *bgstr, *tmpstr;
 static const char *infogeom, *ctrlgeom, *gamgeom, *browgeom, *textgeom, *cmtgeom;
 static int userspecbrowgeom;
 static char *display, *whitestr, *blackstr;
-static char *rootfgstr, *rootbgstr, *imagebgstr, *visualstr;
+static char *rootfgstr, *rootbgstr, *imagebgstr, *visualstr, *resampstr;
+static char *prefetchstr, *tracefile, *invcmapfile;
 static char *monofontname, *flistName;
 #ifdef TV_L10N
 static char **misscharset, *defstr;
@@ -196,6 +197,7 @@ int main(int argc, char **argv)
 	/* if X doesn't support ja_JP.ujis text viewer l10n doesn't work. */
 #endif
 
+  InitThreads();
   xv_getwd(initdir, sizeof(initdir));
   searchdir[0] = '\0';
   fullfname[0] = '\0';
@@ -207,7 +209,7 @@ int main(int argc, char **argv)
   display = NULL;
   fgstr = bgstr = rootfgstr = rootbgstr = imagebgstr = NULL;
   histr = lostr = whitestr = blackstr = NULL;
-  visualstr = monofontname = flistName = NULL;
+  visualstr = monofontname = flistName = resampstr = prefetchstr = NULL;
   winTitle = NULL;
 
   pic = egampic = epic = cpic = origPic = NULL;
@@ -290,7 +292,8 @@ int main(int argc, char **argv)
   resetroot = 1;
   clearonload = 0;
   curstype = XC_top_left_arrow;
-  browseMode = savenorm = nostat = 0;
+  browseMode = savenorm = nostat = noshm = nthreads = 0;
+  cacheMB = 256;  prefetchNext = 2;  prefetchPrev = 1;  dctScale = 0;
   preview = 0;
   pscomp = 0;
   preset = 0;
@@ -315,6 +318,8 @@ int main(int argc, char **argv)
   kludge_offx = kludge_offy = winCtrPosKludge = 0;
 
   conv24 = CONV24_SLOW;  /* use 'slow' algorithm by default */
+  octdither = 1;
+  ordered332 = 0;
 
   defaspect = normaspect = 1.0;
   mainW = dirW = infoW = ctrlW = gamW = psW = (Window) None;
@@ -381,6 +386,8 @@ int main(int argc, char **argv)
   parseOptions( getenv("XV_OPTIONS") );
   parseCmdLine(argc, argv, 1);
   verifyArgs();
+  TraceInit(tracefile);     /* or $XV_TRACE */
+  InvCmapInit(invcmapfile);
 #ifdef AUTO_EXPAND
   Vdinit();
   vd_handler_setup();
@@ -1373,15 +1380,18 @@ static void parseResources(int argc, char **argv)
   if (rd_flag("best24") && def_int)  conv24  = CONV24_BEST;
   if (rd_str ("black"))          blackstr    = def_str;
   if (rd_int ("borderWidth"))    bwidth      = def_int;
+  if (rd_int ("cacheMB"))        cacheMB     = def_int;
   if (rd_str ("ceditGeometry"))  gamgeom     = def_str;
   if (rd_flag("ceditMap"))       gmap        = def_int;
   if (rd_flag("ceditColorMap"))  cmapInGam   = def_int;
   if (rd_flag("clearOnLoad"))    clearonload = def_int;
+  if (rd_str ("cmapCache"))      invcmapfile = def_str;
   if (rd_str ("commentGeometry")) cmtgeom    = def_str;
   if (rd_flag("commentMap"))     cmtmap      = def_int;
   if (rd_str ("ctrlGeometry"))   ctrlgeom    = def_str;
   if (rd_flag("ctrlMap"))        ctrlmap     = def_int;
   if (rd_int ("cursor"))         curstype    = def_int;
+  if (rd_flag("dctScale"))       dctScale    = def_int;
   if (rd_int ("defaultPreset"))  preset      = def_int;
   if (rd_int ("incrementalSearchTimeout"))  incrementalSearchTimeout = def_int;
 
@@ -1441,13 +1451,23 @@ static void parseResources(int argc, char **argv)
   if (rd_flag("nopos"))          nopos       = def_int;
   if (rd_flag("forcegeom]"))     forcegeom   = def_int;
   if (rd_flag("noqcheck"))       noqcheck    = def_int;
+#ifdef HAVE_XSHM
+  if (rd_flag("noshm"))          noshm       = def_int;
+#endif
   if (rd_flag("nostat"))         nostat      = def_int;
+  if (rd_flag("octree24") && def_int)  conv24 = CONV24_OCTREE;
+  if (rd_flag("octreeDither"))   octdither   = def_int;
+  if (rd_flag("ordered"))        ordered332  = def_int;
+  if (rd_flag("ordered24") && def_int)  conv24 = CONV24_ORDERED;
   if (rd_flag("ownCmap"))        owncmap     = def_int;
   if (rd_flag("perfect"))        perfect     = def_int;
 #ifdef HAVE_PIC2
   if (rd_flag("pic2split"))      pic2split   = def_int;
 #endif
   if (rd_flag("popupKludge"))    winCtrPosKludge = def_int;
+#ifdef HAVE_PTHREAD
+  if (rd_str ("prefetch"))       prefetchstr = def_str;
+#endif
   if (rd_str ("print"))          { strncpy(printCmd, def_str, (size_t) PRINTCMDLEN);
                                    printCmd[ PRINTCMDLEN - 1 ] = '\0'; }
   if (rd_flag("pscompress"))     pscomp      = def_int;
@@ -1457,11 +1477,15 @@ static void parseResources(int argc, char **argv)
   if (rd_flag("reverse"))        revvideo    = def_int;
   if (rd_str ("rootBackground")) rootbgstr   = def_str;
   if (rd_str ("rootForeground")) rootfgstr   = def_str;
+  if (rd_str ("resample"))       resampstr   = def_str;
   if (rd_int ("rootMode"))       { rootMode    = def_int;  ++rmodeset; }
   if (rd_flag("rwColor"))        rwcolor     = def_int;
   if (rd_flag("saveNormal"))     savenorm    = def_int;
   if (rd_str ("searchDirectory"))  strcpy(searchdir, def_str);
   if (rd_str ("textviewGeometry")) textgeom  = def_str;
+#ifdef HAVE_PTHREAD
+  if (rd_int ("threads"))        nthreads    = def_int;
+#endif
   if (rd_flag("useStdCmap"))     stdcmap     = def_int;
   if (rd_str ("visual"))         visualstr   = def_str;
 #ifdef VS_ADJUST
@@ -1573,6 +1597,9 @@ static void parseCmdLine(int argc, char **argv, int allow_file_names)
     else if (!argcmp(argv[i],"-bw",3,0,&pm))               /* border width */
       { if (++i<argc) bwidth=atoi(argv[i]); }
 
+    else if (!argcmp(argv[i],"-cachemb",4,0,&pm))         /* image cache */
+      { if (++i<argc) cacheMB = abs(atoi(argv[i])); }
+
     else if (!argcmp(argv[i],"-cecmap",4,1,&cmapInGam));   /* cmapInGam */
 
     else if (!argcmp(argv[i],"-cegeometry",4,0,&pm))       /* gammageom */
@@ -1596,6 +1623,9 @@ static void parseCmdLine(int argc, char **argv, int allow_file_names)
     else if (!argcmp(argv[i],"-close",4,1,&autoclose));	   /* close */
     else if (!argcmp(argv[i],"-cmap", 3,1,&ctrlmap));	   /* ctrlmap */
 
+    else if (!argcmp(argv[i],"-cmapcache",6,0,&pm))	   /* inv cmap file */
+      { if (++i<argc) invcmapfile = argv[i]; }
+
     else if (!argcmp(argv[i],"-cmtgeometry",5,0,&pm))	   /* comment geom */
       { if (++i<argc) cmtgeom = argv[i]; }
 
@@ -1614,6 +1644,8 @@ static void parseCmdLine(int argc, char **argv, int allow_file_names)
     else if (!argcmp(argv[i],"-cursor",3,0,&pm))	   /* cursor */
       { if (++i<argc) curstype = atoi(argv[i]); }
 
+    else if (!argcmp(argv[i],"-dctscale",4,1,&dctScale));  /* small JPEGs */
+
 #ifdef VMS    /* in VMS, cmd-line-opts are in lower case */
     else if (!argcmp(argv[i],"-debug",3,0,&pm)) {
       { if (++i<argc) DEBUG = atoi(argv[i]); }
@@ -1799,8 +1831,19 @@ static void parseCmdLine(int argc, char **argv, int allow_file_names)
     else if (!argcmp(argv[i],"-forcegeom", 6,1,&forcegeom));  /* forcegeom */
     else if (!argcmp(argv[i],"-noqcheck",  4,1,&noqcheck));   /* noqcheck */
     else if (!argcmp(argv[i],"-noresetroot",5,1,&resetroot)); /* reset root */
+#ifdef HAVE_XSHM
+    else if (!argcmp(argv[i],"-noshm",     5,1,&noshm));      /* no MIT-SHM */
+#endif
     else if (!argcmp(argv[i],"-norm",      5,1,&autonorm));   /* norm */
     else if (!argcmp(argv[i],"-nostat",    4,1,&nostat));     /* nostat */
+    else if (!argcmp(argv[i],"-octree24",  3,0,&pm))      /* octree 24->8 */
+      conv24 = CONV24_OCTREE;
+
+    else if (!argcmp(argv[i],"-octdither", 5,1,&octdither));  /* dither it */
+    else if (!argcmp(argv[i],"-ordered",   4,1,&ordered332)); /* std cmap */
+    else if (!argcmp(argv[i],"-ordered24", 9,0,&pm))     /* ordered 24->8 */
+      conv24 = CONV24_ORDERED;
+
     else if (!argcmp(argv[i],"-owncmap",   2,1,&owncmap));    /* own cmap */
 #ifdef HAVE_PCD
     else if (!argcmp(argv[i],"-pcd",       4,0,&pm))         /* pcd with size */
@@ -1812,6 +1855,10 @@ static void parseCmdLine(int argc, char **argv, int allow_file_names)
 #endif
     else if (!argcmp(argv[i],"-pkludge",   3,1,&winCtrPosKludge));
     else if (!argcmp(argv[i],"-poll",      3,1,&polling));    /* chk mod? */
+#ifdef HAVE_PTHREAD
+    else if (!argcmp(argv[i],"-prefetch",5,0,&pm))    /* background loads */
+      { if (++i<argc) prefetchstr = argv[i]; }
+#endif
 
     else if (!argcmp(argv[i],"-preset",3,0,&pm))      /* preset */
       { if (++i<argc) preset=abs(atoi(argv[i])); }
@@ -1826,6 +1873,9 @@ static void parseCmdLine(int argc, char **argv, int allow_file_names)
     else if (!argcmp(argv[i],"-rbg",3,0,&pm))      /* root background color */
       { if (++i<argc) rootbgstr = argv[i]; }
 
+    else if (!argcmp(argv[i],"-resample",4,0,&pm))    /* resample filter */
+      { if (++i<argc) resampstr = argv[i]; }
+
     else if (!argcmp(argv[i],"-rfg",3,0,&pm))      /* root foreground color */
       { if (++i<argc) rootfgstr = argv[i]; }
 
@@ -1855,9 +1905,17 @@ static void parseCmdLine(int argc, char **argv, int allow_file_names)
     else if (!argcmp(argv[i],"-startgrab",3,1,&startGrab)); /* startGrab */
     else if (!argcmp(argv[i],"-stdcmap",3,1,&stdcmap));    /* use stdcmap */
 
+#ifdef HAVE_PTHREAD
+    else if (!argcmp(argv[i],"-threads",3,0,&pm))	   /* # of threads */
+      { if (++i<argc) nthreads = abs(atoi(argv[i])); }
+#endif
+
     else if (!argcmp(argv[i],"-tgeometry",2,0,&pm))	   /* textview geom */
       { if (++i<argc) textgeom = argv[i]; }
 
+    else if (!argcmp(argv[i],"-trace",3,0,&pm))	   /* timing trace file */
+      { if (++i<argc) tracefile = argv[i]; }
+
     else if (!argcmp(argv[i],"-vflip",3,1,&autovflip));	   /* vflip */
     else if (!argcmp(argv[i],"-viewonly",4,1,&viewonly));  /* viewonly */
 
@@ -1977,6 +2035,8 @@ static void verifyArgs(void)
 {
   /* check options for validity */
 
+  int i;
+
   if (strlen(searchdir)) {  /* got a search directory */
 #ifdef AUTO_EXPAND
     if (Chvdir(searchdir)) {
@@ -2000,6 +2060,27 @@ static void verifyArgs(void)
   if (hexpand == 0.0 || vexpand == 0.0) cmdSyntax(1);
   if (rootMode < 0 || rootMode > RM_MAX) rmodeSyntax();
 
+  if (resampstr) {
+    resampFilter = ResampleFilterNum(resampstr);
+    if (resampFilter < 0) {
+      fprintf(stderr,"%s: unknown resample filter '%s'.  ", cmd, resampstr);
+      fprintf(stderr,"Use 'lanczos', 'mitchell' or 'catrom'\n");
+      Quit(1);
+    }
+    autoresamp = 1;
+  }
+
+  if (prefetchstr) {
+    prefetchNext = prefetchPrev = 0;
+    i = sscanf(prefetchstr, "%d,%d", &prefetchNext, &prefetchPrev);
+    if (i == 1) prefetchPrev = (prefetchNext > 0);
+    if (i < 1 || prefetchNext < 0 || prefetchPrev < 0) {
+      fprintf(stderr,"%s: bad '-prefetch' value '%s'.  ", cmd, prefetchstr);
+      fprintf(stderr,"Use '-prefetch next[,prev]', e.g. '-prefetch 2,1'\n");
+      Quit(1);
+    }
+  }
+
   if (DEBUG) XSynchronize(theDisp, True);
 
   /* if using root, generally gotta map ctrl window, 'cause there won't be
@@ -2100,6 +2181,7 @@ static void cmdSyntax(int i)
   printoption("[-bg color]");
   printoption("[-black color]");
   printoption("[-bw width]");
+  printoption("[-cachemb #]");
   printoption("[-/+cecmap]");
   printoption("[-cegeometry geom]");
   printoption("[-/+cemap]");
@@ -2108,10 +2190,12 @@ static void cmdSyntax(int i)
   printoption("[-/+clear]");
   printoption("[-/+close]");
   printoption("[-/+cmap]");
+  printoption("[-cmapcache file]");
   printoption("[-cmtgeometry geom]");
   printoption("[-/+cmtmap]");
   printoption("[-crop x y w h]");
   printoption("[-cursor char#]");
+  printoption("[-/+dctscale]");
 
 #ifndef VMS
   printoption("[-DEBUG level]");
@@ -2178,8 +2262,15 @@ static void cmdSyntax(int i)
   printoption("[-/+forcegeom]");
   printoption("[-/+noqcheck]");
   printoption("[-/+noresetroot]");
+#ifdef HAVE_XSHM
+  printoption("[-/+noshm]");
+#endif
   printoption("[-/+norm]");
   printoption("[-/+nostat]");
+  printoption("[-octree24]");
+  printoption("[-/+octdither]");
+  printoption("[-/+ordered]");
+  printoption("[-ordered24]");
   printoption("[-/+owncmap]");
 #ifdef HAVE_PCD
   printoption("[-pcd size(0=192*128,1,2,3,4=3072*2048)]");
@@ -2190,6 +2281,9 @@ static void cmdSyntax(int i)
 #endif
   printoption("[-/+pkludge]");
   printoption("[-/+poll]");
+#ifdef HAVE_PTHREAD
+  printoption("[-prefetch next[,prev]]");
+#endif
   printoption("[-preset #]");
   printoption("[-quick24]");
   printoption("[-/+quit]");
@@ -2199,6 +2293,7 @@ static void cmdSyntax(int i)
   printoption("[-rfg color]");
   printoption("[-/+rgb]");
   printoption("[-RM]");
+  printoption("[-resample lanczos|mitchell|catrom]");
   printoption("[-rmode #]");
   printoption("[-/+root]");
   printoption("[-rotate deg]");
@@ -2208,7 +2303,11 @@ static void cmdSyntax(int i)
   printoption("[-/+smooth]");
   printoption("[-/+startgrab]");
   printoption("[-/+stdcmap]");
+#ifdef HAVE_PTHREAD
+  printoption("[-threads #]");
+#endif
   printoption("[-tgeometry geom]");
+  printoption("[-trace file]");
   printoption("[-/+vflip]");
   printoption("[-/+viewonly]");
   printoption("[-visual type]");
@@ -2286,6 +2385,22 @@ static int openPic(int filenum)
    * returns 0 on failure (cleans up after itself)
    * returns '-1' if caller should display DFLTPIC  (shown as text)
    * if successful, returns 1, creates mainW
+   */
+
+  int rv;
+
+  TraceBegin("openPic", (filenum >= 0 && filenum < numnames) ?
+	     namelist[filenum] : (const char *) NULL);
+  rv = doOpenPic(filenum);
+  TraceEnd("openPic");
+  return rv;
+}
+
+
+/***********************************/
+static int doOpenPic(int filenum)
+{
+  /* does the work for openPic()
    *
    * By the way, I'd just like to point out that this procedure has gotten
    * *way* out of hand...
@@ -2293,6 +2408,8 @@ static int openPic(int filenum)
 
   PICINFO pinfo;
   int   i,filetype,freename, frompipe, frompoll, fromint, killpage;
+  int   cacheable, cachenew, page;
+  PICINFO origpinfo;
   int   oldeWIDE, oldeHIGH, oldpWIDE, oldpHIGH;
   int   oldCXOFF, oldCYOFF, oldCWIDE, oldCHIGH, wascropped;
   char *tmp;
@@ -2315,6 +2432,7 @@ static int openPic(int filenum)
 
   normaspect = defaspect;
   freename = dfltkludge = frompipe = frompoll = fromint = wascropped = 0;
+  cachenew = page = 0;
   oldpWIDE = oldpHIGH = oldCXOFF = oldCYOFF = oldCWIDE = oldCHIGH = 0;
   oldeWIDE = eWIDE;  oldeHIGH = eHIGH;
   fullname = NULL;
@@ -2729,7 +2847,30 @@ ms_auto_no:
 
   SetISTR(ISTR_INFO,"Loading...");
 
-  i = ReadPicFile(filename, filetype, &pinfo, 0);
+  /* it may well have been decoded already, either in the background, or
+     the last time it was looked at.  Not if it's a /tmp file, though */
+  cacheable = (fullname && strcmp(fullname, filename) == 0);
+#ifdef HAVE_PCD
+  /* not if the PCD dialog is going to ask which size to load */
+  if (filetype == RFT_PCD && PcdSize < 0) cacheable = 0;
+#endif
+  page = (filenum == OP_PAGEDN || filenum == OP_PAGEUP) ? curPage+1 : 0;
+
+  if (cacheable && (fromint || frompoll)) CacheForget(filename);
+  if (cacheable) PrefetchWait(filename);
+
+  /* big JPEGs can be decoded at (about) the size they'll be shown at */
+  if (cacheable && !frompoll && !page)
+    ReducedLoadSize(&pinfo.loadw, &pinfo.loadh);
+
+  /* a freshly loaded pic is cached further down, once we know if we're
+     going to be keeping it as it is (see xvcache.c) */
+  if (cacheable && CacheGet(filename, 0, page, &pinfo)) i = 1;
+  else {
+    i = ReadPicFile(filename, filetype, &pinfo, 0);
+    cachenew = (i && cacheable);
+  }
+  ProbeRelease();
 
   if (filetype == RFT_XBM && (!i || pinfo.w==0 || pinfo.h==0)) {
     /* probably just a '.h' file or something... */
@@ -2784,9 +2925,12 @@ ms_auto_no:
   if (conv24MB.flags[CONV24_LOCK]) {  /* locked */
     if (pinfo.type==PIC24 && picType==PIC8) {           /* 24 -> 8 bit */
       byte *pic8;
+      origpinfo = pinfo;
       pic8 = Conv24to8(pinfo.pic, pinfo.w, pinfo.h, ncols,
 		       pinfo.r, pinfo.g, pinfo.b);
-      free(pinfo.pic);
+      if (cachenew) CachePut(filename, 0, page, &origpinfo, CACHE_TAKEPIC);
+      else free(origpinfo.pic);
+      cachenew = 0;
       pinfo.pic = pic8;
       pinfo.type = PIC8;
 
@@ -2795,9 +2939,12 @@ ms_auto_no:
 
     else if (pinfo.type!=PIC24 && picType==PIC24) {    /* 8 -> 24 bit */
       byte *pic24;
+      origpinfo = pinfo;
       pic24 = Conv8to24(pinfo.pic, pinfo.w, pinfo.h,
 			pinfo.r, pinfo.g, pinfo.b);
-      free(pinfo.pic);
+      if (cachenew) CachePut(filename, 0, page, &origpinfo, CACHE_TAKEPIC);
+      else free(origpinfo.pic);
+      cachenew = 0;
       pinfo.pic  = pic24;
       pinfo.type = PIC24;
     }
@@ -2849,11 +2996,16 @@ ms_auto_no:
   KillOldPics();
   SetInfoMode(INF_STR);
 
+  /* we're keeping the pic as it is, so the cache gets a copy, if it's not
+     too big.  (Done now, so that it isn't alongside the old pic) */
+  if (cachenew) CachePut(filename, 0, page, &pinfo, CACHE_COPY);
+
 
   /* get info out of the PICINFO struct */
   pic   = pinfo.pic;
   pWIDE = pinfo.w;
   pHIGH = pinfo.h;
+  reducedPic = 0;    /* (set below, once the auto-whatevers are done) */
   if (pinfo.frmType >=0) SetDirSaveMode(F_FORMAT, pinfo.frmType);
   if (pinfo.colType >=0) SetDirSaveMode(F_COLORS, pinfo.colType);
 
@@ -2900,7 +3052,10 @@ ms_auto_no:
   else
     SetISTR(ISTR_FILENAME, "%s", basefname);
 
-  SetISTR(ISTR_RES,"%d x %d",pWIDE,pHIGH);
+  if (pinfo.reduced > 1)
+    SetISTR(ISTR_RES,"%d x %d  (1/%d size)",pWIDE,pHIGH,pinfo.reduced);
+  else
+    SetISTR(ISTR_RES,"%d x %d",pWIDE,pHIGH);
   SetISTR(ISTR_COLOR, "");
   SetISTR(ISTR_COLOR2,"");
 
@@ -3111,7 +3266,8 @@ ms_auto_no:
 
     /* if -smooth or image has been shrunk to fit screen */
     if (autosmooth || (pWIDE >maxWIDE || pHIGH>maxHIGH)
-	           || (cWIDE != eWIDE || cHIGH != eHIGH)) epicMode = EM_SMOOTH;
+	           || (cWIDE != eWIDE || cHIGH != eHIGH))
+      epicMode = (autoresamp) ? EM_RESAMP : EM_SMOOTH;
 
     if (autoraw) epicMode = EM_RAW;
 
@@ -3148,10 +3304,17 @@ ms_auto_no:
   if (useroot) mainW = vrootW;
   if (eWIDE != cWIDE || eHIGH != cHIGH) epic = (byte *) NULL;
 
+  TraceBegin("NewPicGetColors", (const char *) NULL);
   NewPicGetColors(autonorm, autohisteq);
+  TraceEnd("NewPicGetColors");
 
+  TraceBegin("GenerateEpic", (const char *) NULL);
   GenerateEpic(eWIDE, eHIGH);     /* want to dither *after* color allocs */
+  TraceEnd("GenerateEpic");
+
+  TraceBegin("CreateXImage", (const char *) NULL);
   CreateXImage();
+  TraceEnd("CreateXImage");
 
   WaitCursor();
   HandleDispMode();   /* create root pic, or mainW, depending... */
@@ -3199,6 +3362,15 @@ ms_auto_no:
     GenExpose(mainW, 0, 0, (u_int) eWIDE, (u_int) eHIGH);
   }
 
+  /* remember where to get the rest of it from, if it's wanted */
+  if (pinfo.reduced > 1 && picType == PIC24) {
+    reducedPic = pinfo.reduced;
+    strcpy(reducedName, filename);
+  }
+
+  /* start decoding its neighbors while this one's being looked at */
+  if (filenum >= 0 && filenum < numnames) PrefetchNear(filenum);
+
   return 1;
 
 
@@ -3229,573 +3401,112 @@ ms_auto_no:
 }
 
 
-extern byte ZXheader[128];	/* [JCE] Spectrum screen magic number is
-                                  defined in xvzx.c */
-
-
 /********************************/
-int ReadFileType(char *fname)
+int ReducedLoadSize(int *wp, int *hp)
 {
-  /* opens fname (which *better* be an actual file by this point!) and
-     reads the first couple o' bytes.  Figures out what the file's likely
-     to be, and returns the appropriate RFT_*** code */
-
-
-  FILE *fp;
-  byte  magicno[30];    /* first 30 bytes of file */
-  int   rv=RFT_UNKNOWN, n;
-#ifdef MACBINARY
-  int   macbin_alrchk = False;
-#endif
-
-  if (!fname) return RFT_ERROR;   /* shouldn't happen */
-
-  fp = xv_fopen(fname, "r");
-  if (!fp) return RFT_ERROR;
-
-  if (strlen(fname) > 4 &&
-      strcasecmp(fname+strlen(fname)-5, ".wbmp")==0)          rv = RFT_WBMP;
-
-  n = fread(magicno, (size_t) 1, sizeof(magicno), fp);
-  fclose(fp);
-
-  if (n<=0) return RFT_UNKNOWN;
-
-  /* it is just barely possible that a few files could legitimately be as small
-     as 30 bytes (e.g., binary P{B,G,P}M format), so zero out rest of "magic
-     number" buffer and don't quit immediately if we read something small but
-     not empty */
-  if (n<30) memset(magicno+n, 0, sizeof(magicno)-n);
-
-#ifdef MACBINARY
-  macb_file = False;
-  while (1) {
-#endif
-
-#ifdef HAVE_MGCSFX
-  if (is_mgcsfx(fname, magicno, 30) != 0) rv = RFT_MGCSFX;
-  else
-#endif
-       if (strncmp((char *) magicno,"GIF87a", (size_t) 6)==0 ||
-	   strncmp((char *) magicno,"GIF89a", (size_t) 6)==0) rv = RFT_GIF;
-
-  else if (strncmp((char *) magicno,"VIEW", (size_t) 4)==0 ||
-	   strncmp((char *) magicno,"WEIV", (size_t) 4)==0)   rv = RFT_PM;
-
-#ifdef HAVE_PIC2
-  else if (magicno[0]=='P' && magicno[1]=='2' &&
-	   magicno[2]=='D' && magicno[3]=='T')                rv = RFT_PIC2;
-#endif
-
-  else if (magicno[0] == 'P' && magicno[1]>='1' &&
-	   (magicno[1]<='6' || magicno[1]=='8'))              rv = RFT_PBM;
-
-  /* note: have to check XPM before XBM, as first 2 chars are the same */
-  else if (strncmp((char *) magicno, "/* XPM */", (size_t) 9)==0) rv = RFT_XPM;
-
-  else if (strncmp((char *) magicno,"#define", (size_t) 7)==0 ||
-	   (magicno[0] == '/' && magicno[1] == '*'))          rv = RFT_XBM;
-
-  else if (magicno[0]==0x59 && (magicno[1]&0x7f)==0x26 &&
-	   magicno[2]==0x6a && (magicno[3]&0x7f)==0x15)       rv = RFT_SUNRAS;
-
-  else if (magicno[0] == 'B' && magicno[1] == 'M')            rv = RFT_BMP;
-
-  else if (magicno[0]==0x52 && magicno[1]==0xcc)              rv = RFT_UTAHRLE;
-
-  else if ((magicno[0]==0x01 && magicno[1]==0xda) ||
-	   (magicno[0]==0xda && magicno[1]==0x01))            rv = RFT_IRIS;
-
-  else if (magicno[0]==0x1f && magicno[1]==0x9d)              rv = RFT_COMPRESS;
-
-#ifdef GUNZIP
-  else if (magicno[0]==0x1f && magicno[1]==0x8b)              rv = RFT_COMPRESS;
-#endif
-
-#ifdef BUNZIP2
-  else if (magicno[0]==0x42 && magicno[1]==0x5a)              rv = RFT_BZIP2;
-#endif
-
-#ifdef XZ
-  else if (magicno[0]==0xfd &&
-           magicno[1]=='7' && magicno[2]=='z' &&
-           magicno[3]=='X' && magicno[4]=='Z')                rv = RFT_XZ;
-#endif
-
-  else if (magicno[0]==0x0a && magicno[1] <= 5)               rv = RFT_PCX;
-
-  else if (strncmp((char *) magicno,   "FORM", (size_t) 4)==0 &&
-	   strncmp((char *) magicno+8, "ILBM", (size_t) 4)==0) rv = RFT_IFF;
-
-  else if (magicno[0]==0 && magicno[1]==0 &&
-	   magicno[2]==2 && magicno[3]==0 &&
-	   magicno[4]==0 && magicno[5]==0 &&
-	   magicno[6]==0 && magicno[7]==0)                    rv = RFT_TARGA;
-
-  else if (magicno[4]==0x00 && magicno[5]==0x00 &&
-	   magicno[6]==0x00 && magicno[7]==0x07)              rv = RFT_XWD;
-
-  else if (strncmp((char *) magicno,"SIMPLE  ", (size_t) 8)==0 &&
-	   magicno[29] == 'T')                                rv = RFT_FITS;
-
-  /* [JCE] Spectrum screen */
-  else if (memcmp(magicno, ZXheader, (size_t) 18)==0)         rv = RFT_ZX;
-
-#ifdef HAVE_JPEG
-  else if (magicno[0]==0xff && magicno[1]==0xd8 &&
-	   magicno[2]==0xff)                                  rv = RFT_JFIF;
-#endif
-
-#ifdef HAVE_JP2K
-  else if (magicno[0]==0xff && magicno[1]==0x4f &&
-           magicno[2]==0xff && magicno[3]==0x51)              rv = RFT_JPC;
-
-  else if (memcmp(magicno, jp2k_magic, sizeof(jp2k_magic))==0) rv = RFT_JP2;
-#endif
-
-#ifdef HAVE_TIFF
-  else if ((magicno[0]=='M' && magicno[1]=='M') ||
-	   (magicno[0]=='I' && magicno[1]=='I'))              rv = RFT_TIFF;
-#endif
-
-#ifdef HAVE_PNG
-  else if (magicno[0]==0x89 && magicno[1]=='P' &&
-           magicno[2]=='N'  && magicno[3]=='G')               rv = RFT_PNG;
-#endif
-
-#ifdef HAVE_WEBP
-  else if (magicno[0]=='R'  && magicno[1]=='I' &&
-           magicno[2]=='F'  && magicno[3]=='F' &&
-           magicno[8]=='W'  && magicno[9]=='E' &&
-           magicno[10]=='B' && magicno[11]=='P')               rv = RFT_WEBP;
-#endif
-
-#ifdef HAVE_PDS
-  else if (strncmp((char *) magicno,  "NJPL1I00", (size_t) 8)==0 ||
-	   strncmp((char *) magicno+2,"NJPL1I",   (size_t) 6)==0 ||
-           strncmp((char *) magicno,  "CCSD3ZF",  (size_t) 7)==0 ||
-	   strncmp((char *) magicno+2,"CCSD3Z",   (size_t) 6)==0 ||
-	   strncmp((char *) magicno,  "LBLSIZE=", (size_t) 8)==0)
-      rv = RFT_PDSVICAR;
-#endif
-
-#ifdef GS_PATH   /* Ghostscript handles both PostScript and PDF */
-  else if (strncmp((char *) magicno, "%!",     (size_t) 2)==0 ||
-	   strncmp((char *) magicno, "\004%!", (size_t) 3)==0 ||
-           strncmp((char *) magicno, "%PDF",   (size_t) 4)==0) rv = RFT_PS;
-#endif
-
-#ifdef HAVE_MAG
-  else if (strncmp((char *) magicno,"MAKI02  ", (size_t) 8)==0) rv = RFT_MAG;
-#endif
-
-#ifdef HAVE_MAKI
-  else if (strncmp((char *) magicno,"MAKI01A ", (size_t) 8)==0 ||
-	   strncmp((char *) magicno,"MAKI01B ", (size_t) 8)==0) rv = RFT_MAKI;
-#endif
-
-#ifdef HAVE_PIC
-  else if (magicno[0]=='P' && magicno[1]=='I'&&magicno[2]=='C') rv = RFT_PIC;
-#endif
-
-#ifdef HAVE_PI
-  else if (magicno[0]=='P' && magicno[1]=='i')                rv = RFT_PI;
-#endif
-
-#ifdef HAVE_HIPS
-  else if (strstr((char *) magicno, "./digest"))              rv = RFT_HIPS;
-#endif
-
-#ifdef HAVE_PCD
-  else if (magicno[0]==0xff && magicno[1]==0xff &&
-           magicno[2]==0xff && magicno[3]==0xff)              rv = RFT_PCD;
-#endif
+  /* with '-dctscale', big JPEGs get decoded at a reduced size, no smaller
+     than what they'll be shown at.  That's only known in advance when the
+     image is going to be shown at its normal size, shrunk (keeping its
+     aspect ratio) to fit on the screen, if need be.  If that's the case,
+     returns '1', and the size it'll be shrunk to fit into in wp,hp.
+     Otherwise, sets them to '0' and returns '0' */
+
+  *wp = *hp = 0;
+
+  if (!dctScale) return 0;
+  if (revvideo) return 0;     /* FullResPic() would lose the inversion */
+  if (hexpand != 1.0 || vexpand != 1.0 || maingeom || defaspect != 1.0 ||
+      auto4x3 || autocrop || acrop || autorotate || autohflip || autovflip)
+    return 0;
+  if (automax && !fixedaspect) return 0;               /* stretched */
+  if (conv24MB.flags[CONV24_LOCK] && picType == PIC8) return 0;
 
-#ifdef HAVE_G3
-  else if ((magicno[0]==  1 && magicno[1]==  1 &&
-            magicno[2]== 77 && magicno[3]==154 &&
-            magicno[4]==128 && magicno[5]==  0 &&
-            magicno[6]==  1 && magicno[7]== 77) ||
-            (rv == RFT_UNKNOWN &&
-             (highresfax || lowresfax || (strlen(fname)>3 && !strcmp(fname+strlen(fname)-3,".g3"))))) {
-               rv = RFT_G3;
+  *wp = maxWIDE;  *hp = maxHIGH;
+  if (automax) {
+    if (dispWIDE < *wp) *wp = dispWIDE;
+    if (dispHIGH < *hp) *hp = dispHIGH;
   }
-#endif
-
-#ifdef MACBINARY
-    /* Now we try to handle MacBinary files, but the method is VERY dirty... */
-    if (macbin_alrchk == True) {
-      macb_file = True;
-      break;
-    }
-
-    if (rv != RFT_UNKNOWN)
-      break;
 
-    /* Skip MACBSIZE and recheck */
-    macbin_alrchk = True;
-    fp = xv_fopen(fname, "r");
-    if (!fp) return RFT_ERROR;
-    fseek(fp, MACBSIZE, SEEK_SET);
-    n = fread(magicno, (size_t) 1, (size_t) 30, fp);
-    fclose(fp);
-
-    if (n<30) return RFT_UNKNOWN;    /* files less than 30 bytes long... */
-  }
-#endif
-  return rv;
+  return 1;
 }
 
 
-
 /********************************/
-int ReadPicFile(char *fname, int ftype, PICINFO *pinfo, int quick)
+int FullResPic(void)
 {
-  /* if quick is set, we're being called to generate icons, or something
-     like that.  We should load the image as quickly as possible.  Previously,
-     this affected only the LoadPS routine, which, if quick is set, only
-     generates the page file for the first page of the document.  Now it
-     also affects PCD, which loads only a thumbnail. */
-
-  int rv = 0;
-
-  /* by default, most formats aren't multi-page */
-  pinfo->numpages = 1;
-  pinfo->pagebname[0] = '\0';
-
-  switch (ftype) {
-  case RFT_GIF:     rv = LoadGIF   (fname, pinfo);         break;
-  case RFT_PM:      rv = LoadPM    (fname, pinfo);         break;
-#ifdef HAVE_MGCSFX
-  case RFT_PBM:     rv = LoadPBM   (fname, pinfo, -1);     break;
-#else
-  case RFT_PBM:     rv = LoadPBM   (fname, pinfo);         break;
-#endif
-  case RFT_XBM:     rv = LoadXBM   (fname, pinfo);         break;
-  case RFT_SUNRAS:  rv = LoadSunRas(fname, pinfo);         break;
-  case RFT_BMP:     rv = LoadBMP   (fname, pinfo);         break;
-  case RFT_UTAHRLE: rv = LoadRLE   (fname, pinfo);         break;
-  case RFT_IRIS:    rv = LoadIRIS  (fname, pinfo);         break;
-  case RFT_PCX:     rv = LoadPCX   (fname, pinfo);         break;
-  case RFT_IFF:     rv = LoadIFF   (fname, pinfo);         break;
-  case RFT_TARGA:   rv = LoadTarga (fname, pinfo);         break;
-  case RFT_XPM:     rv = LoadXPM   (fname, pinfo);         break;
-  case RFT_XWD:     rv = LoadXWD   (fname, pinfo);         break;
-  case RFT_FITS:    rv = LoadFITS  (fname, pinfo, quick);  break;
-  case RFT_ZX:      rv = LoadZX    (fname, pinfo);         break; /* [JCE] */
-  case RFT_WBMP:    rv = LoadWBMP  (fname, pinfo);         break;
-
-#ifdef HAVE_PCD
-  /* if quick is switched on, use the smallest image size; don't ask the user */
-  case RFT_PCD:     rv = LoadPCD   (fname, pinfo, quick ? 0 : PcdSize);  break;
-#endif
-
-#ifdef HAVE_JPEG
-  case RFT_JFIF:    rv = LoadJFIF  (fname, pinfo, quick);  break;
-#endif
-
-#ifdef HAVE_JP2K
-  case RFT_JPC:     rv = LoadJPC   (fname, pinfo, quick);  break;
-  case RFT_JP2:     rv = LoadJP2   (fname, pinfo, quick);  break;
-#endif
-
-#ifdef HAVE_TIFF
-  case RFT_TIFF:    rv = LoadTIFF  (fname, pinfo, quick);  break;
-#endif
-
-#ifdef HAVE_PNG
-  case RFT_PNG:     rv = LoadPNG   (fname, pinfo);         break;
-#endif
-
-#ifdef HAVE_WEBP
-  case RFT_WEBP:     rv = LoadWEBP (fname, pinfo);       break;
-#endif
-
-#ifdef HAVE_PDS
-  case RFT_PDSVICAR: rv = LoadPDS  (fname, pinfo);         break;
-#endif
-
-#ifdef HAVE_G3
-  case RFT_G3:      rv = LoadG3    (fname, pinfo);         break;
-#endif
-
-#ifdef GS_PATH
-  case RFT_PS:      rv = LoadPS    (fname, pinfo, quick);  break;
-#endif
-
-#ifdef HAVE_MAG
-  case RFT_MAG:     rv = LoadMAG   (fname, pinfo);         break;
-#endif
-
-#ifdef HAVE_MAKI
-  case RFT_MAKI:    rv = LoadMAKI  (fname, pinfo);         break;
-#endif
+  /* if 'pic' was decoded at a reduced size, replaces it with the full-size
+     image.  The crop rectangle is scaled up to match, and eWIDE,eHIGH stay
+     the same.  Called before anything that wants more detail than a
+     reduced pic has, or that's going to change pic (after which it
+     couldn't be swapped out).  Returns '0' if it couldn't be done, in which
+     case we're stuck with the reduced pic from here on */
 
-#ifdef HAVE_PIC
-  case RFT_PIC:     rv = LoadPIC   (fname, pinfo);         break;
-#endif
-
-#ifdef HAVE_PI
-  case RFT_PI:      rv = LoadPi    (fname, pinfo);         break;
-#endif
-
-#ifdef HAVE_PIC2
-  case RFT_PIC2:    rv = LoadPIC2  (fname, pinfo, quick);  break;
-#endif
-
-#ifdef HAVE_HIPS
-  case RFT_HIPS:    rv = LoadHIPS  (fname, pinfo);         break;
-#endif
-
-#ifdef HAVE_MGCSFX
-  case RFT_MGCSFX:  rv = LoadMGCSFX (fname, pinfo);        break;
-#endif
+  PICINFO pinfo;
+  int     i, d, ew, eh, cx, cy, cw, ch, cropped, hadepic;
+  double  sx, sy;
 
-  }
+  if (reducedPic <= 1) return 1;
 
-  reorient_image(pinfo);
-  return rv;
-}
+  d = reducedPic;
+  reducedPic = 0;                /* whatever happens, only try it once */
 
-/********************************/
-char *QuoteFileName(char *safe_name, const char *orig_name, int max_len)
-{
-  /* Returns a quoted version of orig_name safe for use in command lines. */
-  /* The return value is safe_name to simplify use in sprintf calls. */
-  /* safe_name should be at least 3 * length(orig_name) + 4 */
-  /* Use XV_MAXQUOTEDPATHLEN */
-
-  int i, len;
+  xvbzero((char *) &pinfo, sizeof(PICINFO));
+  pinfo.numpages    = 1;
+  pinfo.orientation = ORIENT_NONE;
 
-  if (max_len < 10) {
-    fprintf(stderr, "Error quoting file name\n");
-    Quit(1);
-    return NULL;
-  }
+  WaitCursor();
+  SetISTR(ISTR_INFO,"Loading full-size image...");
 
-  len = 0;
-  safe_name[ len++ ] = XV_SINGLE_QUOTE;
-  i = 0;
-  while (orig_name[i] != '\0' && len + 4 < max_len) {
-    if (orig_name[i] == XV_SINGLE_QUOTE) {
-      if (len < max_len) safe_name[ len++ ] = XV_SINGLE_QUOTE;
-      while (orig_name[i] == XV_SINGLE_QUOTE && len + 4 < max_len) {
-        if (len < max_len) safe_name[ len++ ] = '\\';
-        if (len < max_len) safe_name[ len++ ] = XV_SINGLE_QUOTE;
-        i++;
-      }
-      if (len < max_len) safe_name[ len++ ] = XV_SINGLE_QUOTE;
-    } else {
-      if (len < max_len) safe_name[ len++ ] = orig_name[ i ];
-      i++;
-    }
+  i = CacheGet(reducedName, 0, 0, &pinfo);
+  if (!i) {
+    i = ReadPicFile(reducedName, RFT_JFIF, &pinfo, 0);
+    if (i) CachePut(reducedName, 0, 0, &pinfo, CACHE_COPY);
   }
 
-  safe_name[ len++ ] = XV_SINGLE_QUOTE;
-  safe_name[ len ] = '\0';
-
-  return safe_name;
-}
-
-/********************************/
-int UncompressFile(char *name, char *uncompname, int filetype)
-{
-  /* returns '1' on success, with name of uncompressed file in uncompname
-     returns '0' on failure */
-
-  char namez[128], *fname, buf[ 512 + 2 * XV_MAXQUOTEDPATHLEN ];
-  char quoted_name[ XV_MAXQUOTEDPATHLEN ], quoted_uncompname[ XV_MAXQUOTEDPATHLEN ];
-#ifndef USE_MKSTEMP
-  int tmpfd;
-#endif
-
-  fname = name;
-  namez[0] = '\0';
-
-
-#if !defined(VMS) && !defined(GUNZIP)
-  /* see if compressed file name ends with '.Z'.  If it *doesn't* we need
-     temporarily rename it so it *does*, uncompress it, and rename *back*
-     to what it was.  necessary because uncompress doesn't handle files
-     that don't end with '.Z' */
-
-  if (strlen(name) >= (size_t) 2            &&
-      strcmp(name + strlen(name)-2,".Z")!=0 &&
-      strcmp(name + strlen(name)-2,".z")!=0) {
-    strcpy(namez, name);
-    strcat(namez,".Z");
-
-    if (rename(name, namez) < 0) {
-      sprintf(buf, "Error renaming '%s' to '%s':  %s",
-	      name, namez, ERRSTR(errno));
-      ErrPopUp(buf, "\nBummer!");
-      return 0;
-    }
-
-    fname = namez;
+  /* make sure it's still the same image */
+  if (i && (pinfo.type != PIC24 || picType != PIC24 ||
+	    (pinfo.w + d-1) / d != pWIDE || (pinfo.h + d-1) / d != pHIGH)) {
+    free(pinfo.pic);
+    i = 0;
   }
-#endif   /* not VMS and not GUNZIP */
 
+  if (pinfo.comment)  free(pinfo.comment);     /* already have these */
+  if (pinfo.exifInfo) free(pinfo.exifInfo);
 
-#ifndef VMS
-  sprintf(uncompname, "%s/xvuXXXXXX", tmpdir);
-#else
-  strcpy(uncompname, "[]xvuXXXXXX");
-#endif
-
-#ifdef USE_MKSTEMP
-  close(mkstemp(uncompname));
-#else
-  mktemp(uncompname);
-  tmpfd = open(uncompname,O_WRONLY|O_CREAT|O_EXCL,S_IRWUSR);
-  if (tmpfd < 0) FatalError("UncompressFile(): can't create temporary file");
-  close(tmpfd);
-#endif
-
-  /* FIXME: need to replace any ticks in filename (with the
-   * ugly sequence '\"'\"' because backslash won't work inside
-   * single quotes) before calling system().  Maybe one of the
-   * exec() variants would be better...
-   */
-  /* QuoteFileName handles single quotes.
-   * It also adds the outer quotes for flexibility for more efficient quoting or other operating systems.
-   */
-  buf[0] = '\0';
-#ifndef VMS
-  if (filetype == RFT_COMPRESS)
-    sprintf(buf,"%s -c %s > %s", UNCOMPRESS, QuoteFileName(quoted_name, fname, XV_MAXQUOTEDPATHLEN), QuoteFileName(quoted_uncompname, uncompname, XV_MAXQUOTEDPATHLEN));
-# ifdef BUNZIP2
-  else if (filetype == RFT_BZIP2)
-    sprintf(buf,"%s -c %s > %s", BUNZIP2, QuoteFileName(quoted_name, fname, XV_MAXQUOTEDPATHLEN), QuoteFileName(quoted_uncompname, uncompname, XV_MAXQUOTEDPATHLEN));
-# endif
-# ifdef XZ
-  else if (filetype == RFT_XZ)
-    sprintf(buf,"%s -c %s > %s", XZ, QuoteFileName(quoted_name, fname, XV_MAXQUOTEDPATHLEN), QuoteFileName(quoted_uncompname, uncompname, XV_MAXQUOTEDPATHLEN));
-# endif
-#else /* it IS VMS */
-  /* QuoteFileName currently doesn't know the quote rules for VMS */
-  /* VMS uses double quotes around the file name. */
-  /* Use two double quotes for an embedded double quote. */
-  /* It might depend if the CLI is DCL or a shell. */
-# ifdef GUNZIP
-  sprintf(buf,"%s '%s' '%s'", UNCOMPRESS, fname, uncompname);
-# else
-  sprintf(buf,"%s '%s'", UNCOMPRESS, fname);
-# endif
-#endif
-
-  SetISTR(ISTR_INFO, "Uncompressing '%s'...", BaseName(fname));
-#ifndef VMS
-  if (system(buf))
-#else
-  if (!system(buf))
-#endif
-  {
-    SetISTR(ISTR_INFO, "Unable to uncompress '%s'.", BaseName(fname));
-    Warning();
+  if (!i) {
+    SetISTR(ISTR_INFO,"Couldn't load full-size image.");
     return 0;
   }
 
-#ifndef VMS
-  /* if we renamed the file to end with a .Z for the sake of 'uncompress',
-     rename it back to what it once was... */
-
-  if (strlen(namez)) {
-    if (rename(namez, name) < 0) {
-      sprintf(buf, "Error renaming '%s' to '%s':  %s",
-	      namez, name, ERRSTR(errno));
-      ErrPopUp(buf, "\nBummer!");
-    }
-  }
-#else
-  /*
-    sprintf(buf,"Rename %s %s", fname, uncompname);
-    SetISTR(ISTR_INFO,"Renaming '%s'...", fname);
-    if (!system(buf)) {
-    SetISTR(ISTR_INFO,"Unable to rename '%s'.", fname);
-    Warning();
-    return 0;
-    }
-   */
-#endif /* not VMS */
-
-  return 1;
-}
 
+  if (HaveSelection()) EnableSelection(0);    /* it's in the old coords */
 
-#ifdef MACBINARY
-/********************************/
-int RemoveMacbinary(src, dst)
-     char *src, *dst;
-{
-  char buffer[8192]; /* XXX */
-  int n, eof;
-#ifndef USE_MKSTEMP
-  int tmpfd;
-#endif
-  FILE *sfp, *dfp;
+  sx = ((double) pinfo.w) / pWIDE;
+  sy = ((double) pinfo.h) / pHIGH;
+  cropped = (cpic != pic);
+  cx = (int) (cXOFF * sx + 0.5);   cy = (int) (cYOFF * sy + 0.5);
+  cw = (int) (cWIDE * sx + 0.5);   ch = (int) (cHIGH * sy + 0.5);
 
-  sprintf(dst, "%s/xvmXXXXXX", tmpdir);
-#ifdef USE_MKSTEMP
-  close(mkstemp(dst));
-#else
-  mktemp(dst);
-  tmpfd = open(dst,O_WRONLY|O_CREAT|O_EXCL,S_IRWUSR);
-  if (tmpfd < 0) FatalError("RemoveMacbinary(): can't create temporary file");
-#endif
+  ew = eWIDE;  eh = eHIGH;
+  hadepic = (epic != NULL || epicTiled);
 
-  SetISTR(ISTR_INFO, "Removing MacBinary...");
+  FreeEpic();  FreePyramid();
+  if (cpic && cpic != pic) free(cpic);
+  free(pic);
 
-  sfp = xv_fopen(src, "r");
-#ifdef USE_MKSTEMP
-  dfp = xv_fopen(dst, "w");
-#else
-  dfp = fdopen(tmpfd, "w");
-#endif
-  if (!sfp || !dfp) {
-    SetISTR(ISTR_INFO, "Unable to remove a InfoFile header form '%s'.", src);
-    Warning();
-    return 0;
-  }
-  fseek(sfp, MACBSIZE, SEEK_SET);
-  while ((n = fread(buffer, 1, sizeof(buffer), sfp)) == 8192) /* XXX */
-    fwrite(buffer, 1, n, dfp);
-  if ((eof = feof(sfp)))
-    fwrite(buffer, 1, n, dfp);
-  fclose(sfp);
-  fflush(dfp);
-  fclose(dfp);
-#ifndef USE_MKSTEMP
-  close(tmpfd);
-#endif
-  if (!eof) {
-    SetISTR(ISTR_INFO, "Unable to remove a InfoFile header form '%s'.", src);
-    Warning();
-    return 0;
-  }
-
-  return 1;
-}
-#endif
-
-
-/********************************/
-void KillPageFiles(char *bname, int numpages)
-{
-  /* deletes any page files (numbered 1 through numpages) that might exist */
-  char tmp[128];
-  int  i;
+  pic   = pinfo.pic;
+  pWIDE = pinfo.w;   pHIGH = pinfo.h;
+  cpic  = pic;
+  cWIDE = pWIDE;     cHIGH = pHIGH;   cXOFF = cYOFF = 0;
 
-  if (strlen(bname) == 0) return;   /* no page files */
+  if (cropped) DoCrop(cx, cy, cw, ch);
+  eWIDE = ew;  eHIGH = eh;
 
-  for (i=1; i<=numpages; i++) {
-    sprintf(tmp, "%s%d", bname, i);
-    unlink(tmp);
-  }
+  SetISTR(ISTR_RES,"%d x %d",pWIDE,pHIGH);
+  SetISTR(ISTR_INFO,"%s", formatStr);
 
-  /* GRR 20070506:  basename file doesn't go away, at least on Linux and for
-   *   GIF and TIFF images, so explicitly unlink() it, too */
-  unlink(bname);
+  if (hadepic) GenerateEpic(eWIDE, eHIGH);
+  return 1;
 }
 
 
@@ -3868,6 +3579,7 @@ void NewPicGetColors(int donorm, int dohist)
   else if (picType == PIC24 && revvideo) {
     if (pic)                        InvertPic24(pic,     pWIDE, pHIGH);
     if (cpic && cpic!=pic)          InvertPic24(cpic,    cWIDE, cHIGH);
+    FreePyramid();
     if (epic && epic!=cpic)         InvertPic24(epic,    eWIDE, eHIGH);
     if (egampic && egampic != epic) InvertPic24(egampic, eWIDE, eHIGH);
   }
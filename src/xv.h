@@ -111,7 +111,17 @@
 /* at least on Linux, the following file (1) includes sys/types.h and
  * (2) defines __USE_BSD (which was not defined before here), so __linux__
  * block is now moved after this #include */
-#include <X11/Xos.h>     /* need type declarations immediately */
+#ifndef XV_HEADLESS
+#  include <X11/Xos.h>   /* need type declarations immediately */
+#else
+#  include <sys/types.h> /* the parts of Xos.h that xv actually uses */
+#  include <string.h>
+#  include <strings.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/time.h>
+#  include <time.h>
+#endif
 
 
 #ifdef __linux__
@@ -244,6 +254,7 @@
 
 
 
+#ifndef XV_HEADLESS
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/cursorfont.h>
@@ -252,11 +263,68 @@
 #include <X11/Xatom.h>
 #include <X11/Xmd.h>
 
+#else  /* XV_HEADLESS */
+
+/* libxvcore (see xvcore.c) is compiled without the X11 headers.  None of
+ * the code that goes into it does anything with X, but the X types are all
+ * over the declarations below, so they get opaque stand-ins here */
+typedef unsigned long  XID;
+typedef XID            Window, Pixmap, Colormap, Cursor, Font, Drawable;
+typedef unsigned long  Atom, KeySym, Time, Mask;
+typedef int            Bool, Status;
+#define XMD_H                          /* keeps jpeglib.h off INT32 */
+typedef int            INT32;          /* from Xmd.h */
+typedef unsigned int   CARD32;
+typedef unsigned short CARD16;
+typedef unsigned char  CARD8;
+
+typedef struct _XDisplay         Display;
+typedef struct _XGC             *GC;
+typedef struct _XOC             *XFontSet;
+typedef struct xvHeadlessVisual  Visual;
+typedef struct xvHeadlessImage   XImage;
+typedef struct xvHeadlessFont    XFontStruct;
+typedef struct xvHeadlessExtents XFontSetExtents;
+typedef struct xvHeadlessAttribs XWindowAttributes;
+typedef union  xvHeadlessEvent   XEvent;
+typedef struct xvHeadlessButton  XButtonEvent;
+typedef struct xvHeadlessError   XErrorEvent;
+
+typedef struct { short x, y; } XPoint;
+typedef struct { unsigned long pixel;
+		 unsigned short red, green, blue;
+		 char flags, pad; } XColor;
+
+#ifndef True
+#  define True  1
+#  define False 0
+#endif
+#define None    0L
+
+#define StaticGray  0                  /* visual classes, as in X.h */
+#define GrayScale   1
+#define StaticColor 2
+#define PseudoColor 3
+#define TrueColor   4
+#define DirectColor 5
+#define LSBFirst    0
+#define MSBFirst    1
+#define XYBitmap    0                  /* image formats */
+#define XYPixmap    1
+#define ZPixmap     2
+#endif /* XV_HEADLESS */
+
 #ifdef HAVE_XRR
 #include <X11/Xproto.h>
 #include <X11/extensions/Xrandr.h>
 #endif
 
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
+
 #ifdef TV_L10N
 #  include <X11/Xlocale.h>
 #endif
@@ -669,6 +737,8 @@
 #  define MACBSIZE 128
 #endif
 
+#define PROBESIZE 4096   /* how much of a file ReadFileType() reads */
+
 /* NOTE:  order must match saveFormats[] in xvdir.c */
 /* [this works best when first one is always present, but...we like PNG :-) ] */
 #define F_PNG         0
@@ -772,10 +842,41 @@
 #define CK_END      8
 
 
+/* TrueColor pixel layouts PackRGB24() knows how to generate */
+#define PACK_NONE    0
+#define PACK_XRGB32  1     /* r<<16 | g<<8 | b, 32 bits per pixel */
+#define PACK_XBGR32  2     /* b<<16 | g<<8 | r, 32 bits per pixel */
+#define PACK_RGB565  3     /* 5/6/5, 16 bits per pixel */
+#define PACK_RGB30   4     /* r<<20 | g<<10 | b, 10 bits per channel */
+
+/* raw pixel layouts UnpackRGB24() knows how to convert into RGB triples.
+   (the bytes, in the order they come in the file) */
+#define UNPACK_BGR24   1     /* b,g,r             (BMP, Targa, Sun) */
+#define UNPACK_BGRX32  2     /* b,g,r,x           (BMP, little-endian XWD) */
+#define UNPACK_XBGR32  3     /* x,b,g,r           (Sun) */
+#define UNPACK_XRGB32  4     /* x,r,g,b           (Sun, big-endian XWD) */
+
+/* bits returned by SIMDFeatures() */
+#define SIMD_SSSE3   0x01
+#define SIMD_AVX2    0x02
+
+
 /* values 'epicMode' can take */
 #define EM_RAW    0
 #define EM_DITH   1
 #define EM_SMOOTH 2
+#define EM_RESAMP 3
+
+/* values 'resampFilter' can take (filters used in EM_RESAMP mode) */
+#define RF_LANCZOS3  0
+#define RF_MITCHELL  1
+#define RF_CATROM    2
+#define RF_MAX       3
+
+/* what CachePut() does with the PICINFO it's given */
+#define CACHE_TAKE     0   /* takes over its pic, comment and exifInfo */
+#define CACHE_COPY     1   /* copies them (if they're not too big) */
+#define CACHE_TAKEPIC  2   /* takes the pic, and copies the others */
 
 
 /* things EventLoop() can return (0 and above reserved for 'goto pic#') */
@@ -837,14 +938,15 @@
 #define DMB_RAW      0
 #define DMB_DITH     1
 #define DMB_SMOOTH   2
-#define DMB_SEP1     3     /* ---- separator */
-#define DMB_COLRW    4
-#define DMB_SEP2     5     /* ---- separator */
-#define DMB_COLNORM  6
-#define DMB_COLPERF  7
-#define DMB_COLOWNC  8
-#define DMB_COLSTDC  9
-#define DMB_MAX      10
+#define DMB_RESAMP   3
+#define DMB_SEP1     4     /* ---- separator */
+#define DMB_COLRW    5
+#define DMB_SEP2     6     /* ---- separator */
+#define DMB_COLNORM  7
+#define DMB_COLPERF  8
+#define DMB_COLOWNC  9
+#define DMB_COLSTDC  10
+#define DMB_MAX      11
 
 
 /* selections in rootMB */
@@ -872,12 +974,17 @@
 #define CONV24_FAST  5
 #define CONV24_SLOW  6
 #define CONV24_BEST  7
-#define CONV24_MAX   8
+#define CONV24_OCTREE 8
+#define CONV24_ORDERED 9
+#define CONV24_MAX   10
 
 /* values 'picType' can take */
 #define PIC8  CONV24_8BIT
 #define PIC24 CONV24_24BIT
 
+/* cells in DoColorDither()'s inverse colormaps (see xvinvcmap.c) */
+#define INVCMAPCELLS (1<<14)
+
 /* indices into algMB */
 #define ALG_NONE      0
 #define ALG_SEP1      1  /* separator */
@@ -892,7 +999,8 @@
 #define ALG_PIXEL     10
 #define ALG_SPREAD    11
 #define ALG_MEDIAN    12
-#define ALG_MAX       13
+#define ALG_GAUSS     13
+#define ALG_MAX       14
 
 /* FLmask algorithms */
 #define MSK_NONE	0
@@ -1110,6 +1218,16 @@ typedef struct { Window       win;       /* window */
 	       } LIST;
 
 
+/* the global settings that change what ReadPicFile() gives back, as of
+   some moment (see LoadOptsNow()) */
+typedef struct { int         conv24;         /* if LoadJFIF() is to do its
+						own 24->8, 1 + CONV24_* */
+		 int         pcdsize;        /* PcdSize */
+		 int         fax;            /* lowresfax, highresfax */
+		 int         gsres;          /* gsRes * dpiMult */
+		 const char *gsdev, *gsgeom; /* gsDev, gsGeomStr */
+	       } LOADOPTS;
+
 /* info structure filled in by the LoadXXX() image reading routines */
 typedef struct { byte *pic;                  /* image data */
 		 int   w, h;                 /* pic size */
@@ -1134,8 +1252,45 @@ typedef struct { byte *pic;                  /* image data */
 		 int   orientation;          /* Which way up is the image? */
 		 int   numpages;             /* # of page files, if >1 */
 		 char  pagebname[64];        /* basename of page files */
+
+		 int   loadw, loadh;         /* if set, it'll be shown no
+						bigger than this (see
+						ReducedLoadSize()) */
+		 int   reduced;              /* if >1, the loader made use of
+						that, and w,h are 1/reduced
+						of normw,normh */
+		 LOADOPTS *opts;             /* if set, load with these, not
+						the current globals */
 	       } PICINFO;
 
+typedef struct { FILE   *fp;
+		 byte   *buf;                /* what's been read, not used yet */
+		 size_t  bufsize, pos, end;
+		 size_t  left;               /* # of bytes left to read from fp */
+		 size_t  missing;            /* # of bytes asked for past EOF */
+		 int     fill;               /* ... and what they read as */
+	       } BULKIN;                     /* see xvbulk.c */
+
+typedef struct { int    hremap[360];         /* hue remapping (0..359) */
+		 int    whtenab;             /* give grays a hue? */
+		 int    whthue, whtsat;      /* ... and this one */
+		 double satval;              /* saturation change, -100..100 */
+		 byte   intfunc[256];        /* intensity (HSV 'value') curve */
+		 byte   rfunc[256];          /* red, green, blue curves */
+		 byte   gfunc[256];
+		 byte   bfunc[256];
+		 int    approx;              /* may interpolate the HSV mods */
+	       } GAMMODS;                    /* see xvgamma.c */
+
+/* libxvcore's (see xvcore.c) message levels, and its callbacks */
+#define XVC_INFO     0
+#define XVC_WARNING  1
+#define XVC_ERROR    2
+#define XVC_FATAL    3
+
+typedef void (*XVCMSGFUNC)  PARM((int, const char *));     /* level, msg */
+typedef void (*XVCPROGFUNC) PARM((int, int, const char *)); /* done, of, what */
+
 #define MAX_GHANDS 16   /* maximum # of GRAF handles */
 
 #define N_GFB 6
@@ -1273,6 +1428,8 @@ WHERE byte          *epic;         /* expanded version of cpic */
                                    /* points to cpic when at 1:1 expansion */
                                    /* this is converted to 'theImage' */
 WHERE int           eWIDE, eHIGH;  /* size of epic */
+WHERE int           epicTiled;     /* epic is NULL, and is instead built in
+				      tiles as needed by DrawWindow() */
 
 WHERE byte          *egampic;      /* expanded, gammified cpic
 				      (only used in 24-bit mode) */
@@ -1359,13 +1516,16 @@ WHERE char         *winTitle;      /* user-specified mainW title */
 WHERE int           bwidth,        /* border width of created windows */
                     fixedaspect,   /* fixed aspect ratio */
                     conv24,        /* 24to8 algorithm to use (CONV24_*) */
+                    octdither,     /* dither the CONV24_OCTREE results */
+                    ordered332,    /* ordered dither to the std cmap */
                     ninstall,      /* true if using icccm-complaint WM
 				      (a WM that will does install CMaps */
                     useroot,       /* true if we should draw in rootW */
 		    nolimits,	   /* No limits on picture size */
 		    resetroot,     /* true if we should clear in window mode */
                     noqcheck,      /* true if we should NOT do QuickCheck */
-                    epicMode,      /* either SMOOTH, DITH, or RAW */
+                    epicMode,      /* SMOOTH, DITH, RAW, or RESAMP */
+                    resampFilter,  /* RF_* filter used by RESAMP */
                     autoclose,     /* if true, autoclose when iconifying */
                     polling,       /* if true, reload if file changes */
                     viewonly,      /* if true, ignore any user input */
@@ -1392,6 +1552,12 @@ WHERE int           automax;       /* maximize pic on open */
 WHERE int           rootMode;      /* mode used for -root images */
 
 WHERE int           nostat;        /* if true, don't stat() in LdCurDir */
+WHERE int           noshm;         /* if true, don't use MIT-SHM XImages */
+WHERE int           nthreads;      /* # of threads to use.  0 = one per CPU */
+WHERE int           cacheMB;       /* size limit of decoded image cache */
+WHERE int           prefetchNext;  /* # of files after the current one, and */
+WHERE int           prefetchPrev;  /*   before it, to decode in background */
+WHERE int           dctScale;      /* decode big JPEGs at display size */
 
 WHERE int           ctrlColor;     /* whether or not to use colored butts */
 
@@ -1597,14 +1763,8 @@ WHERE int           mgcsfxUp;      /* is mgcsfxW mapped, or what? */
 
 /****************************** XV.C ****************************/
 void  SendSelection        PARM((Atom, Window, Atom, Atom, Time, char const *));
-int   ReadFileType         PARM((char *));
-int   ReadPicFile          PARM((char *, int, PICINFO *, int));
-char *QuoteFileName        PARM((char *, const char *, int));
-int   UncompressFile       PARM((char *, char *, int));
-void  KillPageFiles        PARM((char *, int));
-#ifdef MACBINARY
-int   RemoveMacbinary      PARM((char *, char *));
-#endif
+int   ReducedLoadSize      PARM((int *, int *));
+int   FullResPic           PARM((void));
 
 void NewPicGetColors       PARM((int, int));
 void FixAspect             PARM((int, int *, int *));
@@ -1631,6 +1791,8 @@ byte *Conv8to24            PARM((byte *, int, int, byte *, byte *, byte *));
 /*************************** XVALG.C ***************************/
 void AlgInit               PARM((void));
 void DoAlg                 PARM((int));
+int  AlgApply24            PARM((int, byte *, int, int, byte *,
+				 int, int, int, int, double, double));
 
 
 /*************************** XVBROWSE.C ************************/
@@ -1649,6 +1811,12 @@ void BRDeletedFile         PARM((char *));
 void BRCreatedFile         PARM((char *));
 
 
+/*************************** XVBULK.C ***************************/
+void  BulkInit             PARM((BULKIN *, FILE *, size_t, int));
+byte *BulkRow              PARM((BULKIN *, size_t));
+void  BulkDone             PARM((BULKIN *));
+
+
 /**************************** XVBUTT.C ***************************/
 void BTCreate              PARM((BUTT *, Window, int, int, u_int, u_int,
 				 const char *, u_long, u_long, u_long, u_long));
@@ -1696,6 +1864,13 @@ int    MBClick             PARM((MBUTT *, int, int));
 int    MBTrack             PARM((MBUTT *));
 
 
+/*************************** XVCACHE.C ***************************/
+int   CacheGet             PARM((char *, int, int, PICINFO *));
+int   CacheHas             PARM((char *, int, int, int, int, LOADOPTS *));
+void  CachePut             PARM((char *, int, int, PICINFO *, int));
+void  CacheForget          PARM((char *));
+
+
 /*************************** XVCOLOR.C ***************************/
 void   SortColormap        PARM((byte *, int, int, int *, byte*,byte*,byte*,
 				 byte *, byte *));
@@ -1710,6 +1885,11 @@ void   MakeBrowCmap        PARM((void));
 void   ChangeCmapMode      PARM((int, int, int));
 
 
+/*************************** XVCORE.C ****************************/
+void XVCoreInit            PARM((void));
+void XVCoreCallbacks       PARM((XVCMSGFUNC, XVCPROGFUNC));
+
+
 /************************** XVCPMASK.C **************************/
 CPS   *calcCPmask          PARM((char *, int));
 void   cpcode 	           PARM((char *, unsigned char *, int));
@@ -1763,7 +1943,6 @@ void FlashSelection        PARM((int));
 /* FLmask: Mask Select. */
 void MaskSelect            PARM((int,int,int,int));
 
-void CropRect2Rect         PARM((int*,int*,int*,int*, int,int,int,int));
 void CoordE2C              PARM((int, int, int *, int *));
 void CoordC2E              PARM((int, int, int *, int *));
 void CoordP2C              PARM((int, int, int *, int *));
@@ -1862,18 +2041,30 @@ void NewCMap               PARM((void));
 void RedrawCMap            PARM((void));
 void ChangeEC              PARM((int));
 void ApplyECctrls          PARM((void));
-void GenerateFSGamma       PARM((void));
 void DoNorm                PARM((void));
 void DoHistEq              PARM((void));
 void GammifyColors         PARM((void));
 void Gammify1              PARM((int));
-void rgb2hsv               PARM((int, int, int, double *, double *, double *));
-void hsv2rgb               PARM((double, double, double, int *, int *, int *));
 
-byte *GammifyPic24         PARM((byte *, int, int));
+byte *GammifyPic24         PARM((byte *, int, int, int));
 void GamSetAutoApply       PARM((int));
 
 
+/*************************** XVGAMMA.C **************************/
+void  InitGamMods          PARM((GAMMODS *));
+byte *ApplyGamMods24       PARM((byte *, int, int, GAMMODS *));
+void  rgb2hsv              PARM((int, int, int, double *, double *, double *));
+void  hsv2rgb              PARM((double, double, double, int *, int *, int *));
+void  GenerateFSGamma      PARM((void));
+void  InitSpline           PARM((int *, int *, int, double *));
+double EvalSpline          PARM((int *, int *, double *, int, double));
+
+/**************************** XVGEOM.C ***************************/
+void RotatePic             PARM((byte *, int, int *, int *, int));
+void FlipPic               PARM((byte *, int, int, int, int));
+byte *XVGetSubImage        PARM((byte *, int, int,int, int,int,int,int));
+void CropRect2Rect         PARM((int*,int*,int*,int*, int,int,int,int));
+
 /**************************** XVGRAB.C ***************************/
 int Grab                   PARM((void));
 int LoadGrab               PARM((PICINFO *));
@@ -1892,8 +2083,6 @@ void   Graf2Str            PARM((GRAF_STATE *, char *));
 int    Str2Graf            PARM((GRAF_STATE *, const char *));
 void   GetGrafState        PARM((GRAF *, GRAF_STATE *));
 int    SetGrafState        PARM((GRAF *, GRAF_STATE *));
-void   InitSpline          PARM((int *, int *, int, double *));
-double EvalSpline          PARM((int *, int *, double *, int, double));
 
 
 /*************************** XVIMAGE.C ***************************/
@@ -1908,16 +2097,11 @@ int  DoAutoCrop            PARM((void));
 void DoCrop                PARM((int, int, int, int));
 void Rotate                PARM((int));
 void DoRotate              PARM((int));
-void RotatePic             PARM((byte *, int, int *, int *, int));
 void Flip                  PARM((int));
-void FlipPic               PARM((byte *, int, int, int));
 void InstallNewPic         PARM((void));
 void DrawEpic              PARM((void));
 void KillOldPics           PARM((void));
 
-byte *FSDither             PARM((byte *, int, int, int,
-				 byte *, byte *, byte *, int, int));
-
 void CreateXImage          PARM((void));
 XImage *Pic8ToXImage       PARM((byte *, u_int, u_int, u_long *,
 				 byte *, byte *, byte *));
@@ -1927,14 +2111,25 @@ XImage *Pic24ToXImage      PARM((byte *, u_int, u_int));
 void Set824Menus           PARM((int));
 void Change824Mode         PARM((int));
 void FreeEpic              PARM((void));
+void DrawEpicTiles         PARM((int, int, int, int));
+void UntileEpic            PARM((void));
 void InvertPic24           PARM((byte *, int, int));
 
-byte *XVGetSubImage        PARM((byte *, int, int,int, int,int,int,int));
-
 int  DoPad                 PARM((int, char *, int, int, int, int));
 int  LoadPad               PARM((PICINFO *, char *));
 
 
+/*************************** XVINCR.C ***************************/
+int  IncrStart             PARM((PICINFO *));
+void IncrRows              PARM((int, int));
+void IncrDone              PARM((int));
+
+/*************************** XVINVCMAP.C ***************************/
+void   InvCmapInit         PARM((const char *));
+short *InvCmapGet          PARM((byte *, byte *, byte *, int));
+void   InvCmapRelease      PARM((short *));
+void   InvCmapSave         PARM((void));
+
 /*************************** XVINFO.C ***************************/
 void  CreateInfo           PARM((const char *));
 void  InfoBox              PARM((int));
@@ -1950,11 +2145,28 @@ void  SetISTR();
 #endif
 
 
+/*************************** XVLOAD.C ***************************/
+int   ReadFileType         PARM((char *));
+int   ReadPicFile          PARM((char *, int, PICINFO *, int));
+void  LoadOptsNow          PARM((LOADOPTS *));
+int   SameLoadOpts         PARM((LOADOPTS *, LOADOPTS *));
+char *QuoteFileName        PARM((char *, const char *, int));
+int   UncompressFile       PARM((char *, char *, int));
+void  KillPageFiles        PARM((char *, int));
+#ifdef MACBINARY
+int   RemoveMacbinary      PARM((char *, char *));
+#endif
+
 /*************************** XVMASK.C ***************************/
 void DoMask                PARM((int));
 void MaskCr                PARM((void));
 
 
+/*************************** XVMIPMAP.C ***************************/
+byte *PyramidLevel         PARM((int, int, int *, int *, int *));
+void  FreePyramid          PARM((void));
+
+
 /*************************** XVMISC.C ***************************/
 void StoreDeleteWindowProp PARM((Window));
 Window CreateFlexWindow    PARM((const char *, const char *, const char *,
@@ -1977,6 +2189,8 @@ void Draw3dRect            PARM((Window, int, int, u_int, u_int, int, int,
 
 void RemapKeyCheck         PARM((KeySym, char *, int *));
 void xvDestroyImage        PARM((XImage *));
+void xvPutImage            PARM((Drawable, GC, XImage *, int, int, int, int,
+				 u_int, u_int));
 void SetCropString         PARM((void));
 void SetSelectionString    PARM((void));
 void Warning               PARM((void));
@@ -2020,6 +2234,29 @@ void  CloseAlert           PARM((void));
 int   PUCheckEvent         PARM((XEvent *));
 
 
+/************************** XVPREFETCH.C **************************/
+void  PrefetchNear         PARM((int));
+void  PrefetchWait         PARM((char *));
+void  LockLoaders          PARM((void));
+void  UnlockLoaders        PARM((void));
+
+
+/*************************** XVPROBE.C ***************************/
+int   ProbeFile            PARM((char *, byte *, int));
+FILE *ProbeTake            PARM((const char *));
+void  ProbeRelease         PARM((void));
+
+
+/*************************** XVRESAMP.C ***************************/
+byte *ResampleResize       PARM((byte *, int, int, int, int, byte *, byte *,
+				 byte *, byte *, byte *, byte *, int));
+
+byte *Resample24           PARM((byte *, int, int, int, int, int,
+				 byte *, byte *, byte *));
+int   ResampleFilterNum    PARM((const char *));
+const char *ResampleFilterName PARM((int));
+
+
 /**************************** XVROOT.C ****************************/
 void MakeRootPic           PARM((void));
 void ClearRoot             PARM((void));
@@ -2054,6 +2291,25 @@ byte *DoColorDither        PARM((byte *, byte *, int, int, byte *, byte *,
 byte *Do332ColorDither     PARM((byte *, byte *, int, int, byte *, byte *,
 				 byte *, byte *, byte *, byte *, int));
 
+byte *FSDither             PARM((byte *, int, int, int,
+				 byte *, byte *, byte *, int, int));
+
+
+/*************************** XVSIMD.C ***************************/
+int  SIMDFeatures          PARM((void));
+void PackRGB24             PARM((byte *, byte *, int, int));
+void UnpackRGB24           PARM((byte *, byte *, int, int));
+void OrderedDither332      PARM((byte *, byte *, int, int));
+
+
+/*************************** XVTHREAD.C ***************************/
+void InitThreads           PARM((void));
+int  IsMainThread          PARM((void));
+int  NumThreads            PARM((void));
+void DoRowBands            PARM((int, void (*)(void *, int, int), void *));
+void DoRowWave             PARM((int, int, int, void (*)(void *, int, int, int),
+				 void *));
+
 
 /*************************** XVTEXT.C ************************/
 void CreateTextWins        PARM((const char *, const char *));
@@ -2079,6 +2335,19 @@ int  CharsetCheckEvent     PARM((XEvent *));
 int  CharsetDelWin         PARM((Window));
 
 
+/*************************** XVTRACE.C ***************************/
+void TraceInit             PARM((const char *));
+int  Tracing               PARM((void));
+void TraceBegin            PARM((const char *, const char *));
+void TraceEnd              PARM((const char *));
+void TraceDone             PARM((void));
+
+
+/*************************** XVUNCOMP.C ***************************/
+int   MemUncompress        PARM((char *, char *));
+FILE *MemFileOpen          PARM((const char *));
+
+
 /**************************** XVVD.C ****************************/
 void  Vdinit               PARM((void));
 void  Vdsettle             PARM((void));
@@ -29,6 +29,16 @@
  * comments regarding their algorithm.  Folks interested in learning how it
  * works are encouraged to look at the original source.  (jpeg/jquant2.c)
  *
+ * There's also an octree quantizer (CONV24_OCTREE), which only needs one
+ * pass over the image, and a fixed amount of memory.  See oct_quant().
+ * And CONV24_ORDERED, which is the 'quick' colors with an ordered dither
+ * instead of Floyd-Steinberg.
+ *
+ * The color histograms, and the mapping of the image to the new colors,
+ * are split up into bands of rows with DoRowBands().  Each band counts its
+ * colors separately, and they're added together afterwards.  The 'quick'
+ * dither is done in a wave down the image with DoRowWave().
+ *
  * contains:
  *   Cont24to8()
  *   Init24to8()
@@ -43,11 +53,23 @@
 
 #include "xv.h"
 
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+static pthread_mutex_t quantLock = PTHREAD_MUTEX_INITIALIZER;
+#  define LOCK_QUANT()    pthread_mutex_lock(&quantLock)
+#  define UNLOCK_QUANT()  pthread_mutex_unlock(&quantLock)
+#else
+#  define LOCK_QUANT()
+#  define UNLOCK_QUANT()
+#endif
+
 static int    quick_check PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
 static int    quick_quant PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
+static int    ordered_quant PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
 static int    ppm_quant   PARM((byte *,int,int, byte*, byte*,byte*,byte*,int));
 
 static int    slow_quant  PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
+static int    oct_quant   PARM((byte*, int,int, byte*, byte*,byte*,byte*,int));
 
 /****************************/
 void Init24to8(void)
@@ -76,29 +98,54 @@ byte *Conv24to8(byte *pic24, int w, int h, int nc, byte *rm, byte *gm, byte *bm)
 
   if (nc<=0) nc = 255;  /* 'nc == 0' breaks code */
 
+  TraceBegin("Conv24to8", (const char *) NULL);
+
   if (!noqcheck && quick_check(pic24, w,h, pic8, rm,gm,bm, nc)) {
     SetISTR(ISTR_INFO,"No color compression was necessary.\n");
+    TraceEnd("Conv24to8");
     return pic8;
   }
 
   switch (conv24) {
   case CONV24_FAST:
     SetISTR(ISTR_INFO,"Doing 'quick' 24-bit to 8-bit conversion.");
+    TraceBegin("quick_quant", (const char *) NULL);
     i = quick_quant(pic24, w, h, pic8, rm, gm, bm, nc);
+    TraceEnd("quick_quant");
+    break;
+
+  case CONV24_ORDERED:
+    SetISTR(ISTR_INFO,"Doing 'ordered' 24-bit to 8-bit conversion.");
+    TraceBegin("ordered_quant", (const char *) NULL);
+    i = ordered_quant(pic24, w, h, pic8, rm, gm, bm, nc);
+    TraceEnd("ordered_quant");
     break;
 
   case CONV24_BEST:
     SetISTR(ISTR_INFO,"Doing 'best' 24-bit to 8-bit conversion.");
+    TraceBegin("ppm_quant", (const char *) NULL);
     i = ppm_quant(pic24, w, h, pic8, rm, gm, bm, nc);
+    TraceEnd("ppm_quant");
+    break;
+
+  case CONV24_OCTREE:
+    SetISTR(ISTR_INFO,"Doing 'octree' 24-bit to 8-bit conversion.");
+    TraceBegin("oct_quant", (const char *) NULL);
+    i = oct_quant(pic24, w, h, pic8, rm, gm, bm, nc);
+    TraceEnd("oct_quant");
     break;
 
   case CONV24_SLOW:
   default:
     SetISTR(ISTR_INFO,"Doing 'slow' 24-bit to 8-bit conversion.");
+    TraceBegin("slow_quant", (const char *) NULL);
     i = slow_quant(pic24, w, h, pic8, rm, gm, bm, nc);
+    TraceEnd("slow_quant");
     break;
   }
 
+  TraceEnd("Conv24to8");
+
   if (i) { free(pic8);  pic8 = NULL; }
   return pic8;
 }
@@ -211,12 +258,6 @@ static int quick_check(byte *pic24, int w, int h, byte *pic8, byte *rmap, byte *
 
 
 /************************************/
-static int quick_quant(byte *p24, int w, int h, byte *p8, byte *rmap, byte *gmap, byte *bmap, int nc)
-{
-  XV_UNUSED(nc);
-  /* called after 'pic8' has been alloced, pWIDE,pHIGH set up, mono/1-bit
-     checked already */
-
 /* up to 256 colors:     3 bits R, 3 bits G, 2 bits B  (RRRGGGBB) */
 #define RMASK      0xe0
 #define RSHIFT        0
@@ -225,13 +266,30 @@ static int quick_quant(byte *p24, int w, int h, byte *p8, byte *rmap, byte *gmap
 #define BMASK      0xc0
 #define BSHIFT        6
 
-  byte *pp;
-  int  r1, g1, b1;
-  int  *thisline, *nextline, *thisptr, *nextptr, *tmpptr;
-  int  i, j, val, pwide3;
-  int  imax, jmax;
+#define QUICKWAVEMIN  (256*1024)   /* pixels it takes to be worth threads */
+
+/* state shared by the threads working on one quick_quant() */
+typedef struct { byte *p24, *p8;
+		 int   w, h;
+		 byte *rmap, *gmap, *bmap;
+		 int  *lines;              /* ring of 'nbufs' rows of errors */
+		 int   nbufs;
+	       } QUICKJOB;
+
+static void quickLoadRow  PARM((QUICKJOB *, int));
+static void quickQuantRow PARM((void *, int, int, int));
+static void orderedRows   PARM((void *, int, int));
+
+
+static int quick_quant(byte *p24, int w, int h, byte *p8, byte *rmap, byte *gmap, byte *bmap, int nc)
+{
+  XV_UNUSED(nc);
+  /* called after 'pic8' has been alloced, pWIDE,pHIGH set up, mono/1-bit
+     checked already.  Big images are dithered by several threads at once,
+     in a wave down the image (see DoRowWave()), with the same results */
 
-  pp = p8;  pwide3 = w * 3;  imax = h-1;  jmax = w-1;
+  QUICKJOB qj;
+  int      i, nbufs;
 
 
   /* load up colormap:
@@ -245,74 +303,138 @@ static int quick_quant(byte *p24, int w, int h, byte *p8, byte *rmap, byte *gmap
     bmap[i] = (((i<<BSHIFT) & BMASK) * 255 + BMASK/2) / BMASK;
   }
 
+  nbufs = 2;
+  if (NumThreads() > 1 && (long) w * h >= QUICKWAVEMIN) nbufs = NumThreads() + 2;
 
-  thisline = (int *) malloc(pwide3 * sizeof(int));
-  nextline = (int *) malloc(pwide3 * sizeof(int));
-  if (!thisline || !nextline) {
-    if (thisline) free(thisline);
-    if (nextline) free(nextline);
+  qj.lines = (int *) malloc((size_t) nbufs * w * 3 * sizeof(int));
+  if (!qj.lines) {
     fprintf(stderr,"%s: unable to allocate memory in quick_quant()\n", cmd);
     return(1);
   }
 
+  qj.p24 = p24;  qj.p8 = p8;  qj.w = w;  qj.h = h;  qj.nbufs = nbufs;
+  qj.rmap = rmap;  qj.gmap = gmap;  qj.bmap = bmap;
+
   /* get first line of picture */
-  for (j=pwide3, tmpptr=nextline; j; j--) *tmpptr++ = (int) *p24++;
+  quickLoadRow(&qj, 0);
+
+  DoRowWave(h, w, nbufs - 1, quickQuantRow, (void *) &qj);
+
+  free(qj.lines);
+  return 0;
+}
+
+
+static void quickLoadRow(QUICKJOB *qj, int y)
+{
+  byte *pp;
+  int  *tmpptr, j;
+
+  pp     = qj->p24 + (size_t) y * qj->w * 3;
+  tmpptr = qj->lines + (y % qj->nbufs) * qj->w * 3;
+  for (j=qj->w*3; j; j--) *tmpptr++ = (int) *pp++;
+}
 
-  for (i=0; i<h; i++) {
-    tmpptr = thisline;  thisline = nextline;  nextline = tmpptr;   /* swap */
 
+static void quickQuantRow(void *data, int i, int x0, int x1)
+{
+  /* dithers columns [x0,x1) of row 'i', for quick_quant() */
+
+  QUICKJOB *qj = (QUICKJOB *) data;
+  byte *pp;
+  int  r1, g1, b1;
+  int  *thisptr, *nextptr;
+  int  j, val;
+  int  imax, jmax;
+
+  imax = qj->h-1;  jmax = qj->w-1;
+
+  if (x0 == 0) {
     if ((i&0x3f) == 0) WaitCursor();
+    if (i!=imax) quickLoadRow(qj, i+1);   /* get next line */
+  }
 
-    if (i!=imax)   /* get next line */
-      for (j=pwide3, tmpptr=nextline; j; j--)
-	*tmpptr++ = (int) *p24++;
-
-    for (j=0, thisptr=thisline, nextptr=nextline; j<w; j++,pp++) {
-      r1 = *thisptr++;  g1 = *thisptr++;  b1 = *thisptr++;
-      RANGE(r1,0,255);  RANGE(g1,0,255);  RANGE(b1,0,255);
-
-      /* choose actual pixel value */
-      val = (((r1&RMASK)>>RSHIFT) | ((g1&GMASK)>>GSHIFT) |
-	     ((b1&BMASK)>>BSHIFT));
-      *pp = val;
-
-      /* compute color errors */
-      r1 -= rmap[val];
-      g1 -= gmap[val];
-      b1 -= bmap[val];
-
-      /* Add fractions of errors to adjacent pixels */
-      if (j!=jmax) {  /* adjust RIGHT pixel */
-	thisptr[0] += (r1*7) / 16;
-	thisptr[1] += (g1*7) / 16;
-	thisptr[2] += (b1*7) / 16;
-      }
+  pp      = qj->p8 + (size_t) i * qj->w + x0;
+  thisptr = qj->lines + ( i    % qj->nbufs) * qj->w * 3 + x0 * 3;
+  nextptr = qj->lines + ((i+1) % qj->nbufs) * qj->w * 3 + x0 * 3;
+
+  for (j=x0; j<x1; j++,pp++) {
+    r1 = *thisptr++;  g1 = *thisptr++;  b1 = *thisptr++;
+    RANGE(r1,0,255);  RANGE(g1,0,255);  RANGE(b1,0,255);
+
+    /* choose actual pixel value */
+    val = (((r1&RMASK)>>RSHIFT) | ((g1&GMASK)>>GSHIFT) |
+	   ((b1&BMASK)>>BSHIFT));
+    *pp = val;
+
+    /* compute color errors */
+    r1 -= qj->rmap[val];
+    g1 -= qj->gmap[val];
+    b1 -= qj->bmap[val];
+
+    /* Add fractions of errors to adjacent pixels */
+    if (j!=jmax) {  /* adjust RIGHT pixel */
+      thisptr[0] += (r1*7) / 16;
+      thisptr[1] += (g1*7) / 16;
+      thisptr[2] += (b1*7) / 16;
+    }
 
-      if (i!=imax) {	/* do BOTTOM pixel */
-	nextptr[0] += (r1*5) / 16;
-	nextptr[1] += (g1*5) / 16;
-	nextptr[2] += (b1*5) / 16;
+    if (i!=imax) {	/* do BOTTOM pixel */
+      nextptr[0] += (r1*5) / 16;
+      nextptr[1] += (g1*5) / 16;
+      nextptr[2] += (b1*5) / 16;
 
-	if (j>0) {  /* do BOTTOM LEFT pixel */
-	  nextptr[-3] += (r1*3) / 16;
-	  nextptr[-2] += (g1*3) / 16;
-	  nextptr[-1] += (b1*3) / 16;
-	}
+      if (j>0) {  /* do BOTTOM LEFT pixel */
+	nextptr[-3] += (r1*3) / 16;
+	nextptr[-2] += (g1*3) / 16;
+	nextptr[-1] += (b1*3) / 16;
+      }
 
-	if (j!=jmax) {  /* do BOTTOM RIGHT pixel */
-	  nextptr[3] += (r1)/16;
-	  nextptr[4] += (g1)/16;
-	  nextptr[5] += (b1)/16;
-	}
-	nextptr += 3;
+      if (j!=jmax) {  /* do BOTTOM RIGHT pixel */
+	nextptr[3] += (r1)/16;
+	nextptr[4] += (g1)/16;
+	nextptr[5] += (b1)/16;
       }
+      nextptr += 3;
     }
   }
+}
+
+
+
+static int ordered_quant(byte *p24, int w, int h, byte *p8, byte *rmap, byte *gmap, byte *bmap, int nc)
+{
+  /* the same colors as quick_quant(), but with an ordered dither, which
+     doesn't spread errors around, so the rows can all be done at once */
+
+  QUICKJOB qj;
+  int      i;
+
+  XV_UNUSED(nc);
+
+  for (i=0; i<256; i++) {
+    rmap[i] = (((i<<RSHIFT) & RMASK) * 255 + RMASK/2) / RMASK;
+    gmap[i] = (((i<<GSHIFT) & GMASK) * 255 + GMASK/2) / GMASK;
+    bmap[i] = (((i<<BSHIFT) & BMASK) * 255 + BMASK/2) / BMASK;
+  }
 
-  free(thisline);
-  free(nextline);
+  qj.p24 = p24;  qj.p8 = p8;  qj.w = w;  qj.h = h;
+  DoRowBands(h, orderedRows, (void *) &qj);
   return 0;
+}
+
+
+static void orderedRows(void *data, int y0, int y1)
+{
+  QUICKJOB *qj = (QUICKJOB *) data;
+  int       y;
 
+  for (y=y0; y<y1; y++) {
+    if (y0 == 0 && (y&0x3f) == 0) WaitCursor();
+    OrderedDither332(qj->p24 + (size_t) y * qj->w * 3,
+		     qj->p8  + (size_t) y * qj->w, qj->w, y);
+  }
+}
 
 #undef RMASK
 #undef RSHIFT
@@ -320,7 +442,6 @@ static int quick_quant(byte *p24, int w, int h, byte *p8, byte *rmap, byte *gmap
 #undef GSHIFT
 #undef BMASK
 #undef BSHIFT
-}
 
 
 
@@ -396,6 +517,21 @@ struct chist_list_item { struct chist_item ch;
 
 typedef chist_list* chash_table;
 
+/* state shared by the threads working on one ppm_computechash() */
+typedef struct { pixel      **pixels;
+		 int          cols, rows, maxcolors;
+		 chash_table *tables;      /* each band's, indexed by 1st row */
+		 int         *counts;      /* # of colors in each of them */
+		 int          failed;      /* a band found too many colors */
+	       } CHASHJOB;
+
+/* and on the mapping pass of ppm_quant() */
+typedef struct { pixel    **pixels;
+		 int        cols, newcolors;
+		 chist_vec  colormap;
+		 byte      *pic8;
+	       } PPMMAPJOB;
+
 typedef struct box* box_vector;
 struct box {
   int index;
@@ -430,6 +566,8 @@ static int         bluecompare      PARM((const void *, const void *));
 static int         sumcompare       PARM((const void *, const void *));
 static chist_vec   ppm_computechist PARM((pixel **, int,int,int,int *));
 static chash_table ppm_computechash PARM((pixel **, int,int,int,int *));
+static void        chashRows        PARM((void *, int, int));
+static void        ppmMapRows       PARM((void *, int, int));
 static chist_vec   ppm_chashtochist PARM((chash_table, int));
 static chash_table ppm_allocchash   PARM((void));
 static void        ppm_freechist    PARM((chist_vec));
@@ -442,17 +580,14 @@ static int ppm_quant(byte *pic24, int cols, int rows, byte *pic8, byte *rmap, by
   pixel**           pixels;
   register pixel*   pP;
   int               row;
-  register int      col, limitcol;
+  register int      col;
   pixval            maxval, newmaxval;
   int               colors;
-  register int      index;
   chist_vec         chv, colormap;
-  chash_table       cht;
+  PPMMAPJOB         mj;
   int               i;
-  unsigned char     *picptr;
   static const char *fn = "ppmquant()";
 
-  index = 0;
   maxval = 255;
 
   /*
@@ -526,19 +661,58 @@ static int ppm_quant(byte *pic24, int cols, int rows, byte *pic8, byte *rmap, by
    */
 
   if (DEBUG) fprintf(stderr,"%s: mapping image to new colors\n", fn);
-  cht = ppm_allocchash();
 
-  picptr = pic8;
-  for (row = 0;  row < rows;  ++row) {
-    col = 0;  limitcol = cols;  pP = pixels[row];
+  mj.pixels = pixels;  mj.cols = cols;  mj.newcolors = newcolors;
+  mj.colormap = colormap;  mj.pic8 = pic8;
+  DoRowBands(rows, ppmMapRows, (void *) &mj);
 
-    ProgressMeter(0, rows-1, row, "24 -> 8");
+  /* rescale the colormap and load the XV colormap */
+  for (i=0; i<newcolors; i++) {
+    PPM_DEPTH(colormap[i].color, colormap[i].color, maxval, 255);
+    rmap[i] = PPM_GETR( colormap[i].color );
+    gmap[i] = PPM_GETG( colormap[i].color );
+    bmap[i] = PPM_GETB( colormap[i].color );
+  }
 
-    if ((row & 0x1f) == 0) WaitCursor();
-    do {
-      int hash;
-      chist_list chl;
+  /* free the pixels array */
+  for (i=0; i<rows; i++) free(pixels[i]);
+  free(pixels);
+
+  ppm_freechist(colormap);
+
+  return 0;
+}
+
+
+/****************************************************************************/
+static void ppmMapRows(void *data, int y0, int y1)
+{
+  /* maps rows y0..y1-1 to the closest colors in the new colormap.  Each
+     band remembers the colors it's already looked up in its own hash
+     table */
+
+  PPMMAPJOB        *mj = (PPMMAPJOB *) data;
+  register pixel   *pP;
+  chash_table       cht;
+  chist_list        chl;
+  chist_vec         colormap;
+  byte             *picptr;
+  int               row, col, hash, index;
 
+  colormap = mj->colormap;
+  cht = ppm_allocchash();
+  index = 0;
+
+  picptr = mj->pic8 + y0 * mj->cols;
+  for (row = y0;  row < y1;  ++row) {
+    pP = mj->pixels[row];
+
+    if (y0 == 0) {
+      ProgressMeter(0, y1-1, row, "24 -> 8");
+      if ((row & 0x1f) == 0) WaitCursor();
+    }
+
+    for (col = 0;  col < mj->cols;  ++col, ++pP) {
       /* Check hash table to see if we have already matched this color. */
 
       hash = ppm_hashpixel(*pP);
@@ -554,7 +728,7 @@ static int ppm_quant(byte *pic24, int cols, int rows, byte *pic8, byte *rmap, by
 	b1 = PPM_GETB( *pP );
 	dist = 2000000000;
 
-	for (i=0; i<newcolors; i++) {
+	for (i=0; i<mj->newcolors; i++) {
 	  r2 = PPM_GETR( colormap[i].color );
 	  g2 = PPM_GETG( colormap[i].color );
 	  b2 = PPM_GETB( colormap[i].color );
@@ -566,7 +740,6 @@ static int ppm_quant(byte *pic24, int cols, int rows, byte *pic8, byte *rmap, by
 	  if (newdist<dist) { index = i;  dist = newdist; }
 	}
 
-	hash = ppm_hashpixel(*pP);
 	chl = (chist_list) malloc(sizeof(struct chist_list_item));
 	if (!chl) FatalError("ran out of memory adding to hash table");
 
@@ -577,30 +750,10 @@ static int ppm_quant(byte *pic24, int cols, int rows, byte *pic8, byte *rmap, by
       }
 
       *picptr++ = index;
-
-      ++col;
-      ++pP;
     }
-    while (col != limitcol);
-  }
-
-  /* rescale the colormap and load the XV colormap */
-  for (i=0; i<newcolors; i++) {
-    PPM_DEPTH(colormap[i].color, colormap[i].color, maxval, 255);
-    rmap[i] = PPM_GETR( colormap[i].color );
-    gmap[i] = PPM_GETG( colormap[i].color );
-    bmap[i] = PPM_GETB( colormap[i].color );
   }
 
-  /* free the pixels array */
-  for (i=0; i<rows; i++) free(pixels[i]);
-  free(pixels);
-
-  /* free cht and colormap */
-  ppm_freechist(colormap);
   ppm_freechash(cht);
-
-  return 0;
 }
 
 
@@ -823,17 +976,90 @@ static chist_vec
 static chash_table ppm_computechash(pixel** pixels, int cols, int rows,
 					    int maxcolors, int* colorsP )
 {
-  chash_table cht;
-  register pixel* pP;
-  chist_list chl;
-  int col, row, hash;
+  /* builds a hash table of the colors in the image, and how often each one
+     is used.  Returns NULL if there are more than 'maxcolors' of them.
+
+     Each band of rows builds its own table (see chashRows()).  They're
+     merged here, from the top down, with each band's colors added in the
+     order they first appeared in it, so the lists end up in the same order
+     as when it was done in one pass.  (Otherwise, the colors that tie in
+     mediancut()'s sorts could end up in a different order, and give a
+     slightly different colormap.) */
+
+  CHASHJOB    cj;
+  chash_table cht, bcht;
+  chist_list  chl, mchl, next, rev;
+  int         row, i;
+
+  cj.pixels = pixels;  cj.cols = cols;  cj.rows = rows;
+  cj.maxcolors = maxcolors;  cj.failed = 0;
+  cj.tables = (chash_table *) calloc((size_t) rows, sizeof(chash_table));
+  cj.counts = (int *) calloc((size_t) rows, sizeof(int));
+  if (!cj.tables || !cj.counts)
+    FatalError("ran out of memory computing hash table");
+
+  DoRowBands(rows, chashRows, (void *) &cj);
+
+  cht = (chash_table) 0;
+  *colorsP = 0;
+
+  for (row=0; row<rows; row++) {
+    if (!(bcht = cj.tables[row])) continue;
+
+    if (cj.failed) { ppm_freechash(bcht);  continue; }
+    if (!cht) { cht = bcht;  *colorsP = cj.counts[row];  continue; }
+
+    for (i=0; i<HASH_SIZE; i++) {
+      /* the band's list is newest-first.  reverse it */
+      for (chl = bcht[i], rev = (chist_list) 0;  chl;  chl = next) {
+	next = chl->next;  chl->next = rev;  rev = chl;
+      }
+      bcht[i] = (chist_list) 0;
+
+      for (chl = rev;  chl;  chl = next) {
+	next = chl->next;
+
+	for (mchl = cht[i]; mchl != (chist_list) 0; mchl = mchl->next)
+	  if (PPM_EQUAL(mchl->ch.color, chl->ch.color)) break;
+
+	if (mchl) { mchl->ch.value += chl->ch.value;  free(chl); }
+	else {
+	  chl->next = cht[i];
+	  cht[i] = chl;
+	  (*colorsP)++;
+	}
+      }
+    }
+
+    ppm_freechash(bcht);
+    if (*colorsP > maxcolors) cj.failed = 1;
+  }
+
+  if (cj.failed && cht) { ppm_freechash(cht);  cht = (chash_table) 0; }
+
+  free(cj.tables);
+  free(cj.counts);
+  return cht;
+}
+
+
+/****************************************************************************/
+static void chashRows(void *data, int y0, int y1)
+{
+  /* counts the colors in rows y0..y1-1.  Gives up (and sets 'failed') if
+     there are too many, as then there are too many in the whole image */
+
+  CHASHJOB        *cj = (CHASHJOB *) data;
+  chash_table      cht;
+  register pixel  *pP;
+  chist_list       chl;
+  int              col, row, hash, colors;
 
   cht = ppm_allocchash( );
-  *colorsP = 0;
+  colors = 0;
 
-  /* Go through the entire image, building a hash table of colors. */
-  for (row=0; row<rows; row++)
-    for (col=0, pP=pixels[row];  col<cols;  col++, pP++) {
+  for (row=y0; row<y1 && !cj->failed; row++) {
+    for (col=0, pP=cj->pixels[row];  col<cj->cols;  col++, pP++) {
       hash = ppm_hashpixel(*pP);
 
       for (chl = cht[hash]; chl != (chist_list) 0; chl = chl->next)
@@ -841,10 +1067,7 @@ static chash_table ppm_computechash(pixel** pixels, int cols, int rows,
 
       if (chl != (chist_list) 0) ++(chl->ch.value);
       else {
-	if ((*colorsP)++ > maxcolors) {
-	  ppm_freechash(cht);
-	  return (chash_table) 0;
-	}
+	if (++colors > cj->maxcolors) { cj->failed = 1;  break; }
 
 	chl = (chist_list) malloc(sizeof(struct chist_list_item));
 	if (!chl) FatalError("ran out of memory computing hash table");
@@ -855,8 +1078,12 @@ static chash_table ppm_computechash(pixel** pixels, int cols, int rows,
 	cht[hash] = chl;
       }
     }
+  }
 
-  return cht;
+  if (cj->failed) { ppm_freechash(cht);  return; }
+
+  cj->tables[y0] = cht;
+  cj->counts[y0] = colors;
 }
 
 
@@ -986,14 +1213,39 @@ typedef box * boxptr;
 /* Local state for the IJG quantizer */
 
 static hist2d * sl_histogram;	/* pointer to the 3D histogram array */
-static FSERRPTR sl_fserrors;	/* accumulated-errors array */
 static int * sl_error_limiter;	/* table for clamping the applied error */
-static int sl_on_odd_row;	/* flag to remember which row we are on */
 static JSAMPROW sl_colormap[3];	/* selected colormap */
 static int sl_num_colors;	/* number of selected colors */
 
+/* a k-d tree of the colormap, used by oct_quant() (see below).  Node 'i'
+   is colormap entry 'i' */
+typedef struct { byte  c[3];          /* the color */
+		 byte  axis;          /* component its subtrees are split on */
+		 short left, right;   /* subtrees, or -1 */
+	       } KDNODE;
+
+#define KDCACHEBITS 12        /* kdLookup() remembers 2^this colors */
+#define KDCACHESIZE (1 << KDCACHEBITS)
 
-static void   slow_fill_histogram PARM((byte*, int));
+typedef struct { u_int key[KDCACHESIZE];    /* 0x1000000 | RGB, or 0 */
+		 byte  idx[KDCACHESIZE];
+	       } KDCACHE;
+
+/* state shared by the threads filling the histogram, or mapping the pixels */
+typedef struct { byte   *pic24, *pic8;
+		 int     w, h;
+		 KDNODE *kd;          /* colormap's k-d tree, or NULL */
+		 int     kdroot;
+		 int     segmented;   /* slow_map_pixels() is doing segments */
+		 int     failed;      /* a band couldn't malloc */
+	       } SLOWJOB;
+
+#define SEGROWS   64   /* rows in each separately dithered segment */
+#define SEGPRIME  16   /* rows above a segment it dithers first */
+
+
+static int    slow_fill_histogram PARM((byte*, int, int));
+static void   fillHistRows PARM((void *, int, int));
 static boxptr find_biggest_color_pop PARM((boxptr, int));
 static boxptr find_biggest_volume PARM((boxptr, int));
 static void   update_box PARM((boxptr));
@@ -1003,25 +1255,27 @@ static void   slow_select_colors PARM((int));
 static int    find_nearby_colors PARM((int, int, int, JSAMPLE []));
 static void   find_best_colors PARM((int,int,int,int, JSAMPLE [], JSAMPLE []));
 static void   fill_inverse_cmap PARM((int, int, int));
-static void   slow_map_pixels PARM((byte*, int, int, byte*));
+static int    slow_map_pixels PARM((byte*, int, int, byte*, KDNODE *, int));
+static void   slowMapRows PARM((void *, int, int));
+static void   slowDitherRows PARM((SLOWJOB *, FSERRPTR, byte *, KDCACHE *,
+				   int, int, int, int));
+static int    kdLookup PARM((KDNODE *, int, KDCACHE *, int, int, int));
 static void   init_error_limit PARM((void));
 
 
 /* Master control for slow quantizer. */
 static int slow_quant(byte *pic24, int w, int h, byte *pic8, byte *rm, byte *gm, byte *bm, int descols)
 {
-  size_t fs_arraysize = (w + 2) * (3 * sizeof(FSERROR));
+  int rv;
 
   /* Allocate all the temporary storage needed */
   if (sl_error_limiter == NULL)
     init_error_limit();
   sl_histogram = (hist2d *) malloc(sizeof(hist3d));
-  sl_fserrors = (FSERRPTR) malloc(fs_arraysize);
 
-  if (! sl_error_limiter || ! sl_histogram || ! sl_fserrors) {
+  if (! sl_error_limiter || ! sl_histogram) {
     /* we never free sl_error_limiter once acquired */
     if (sl_histogram) free(sl_histogram);
-    if (sl_fserrors) free(sl_fserrors);
     fprintf(stderr,"%s: slow_quant() - failed to allocate workspace\n",cmd);
     return 1;
   }
@@ -1031,47 +1285,93 @@ static int slow_quant(byte *pic24, int w, int h, byte *pic8, byte *rm, byte *gm,
   sl_colormap[2] = (JSAMPROW) bm;
 
   /* Compute the color histogram */
-  slow_fill_histogram(pic24, w*h);
+  rv = slow_fill_histogram(pic24, w, h);
 
-  /* Select the colormap */
-  slow_select_colors(descols);
+  if (!rv) {
+    /* Select the colormap */
+    slow_select_colors(descols);
 
-  /* Zero the histogram: now to be used as inverse color map */
-  xvbzero((char *) sl_histogram, sizeof(hist3d));
+    /* Zero the histogram: now to be used as inverse color map */
+    xvbzero((char *) sl_histogram, sizeof(hist3d));
 
-  /* Initialize the propagated errors to zero. */
-  xvbzero((char *) sl_fserrors, fs_arraysize);
-  sl_on_odd_row = FALSE;
+    /* Map the image. */
+    rv = slow_map_pixels(pic24, w, h, pic8, (KDNODE *) NULL, 0);
+  }
 
-  /* Map the image. */
-  slow_map_pixels(pic24, w, h, pic8);
+  if (rv) fprintf(stderr,"%s: slow_quant() - failed to allocate workspace\n",cmd);
 
   /* Release working memory. */
   /* we never free sl_error_limiter once acquired */
   free(sl_histogram);
-  free(sl_fserrors);
 
-  return 0;
+  return rv;
 }
 
 
-static void slow_fill_histogram (register byte *pic24, register int numpixels)
+static int slow_fill_histogram (byte *pic24, int w, int h)
 {
-  register histptr histp;
-  register hist2d * histogram = sl_histogram;
+  /* returns non-zero on failure (malloc) */
+
+  SLOWJOB sj;
+
+  xvbzero((char *) sl_histogram, sizeof(hist3d));
+
+  sj.pic24 = pic24;  sj.pic8 = (byte *) NULL;  sj.w = w;  sj.h = h;
+  sj.kd = (KDNODE *) NULL;  sj.kdroot = 0;
+  sj.segmented = sj.failed = 0;
+  DoRowBands(h, fillHistRows, (void *) &sj);
 
-  xvbzero((char *) histogram, sizeof(hist3d));
+  return sj.failed;
+}
+
+
+static void fillHistRows (void *data, int y0, int y1)
+{
+  /* counts the colors in rows y0..y1-1.  If that's the whole image, they
+     go straight into sl_histogram.  Otherwise, they're counted in a
+     histogram of the band's own, which is then added in */
 
-  while (numpixels-- > 0) {
+  SLOWJOB *sj = (SLOWJOB *) data;
+  register histptr histp;
+  register hist2d * histogram;
+  register byte *pp;
+  histptr dstp;
+  long    i, v;
+
+  if (y0 == 0 && y1 == sj->h) histogram = sl_histogram;
+  else {
+    histogram = (hist2d *) calloc((size_t) 1, sizeof(hist3d));
+    if (!histogram) { sj->failed = 1;  return; }
+  }
+
+  pp = sj->pic24 + (size_t) y0 * sj->w * 3;
+  for (i = (long) (y1 - y0) * sj->w; i > 0; i--) {
     /* get pixel value and index into the histogram */
-    histp = & histogram[pic24[0] >> C0_SHIFT]
-		       [pic24[1] >> C1_SHIFT]
-		       [pic24[2] >> C2_SHIFT];
+    histp = & histogram[pp[0] >> C0_SHIFT]
+		       [pp[1] >> C1_SHIFT]
+		       [pp[2] >> C2_SHIFT];
     /* increment, check for overflow and undo increment if so. */
     if (++(*histp) <= 0)
       (*histp)--;
-    pic24 += 3;
+    pp += 3;
+  }
+
+  if (histogram == sl_histogram) return;
+
+  /* add them in.  The cells stick at their maximum, like they do above */
+  LOCK_QUANT();
+  histp = (histptr) histogram;
+  dstp  = (histptr) sl_histogram;
+  for (i = HIST_C0_ELEMS * HIST_C1_ELEMS * HIST_C2_ELEMS; i > 0; i--) {
+    if (*histp) {
+      v = (long) *dstp + *histp;
+      *dstp = (v > (histcell) ~0) ? (histcell) ~0 : (histcell) v;
+    }
+    histp++;  dstp++;
   }
+  UNLOCK_QUANT();
+
+  free(histogram);
 }
 
 
@@ -1551,8 +1851,94 @@ static void fill_inverse_cmap (int c0, int c1, int c2)
 }
 
 
-static void slow_map_pixels (byte *pic24, int width, int height, byte *pic8)
+static int slow_map_pixels (byte *pic24, int width, int height, byte *pic8,
+			    KDNODE *kd, int kdroot)
 {
+  /* maps the image to the colormap, with Floyd-Steinberg dithering.
+     Returns non-zero on failure (malloc).  The closest colors are found
+     with the inverse colormap in sl_histogram, or in the k-d tree 'kd',
+     if it isn't NULL.
+
+     With one thread, it's one pass down the image, as always.  Otherwise,
+     it's cut into segments of SEGROWS rows, which are dithered separately,
+     a band of them at a time.  To avoid seams, each segment starts by
+     dithering the SEGPRIME rows above it (and throwing those away), so the
+     errors it carries into its first row are about what they would have
+     been.  The result doesn't depend on how many threads there are, just
+     whether there's more than one.  The row direction alternates based on
+     the row number, in both cases */
+
+  SLOWJOB sj;
+
+  sj.pic24 = pic24;  sj.pic8 = pic8;  sj.w = width;  sj.h = height;
+  sj.kd = kd;  sj.kdroot = kdroot;
+  sj.failed = 0;
+
+  sj.segmented = (NumThreads() > 1 && height > SEGROWS);
+  if (sj.segmented) DoRowBands(height, slowMapRows, (void *) &sj);
+  else slowMapRows((void *) &sj, 0, height);
+
+  return sj.failed;
+}
+
+
+static void slowMapRows (void *data, int y0, int y1)
+{
+  /* dithers the segments that start in rows y0..y1-1, or the whole image
+     in one go, if it isn't 'segmented' */
+
+  SLOWJOB *sj = (SLOWJOB *) data;
+  size_t   fs_arraysize;
+  FSERRPTR fserrors;
+  byte    *scratch;
+  KDCACHE *kc;
+  int      seg, r0, r1;
+
+  fs_arraysize = (sj->w + 2) * (3 * sizeof(FSERROR));
+  fserrors = (FSERRPTR) malloc(fs_arraysize);
+  scratch  = (byte *) malloc((size_t) sj->w);
+  kc = (sj->kd) ? (KDCACHE *) calloc((size_t) 1, sizeof(KDCACHE)) : NULL;
+  if (!fserrors || !scratch || (sj->kd && !kc)) {
+    if (fserrors) free(fserrors);
+    if (scratch)  free(scratch);
+    if (kc)       free(kc);
+    sj->failed = 1;
+    return;
+  }
+
+  if (!sj->segmented) {
+    xvbzero((char *) fserrors, fs_arraysize);
+    slowDitherRows(sj, fserrors, scratch, kc, 0, sj->h, 0, sj->h - 1);
+  }
+
+  else {
+    for (seg = (y0 + SEGROWS - 1) / SEGROWS; seg * SEGROWS < y1; seg++) {
+      r1 = (seg + 1) * SEGROWS;
+      if (r1 > sj->h) r1 = sj->h;
+      r0 = seg * SEGROWS - SEGPRIME;
+      if (r0 < 0) r0 = 0;
+
+      /* Initialize the propagated errors to zero. */
+      xvbzero((char *) fserrors, fs_arraysize);
+      slowDitherRows(sj, fserrors, scratch, kc, r0, r1, seg * SEGROWS,
+		     (y0 == 0) ? y1 - 1 : 0);
+    }
+  }
+
+  free(fserrors);
+  free(scratch);
+  if (kc) free(kc);
+}
+
+
+static void slowDitherRows (SLOWJOB *sj, FSERRPTR fserrors, byte *scratch,
+			    KDCACHE *kc, int r0, int r1, int out0, int pmax)
+{
+  /* dithers rows r0..r1-1, starting with the errors in 'fserrors', which
+     are left as they are after the last row.  Rows before 'out0' go into
+     'scratch' (one row), rather than pic8.  Shows progress if 'pmax' > 0.
+     'kc' is only used (for kdLookup()) if there's a k-d tree */
+
   register LOCFSERROR cur0, cur1, cur2;	/* current error or pixel value */
   LOCFSERROR belowerr0, belowerr1, belowerr2; /* error for pixel below cur */
   LOCFSERROR bpreverr0, bpreverr1, bpreverr2; /* error for below/prev col */
@@ -1562,34 +1948,38 @@ static void slow_map_pixels (byte *pic24, int width, int height, byte *pic8)
   histptr cachep;
   int dir;			/* +1 or -1 depending on direction */
   int dir3;			/* 3*dir, for advancing inptr & errorptr */
-  int row, col;
+  int pixcode;			/* colormap index it's mapped to */
+  int row, col, width;
+  byte *pic24, *pic8;
   int *error_limit = sl_error_limiter;
   JSAMPROW colormap0 = sl_colormap[0];
   JSAMPROW colormap1 = sl_colormap[1];
   JSAMPROW colormap2 = sl_colormap[2];
   hist2d * histogram = sl_histogram;
 
-  for (row = 0; row < height; row++) {
+  pic24 = sj->pic24;  pic8 = sj->pic8;  width = sj->w;
+
+  for (row = r0; row < r1; row++) {
 
-    if ((row&0x3f) == 0) WaitCursor();
-    ProgressMeter(0, height-1, row, "Dither");
+    if (pmax > 0) {
+      if ((row&0x3f) == 0) WaitCursor();
+      ProgressMeter(0, pmax, row, "Dither");
+    }
 
     inptr = & pic24[row * width * 3];
-    outptr = & pic8[row * width];
-    if (sl_on_odd_row) {
+    outptr = (row < out0) ? scratch : & pic8[row * width];
+    if (row & 1) {
       /* work right to left in this row */
       inptr += (width-1) * 3;	/* so point to rightmost pixel */
       outptr += width-1;
       dir = -1;
       dir3 = -3;
-      errorptr = sl_fserrors + (width+1)*3; /* => entry after last column */
-      sl_on_odd_row = FALSE;	/* flip for next time */
+      errorptr = fserrors + (width+1)*3; /* => entry after last column */
     } else {
       /* work left to right in this row */
       dir = 1;
       dir3 = 3;
-      errorptr = sl_fserrors;	/* => entry before first real column */
-      sl_on_odd_row = TRUE;	/* flip for next time */
+      errorptr = fserrors;	/* => entry before first real column */
     }
     /* Preset error values: no error propagated to first pixel from left */
     cur0 = cur1 = cur2 = 0;
@@ -1610,20 +2000,27 @@ static void slow_map_pixels (byte *pic24, int width, int height, byte *pic8)
       RANGE(cur0, 0, 255);
       RANGE(cur1, 0, 255);
       RANGE(cur2, 0, 255);
-      /* Index into the cache with adjusted pixel value */
-      cachep = & histogram[cur0>>C0_SHIFT][cur1>>C1_SHIFT][cur2>>C2_SHIFT];
-      /* If we have not seen this color before, find nearest colormap */
-      /* entry and update the cache */
-      if (*cachep == 0)
-	fill_inverse_cmap(cur0>>C0_SHIFT, cur1>>C1_SHIFT, cur2>>C2_SHIFT);
-      /* Now emit the colormap index for this cell */
-      { register int pixcode = *cachep - 1;
-	*outptr = (JSAMPLE) pixcode;
-	/* Compute representation error for this pixel */
-	cur0 -= (int) colormap0[pixcode];
-	cur1 -= (int) colormap1[pixcode];
-	cur2 -= (int) colormap2[pixcode];
+      if (sj->kd)      /* oct_quant():  look it up in the k-d tree */
+	pixcode = kdLookup(sj->kd, sj->kdroot, kc, cur0, cur1, cur2);
+      else {
+	/* Index into the cache with adjusted pixel value */
+	cachep = & histogram[cur0>>C0_SHIFT][cur1>>C1_SHIFT][cur2>>C2_SHIFT];
+	/* If we have not seen this color before, find nearest colormap */
+	/* entry and update the cache */
+	if (*cachep == 0) {
+	  LOCK_QUANT();    /* another band might be filling it in, too */
+	  if (*cachep == 0)
+	    fill_inverse_cmap(cur0>>C0_SHIFT, cur1>>C1_SHIFT, cur2>>C2_SHIFT);
+	  UNLOCK_QUANT();
+	}
+	pixcode = *cachep - 1;
       }
+      /* Now emit the colormap index for this cell */
+      *outptr = (JSAMPLE) pixcode;
+      /* Compute representation error for this pixel */
+      cur0 -= (int) colormap0[pixcode];
+      cur1 -= (int) colormap1[pixcode];
+      cur2 -= (int) colormap2[pixcode];
       /* Compute error fractions to be propagated to adjacent pixels.
        * Add these into the running sums, and simultaneously shift the
        * next-line error sums left by 1 column.
@@ -1703,3 +2100,579 @@ static void init_error_limit (void)
   }
 #undef STEPSIZE
 }
+
+
+
+
+/***************************************************************/
+/* Octree quantizer                                            */
+/***************************************************************/
+
+/*
+ * oct_quant() makes one pass over the pixels, sorting them into an octree
+ * (see Gervautz & Purgathofer, "A Simple Method for Color Quantization:
+ * Octree Quantization").  The tree has a fixed number of nodes, so when it
+ * has too many leaves, the deepest ones get merged into their parents.
+ * Each leaf keeps the sums (and sum of squares) of the colors that went
+ * into it, so what's left at the end is a summary of the image in a few
+ * thousand clusters of colors, however big the image was.
+ *
+ * The clusters are then divided up into the colormap the way Wu's
+ * quantizer does it:  the box with the most squared error is cut in two,
+ * at the place (along whichever axis is best) that leaves the least error,
+ * until there are enough boxes.  A few rounds of k-means on the clusters
+ * tidy that up.
+ *
+ * The pixels are mapped to the closest color with a k-d tree of the
+ * colormap, and a small cache of recent lookups.  That's done with
+ * Floyd-Steinberg dithering (by slow_map_pixels()), unless 'octdither' is
+ * turned off.
+ */
+
+#define OCT_DEPTH      6       /* levels of the tree, below the root */
+#define OCT_MAXLEAVES  4096    /* leaves get merged to stay under this */
+#define OCT_MAXNODES   ((OCT_MAXLEAVES + 2) * (OCT_DEPTH + 1))
+#define OCT_ROOT       1       /* node 0 means 'none' */
+#define OCT_KMEANS     3       /* rounds of k-means */
+
+typedef struct { int    child[8];     /* nodes, or 0 */
+		 int    next;         /* next on its reducible list, or free */
+		 int    isleaf;
+		 double n, sr, sg, sb, sq;   /* # of pixels, sums, sum of squares */
+	       } OCTNODE;
+
+typedef struct { OCTNODE *nodes;      /* OCT_MAXNODES of them */
+		 int      used;       /* nodes that have ever been used */
+		 int      freelist;   /* nodes that have been merged away */
+		 int      leaves;
+		 int      reducible[OCT_DEPTH];  /* interior nodes on each level */
+	       } OCTREE;
+
+typedef struct { double n, sr, sg, sb, sq;
+		 double mean[3];
+		 int    id;           /* breaks ties when sorting */
+	       } OCTCLUST;
+
+typedef struct { int    lo, hi;       /* its clusters are [lo,hi) */
+		 double err;          /* their total squared error */
+	       } OCTBOX;
+
+/* state shared by the threads doing octMapRows() */
+typedef struct { byte   *pic24, *pic8;
+		 int     w;
+		 KDNODE *kd;
+		 int     kdroot;
+		 int     failed;      /* a band couldn't malloc */
+	       } OCTMAPJOB;
+
+
+static int    octNewNode   PARM((OCTREE *, int));
+static void   octReduce    PARM((OCTREE *));
+static int    octInsert    PARM((OCTREE *, int, int, int));
+static int    octClusters  PARM((OCTREE *, int, OCTCLUST *, int));
+static double octError     PARM((double, double, double, double, double));
+static int    octSplit     PARM((OCTCLUST *, int, OCTBOX *, int));
+static int    octCompare   PARM((const void *, const void *, int));
+static int    octRCompare  PARM((const void *, const void *));
+static int    octGCompare  PARM((const void *, const void *));
+static int    octBCompare  PARM((const void *, const void *));
+static int    octKMeans    PARM((OCTCLUST *, int, KDNODE *, int));
+static void   octMapRows   PARM((void *, int, int));
+static int    kdBuild      PARM((KDNODE *, int, int));
+static void   kdNearest    PARM((KDNODE *, int, int, int, int, int *, int *));
+
+
+static int oct_quant(byte *pic24, int w, int h, byte *pic8, byte *rm, byte *gm, byte *bm, int nc)
+{
+  OCTREE    ot;
+  OCTCLUST *clusters;
+  OCTBOX   *boxes;
+  OCTNODE  *np;
+  KDNODE    kd[256];
+  byte     *pp;
+  int       i, x, y, r, g, b, leaf, nclust, ncols, kdroot, rv;
+
+  if (nc > 256) nc = 256;
+
+  ot.nodes = (OCTNODE *) malloc(OCT_MAXNODES * sizeof(OCTNODE));
+  clusters = (OCTCLUST *) malloc(OCT_MAXLEAVES * sizeof(OCTCLUST));
+  boxes    = (OCTBOX *)   malloc(nc * sizeof(OCTBOX));
+  if (!ot.nodes || !clusters || !boxes) {
+    if (ot.nodes) free(ot.nodes);
+    if (clusters) free(clusters);
+    if (boxes)    free(boxes);
+    fprintf(stderr,"%s: oct_quant() - failed to allocate workspace\n",cmd);
+    return 1;
+  }
+
+  /* build the tree, in one pass over the pixels */
+  ot.used = OCT_ROOT;  ot.freelist = 0;  ot.leaves = 0;
+  for (i=0; i<OCT_DEPTH; i++) ot.reducible[i] = 0;
+  octNewNode(&ot, 0);
+
+  leaf = 0;  r = g = b = -1;
+  for (y=0, pp=pic24; y<h; y++) {
+    if ((y&0x3f) == 0) WaitCursor();
+    ProgressMeter(0, h-1, y, "Octree");
+
+    for (x=0; x<w; x++, pp+=3) {
+      /* runs of the same color are common, and go in the same leaf */
+      if (pp[0] != r || pp[1] != g || pp[2] != b) {
+	r = pp[0];  g = pp[1];  b = pp[2];
+	leaf = octInsert(&ot, r, g, b);
+      }
+
+      np = &ot.nodes[leaf];
+      np->n  += 1.0;
+      np->sr += r;  np->sg += g;  np->sb += b;
+      np->sq += r*r + g*g + b*b;
+    }
+  }
+
+  nclust = octClusters(&ot, OCT_ROOT, clusters, 0);
+  free(ot.nodes);
+
+  /* pick the colors */
+  ncols = octSplit(clusters, nclust, boxes, nc);
+
+  for (i=0; i<ncols; i++) {
+    double sr, sg, sb, n;
+    int    j;
+
+    sr = sg = sb = n = 0.0;
+    for (j=boxes[i].lo; j<boxes[i].hi; j++) {
+      n  += clusters[j].n;
+      sr += clusters[j].sr;  sg += clusters[j].sg;  sb += clusters[j].sb;
+    }
+    kd[i].c[0] = (byte) (sr / n + 0.5);
+    kd[i].c[1] = (byte) (sg / n + 0.5);
+    kd[i].c[2] = (byte) (sb / n + 0.5);
+  }
+
+  kdroot = octKMeans(clusters, nclust, kd, ncols);
+  free(clusters);
+  free(boxes);
+
+  for (i=0; i<256; i++) {
+    if (i<ncols) { rm[i] = kd[i].c[0];  gm[i] = kd[i].c[1];  bm[i] = kd[i].c[2]; }
+    else rm[i] = gm[i] = bm[i] = 0;
+  }
+
+  if (DEBUG) fprintf(stderr,"oct_quant: %d clusters, %d colors\n",
+		     nclust, ncols);
+
+  /* and map the image to them */
+  if (octdither) {
+    if (sl_error_limiter == NULL)
+      init_error_limit();
+    if (!sl_error_limiter) {
+      fprintf(stderr,"%s: oct_quant() - failed to allocate workspace\n",cmd);
+      return 1;
+    }
+
+    sl_colormap[0] = (JSAMPROW) rm;
+    sl_colormap[1] = (JSAMPROW) gm;
+    sl_colormap[2] = (JSAMPROW) bm;
+    rv = slow_map_pixels(pic24, w, h, pic8, kd, kdroot);
+  }
+
+  else {
+    OCTMAPJOB mj;
+
+    mj.pic24 = pic24;  mj.pic8 = pic8;  mj.w = w;
+    mj.kd = kd;  mj.kdroot = kdroot;  mj.failed = 0;
+    DoRowBands(h, octMapRows, (void *) &mj);
+    rv = mj.failed;
+  }
+
+  if (rv) fprintf(stderr,"%s: oct_quant() - failed to allocate workspace\n",cmd);
+  return rv;
+}
+
+
+static int octNewNode (OCTREE *ot, int level)
+{
+  /* returns a new node at the given level (0 = the root) */
+
+  OCTNODE *np;
+  int      n;
+
+  n = 0;
+  if (ot->freelist) { n = ot->freelist;  ot->freelist = ot->nodes[n].next; }
+  else if (ot->used < OCT_MAXNODES) n = ot->used++;
+  else FatalError("oct_quant: ran out of octree nodes");  /* can't happen */
+
+  np = &ot->nodes[n];
+  xvbzero((char *) np, sizeof(OCTNODE));
+
+  if (level == OCT_DEPTH) { np->isleaf = 1;  ot->leaves++; }
+  else {
+    np->next = ot->reducible[level];
+    ot->reducible[level] = n;
+  }
+
+  return n;
+}
+
+
+static void octReduce (OCTREE *ot)
+{
+  /* merges the children of the most recently made node on the deepest
+     level that has any (whose children are all leaves) into it */
+
+  OCTNODE *np, *cp;
+  int      level, n, i, c;
+
+  for (level=OCT_DEPTH-1; level>0 && !ot->reducible[level]; level--);
+  if (!(n = ot->reducible[level])) return;
+
+  np = &ot->nodes[n];
+  ot->reducible[level] = np->next;
+
+  for (i=0; i<8; i++) {
+    if (!(c = np->child[i])) continue;
+
+    cp = &ot->nodes[c];
+    np->n  += cp->n;
+    np->sr += cp->sr;  np->sg += cp->sg;  np->sb += cp->sb;
+    np->sq += cp->sq;
+
+    cp->next = ot->freelist;
+    ot->freelist = c;
+    np->child[i] = 0;
+    ot->leaves--;
+  }
+
+  np->isleaf = 1;
+  ot->leaves++;
+}
+
+
+static int octInsert (OCTREE *ot, int r, int g, int b)
+{
+  /* returns the leaf that color r,g,b belongs in, making it if need be */
+
+  int n, c, i, level, shift;
+
+  /* make room first, so the leaf we return doesn't get merged away */
+  while (ot->leaves >= OCT_MAXLEAVES) octReduce(ot);
+
+  n = OCT_ROOT;
+  for (level=0; !ot->nodes[n].isleaf; level++) {
+    shift = 7 - level;
+    i = (((r >> shift) & 1) << 2) | (((g >> shift) & 1) << 1) |
+         ((b >> shift) & 1);
+
+    if (!(c = ot->nodes[n].child[i])) {
+      c = octNewNode(ot, level+1);
+      ot->nodes[n].child[i] = c;
+    }
+    n = c;
+  }
+
+  return n;
+}
+
+
+static int octClusters (OCTREE *ot, int n, OCTCLUST *clusters, int nclust)
+{
+  /* adds the (non-empty) leaves under node 'n' to 'clusters', which
+     already has 'nclust' of them.  Returns the new total */
+
+  OCTNODE  *np;
+  OCTCLUST *cp;
+  int       i;
+
+  np = &ot->nodes[n];
+
+  if (!np->isleaf) {
+    for (i=0; i<8; i++)
+      if (np->child[i])
+	nclust = octClusters(ot, np->child[i], clusters, nclust);
+    return nclust;
+  }
+
+  if (np->n <= 0.0) return nclust;
+
+  cp = &clusters[nclust];
+  cp->n  = np->n;
+  cp->sr = np->sr;  cp->sg = np->sg;  cp->sb = np->sb;
+  cp->sq = np->sq;
+  cp->mean[0] = np->sr / np->n;
+  cp->mean[1] = np->sg / np->n;
+  cp->mean[2] = np->sb / np->n;
+  cp->id = nclust;
+
+  return nclust + 1;
+}
+
+
+static double octError (double n, double sr, double sg, double sb, double sq)
+{
+  /* squared error of a set of pixels, given their sums */
+
+  if (n <= 0.0) return 0.0;
+  return sq - (sr*sr + sg*sg + sb*sb) / n;
+}
+
+
+static int octCompare (const void *p1, const void *p2, int axis)
+{
+  /* orders clusters by their mean on 'axis', then on the other two, then
+     by id.  qsort() isn't stable, and octSplit() sorts the same clusters
+     more than once, so there mustn't be any ties left for it to settle */
+
+  const OCTCLUST *c1 = (const OCTCLUST *) p1;
+  const OCTCLUST *c2 = (const OCTCLUST *) p2;
+  int i, a;
+
+  for (i=0; i<3; i++) {
+    a = (axis + i) % 3;
+    if (c1->mean[a] < c2->mean[a]) return -1;
+    if (c1->mean[a] > c2->mean[a]) return  1;
+  }
+
+  return (c1->id < c2->id) ? -1 : (c1->id > c2->id) ? 1 : 0;
+}
+
+static int octRCompare (const void *p1, const void *p2)
+{
+  return octCompare(p1, p2, 0);
+}
+
+static int octGCompare (const void *p1, const void *p2)
+{
+  return octCompare(p1, p2, 1);
+}
+
+static int octBCompare (const void *p1, const void *p2)
+{
+  return octCompare(p1, p2, 2);
+}
+
+
+static int octSplit (OCTCLUST *clusters, int nclust, OCTBOX *boxes, int nc)
+{
+  /* divides the clusters into (at most) 'nc' boxes.  Returns how many */
+
+  static int (*compare[3]) PARM((const void *, const void *)) =
+    { octRCompare, octGCompare, octBCompare };
+
+  OCTCLUST *cp;
+  double    n, sr, sg, sb, sq, ln, lr, lg, lb, lq, err, besterr;
+  double    lerr, rerr, bestlerr, bestrerr;
+  int       nbox, i, j, axis, bestaxis, cut, bestcut, lo, hi;
+
+  n = sr = sg = sb = sq = 0.0;
+  for (i=0, cp=clusters; i<nclust; i++, cp++) {
+    n += cp->n;  sr += cp->sr;  sg += cp->sg;  sb += cp->sb;  sq += cp->sq;
+  }
+
+  boxes[0].lo = 0;  boxes[0].hi = nclust;
+  boxes[0].err = octError(n, sr, sg, sb, sq);
+  nbox = (nclust > 0) ? 1 : 0;
+
+  while (nbox < nc) {
+    /* find the box with the most error that can be split */
+    for (i=0, j = -1; i<nbox; i++) {
+      if (boxes[i].hi - boxes[i].lo > 1 && boxes[i].err > 0.0 &&
+	  (j < 0 || boxes[i].err > boxes[j].err)) j = i;
+    }
+    if (j < 0) break;
+
+    lo = boxes[j].lo;  hi = boxes[j].hi;
+
+    /* find the best place to cut it */
+    besterr = bestlerr = bestrerr = -1.0;
+    bestaxis = bestcut = 0;
+
+    for (axis=0; axis<3; axis++) {
+      qsort((char *) &clusters[lo], (size_t) (hi - lo), sizeof(OCTCLUST),
+	    compare[axis]);
+
+      n = sr = sg = sb = sq = 0.0;
+      for (i=lo, cp=&clusters[lo]; i<hi; i++, cp++) {
+	n += cp->n;  sr += cp->sr;  sg += cp->sg;  sb += cp->sb;  sq += cp->sq;
+      }
+
+      ln = lr = lg = lb = lq = 0.0;
+      for (cut=lo+1, cp=&clusters[lo]; cut<hi; cut++, cp++) {
+	ln += cp->n;  lr += cp->sr;  lg += cp->sg;  lb += cp->sb;  lq += cp->sq;
+
+	lerr = octError(ln, lr, lg, lb, lq);
+	rerr = octError(n-ln, sr-lr, sg-lg, sb-lb, sq-lq);
+	err  = lerr + rerr;
+	if (besterr < 0.0 || err < besterr) {
+	  besterr = err;  bestlerr = lerr;  bestrerr = rerr;
+	  bestaxis = axis;  bestcut = cut;
+	}
+      }
+    }
+
+    if (bestaxis != 2)
+      qsort((char *) &clusters[lo], (size_t) (hi - lo), sizeof(OCTCLUST),
+	    compare[bestaxis]);
+
+    boxes[j].hi  = bestcut;  boxes[j].err = bestlerr;
+    boxes[nbox].lo = bestcut;  boxes[nbox].hi = hi;
+    boxes[nbox].err = bestrerr;
+    nbox++;
+  }
+
+  return nbox;
+}
+
+
+static int octKMeans (OCTCLUST *clusters, int nclust, KDNODE *kd, int ncols)
+{
+  /* improves the colors in 'kd' with a few rounds of k-means on the
+     clusters, and leaves them in a k-d tree.  Returns its root */
+
+  double sums[256][4];
+  int    iter, i, k, root, dist;
+  OCTCLUST *cp;
+
+  root = kdBuild(kd, 0, ncols);
+
+  for (iter=0; iter<OCT_KMEANS; iter++) {
+    for (i=0; i<ncols; i++) sums[i][0] = sums[i][1] = sums[i][2] =
+			      sums[i][3] = 0.0;
+
+    for (i=0, cp=clusters; i<nclust; i++, cp++) {
+      k = -1;  dist = 0x7fffffff;
+      kdNearest(kd, root, (int) (cp->mean[0] + 0.5), (int) (cp->mean[1] + 0.5),
+		(int) (cp->mean[2] + 0.5), &k, &dist);
+      if (k < 0) continue;
+
+      sums[k][0] += cp->sr;  sums[k][1] += cp->sg;  sums[k][2] += cp->sb;
+      sums[k][3] += cp->n;
+    }
+
+    for (i=0; i<ncols; i++) {
+      if (sums[i][3] <= 0.0) continue;
+      kd[i].c[0] = (byte) (sums[i][0] / sums[i][3] + 0.5);
+      kd[i].c[1] = (byte) (sums[i][1] / sums[i][3] + 0.5);
+      kd[i].c[2] = (byte) (sums[i][2] / sums[i][3] + 0.5);
+    }
+
+    root = kdBuild(kd, 0, ncols);
+  }
+
+  return root;
+}
+
+
+static void octMapRows (void *data, int y0, int y1)
+{
+  /* maps rows y0..y1-1 to the closest colors, without dithering */
+
+  OCTMAPJOB *mj = (OCTMAPJOB *) data;
+  KDCACHE   *kc;
+  byte      *pp, *op;
+  int        x, y;
+
+  kc = (KDCACHE *) calloc((size_t) 1, sizeof(KDCACHE));
+  if (!kc) { mj->failed = 1;  return; }
+
+  pp = mj->pic24 + (size_t) y0 * mj->w * 3;
+  op = mj->pic8  + (size_t) y0 * mj->w;
+
+  for (y=y0; y<y1; y++) {
+    if (y0 == 0) {
+      if ((y&0x3f) == 0) WaitCursor();
+      ProgressMeter(0, y1-1, y, "24 -> 8");
+    }
+
+    for (x=0; x<mj->w; x++, pp+=3)
+      *op++ = (byte) kdLookup(mj->kd, mj->kdroot, kc, pp[0], pp[1], pp[2]);
+  }
+
+  free(kc);
+}
+
+
+static int kdBuild (KDNODE *kd, int lo, int hi)
+{
+  /* arranges the colors in kd[lo..hi-1] into a k-d tree, and returns its
+     root (or -1, if there aren't any) */
+
+  int   i, j, axis, m, range, bestrange, minc, maxc;
+  KDNODE tmp;
+
+  if (lo >= hi) return -1;
+
+  /* split along the component with the widest range */
+  axis = 0;  bestrange = -1;
+  for (j=0; j<3; j++) {
+    minc = 255;  maxc = 0;
+    for (i=lo; i<hi; i++) {
+      if (kd[i].c[j] < minc) minc = kd[i].c[j];
+      if (kd[i].c[j] > maxc) maxc = kd[i].c[j];
+    }
+    range = maxc - minc;
+    if (range > bestrange) { bestrange = range;  axis = j; }
+  }
+
+  /* (insertion) sort them on it.  There aren't many */
+  for (i=lo+1; i<hi; i++) {
+    tmp = kd[i];
+    for (j=i; j>lo && kd[j-1].c[axis] > tmp.c[axis]; j--) kd[j] = kd[j-1];
+    kd[j] = tmp;
+  }
+
+  m = (lo + hi) / 2;
+  kd[m].axis  = axis;
+  kd[m].left  = kdBuild(kd, lo, m);
+  kd[m].right = kdBuild(kd, m+1, hi);
+  return m;
+}
+
+
+static void kdNearest (KDNODE *kd, int n, int r, int g, int b, int *best, int *bestdist)
+{
+  /* looks for a color closer to r,g,b than *bestdist (squared) in the
+     subtree at 'n', and updates *best and *bestdist if it finds one */
+
+  KDNODE *kp;
+  int     dr, dg, db, dist, diff, near, far;
+
+  while (n >= 0) {
+    kp = &kd[n];
+    dr = r - kp->c[0];  dg = g - kp->c[1];  db = b - kp->c[2];
+    dist = dr*dr + dg*dg + db*db;
+    if (dist < *bestdist) { *bestdist = dist;  *best = n; }
+
+    diff = (kp->axis == 0) ? dr : (kp->axis == 1) ? dg : db;
+    if (diff < 0) { near = kp->left;   far = kp->right; }
+             else { near = kp->right;  far = kp->left;  }
+
+    /* look on the far side only if it could have anything closer */
+    if (far >= 0 && diff*diff < *bestdist) {
+      kdNearest(kd, near, r, g, b, best, bestdist);
+      if (diff*diff < *bestdist) n = far;
+      else break;
+    }
+    else n = near;
+  }
+}
+
+
+static int kdLookup (KDNODE *kd, int root, KDCACHE *kc, int r, int g, int b)
+{
+  /* returns the colormap entry closest to r,g,b */
+
+  u_int key;
+  int   h, best, bestdist;
+
+  key = 0x1000000 | ((u_int) r << 16) | ((u_int) g << 8) | (u_int) b;
+  h = (int) (((key * 2654435761U) & 0xffffffff) >> (32 - KDCACHEBITS));
+
+  if (kc->key[h] != key) {
+    best = 0;  bestdist = 0x7fffffff;
+    kdNearest(kd, root, r, g, b, &best, &bestdist);
+    kc->key[h] = key;
+    kc->idx[h] = (byte) best;
+  }
+
+  return kc->idx[h];
+}
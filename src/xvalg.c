@@ -4,6 +4,10 @@
  *  Contains:
  *         void AlgInit();
  *         void DoAlg(int algnum);
+ *         int  AlgApply24(algnum, pic24, w, h, results, sx, sy, sw, sh, p1, p2);
+ *
+ * AlgApply24() does the actual work, on any 24-bit image, and is part of
+ * the headless libxvcore (see xvcore.c).  The rest is the user interface.
  */
 
 #include "copyright.h"
@@ -15,6 +19,7 @@
 #endif
 
 
+#ifndef XV_HEADLESS
 static void NoAlg          PARM((void));
 static void Blur           PARM((void));
 static void Sharpen        PARM((void));
@@ -26,14 +31,25 @@ static void FineRotate     PARM((int));
 static void Pixelize       PARM((void));
 static void Spread         PARM((void));
 static void MedianFilter   PARM((void));
+static void GaussBlur      PARM((void));
 
 void saveOrigPic    PARM((void));
+#endif
 
 static void doBlurConvolv  PARM((byte *,int,int,byte *, int,int,int,int, int));
+static void doGaussBlur    PARM((byte *,int,int,byte *, int,int,int,int,
+				 double));
+static void gaussRows      PARM((void *, int, int));
+static void gaussCols      PARM((void *, int, int));
+static void boxLine        PARM((byte *, int, byte *, int, int, int));
+static int  boxBlur        PARM((byte *,int,byte *, int,int,int,int, int));
+static void boxBlurRows    PARM((void *, int, int));
 static void doSharpConvolv PARM((byte *,int,int,byte *, int,int,int,int, int));
 static void doEdgeConvolv  PARM((byte *,int,int,byte *, int,int,int,int));
 static void doAngleConvolv PARM((byte *,int,int,byte *, int,int,int,int));
 static void doOilPaint     PARM((byte *,int,int,byte *, int,int,int,int, int));
+static void oilRows        PARM((void *, int, int));
+static void oilUnslot      PARM((int *, int *, int, int));
 static void doBlend        PARM((byte *,int,int,byte *, int,int,int,int));
 static void doRotate       PARM((byte *,int,int,byte *, int,int,int,int,
 				 double, int));
@@ -42,6 +58,8 @@ static void doPixel        PARM((byte *,int,int,byte *, int,int,int,int,
 static void doSpread       PARM((byte *,int,int,byte *, int,int,int,int,
 				 int, int));
 static void doMedianFilter PARM((byte *,int,int,byte *, int,int,int,int, int));
+static void medianRows     PARM((void *, int, int));
+static void medianSortRows PARM((void *, int, int));
 static void add2bb         PARM((int *, int *, int *, int *, int, int));
 static void rotXfer        PARM((int, int, double *,double *,
 				 double,double, double));
@@ -50,36 +68,57 @@ static void rotXfer        PARM((int, int, double *,double *,
 static void intsort        PARM((int *, int));
 #endif
 
+#ifndef XV_HEADLESS
 int         start24bitAlg  PARM((byte **, byte **));
 void        end24bitAlg    PARM((byte *, byte *));
-void        printUTime     PARM((const char *));
 
 static byte origrmap[256], origgmap[256], origbmap[256];
-
-
-#undef TIMING_TEST
-
-#ifdef TIMING_TEST
-#include <sys/time.h>
-#include <sys/resource.h>
 #endif
 
 
-/***************************/
-void printUTime(const char *str)
-{
-  XV_UNUSED(str);
-#ifdef TIMING_TEST
-  int i;
-  struct rusage ru;
-
-  i = getrusage(RUSAGE_SELF, &ru);
-  fprintf(stderr,"%s: utime = %d.%d seconds\n",
-	    str, ru.ru_utime.tv_sec, ru.ru_utime.tv_usec);
-#endif
-}
-
-
+/* state shared by the threads working on one boxBlur() */
+typedef struct { byte *src, *dst;
+		 int   w;
+		 int   selx, sely, selw, selh;
+		 int   n;               /* mask size (odd) */
+		 int   failed;
+	       } BLURJOB;
+
+#define GAUSSSTRIP 16           /* columns doGaussBlur() does at a time */
+
+/* state shared by the threads working on one doGaussBlur() */
+typedef struct { byte *src, *dst;
+		 int   w;
+		 int   selx, sely, selw, selh;
+		 int   sizes[3];        /* the three box widths (odd) */
+		 int   failed;
+	       } GAUSSJOB;
+
+/* state shared by the threads working on one doOilPaint() */
+typedef struct { byte *src, *dst;
+		 int   w;
+		 int   selx, sely, selw, selh;
+		 int   n;               /* mask size (even) */
+		 int   failed;
+	       } OILJOB;
+
+/* where color 'rgb' would like to go in oilRows()' hash table */
+#define OILHASH(rgb, mask) \
+  ((int) ((((unsigned int) (rgb)) * 2654435761U) >> 8) & (mask))
+
+#define MEDSTRIP   128   /* columns doMedianFilter() does at a time */
+#define MEDSORTMAX 3     /* masks this size or less are sorted, instead */
+
+/* state shared by the threads working on one doMedianFilter() */
+typedef struct { byte *src, *dst;
+		 int   w;
+		 int   selx, sely, selw, selh;
+		 int   n;               /* mask size (odd) */
+		 int   failed;
+	       } MEDJOB;
+
+
+#ifndef XV_HEADLESS
 /************************************************************/
 void AlgInit(void)
 {
@@ -100,6 +139,8 @@ void DoAlg(int anum)
   /* called with a value from the algMB button.  Executes the specified
      algorithm */
 
+  if (anum != ALG_NONE) FullResPic();
+
   switch (anum) {
   case ALG_NONE:      NoAlg();        	break;
   case ALG_BLUR:      Blur();         	break;
@@ -113,6 +154,7 @@ void DoAlg(int anum)
   case ALG_PIXEL:     Pixelize();     	break;
   case ALG_SPREAD:    Spread();       	break;
   case ALG_MEDIAN:    MedianFilter(); 	break;
+  case ALG_GAUSS:     GaussBlur();    	break;
   }
 
   algMB.dim[ALG_NONE] = (origPic == (byte *) NULL);
@@ -188,9 +230,8 @@ static void Blur(void)
 	  (HaveSelection() ? "selection" : "image"), n,n);
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  doBlurConvolv(pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh, n);
+  AlgApply24(ALG_BLUR, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh,
+	     (double) n, 0.0);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -230,9 +271,8 @@ static void Sharpen(void)
 	  (HaveSelection() ? "selection" : "image"), n);
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  doSharpConvolv(pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh, n);
+  AlgApply24(ALG_SHARPEN, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh,
+	     (double) n, 0.0);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -242,9 +282,8 @@ static void Sharpen(void)
 /************************/
 static void EdgeDetect(void)
 {
-  byte *pic24, *p24, *tmpPic, *tlp;
-  const char *str;
-  int  i, j, v, maxv, sx,sy,sw,sh;
+  byte *pic24, *tmpPic;
+  int   sx,sy,sw,sh;
 
   WaitCursor();
 
@@ -252,33 +291,10 @@ static void EdgeDetect(void)
   else { sx = 0;  sy = 0;  sw = pWIDE;  sh = pHIGH; }
   CropRect2Rect(&sx,&sy,&sw,&sh, 0,0,pWIDE,pHIGH);
 
-  str = "Doing edge detection...";
-  SetISTR(ISTR_INFO, str);
+  SetISTR(ISTR_INFO, "Doing edge detection...");
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  doEdgeConvolv(pic24, pWIDE, pHIGH, tmpPic, sx,sy,sw,sh);
-
-  SetISTR(ISTR_INFO, "%snormalizing...", str);
-
-  /* Normalize results */
-  for (i=sy, maxv=0; i<sy+sh; i++) {              /* compute max value */
-    p24 = tmpPic + (i*pWIDE + sx) * 3;
-    for (j=sx; j<sx+sw; j++, p24+=3) {
-      v = MONO(p24[0], p24[1], p24[2]);
-      if (v>maxv) maxv = v;
-    }
-  }
-
-  for (i=sy; maxv>0 && i<sy+sh; i++) {            /* normalize */
-    p24 = tlp = tmpPic + (i*pWIDE + sx) * 3;
-    for (j=0; j<sw*3; j++) {
-      v = (((int) *p24) * 255) / maxv;
-      RANGE(v,0,255);
-      *p24++ = (byte) v;
-    }
-  }
+  AlgApply24(ALG_EDGE, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh, 0.0, 0.0);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -287,41 +303,19 @@ static void EdgeDetect(void)
 /************************/
 static void TinFoil(void)
 {
-  byte *pic24, *tmpPic, *tp, *tlp;
-  const char *str;
-  int  i, j, v, sx,sy,sw,sh;
+  byte *pic24, *tmpPic;
+  int   sx,sy,sw,sh;
 
   WaitCursor();
 
-  str = "Doing cheesy embossing effect...";
-  SetISTR(ISTR_INFO, str);
+  SetISTR(ISTR_INFO, "Doing cheesy embossing effect...");
 
   if (HaveSelection()) GetSelRCoords(&sx,&sy,&sw,&sh);
   else { sx = 0;  sy = 0;  sw = pWIDE;  sh = pHIGH; }
   CropRect2Rect(&sx,&sy,&sw,&sh, 0,0,pWIDE,pHIGH);
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  /* fill selected area of tmpPic with gray128 */
-  for (i=sy; i<sy+sh; i++) {
-    tp = tlp = tmpPic + (i*pWIDE + sx) * 3;
-    for (j=sx; j<sx+sw; j++) {
-      *tp++ = 128;  *tp++ = 128;  *tp++ = 128;
-    }
-  }
-
-  doAngleConvolv(pic24, pWIDE, pHIGH, tmpPic, sx,sy,sw,sh);
-
-  /* mono-ify selected area of tmpPic */
-  for (i=sy; i<sy+sh; i++) {
-    tp = tlp = tmpPic + (i*pWIDE + sx) * 3;
-    for (j=sx; j<sx+sw; j++, tp+=3) {
-      v = MONO(tp[0], tp[1], tp[2]);
-      RANGE(v,0,255);
-      tp[0] = tp[1] = tp[2] = (byte) v;
-    }
-  }
+  AlgApply24(ALG_TINF, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh, 0.0, 0.0);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -342,9 +336,7 @@ static void OilPaint(void)
   CropRect2Rect(&sx,&sy,&sw,&sh, 0,0,pWIDE,pHIGH);
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  doOilPaint(pic24, pWIDE, pHIGH, tmpPic, sx,sy,sw,sh, 3);
+  AlgApply24(ALG_OIL, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh, 3.0, 0.0);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -364,9 +356,7 @@ static void Blend(void)
   WaitCursor();
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  doBlend(pic24, pWIDE, pHIGH, tmpPic, sx,sy,sw,sh);
+  AlgApply24(ALG_BLEND, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh, 0.0, 0.0);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -399,9 +389,8 @@ static void FineRotate(int clr)
   WaitCursor();
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  doRotate(pic24, pWIDE, pHIGH, tmpPic, sx,sy,sw,sh, rotval, clr);
+  AlgApply24((clr ? ALG_ROTATECLR : ALG_ROTATE), pic24, pWIDE,pHIGH, tmpPic,
+	     sx,sy,sw,sh, rotval, 0.0);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -445,9 +434,8 @@ static void Pixelize(void)
   WaitCursor();
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  doPixel(pic24, pWIDE, pHIGH, tmpPic, sx,sy,sw,sh, pixX, pixY);
+  AlgApply24(ALG_PIXEL, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh,
+	     (double) pixX, (double) pixY);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -495,9 +483,8 @@ static void Spread(void)
   WaitCursor();
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
-
-  doSpread(pic24, pWIDE, pHIGH, tmpPic, sx,sy,sw,sh, pixX, pixY);
+  AlgApply24(ALG_SPREAD, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh,
+	     (double) pixX, (double) pixY);
 
   end24bitAlg(pic24, tmpPic);
 }
@@ -539,15 +526,169 @@ static void MedianFilter(void)
 	  (HaveSelection() ? "selection" : "image"), n,n);
 
   if (start24bitAlg(&pic24, &tmpPic)) return;
-  xvbcopy((char *) pic24, (char *) tmpPic, (size_t) (pWIDE*pHIGH*3));
+  AlgApply24(ALG_MEDIAN, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh,
+	     (double) n, 0.0);
+
+  end24bitAlg(pic24, tmpPic);
+}
+
+
+/************************/
+static void GaussBlur(void)
+{
+  /* blurs 'pic' with (something very close to) a gaussian of the given
+     standard deviation, producing a 24-bit version.  Then calls 24to8 to
+     generate a new 8-bit image, and installs it */
+
+  byte              *pic24, *tmpPic;
+  int                i, sx,sy,sw,sh;
+  double             sigma;
+  static const char *labels[] = { "\nOk", "\033Cancel" };
+  char               txt[256];
+  static char        buf[64] = { '2', '\0' };
+
+  sprintf(txt, "Gaussian Blur:                          \n\n%s",
+	  "Enter radius (standard deviation, in pixels)");
+
+  i = GetStrPopUp(txt, labels, 2, buf, 64, "0123456789.", 1);
+  if (i==1 || strlen(buf)==0) return;
+  sigma = atof(buf);
+
+  if (sigma <= 0.0) {
+    ErrPopUp("Error:  The value entered must be greater than zero.",
+	     "\nOh!");
+    return;
+  }
+
+  WaitCursor();
+
+  if (HaveSelection()) GetSelRCoords(&sx,&sy,&sw,&sh);
+  else { sx = 0;  sy = 0;  sw = pWIDE;  sh = pHIGH; }
+  CropRect2Rect(&sx,&sy,&sw,&sh, 0,0,pWIDE,pHIGH);
+
+  SetISTR(ISTR_INFO, "Gaussian blurring %s with radius %g...",
+	  (HaveSelection() ? "selection" : "image"), sigma);
 
-  doMedianFilter(pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh, n);
+  if (start24bitAlg(&pic24, &tmpPic)) return;
+  AlgApply24(ALG_GAUSS, pic24, pWIDE,pHIGH, tmpPic, sx,sy,sw,sh, sigma, 0.0);
 
   end24bitAlg(pic24, tmpPic);
 }
 
 
 
+#endif /* !XV_HEADLESS */
+
+
+/************************/
+int AlgApply24(int anum, byte *pic24, int w, int h, byte *results, int sx, int sy, int sw, int sh, double p1, double p2)
+{
+  /* runs algorithm 'anum' (an ALG_* value) over the sx,sy,sw,sh part of the
+     w*h 24-bit image 'pic24'.  The whole image, with that part changed, ends
+     up in 'results', which must be w*h*3 bytes, too.
+
+     p1 is the mask size for Blur, OilPaint and DeSpeckle, the percentage
+     for Sharpen, the angle for Rotate, and the standard deviation for
+     Gaussian Blur.  p1,p2 are the x,y sizes for
+     Pixelize and Spread.  Returns '1' if 'anum' is something it doesn't do */
+
+  byte *p24, *tp;
+  int   i, j, v, maxv;
+
+  xvbcopy((char *) pic24, (char *) results, (size_t) w*h*3);
+
+  switch (anum) {
+  case ALG_BLUR:
+    doBlurConvolv(pic24, w, h, results, sx,sy,sw,sh, (int) p1);
+    break;
+
+  case ALG_SHARPEN:
+    doSharpConvolv(pic24, w, h, results, sx,sy,sw,sh, (int) p1);
+    break;
+
+  case ALG_EDGE:
+    doEdgeConvolv(pic24, w, h, results, sx,sy,sw,sh);
+
+    SetISTR(ISTR_INFO, "Doing edge detection...normalizing...");
+
+    /* Normalize results */
+    for (i=sy, maxv=0; i<sy+sh; i++) {              /* compute max value */
+      p24 = results + (i*w + sx) * 3;
+      for (j=sx; j<sx+sw; j++, p24+=3) {
+	v = MONO(p24[0], p24[1], p24[2]);
+	if (v>maxv) maxv = v;
+      }
+    }
+
+    for (i=sy; maxv>0 && i<sy+sh; i++) {            /* normalize */
+      p24 = results + (i*w + sx) * 3;
+      for (j=0; j<sw*3; j++) {
+	v = (((int) *p24) * 255) / maxv;
+	RANGE(v,0,255);
+	*p24++ = (byte) v;
+      }
+    }
+    break;
+
+  case ALG_TINF:
+    /* fill selected area of results with gray128 */
+    for (i=sy; i<sy+sh; i++) {
+      tp = results + (i*w + sx) * 3;
+      for (j=sx; j<sx+sw; j++) {
+	*tp++ = 128;  *tp++ = 128;  *tp++ = 128;
+      }
+    }
+
+    doAngleConvolv(pic24, w, h, results, sx,sy,sw,sh);
+
+    /* mono-ify selected area of results */
+    for (i=sy; i<sy+sh; i++) {
+      tp = results + (i*w + sx) * 3;
+      for (j=sx; j<sx+sw; j++, tp+=3) {
+	v = MONO(tp[0], tp[1], tp[2]);
+	RANGE(v,0,255);
+	tp[0] = tp[1] = tp[2] = (byte) v;
+      }
+    }
+    break;
+
+  case ALG_OIL:
+    doOilPaint(pic24, w, h, results, sx,sy,sw,sh, (int) p1);
+    break;
+
+  case ALG_BLEND:
+    doBlend(pic24, w, h, results, sx,sy,sw,sh);
+    break;
+
+  case ALG_ROTATE:
+  case ALG_ROTATECLR:
+    doRotate(pic24, w, h, results, sx,sy,sw,sh, p1, (anum==ALG_ROTATECLR));
+    break;
+
+  case ALG_PIXEL:
+    doPixel(pic24, w, h, results, sx,sy,sw,sh, (int) p1, (int) p2);
+    break;
+
+  case ALG_SPREAD:
+    doSpread(pic24, w, h, results, sx,sy,sw,sh, (int) p1, (int) p2);
+    break;
+
+  case ALG_MEDIAN:
+    doMedianFilter(pic24, w, h, results, sx,sy,sw,sh, (int) p1);
+    break;
+
+  case ALG_GAUSS:
+    doGaussBlur(pic24, w, h, results, sx,sy,sw,sh, p1);
+    break;
+
+  default:
+    return 1;
+  }
+
+  return 0;
+}
+
+
 /************************/
 static void doBlurConvolv(byte *pic24, int w, int h, byte *results, int selx, int sely, int selw, int selh, int n)
 {
@@ -555,62 +696,302 @@ static void doBlurConvolv(byte *pic24, int w, int h, byte *results, int selx, in
   /* convolves with an n*n array, consisting of only 1's.
      Operates on rectangular region 'selx,sely,selw,selh' (in pic coords)
      Region is guaranteed to be completely within pic boundaries
-     'n' must be odd */
+     'n' must be odd.  Only the part of the mask that's inside the
+     region is averaged */
 
-  register byte *p24;
-  register int   rsum,gsum,bsum;
-  byte          *rp;
-  int            x,y,x1,y1,count,n2;
+  TraceBegin("blurConvolv", (const char *) NULL);
 
+  if (boxBlur(pic24, w, results, selx,sely,selw,selh, n))
+    FatalError("can't malloc in doBlurConvolv()\n");
 
-  printUTime("start of blurConvolv");
+  TraceEnd("blurConvolv");
+}
 
-  n2 = n/2;
 
-  for (y=sely; y<sely+selh; y++) {
-    ProgressMeter(sely, (sely+selh)-1, y, "Blur");
-    if ((y & 15) == 0) WaitCursor();
+/************************/
+static void doGaussBlur(byte *pic24, int w, int h, byte *results, int selx, int sely, int selw, int selh, double sigma)
+{
+  /* approximates a gaussian blur (of std. deviation 'sigma') of the region
+     'selx,sely,selw,selh' with three box blurs in a row.  The box sizes
+     are picked so that the three together have the same variance as the
+     gaussian.  (Wells, "Efficient Synthesis of Gaussian Filters by Cascaded
+     Uniform Filters", 1986.)  Like Blur, the edges of the region are
+     handled by only averaging the part of each box that's inside it.
+
+     A box blur is a blur along the rows followed by one down the columns,
+     so all three are done along each row (from pic24 into results), and
+     then all three down each column of results.  So the scratch space is
+     just a couple of rows (or strips of a few columns) per thread */
+
+  GAUSSJOB gj;
+  int      i, wl, m;
+  double   wideal;
 
-    p24 = pic24   + y*w*3 + selx*3;
-    rp  = results + y*w*3 + selx*3;
+  XV_UNUSED(h);
 
-    for (x=selx; x<selx+selw; x++) {
+  /* the ideal (real-valued) width, then the odd widths either side of it,
+     and how many of the passes should use the smaller one */
+  wideal = sqrt(12.0 * sigma * sigma / 3.0 + 1.0);
+  wl = (int) floor(wideal);
+  if ((wl & 1) == 0) wl--;
+  if (wl < 1) wl = 1;
+  m = (int) floor((12.0*sigma*sigma - 3*wl*wl - 12*wl - 9) / (-4.0*wl - 4.0)
+		  + 0.5);
+  for (i=0; i<3; i++) gj.sizes[i] = (i < m) ? wl : wl + 2;
 
-      rsum = gsum = bsum = 0;  count = 0;
+  if (selw < 1 || selh < 1) return;
 
-      for (y1=y-n2; y1<=y+n2; y1++) {
+  gj.src  = pic24;  gj.dst  = results;  gj.w = w;
+  gj.selx = selx;   gj.sely = sely;     gj.selw = selw;  gj.selh = selh;
+  gj.failed = 0;
 
-	if (y1>=sely && y1<sely+selh) {
-	  p24 = pic24 + y1*w*3 +(x-n2)*3;
+  TraceBegin("gaussBlur", (const char *) NULL);
 
-	  for (x1=x-n2; x1<=x+n2; x1++) {
-	    if (x1>=selx && x1<selx+selw) {
-	      rsum += *p24++;
-	      gsum += *p24++;
-	      bsum += *p24++;
-	      count++;
-	    }
-	    else p24 += 3;
-	  }
-	}
+  DoRowBands(selh, gaussRows, (void *) &gj);
+  if (!gj.failed) DoRowBands(selw, gaussCols, (void *) &gj);
+
+  TraceEnd("gaussBlur");
+
+  if (gj.failed) FatalError("can't malloc in doGaussBlur()\n");
+}
+
+
+/************************/
+static void gaussRows(void *data, int y0, int y1)
+{
+  /* does the three blurs along rows [y0,y1) (from the top of the region) of
+     a doGaussBlur(), from gj->src into gj->dst */
+
+  GAUSSJOB *gj = (GAUSSJOB *) data;
+  byte     *a, *b, *sp, *dp;
+  int       y, selw;
+
+  selw = gj->selw;
+  a = (byte *) malloc((size_t) selw * 3);
+  b = (byte *) malloc((size_t) selw * 3);
+  if (!a || !b) {
+    gj->failed = 1;
+    if (a) free(a);
+    if (b) free(b);
+    return;
+  }
+
+  for (y=y0; y<y1; y++) {
+    if (y0 == 0) {
+      ProgressMeter(0, 2*y1-1, y, "Blur");
+      if ((y & 15) == 0) WaitCursor();
+    }
+
+    sp = gj->src + ((size_t) (gj->sely + y) * gj->w + gj->selx) * 3;
+    dp = gj->dst + ((size_t) (gj->sely + y) * gj->w + gj->selx) * 3;
+
+    boxLine(sp, 3, a,  3, selw, gj->sizes[0]);
+    boxLine(a,  3, b,  3, selw, gj->sizes[1]);
+    boxLine(b,  3, dp, 3, selw, gj->sizes[2]);
+  }
+
+  free(a);  free(b);
+}
+
+
+/************************/
+static void gaussCols(void *data, int x0, int x1)
+{
+  /* does the three blurs down columns [x0,x1) (from the left of the region)
+     of a doGaussBlur(), in place in gj->dst.  The columns are copied out
+     GAUSSSTRIP at a time, so it's reading along rows, not down them */
+
+  GAUSSJOB *gj = (GAUSSJOB *) data;
+  byte     *a, *b, *cp;
+  int       x, y, i, nx, step, selh;
+
+  selh = gj->selh;
+  a = (byte *) malloc((size_t) selh * GAUSSSTRIP * 3);
+  b = (byte *) malloc((size_t) selh * GAUSSSTRIP * 3);
+  if (!a || !b) {
+    gj->failed = 1;
+    if (a) free(a);
+    if (b) free(b);
+    return;
+  }
+
+  for (x=x0; x<x1; x+=nx) {
+    nx   = (x1 - x < GAUSSSTRIP) ? x1 - x : GAUSSSTRIP;
+    step = nx * 3;
+
+    if (x0 == 0) {
+      ProgressMeter(0, 2*x1-1, x1+x, "Blur");
+      WaitCursor();
+    }
+
+    cp = gj->dst + ((size_t) gj->sely * gj->w + gj->selx + x) * 3;
+    for (y=0; y<selh; y++)
+      xvbcopy((char *) cp + (size_t) y * gj->w * 3, (char *) a + y * step,
+	      (size_t) step);
+
+    for (i=0; i<nx; i++) {
+      boxLine(a + i*3, step, b + i*3, step, selh, gj->sizes[0]);
+      boxLine(b + i*3, step, a + i*3, step, selh, gj->sizes[1]);
+      boxLine(a + i*3, step, b + i*3, step, selh, gj->sizes[2]);
+    }
+
+    for (y=0; y<selh; y++)
+      xvbcopy((char *) b + y * step, (char *) cp + (size_t) y * gj->w * 3,
+	      (size_t) step);
+  }
+
+  free(a);  free(b);
+}
+
+
+/************************/
+static void boxLine(byte *src, int sstep, byte *dst, int dstep, int len, int n)
+{
+  /* sets each of the 'len' pixels of 'dst' to the (rounded) average of the
+     'n' pixels around it in 'src', counting only the ones that are there.
+     'sstep' and 'dstep' are the distances between pixels, in bytes, so it
+     does columns as well as rows */
+
+  byte *sp, *dp;
+  int   x, n2, xl, xr, cnt, rsum, gsum, bsum;
+
+  n2 = n / 2;
+  rsum = gsum = bsum = 0;
+  for (x=0, sp=src; x<=n2 && x<len; x++, sp+=sstep) {
+    rsum += sp[0];  gsum += sp[1];  bsum += sp[2];
+  }
+
+  for (x=0, dp=dst; x<len; x++, dp+=dstep) {
+    xl  = (x-n2 < 0) ? 0 : x-n2;
+    xr  = (x+n2 >= len) ? len-1 : x+n2;
+    cnt = xr - xl + 1;
+
+    dp[0] = (byte) ((rsum + cnt/2) / cnt);
+    dp[1] = (byte) ((gsum + cnt/2) / cnt);
+    dp[2] = (byte) ((bsum + cnt/2) / cnt);
+
+    if (x-n2 >= 0) {
+      sp = src + (x-n2) * sstep;
+      rsum -= sp[0];  gsum -= sp[1];  bsum -= sp[2];
+    }
+    if (x+n2+1 < len) {
+      sp = src + (x+n2+1) * sstep;
+      rsum += sp[0];  gsum += sp[1];  bsum += sp[2];
+    }
+  }
+}
+
+
+/************************/
+static int boxBlur(byte *src, int w, byte *dst, int selx, int sely, int selw, int selh, int n)
+{
+  /* sets each pixel of the 'selx,sely,selw,selh' region of 'dst' to the
+     average of the n*n box around that pixel in 'src' (both w pixels wide),
+     counting only the part of the box that's inside the region.  The rows
+     are split up across threads.  Returns '1' if it ran out of memory */
+
+  BLURJOB bj;
+
+  if (selw < 1 || selh < 1) return 0;
+
+  bj.src  = src;   bj.dst  = dst;   bj.w = w;
+  bj.selx = selx;  bj.sely = sely;  bj.selw = selw;  bj.selh = selh;
+  bj.n    = n;
+  bj.failed = 0;
+
+  DoRowBands(selh, boxBlurRows, (void *) &bj);
+
+  return bj.failed;
+}
+
+
+/************************/
+static void boxBlurRows(void *data, int y0, int y1)
+{
+  /* does rows [y0,y1) (from the top of the region) of a boxBlur().  Keeps,
+     for each column of the region, the sum of the rows of the box that are
+     inside it, adding a row at the bottom and dropping one off the top as
+     it moves down.  Then does the same thing with those sums along each
+     row.  So it doesn't matter how big 'n' is:  it's a couple of adds and
+     subtracts per pixel, either way */
+
+  BLURJOB *bj = (BLURJOB *) data;
+  byte    *sp, *dp;
+  int     *colsum, *cp;
+  int      x, y, i, n2, top, bot, stride, rowlen, ytop, ybot, cy;
+  int      xl, xr, cnt, rsum, gsum, bsum;
+
+  n2     = bj->n / 2;
+  stride = bj->w * 3;
+  rowlen = bj->selw * 3;
+  top    = bj->sely;                   /* the region's rows, in pic coords */
+  bot    = bj->sely + bj->selh - 1;
+
+  colsum = (int *) malloc(rowlen * sizeof(int));
+  if (!colsum) { bj->failed = 1;  return; }
+
+#define ROWP(pic, y)  ((pic) + (size_t) (y) * stride + bj->selx * 3)
+
+  /* the column sums for the first row of this band */
+  for (i=0; i<rowlen; i++) colsum[i] = 0;
+  ytop = top + y0 - n2;  if (ytop < top) ytop = top;
+  ybot = top + y0 + n2;  if (ybot > bot) ybot = bot;
+  for (y=ytop; y<=ybot; y++) {
+    sp = ROWP(bj->src, y);
+    for (i=0; i<rowlen; i++) colsum[i] += sp[i];
+  }
+
+  for (y=top+y0; y<top+y1; y++) {
+    if (y0 == 0) {
+      ProgressMeter(0, y1-1, y-top, "Blur");
+      if (((y-top) & 15) == 0) WaitCursor();
+    }
+
+    if (y > top+y0) {          /* slide the box down a row */
+      if (y-n2-1 >= top) {
+	sp = ROWP(bj->src, y-n2-1);
+	for (i=0; i<rowlen; i++) colsum[i] -= sp[i];
       }
+      if (y+n2 <= bot) {
+	sp = ROWP(bj->src, y+n2);
+	for (i=0; i<rowlen; i++) colsum[i] += sp[i];
+      }
+    }
 
-      rsum = rsum / count;
-      gsum = gsum / count;
-      bsum = bsum / count;
+    ytop = (y-n2 < top) ? top : y-n2;
+    ybot = (y+n2 > bot) ? bot : y+n2;
+    cy   = ybot - ytop + 1;
 
-      RANGE(rsum,0,255);
-      RANGE(gsum,0,255);
-      RANGE(bsum,0,255);
+    /* now the same thing along the row, over the column sums */
+    rsum = gsum = bsum = 0;
+    for (x=0, cp=colsum; x<=n2 && x<bj->selw; x++, cp+=3) {
+      rsum += cp[0];  gsum += cp[1];  bsum += cp[2];
+    }
 
-      *rp++ = (byte) rsum;
-      *rp++ = (byte) gsum;
-      *rp++ = (byte) bsum;
+    dp = ROWP(bj->dst, y);
+    for (x=0; x<bj->selw; x++) {
+      xl  = (x-n2 < 0) ? 0 : x-n2;
+      xr  = (x+n2 >= bj->selw) ? bj->selw-1 : x+n2;
+      cnt = (xr - xl + 1) * cy;
+
+      *dp++ = (byte) (rsum / cnt);
+      *dp++ = (byte) (gsum / cnt);
+      *dp++ = (byte) (bsum / cnt);
+
+      if (x-n2 >= 0) {
+	cp = colsum + (x-n2) * 3;
+	rsum -= cp[0];  gsum -= cp[1];  bsum -= cp[2];
+      }
+      if (x+n2+1 < bj->selw) {
+	cp = colsum + (x+n2+1) * 3;
+	rsum += cp[0];  gsum += cp[1];  bsum += cp[2];
+      }
     }
   }
 
+#undef ROWP
 
-  printUTime("end of blurConvolv");
+  free(colsum);
 }
 
 
@@ -626,8 +1007,6 @@ static void doSharpConvolv(byte *pic24, int w, int h, byte *results, int selx, i
   double fact, ifact, hue,sat,val, vsum;
   double *linem1, *line0, *linep1, *tmpptr;
 
-  printUTime("start of sharpConvolv");
-
   fact  = n / 100.0;
   ifact = 1.0 - fact;
 
@@ -646,6 +1025,8 @@ static void doSharpConvolv(byte *pic24, int w, int h, byte *results, int selx, i
     return;
   }
 
+  TraceBegin("sharpConvolv", (const char *) NULL);
+
 
   /* load up line arrays */
   p24 = pic24 + (((sely+1)-1)*w + selx) * 3;
@@ -702,7 +1083,7 @@ static void doSharpConvolv(byte *pic24, int w, int h, byte *results, int selx, i
 
   free(linem1);  free(line0);  free(linep1);
 
-  printUTime("end of sharpConvolv");
+  TraceEnd("sharpConvolv");
 }
 
 
@@ -739,7 +1120,7 @@ static void doEdgeConvolv(byte *pic24, int w, int h, byte *results, int selx, in
   int            x, y;
 
 
-  printUTime("start of edgeConvolv");
+  TraceBegin("edgeConvolv", (const char *) NULL);
 
   bperlin = w * 3;
 
@@ -796,7 +1177,7 @@ static void doEdgeConvolv(byte *pic24, int w, int h, byte *results, int selx, in
     }
   }
 
-  printUTime("end of edgeConvolv");
+  TraceEnd("edgeConvolv");
 }
 
 
@@ -825,7 +1206,7 @@ static void doAngleConvolv(byte *pic24, int w, int h, byte *results, int selx, i
   int            x,y;
 
 
-  printUTime("start of doAngleConvolv");
+  TraceBegin("doAngleConvolv", (const char *) NULL);
 
   bperlin = w * 3;
 
@@ -879,7 +1260,7 @@ static void doAngleConvolv(byte *pic24, int w, int h, byte *results, int selx, i
     }
   }
 
-  printUTime("end of edgeConvolv");
+  TraceEnd("doAngleConvolv");
 }
 
 
@@ -906,68 +1287,178 @@ static void doOilPaint(byte *pic24, int w, int h, byte *results, int selx, int s
      (jhb, 6/94)  */
 
 
-  register byte *pp;
-  register int   bperlin;
-  byte          *rp, *p24, *plin;
-  int            i,j,k,x,y,n2,col,cnt,maxcnt;
-  int           *nnrect;
+  /* That's the most common color in the mask, or the first of them (going
+     across, then down) to appear, if there's a tie.  It's done by keeping
+     a count of each color in the mask as it slides along the row (see
+     oilRows()), rather than counting them all up for every pixel */
+
+  OILJOB oj;
 
-  printUTime("start of doOilPaint");
+  TraceBegin("doOilPaint", (const char *) NULL);
 
   if (n & 1) n++;   /* n must be odd */
 
-  bperlin = w * 3;
-  n2 = n/2;
+  oj.src  = pic24;  oj.dst  = results;  oj.w = w;
+  oj.selx = selx;   oj.sely = sely;     oj.selw = selw;  oj.selh = selh;
+  oj.n    = n;      oj.failed = 0;
+
+  if (selw > 0 && selh > 0) DoRowBands(selh, oilRows, (void *) &oj);
+  if (oj.failed) FatalError("can't malloc in doOilPaint()\n");
 
-  /* nnrect[] is an n*n array of ints, with '-1' meaning 'outside the region'
-     otherwise they'll have 24-bit RGB values */
+  TraceEnd("doOilPaint");
+}
 
-  nnrect = (int *) malloc(n * n * sizeof(int));
-  if (!nnrect) FatalError("can't malloc nnrect[] in doOilPaint()\n");
 
-  for (y=sely; y<sely+selh; y++) {
-    if ((y & 15) == 0) WaitCursor();
-    ProgressMeter(sely, (sely+selh)-1, y, "Oil Paint");
+/************************/
+static void oilRows(void *data, int y0, int y1)
+{
+  /* does rows [y0,y1) (from the top of the region) of a doOilPaint().
+
+     The mask for x,y is rows y-n/2 .. y+n/2-1 and columns x-n/2 .. x+n/2-1
+     (n is even), or as much of that as is inside the region.  The colors
+     in it are counted in a little hash table (keys[], counts[]), with one
+     column of the mask added and one dropped as it moves along.  freq[c]
+     is how many colors have a count of 'c', which makes it easy to keep
+     track of the biggest count.  Then the first pixel in the mask with a
+     color that has that many is the answer.  That's usually found right
+     away */
+
+  OILJOB *oj = (OILJOB *) data;
+  byte   *src, *sp, *dp;
+  int    *keys, *counts, *freq;
+  int     n, n2, x, y, i, j, k, xl, xr, ytop, ybot, col, rgb, c, mask, maxcnt;
+  int     w, selx, sely, selw, selh;
+
+  /* (in locals, as the stores to 'dp' could, as far as the compiler knows,
+     have changed any of them) */
+  src  = oj->src;   w    = oj->w;     n    = oj->n;
+  selx = oj->selx;  sely = oj->sely;  selw = oj->selw;  selh = oj->selh;
+
+  n2 = n / 2;
+
+  /* never more than n*n colors in it, so it's at most 1/4 full */
+  for (mask=63; mask+1 < 4 * n * n; mask = mask*2 + 1);
+
+  keys   = (int *) malloc((mask+1) * sizeof(int));
+  counts = (int *) malloc((mask+1) * sizeof(int));
+  freq   = (int *) malloc((n * n + 1) * sizeof(int));
+  if (!keys || !counts || !freq) {
+    if (keys)   free(keys);
+    if (counts) free(counts);
+    if (freq)   free(freq);
+    oj->failed = 1;
+    return;
+  }
 
-    p24 = pic24 + ((y-n2)*w + selx-n2)*3;   /* pts to top-left of mask */
-    rp  = results + (y*w + selx)*3;
+#define PIXP(x, y)  (src + ((size_t) (y) * w + (x)) * 3)
+#define PIXRGB(p)   ((((int) (p)[0])<<16) | (((int) (p)[1])<<8) | (p)[2])
 
-    for (x=selx; x<selx+selw; x++) {
-      /* fill 'nnrect' with valid pixels from n*n region centered round x,y */
-      pp = plin = p24;
-      for (i=y-n2, k=0; i<y+n2; i++) {
-	for (j=x-n2; j<x+n2; j++, k++, pp+=3) {
-	  if (i>=sely && i<sely+selh && j>=selx && j<selx+selw) {
-	    nnrect[k] = (((int) pp[0])<<16) | (((int) pp[1])<<8) | pp[2];
-	  }
-	  else nnrect[k] = -1;
-	}
-	plin += bperlin;  pp = plin;
-      }
+  /* sets 'k' to the slot for color 'rgb':  where it is, or where it'd go */
+#define SLOT(rgb) { \
+    k = OILHASH(rgb, mask); \
+    while (keys[k] != -1 && keys[k] != (rgb)) k = (k+1) & mask; \
+  }
 
+  /* adds column 'x' of the mask to the counts */
+#define ADDCOL(x) { \
+    for (i=ytop, sp=PIXP(x, ytop); i<=ybot; i++, sp+=w*3) { \
+      rgb = PIXRGB(sp); \
+      SLOT(rgb); \
+      if (keys[k] == -1) { keys[k] = rgb;  counts[k] = 0; } \
+      c = counts[k]++; \
+      freq[c]--;  freq[c+1]++; \
+      if (c+1 > maxcnt) maxcnt = c+1; \
+    } \
+  }
 
-      /* find 'most popular color' in nnrect, not counting '-1' */
-      maxcnt = cnt = col = 0;
-      for (i=0; i<n*n; i++) {
-	if (nnrect[i] != -1) {
-	  cnt = 1;
-	  for (j=i+1; j<n*n; j++) { /* count it */
-	    if (nnrect[i] == nnrect[j]) cnt++;
-	  }
-	  if (cnt>maxcnt) { col = nnrect[i];  maxcnt = cnt; }
+  /* and takes one out */
+#define DELCOL(x) { \
+    for (i=ytop, sp=PIXP(x, ytop); i<=ybot; i++, sp+=w*3) { \
+      rgb = PIXRGB(sp); \
+      SLOT(rgb); \
+      c = counts[k]--; \
+      if (c == 1) oilUnslot(keys, counts, mask, k); \
+      freq[c]--;  freq[c-1]++; \
+      if (maxcnt > 0 && !freq[maxcnt]) maxcnt--; \
+    } \
+  }
+
+  for (y=sely+y0; y<sely+y1; y++) {
+    if (y0 == 0) {
+      if ((y & 15) == 0) WaitCursor();
+      ProgressMeter(sely, (sely+y1)-1, y, "Oil Paint");
+    }
+
+    ytop = y - n2;    if (ytop < sely) ytop = sely;
+    ybot = y + n2-1;  if (ybot > sely + selh - 1) ybot = sely + selh - 1;
+
+    for (i=0; i<=mask; i++) keys[i] = -1;
+    for (i=0; i<=n * n; i++) freq[i] = 0;
+    maxcnt = 0;
+
+    /* the mask for the first pixel of the row */
+    xl = selx - n2;      if (xl < selx) xl = selx;
+    xr = selx + n2 - 1;  if (xr > selx + selw - 1) xr = selx + selw - 1;
+    for (x=xl; x<=xr; x++) ADDCOL(x);
+
+    dp = oj->dst + ((size_t) y * w + selx) * 3;
+
+    for (x=selx; x<selx+selw; x++) {
+      xl = x - n2;      if (xl < selx) xl = selx;
+      xr = x + n2 - 1;  if (xr > selx + selw - 1) xr = selx + selw - 1;
+
+      /* find the first pixel whose color has the biggest count */
+      col = 0;
+      for (i=ytop; i<=ybot && maxcnt > 0; i++) {
+	for (j=xl, sp=PIXP(xl, i); j<=xr; j++, sp+=3) {
+	  rgb = PIXRGB(sp);
+	  SLOT(rgb);
+	  if (counts[k] == maxcnt) break;
 	}
+	if (j<=xr) { col = rgb;  break; }
       }
 
-      *rp++ = (byte) ((col>>16) & 0xff);
-      *rp++ = (byte) ((col>>8)  & 0xff);
-      *rp++ = (byte) ((col)     & 0xff);
+      *dp++ = (byte) ((col>>16) & 0xff);
+      *dp++ = (byte) ((col>>8)  & 0xff);
+      *dp++ = (byte) ((col)     & 0xff);
 
-      p24 += 3;
+      /* slide the mask one to the right */
+      if (x - n2 >= selx) DELCOL(x - n2);
+      if (x + n2 < selx + selw) ADDCOL(x + n2);
     }
   }
 
-  free(nnrect);
-  printUTime("end of doOilPaint");
+#undef DELCOL
+#undef ADDCOL
+#undef SLOT
+#undef PIXRGB
+#undef PIXP
+
+  free(keys);  free(counts);  free(freq);
+}
+
+
+/************************/
+static void oilUnslot(int *keys, int *counts, int mask, int k)
+{
+  /* empties slot 'k' of oilRows()' hash table, and moves any of the
+     colors after it that can't be found without it back into the gap */
+
+  int j, h;
+
+  keys[k] = -1;
+
+  for (j = (k+1) & mask;  keys[j] != -1;  j = (j+1) & mask) {
+    h = OILHASH(keys[j], mask);
+
+    /* leave it if it's already somewhere between where it hashes to, and
+       where it is */
+    if ((j > k) ? (h > k && h <= j) : (h > k || h <= j)) continue;
+
+    keys[k] = keys[j];  counts[k] = counts[j];
+    keys[j] = -1;
+    k = j;
+  }
 }
 
 
@@ -990,7 +1481,7 @@ static void doBlend(byte *pic24, int w, int h, byte *results, int selx, int sely
 
   if (selw<3 || selh<3) return;        /* too small to blend */
 
-  printUTime("start of blend");
+  TraceBegin("blend", (const char *) NULL);
 
   /*** COMPUTE COLOR OF CENTER POINT ***/
 
@@ -1076,7 +1567,7 @@ static void doBlend(byte *pic24, int w, int h, byte *results, int selx, int sely
     }
   }
 
-  printUTime("end of blend");
+  TraceEnd("blend");
 }
 
 
@@ -1099,7 +1590,7 @@ static void doRotate(byte *pic24, int w, int h, byte *results, int selx, int sel
 
   if (selw<1 || selh<1) return;
 
-  printUTime("start of rotate");
+  TraceBegin("rotate", (const char *) NULL);
 
   /*
    * cfx,cfy  -  center point of sel rectangle (double)
@@ -1255,7 +1746,7 @@ if (0)	{
       }
     }
   }
-  printUTime("end of rotate");
+  TraceEnd("rotate");
 }
 
 
@@ -1310,7 +1801,7 @@ static void doPixel(byte *pic24, int w, int h, byte *results, int selx, int sely
   int    nwide, nhigh, i,j, x,y, x1,y1, stx,sty;
   int    nsum, rsum, gsum, bsum;
 
-  printUTime("start of pixelize");
+  TraceBegin("pixelize", (const char *) NULL);
 
   /* center grid on selection */
   nwide = (selw + pixX-1) / pixX;
@@ -1358,7 +1849,7 @@ static void doPixel(byte *pic24, int w, int h, byte *results, int selx, int sely
     }
   }
 
-  printUTime("end of pixelize");
+  TraceEnd("pixelize");
 }
 
 
@@ -1384,7 +1875,7 @@ static void doSpread(byte *pic24, int w, int h, byte *results, int selx, int sel
   time(&nowT);
   srandom((unsigned int) nowT);
 
-  printUTime("start of spread");
+  TraceBegin("spread", (const char *) NULL);
 
   for (y=sely; y<sely+selh; y++) {
     ProgressMeter(sely, sely+selh-1, y, "Spread");
@@ -1430,7 +1921,7 @@ static void doSpread(byte *pic24, int w, int h, byte *results, int selx, int sel
       }
     }
   }
-  printUTime("end of spread");
+  TraceEnd("spread");
 }
 
 
@@ -1442,39 +1933,240 @@ static void doMedianFilter(byte *pic24, int w, int h, byte *results, int selx, i
   /* runs the median filter algorithm
      Operates on rectangular region 'selx,sely,selw,selh' (in pic coords)
      Region is guaranteed to be completely within pic boundaries
-     'n' must be odd */
+     'n' must be odd.  Only the part of the mask that's inside the region
+     counts, and if that's an even number of pixels, the two middle values
+     are averaged.
 
-  byte *p24;
-  /* int   rsum,gsum,bsum; */
-  byte          *rp;
-  int            x,y,x1,y1,count,n2,nsq,c2;
+     Rather than sorting the n*n values around each pixel, it keeps a
+     histogram of each column of the mask, and slides them down the rows.
+     (Perreault & Hebert, "Median Filtering in Constant Time", 2007.)  See
+     medianRows().  For the smallest masks, just sorting them is quicker */
+
+  MEDJOB mj;
+
+  if (selw < 1 || selh < 1) return;
+
+  TraceBegin("doMedianFilter", (const char *) NULL);
+
+  mj.src  = pic24;  mj.dst  = results;  mj.w = w;
+  mj.selx = selx;   mj.sely = sely;     mj.selw = selw;  mj.selh = selh;
+  mj.n    = n;      mj.failed = 0;
+
+  DoRowBands(selh, (n <= MEDSORTMAX) ? medianSortRows : medianRows,
+	     (void *) &mj);
+  if (mj.failed) FatalError("can't malloc in doMedianFilter!");
+
+  TraceEnd("doMedianFilter");
+}
+
+
+/************************/
+static void medianRows(void *data, int y0, int y1)
+{
+  /* does rows [y0,y1) (from the top of the region) of a doMedianFilter().
+
+     Each column has a 256-bin histogram, per channel, of the pixels of the
+     mask in that column, and a 16-bin 'coarse' one (the top 4 bits).
+     Moving down a row is one add and one subtract per column.  Along the
+     row, the mask's coarse histogram is kept up to date the same way,
+     column histograms in and out, so finding which 16 values the median
+     is among takes a quick scan.  The mask's fine histogram is only
+     brought up to date for that group of 16, when it's needed.  None of
+     it depends on 'n', apart from setting up.
+
+     The histograms for a whole row of columns would be far too big to stay
+     in the cache, so the band is done in strips of MEDSTRIP columns, each
+     from top to bottom.  A strip's columns are padded with n/2 more on
+     either side:  its neighbors' (the mask overlaps them), or empty ones,
+     past the ends of the region */
+
+  MEDJOB *mj = (MEDJOB *) data;
+  byte   *sp, *dp;
+  int    *fine, *coarse, *cf, *cc, *kf, *kc, *luc;
+  int     n, n2, ncols, top, bot, x, y, c, i, j, k, v, e, sx0, sx1, cx0, cx1;
+  int     ytop, ybot, cy, cnt, rank, val[2];
+
+  n  = mj->n;  n2 = n / 2;
+  ncols = MEDSTRIP + 2*n2;
+  top   = mj->sely;
+  bot   = mj->sely + mj->selh - 1;
+
+  fine   = (int *) malloc((size_t) ncols * 3 * 256 * sizeof(int));
+  coarse = (int *) malloc((size_t) ncols * 3 * 16  * sizeof(int));
+  kf     = (int *) malloc(3 * 256 * sizeof(int));
+  kc     = (int *) malloc(3 * 16  * sizeof(int));
+  luc    = (int *) malloc(3 * 16  * sizeof(int));
+  if (!fine || !coarse || !kf || !kc || !luc) {
+    if (fine)   free(fine);
+    if (coarse) free(coarse);
+    if (kf)     free(kf);
+    if (kc)     free(kc);
+    if (luc)    free(luc);
+    mj->failed = 1;
+    return;
+  }
+
+#define ROWP(pic, y)  ((pic) + (size_t) (y) * mj->w * 3 + mj->selx * 3)
+#define FINE(col, c)    (fine   + ((col) * 3 + (c)) * 256)
+#define COARSE(col, c)  (coarse + ((col) * 3 + (c)) * 16)
+
+  /* adds (d=1) or removes (d=-1) row 'y' from the strip's column
+     histograms.  Column 'j' of the strip is x = sx0 + j - n2 */
+#define COLROW(y, d) { \
+    sp = ROWP(mj->src, y) + cx0 * 3; \
+    for (j=cx0+n2-sx0; j<cx1+n2-sx0; j++) \
+      for (c=0; c<3; c++, sp++) { \
+	FINE(j,c)[*sp] += d;  COARSE(j,c)[*sp >> 4] += d; \
+      } \
+  }
+
+  for (sx0=0; sx0<mj->selw; sx0+=MEDSTRIP) {
+    sx1 = sx0 + MEDSTRIP;  if (sx1 > mj->selw) sx1 = mj->selw;
+
+    /* the real columns the strip's histograms cover */
+    cx0 = sx0 - n2;  if (cx0 < 0) cx0 = 0;
+    cx1 = sx1 + n2;  if (cx1 > mj->selw) cx1 = mj->selw;
+
+    xvbzero((char *) fine,   ncols * 3 * 256 * sizeof(int));
+    xvbzero((char *) coarse, ncols * 3 * 16  * sizeof(int));
+
+    ytop = top + y0 - n2;  if (ytop < top) ytop = top;
+    ybot = top + y0 + n2;  if (ybot > bot) ybot = bot;
+    for (y=ytop; y<=ybot; y++) COLROW(y, 1);
+
+    for (y=top+y0; y<top+y1; y++) {
+      if (y0 == 0 && ((y-top) & 15) == 0) {
+	ProgressMeter(0, mj->selw - 1, sx0 + ((sx1-sx0) * (y-top)) / y1,
+		      "DeSpeckle");
+	WaitCursor();
+      }
+
+      if (y > top+y0) {               /* slide the columns down a row */
+	if (y-n2-1 >= top) COLROW(y-n2-1, -1);
+	if (y+n2   <= bot) COLROW(y+n2,    1);
+      }
+
+      ytop = (y-n2 < top) ? top : y-n2;
+      ybot = (y+n2 > bot) ? bot : y+n2;
+      cy   = ybot - ytop + 1;
+
+      /* the mask's coarse histograms start as columns 0..n-2.  Its fine
+	 ones are all out of date (luc[] is the last column each group of
+	 16 has been brought up to) */
+      for (i=0; i<3*16; i++) { kc[i] = 0;  luc[i] = -n; }
+      for (j=0; j<n-1; j++)
+	for (c=0; c<3; c++) {
+	  cc = COARSE(j,c);
+	  for (k=0; k<16; k++) kc[c*16+k] += cc[k];
+	}
+
+      dp = ROWP(mj->dst, y) + sx0 * 3;
+      for (x=sx0; x<sx1; x++) {
+	/* the mask is columns x-sx0 .. e of the strip */
+	e = x - sx0 + n - 1;
+	for (c=0; c<3; c++) {
+	  cc = COARSE(e,c);
+	  for (k=0; k<16; k++) kc[c*16+k] += cc[k];
+	}
+
+	cnt = ((x+n2 < mj->selw) ? x+n2 : mj->selw-1) - ((x-n2 > 0) ? x-n2 : 0);
+	cnt = (cnt + 1) * cy;
+
+	for (c=0; c<3; c++) {
+	  for (i=0; i<2; i++) {
+	    /* the value of rank cnt/2 and, if cnt is even, cnt/2 - 1 */
+	    if (i && (cnt&1)) { val[1] = val[0];  break; }
+	    rank = cnt/2 - i;
+
+	    for (k=0; k<16 && rank >= kc[c*16+k]; k++) rank -= kc[c*16+k];
+	    if (k > 15) k = 15;                /* can't happen */
+
+	    /* bring fine group 'k' up to column e */
+	    cf = kf + c*256 + k*16;
+	    if (luc[c*16+k] <= e - n) {        /* quicker to start over */
+	      for (v=0; v<16; v++) cf[v] = 0;
+	      for (j=e-n+1; j<=e; j++) {
+		int *fp = FINE(j,c) + k*16;
+		for (v=0; v<16; v++) cf[v] += fp[v];
+	      }
+	    }
+	    else {
+	      for (j=luc[c*16+k]+1; j<=e; j++) {
+		int *fp = FINE(j,c) + k*16;
+		int *op = FINE(j-n,c) + k*16;
+		for (v=0; v<16; v++) cf[v] += fp[v] - op[v];
+	      }
+	    }
+	    luc[c*16+k] = e;
+
+	    for (v=0; v<15 && rank >= cf[v]; v++) rank -= cf[v];
+	    val[i] = k*16 + v;
+	  }
+
+	  *dp++ = (byte) ((val[0] + val[1]) / 2);
+	}
+
+	/* and drop the leftmost column off, for next time */
+	for (c=0; c<3; c++) {
+	  cc = COARSE(x-sx0,c);
+	  for (k=0; k<16; k++) kc[c*16+k] -= cc[k];
+	}
+      }
+    }
+  }
+
+#undef COLROW
+#undef COARSE
+#undef FINE
+#undef ROWP
+
+  free(fine);  free(coarse);  free(kf);  free(kc);  free(luc);
+}
+
+
+/************************/
+static void medianSortRows(void *data, int band0, int band1)
+{
+  /* does rows [band0,band1) (from the top of the region) of a doMedianFilter()
+     the simple way:  gathers the mask's values, sorts them, and picks the
+     middle one */
+
+  MEDJOB        *mj = (MEDJOB *) data;
+  byte          *p24, *pic24, *rp;
+  int            x,y,x1,y1,count,n2,nsq,c2,w,selx,sely,selw,selh;
   int           *rtab, *gtab, *btab;
 
-  printUTime("start of doMedianFilter");
+  pic24 = mj->src;  w = mj->w;
+  selx  = mj->selx;  sely = mj->sely;  selw = mj->selw;  selh = mj->selh;
 
-  n2 = n/2;  nsq = n * n;
+  n2 = mj->n/2;  nsq = mj->n * mj->n;
 
   rtab = (int *) malloc(nsq * sizeof(int));
   gtab = (int *) malloc(nsq * sizeof(int));
   btab = (int *) malloc(nsq * sizeof(int));
-  if (!rtab || !gtab || !btab) FatalError("can't malloc in doMedianFilter!");
+  if (!rtab || !gtab || !btab) {
+    if (rtab) free(rtab);
+    if (gtab) free(gtab);
+    if (btab) free(btab);
+    mj->failed = 1;
+    return;
+  }
 
-  for (y=sely; y<sely+selh; y++) {
-    ProgressMeter(sely, (sely+selh)-1, y, "DeSpeckle");
-    if ((y & 15) == 0) WaitCursor();
+  for (y=sely+band0; y<sely+band1; y++) {
+    if (band0 == 0) {
+      ProgressMeter(sely, (sely+band1)-1, y, "DeSpeckle");
+      if ((y & 15) == 0) WaitCursor();
+    }
 
-    p24 = pic24   + y*w*3 + selx*3;
-    rp  = results + y*w*3 + selx*3;
+    rp  = mj->dst + (size_t) y*w*3 + selx*3;
 
     for (x=selx; x<selx+selw; x++) {
-
-      /* rsum = gsum = bsum = 0; */
       count = 0;
 
       for (y1=y-n2; y1<=y+n2; y1++) {
 
 	if (y1>=sely && y1<sely+selh) {
-	  p24 = pic24 + y1*w*3 +(x-n2)*3;
+	  p24 = pic24 + (size_t) y1*w*3 +(x-n2)*3;
 
 	  for (x1=x-n2; x1<=x+n2; x1++) {
 	    if (x1>=selx && x1<selx+selw) {
@@ -1520,7 +2212,6 @@ static void doMedianFilter(byte *pic24, int w, int h, byte *results, int selx, i
   }
 
   free(rtab);  free(gtab);  free(btab);
-  printUTime("end of doMedianFilter");
 }
 
 
@@ -1546,6 +2237,7 @@ static void intsort(a, n)
 #endif /* FOO */
 
 
+#ifndef XV_HEADLESS
 /***********************************************/
 int start24bitAlg(byte **pic24, byte **tmpPic)
 {
@@ -1617,7 +2309,7 @@ void saveOrigPic(void)
 
   int i;
 
-  FreeEpic();
+  FreeEpic();  FreePyramid();
   if (cpic && cpic != pic) free(cpic);
   xvDestroyImage(theImage);
   theImage = NULL;
@@ -1647,4 +2339,4 @@ void saveOrigPic(void)
     pic = NULL;
   }
 }
-
+#endif /* !XV_HEADLESS */
@@ -0,0 +1,847 @@
+/*
+ * xvbench.c - times xv's image loaders and image-processing kernels
+ *
+ *  usage:  xvbench [-size WxH] [-reps n] [-time secs] [-only str]
+ *                  [-threads n] [-o file] [-nosynth] [file|dir ...]
+ *
+ * Runs each kernel over and over (at least 'reps' times, and for at least
+ * 'secs' seconds), and reports how fast the quickest run was, in megapixels
+ * (of output) per second.  The results go to stdout, or 'file', as JSON,
+ * so that runs from different versions can be lined up and compared.
+ * Progress goes to stderr.
+ *
+ * The loaders are run on every image in the given files and directories
+ * (data/images in the source tree, by default), and on a big synthetic
+ * image, saved in each format libxvcore can write (and JPEG and PNG).  The
+ * other kernels are run on the synthetic image:  Conv24to8() in each
+ * CONV24 mode, Smooth24(), Resample24(), DoColorDither(), FSDither(),
+ * ApplyGamMods24() (which does the work for GammifyPic24()), RotatePic(),
+ * FlipPic(), and each of the xvalg.c filters (AlgApply24()).
+ *
+ * '-only' skips anything whose "kernel/variant" name doesn't contain 'str'.
+ *
+ * Built against libxvcore (see xvcore.c), so it doesn't need an X display.
+ */
+
+#include "copyright.h"
+
+#define NEEDSTIME
+#include "xv.h"
+
+#ifdef HAVE_JPEG
+#  include <setjmp.h>
+#  include "jpeglib.h"
+#endif
+
+#ifdef HAVE_PNG
+#  include "png.h"
+#endif
+
+#ifndef XVBENCH_IMAGES
+#  define XVBENCH_IMAGES "data/images"
+#endif
+
+#define MAXREPS   1000           /* give up on 'secs' after this many */
+
+
+typedef struct { byte *pic;              /* input */
+		 int   ptype, w, h;
+		 byte *r, *g, *b;            /* its colormap, if PIC8 */
+		 byte *work;                 /* scratch copy, if needed */
+		 int   i1, i2;               /* kernel-specific parameters */
+		 double d1, d2;
+		 GAMMODS *gm;                /* for ApplyGamMods24() */
+		 char *fname;                /* file to load */
+		 int   ftype;
+		 long  npix;                 /* output pixels, set by the kernel */
+	       } BARG;
+
+typedef int (*BFUNC) PARM((BARG *));
+
+
+static void   usage        PARM((void));
+static double now          PARM((void));
+static void   bench        PARM((const char *, const char *, const char *,
+				 BFUNC, BARG *));
+static void   jsonStr      PARM((const char *));
+static int    nameCmp      PARM((const void *, const void *));
+static void   benchFiles   PARM((const char *));
+static void   benchLoad    PARM((char *, const char *));
+static void   makeSynth    PARM((void));
+static void   saveSynth    PARM((void));
+static void   benchKernels PARM((void));
+
+static int    kLoad        PARM((BARG *));
+static int    kConv24to8   PARM((BARG *));
+static int    kSmooth24    PARM((BARG *));
+static int    kResample24  PARM((BARG *));
+static int    kColorDither PARM((BARG *));
+static int    kFSDither    PARM((BARG *));
+static int    kGamMods     PARM((BARG *));
+static int    kRotatePic   PARM((BARG *));
+static int    kFlipPic     PARM((BARG *));
+static int    kAlg         PARM((BARG *));
+
+#ifdef HAVE_JPEG
+static int    writeJPEG    PARM((FILE *, byte *, int, int));
+#endif
+#ifdef HAVE_PNG
+static int    writePNG     PARM((FILE *, byte *, int, int));
+#endif
+
+
+static int    minreps  = 3;
+static double mintime  = 0.5;
+static char  *onlystr  = (char *) NULL;
+static FILE  *out;
+static int    nresults = 0;
+
+static int    synW = 2048, synH = 1536;
+static byte  *syn24;                       /* the synthetic image */
+static byte  *syn8;                        /* ... as a PIC8 */
+static byte   synR[256], synG[256], synB[256];
+static char   synDir[MAXPATHLEN];          /* where it's saved */
+
+static const char *rftNames[] = {          /* indexed by RFT_* */
+  "", "GIF", "PM", "PBM", "XBM", "SunRas", "BMP", "RLE", "IRIS", "PCX",
+  "JFIF", "TIFF", "PDS", "", "PS", "IFF", "Targa", "XPM", "XWD", "FITS",
+  "PNG", "ZX", "WBMP", "PCD", "HIPS", "", "", "JP2", "JP2", "G3", "WEBP" };
+
+
+
+/***************************************************/
+int main(int argc, char **argv)
+{
+  int   i, nosynth, nfiles;
+  char *outname;
+
+  XVCoreInit();
+  cmd = "xvbench";
+
+  nosynth = nfiles = 0;
+  outname = (char *) NULL;
+
+  for (i=1; i<argc; i++) {
+    if      (!strcmp(argv[i], "-size") && i+1<argc) {
+      if (sscanf(argv[++i], "%dx%d", &synW, &synH) != 2 ||
+	  synW < 16 || synH < 16) usage();
+    }
+    else if (!strcmp(argv[i], "-reps") && i+1<argc) {
+      minreps = atoi(argv[++i]);
+      if (minreps < 1) minreps = 1;
+    }
+    else if (!strcmp(argv[i], "-time")    && i+1<argc) mintime = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-only")    && i+1<argc) onlystr = argv[++i];
+    else if (!strcmp(argv[i], "-threads") && i+1<argc) nthreads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-o")       && i+1<argc) outname = argv[++i];
+    else if (!strcmp(argv[i], "-nosynth")) nosynth = 1;
+    else if (argv[i][0] == '-') usage();
+    else nfiles++;
+  }
+
+  out = stdout;
+  if (outname && !(out = fopen(outname, "w"))) {
+    fprintf(stderr, "%s: can't create '%s'\n", cmd, outname);
+    exit(1);
+  }
+
+  noqcheck = 1;      /* time the quantizers, not the check that skips them */
+
+  fprintf(out, "{\n  \"program\": \"xvbench\",\n");
+  fprintf(out, "  \"version\": \"%s\",\n", XV_VERSTR);
+  fprintf(out, "  \"threads\": %d,\n", NumThreads());
+  fprintf(out, "  \"synthetic\": { \"width\": %d, \"height\": %d },\n",
+	  synW, synH);
+  fprintf(out, "  \"results\": [");
+
+  if (nfiles) {
+    for (i=1; i<argc; i++) {
+      if (argv[i][0] == '-') {
+	if (strcmp(argv[i], "-nosynth") != 0) i++;   /* skip its argument */
+	continue;
+      }
+      benchFiles(argv[i]);
+    }
+  }
+  else benchFiles(XVBENCH_IMAGES);
+
+  if (!nosynth) {
+    makeSynth();
+    saveSynth();
+    benchKernels();
+  }
+
+  fprintf(out, "\n  ]\n}\n");
+  if (out != stdout) fclose(out);
+  return 0;
+}
+
+
+/***************************************************/
+static void usage(void)
+{
+  fprintf(stderr, "usage:  %s [-size WxH] [-reps n] [-time secs] %s\n", cmd,
+	  "[-only str] [-threads n]");
+  fprintf(stderr, "                [-o file] [-nosynth] [file|dir ...]\n");
+  exit(1);
+}
+
+
+/***************************************************/
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+/***************************************************/
+static void bench(const char *kernel, const char *variant, const char *input,
+		  BFUNC func, BARG *ba)
+{
+  /* runs func(ba) until it's been run 'minreps' times and 'mintime' seconds
+     have gone by, and writes out how it did.  The first run (which warms
+     up the caches, and tells us how many pixels there are) isn't counted */
+
+  char   name[256];
+  double t, best, total;
+  int    n;
+
+  snprintf(name, sizeof(name), "%s/%s", kernel, variant);
+  if (onlystr && !strstr(name, onlystr)) return;
+
+  fprintf(stderr, "%s: %-40s ", cmd, name);
+  ba->npix = 0;
+  if (!(*func)(ba) || ba->npix <= 0) {
+    fprintf(stderr, "failed, skipped\n");
+    return;
+  }
+
+  best = 1e30;  total = 0.0;
+  for (n=0; n < minreps || (total < mintime && n < MAXREPS); n++) {
+    t = now();
+    (*func)(ba);
+    t = now() - t;
+    total += t;
+    if (t < best) best = t;
+  }
+  if (best < 1e-9) best = 1e-9;
+
+  fprintf(stderr, "%9.2f MP/s  (%d runs)\n", ba->npix / best / 1e6, n);
+
+  fprintf(out, "%s\n    { \"kernel\": ", nresults++ ? "," : "");
+  jsonStr(kernel);
+  fprintf(out, ", \"variant\": ");
+  jsonStr(variant);
+  fprintf(out, ", \"input\": ");
+  jsonStr(input);
+  fprintf(out, ",\n      \"pixels\": %ld, \"runs\": %d, \"best_ms\": %.3f, ",
+	  ba->npix, n, best * 1000.0);
+  fprintf(out, "\"mean_ms\": %.3f, \"mpps\": %.3f }",
+	  total * 1000.0 / n, ba->npix / best / 1e6);
+  fflush(out);
+}
+
+
+/***************************************************/
+static void jsonStr(const char *st)
+{
+  putc('"', out);
+  for ( ; *st; st++) {
+    if (*st == '"' || *st == '\\') fprintf(out, "\\%c", *st);
+    else if ((byte) *st < 0x20) fprintf(out, "\\u%04x", (byte) *st);
+    else putc(*st, out);
+  }
+  putc('"', out);
+}
+
+
+
+/***************************************************/
+/* LOADERS                                         */
+/***************************************************/
+
+
+/***************************************************/
+static void benchFiles(const char *path)
+{
+  /* times loading 'path', or each file in it, if it's a directory */
+
+  DIR           *dirp;
+  struct dirent *dp;
+  struct stat    st;
+  char         **names, fname[MAXPATHLEN];
+  int            i, n, max;
+
+  if (stat(path, &st) != 0) {
+    fprintf(stderr, "%s: can't stat '%s'\n", cmd, path);
+    return;
+  }
+
+  if (!S_ISDIR(st.st_mode)) {
+    strncpy(fname, path, sizeof(fname) - 1);
+    fname[sizeof(fname) - 1] = '\0';
+    benchLoad(fname, BaseName(fname));
+    return;
+  }
+
+  dirp = opendir(path);
+  if (!dirp) {
+    fprintf(stderr, "%s: can't read directory '%s'\n", cmd, path);
+    return;
+  }
+
+  /* sorted, so the results come out in the same order every time */
+  n = 0;  max = 64;
+  names = (char **) malloc(max * sizeof(char *));
+  if (!names) FatalError("out of memory in benchFiles()");
+
+  while ((dp = readdir(dirp)) != NULL) {
+    if (dp->d_name[0] == '.') continue;
+    if (n == max) {
+      max *= 2;
+      names = (char **) realloc(names, max * sizeof(char *));
+      if (!names) FatalError("out of memory in benchFiles()");
+    }
+    names[n] = strdup(dp->d_name);
+    if (!names[n]) FatalError("out of memory in benchFiles()");
+    n++;
+  }
+  closedir(dirp);
+
+  qsort(names, (size_t) n, sizeof(char *), nameCmp);
+
+  for (i=0; i<n; i++) {
+    snprintf(fname, sizeof(fname), "%s/%s", path, names[i]);
+    if (stat(fname, &st) == 0 && S_ISREG(st.st_mode))
+      benchLoad(fname, names[i]);
+    free(names[i]);
+  }
+  free(names);
+}
+
+
+/***************************************************/
+static int nameCmp(const void *a, const void *b)
+{
+  return strcmp(*((char * const *) a), *((char * const *) b));
+}
+
+
+/***************************************************/
+static void benchLoad(char *fname, const char *input)
+{
+  BARG ba;
+  char kernel[64];
+  int  ftype;
+
+  ftype = ReadFileType(fname);
+  ProbeRelease();
+
+  if (ftype == RFT_COMPRESS || ftype == RFT_BZIP2 || ftype == RFT_XZ) {
+    fprintf(stderr, "%s: %s is compressed, skipped\n", cmd, input);
+    return;
+  }
+
+  if (ftype <= RFT_UNKNOWN ||
+      ftype >= (int) (sizeof(rftNames) / sizeof(rftNames[0])) ||
+      !*rftNames[ftype]) {
+    fprintf(stderr, "%s: %s isn't something libxvcore can load, skipped\n",
+	    cmd, input);
+    return;
+  }
+
+  xvbzero((char *) &ba, sizeof(ba));
+  ba.fname = fname;
+  ba.ftype = ftype;
+
+  snprintf(kernel, sizeof(kernel), "Load%s", rftNames[ftype]);
+  bench(kernel, input, input, kLoad, &ba);
+}
+
+
+/***************************************************/
+static int kLoad(BARG *ba)
+{
+  PICINFO pinfo;
+
+  xvbzero((char *) &pinfo, sizeof(pinfo));
+  if (!ReadPicFile(ba->fname, ba->ftype, &pinfo, 0)) return 0;
+
+  ba->npix = (long) pinfo.w * pinfo.h;
+
+  if (pinfo.pic)     free(pinfo.pic);
+  if (pinfo.comment) free(pinfo.comment);
+  if (pinfo.exifInfo) free(pinfo.exifInfo);
+  if (pinfo.numpages > 1) KillPageFiles(pinfo.pagebname, pinfo.numpages);
+  return 1;
+}
+
+
+
+/***************************************************/
+/* THE SYNTHETIC IMAGE                             */
+/***************************************************/
+
+
+/***************************************************/
+static void makeSynth(void)
+{
+  /* something photo-ish:  smooth color gradients, some sharp edges, and a
+     bit of noise, so the quantizers have a few thousand colors to chew
+     on.  Always the same, for a given size */
+
+  int           x, y, v, c;
+  byte         *p;
+  unsigned long seed = 12345;
+  double        fx, fy;
+
+  syn24 = (byte *) malloc((size_t) synW * synH * 3);
+  if (!syn24) FatalError("out of memory for the synthetic image");
+
+  for (y=0, p=syn24; y<synH; y++) {
+    fy = (double) y / synH;
+    for (x=0; x<synW; x++) {
+      fx = (double) x / synW;
+      seed = seed * 1103515245 + 12345;
+      v = (int) ((seed >> 16) & 0x0f) - 8;
+
+      if (((x / 128) + (y / 128)) % 5 == 0) {        /* flat tiles */
+	*p++ = 40;  *p++ = 90;  *p++ = 200;
+	continue;
+      }
+
+      c = (int) (255 * fx) + v;                          RANGE(c,0,255);
+      *p++ = (byte) c;
+      c = (int) (255 * fy) + v;                          RANGE(c,0,255);
+      *p++ = (byte) c;
+      c = (int) (128 + 127 * sin(12 * fx + 7 * fy)) + v; RANGE(c,0,255);
+      *p++ = (byte) c;
+    }
+  }
+
+  conv24 = CONV24_FAST;
+  syn8 = Conv24to8(syn24, synW, synH, 256, synR, synG, synB);
+  if (!syn8) FatalError("couldn't make the 8-bit synthetic image");
+}
+
+
+/***************************************************/
+static void saveSynth(void)
+{
+  /* saves the synthetic image (or the 8-bit, or a dithered b/w version)
+     in each format we can write, and times loading it back in */
+
+  static struct { const char *name;  int ptype;  int bw; } fmts[] = {
+    { "big.gif",  PIC8,  0 },   { "big.pgm",  PIC8,  0 },
+    { "big.ppm",  PIC24, 0 },   { "big.pbm",  PIC8,  1 },
+    { "big.xbm",  PIC8,  1 },   { "big.wbmp", PIC8,  1 },
+    { "big.ras",  PIC24, 0 },   { "big.bmp",  PIC24, 0 },
+    { "big8.bmp", PIC8,  0 },   { "big.rgb",  PIC24, 0 },
+    { "big.tga",  PIC24, 0 },   { "big.xpm",  PIC8,  0 },
+    { "big.fits", PIC24, 0 },   { "big.pm",   PIC24, 0 },
+#ifdef HAVE_JPEG
+    { "big.jpg",  PIC24, 0 },
+#endif
+#ifdef HAVE_PNG
+    { "big.png",  PIC24, 0 },
+#endif
+  };
+
+  char  fname[MAXPATHLEN], input[64];
+  byte *pic, *bw, bwmap[2];
+  FILE *fp;
+  int   i, rv, ptype, col;
+
+  snprintf(synDir, sizeof(synDir), "%s/xvbenchXXXXXX", tmpdir);
+  if (!mkdtemp(synDir)) {
+    fprintf(stderr, "%s: can't make a directory in %s\n", cmd, tmpdir);
+    return;
+  }
+
+  bw = FSDither(syn24, PIC24, synW, synH, NULL, NULL, NULL, 0, 1);
+  if (!bw) FatalError("out of memory in saveSynth()");
+  bwmap[0] = 0;  bwmap[1] = 255;
+
+  for (i=0; i < (int) (sizeof(fmts) / sizeof(fmts[0])); i++) {
+    snprintf(fname, sizeof(fname), "%s/%s", synDir, fmts[i].name);
+    fp = fopen(fname, "w");
+    if (!fp) continue;
+
+    ptype = fmts[i].ptype;
+    pic = (ptype == PIC24) ? syn24 : (fmts[i].bw ? bw : syn8);
+    col = fmts[i].bw ? F_BWDITHER : F_FULLCOLOR;
+
+    if (fmts[i].bw) {
+      if (strstr(fmts[i].name, ".xbm"))
+	rv = WriteXBM(fp, pic, synW, synH, bwmap, bwmap, bwmap, fname);
+      else if (strstr(fmts[i].name, ".wbmp"))
+	rv = WriteWBMP(fp, pic, ptype, synW, synH, bwmap, bwmap, bwmap, 2,col);
+      else
+	rv = WritePBM(fp, pic, ptype, synW, synH, bwmap, bwmap, bwmap, 2, col,
+		      1, NULL);
+    }
+    else if (strstr(fmts[i].name, ".gif"))
+      rv = WriteGIF(fp, pic, ptype, synW, synH, synR, synG, synB, 256, col,
+		    NULL);
+    else if (strstr(fmts[i].name, ".pgm"))
+      rv = WritePBM(fp, pic, ptype, synW, synH, synR, synG, synB, 256,
+		    F_GREYSCALE, 1, NULL);
+    else if (strstr(fmts[i].name, ".ppm"))
+      rv = WritePBM(fp, pic, ptype, synW, synH, synR, synG, synB, 256, col,
+		    1, NULL);
+    else if (strstr(fmts[i].name, ".ras"))
+      rv = WriteSunRas(fp, pic, ptype, synW, synH, synR, synG, synB, 256,
+		       col, 0);
+    else if (strstr(fmts[i].name, ".bmp"))
+      rv = WriteBMP(fp, pic, ptype, synW, synH, synR, synG, synB, 256, col);
+    else if (strstr(fmts[i].name, ".rgb"))
+      rv = WriteIRIS(fp, pic, ptype, synW, synH, synR, synG, synB, 256, col);
+    else if (strstr(fmts[i].name, ".tga"))
+      rv = WriteTarga(fp, pic, ptype, synW, synH, synR, synG, synB, 256, col);
+    else if (strstr(fmts[i].name, ".xpm"))
+      rv = WriteXPM(fp, pic, ptype, synW, synH, synR, synG, synB, 256, col,
+		    "big", NULL);
+    else if (strstr(fmts[i].name, ".fits"))
+      rv = WriteFITS(fp, pic, ptype, synW, synH, synR, synG, synB, 256, col,
+		     NULL);
+    else if (strstr(fmts[i].name, ".pm"))
+      rv = WritePM(fp, pic, ptype, synW, synH, synR, synG, synB, 256, col,
+		   NULL);
+#ifdef HAVE_JPEG
+    else if (strstr(fmts[i].name, ".jpg"))
+      rv = writeJPEG(fp, pic, synW, synH);
+#endif
+#ifdef HAVE_PNG
+    else if (strstr(fmts[i].name, ".png"))
+      rv = writePNG(fp, pic, synW, synH);
+#endif
+    else rv = -1;
+
+    if (fclose(fp) != 0) rv = -1;
+
+    if (rv == 0) {
+      snprintf(input, sizeof(input), "synthetic %s", fmts[i].name);
+      benchLoad(fname, input);
+    }
+    else fprintf(stderr, "%s: couldn't write %s, skipped\n", cmd,
+		 fmts[i].name);
+
+    unlink(fname);
+  }
+
+  free(bw);
+  rmdir(synDir);
+}
+
+
+#ifdef HAVE_JPEG
+/***************************************************/
+static int writeJPEG(FILE *fp, byte *pic24, int w, int h)
+{
+  /* no save dialog in libxvcore, so no writeJFIF().  A plain quality-75
+     baseline JPEG is all we need */
+
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr       jerr;
+  JSAMPROW                    row;
+
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  jpeg_stdio_dest(&cinfo, fp);
+
+  cinfo.image_width      = w;
+  cinfo.image_height     = h;
+  cinfo.input_components = 3;
+  cinfo.in_color_space   = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 75, TRUE);
+
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    row = pic24 + (size_t) cinfo.next_scanline * w * 3;
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return 0;
+}
+#endif /* HAVE_JPEG */
+
+
+#ifdef HAVE_PNG
+/***************************************************/
+static int writePNG(FILE *fp, byte *pic24, int w, int h)
+{
+  png_structp png_ptr;
+  png_infop   info_ptr;
+  int         y;
+
+  png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (!png_ptr) return -1;
+
+  info_ptr = png_create_info_struct(png_ptr);
+  if (!info_ptr || setjmp(png_jmpbuf(png_ptr))) {
+    png_destroy_write_struct(&png_ptr, info_ptr ? &info_ptr : NULL);
+    return -1;
+  }
+
+  png_init_io(png_ptr, fp);
+  png_set_IHDR(png_ptr, info_ptr, (png_uint_32) w, (png_uint_32) h, 8,
+	       PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+	       PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png_ptr, info_ptr);
+
+  for (y=0; y<h; y++) png_write_row(png_ptr, pic24 + (size_t) y * w * 3);
+
+  png_write_end(png_ptr, info_ptr);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  return 0;
+}
+#endif /* HAVE_PNG */
+
+
+
+/***************************************************/
+/* KERNELS                                         */
+/***************************************************/
+
+
+/***************************************************/
+static void benchKernels(void)
+{
+  static struct { int mode;  const char *name; } convs[] = {
+    { CONV24_FAST, "fast" },  { CONV24_SLOW, "slow" },
+    { CONV24_BEST, "best" },  { CONV24_OCTREE, "octree" },
+    { CONV24_ORDERED, "ordered" } };
+
+  static struct { int alg;  const char *name;  double p1, p2; } algs[] = {
+    { ALG_BLUR,      "blur3",     3.0,  0.0 },
+    { ALG_BLUR,      "blur15",   15.0,  0.0 },
+    { ALG_BLUR,      "blur41",   41.0,  0.0 },
+    { ALG_GAUSS,     "gauss5",    5.0,  0.0 },
+    { ALG_SHARPEN,   "sharpen",  75.0,  0.0 },
+    { ALG_EDGE,      "edge",      0.0,  0.0 },
+    { ALG_TINF,      "emboss",    0.0,  0.0 },
+    { ALG_OIL,       "oil3",      3.0,  0.0 },
+    { ALG_OIL,       "oil15",    15.0,  0.0 },
+    { ALG_BLEND,     "blend",     0.0,  0.0 },
+    { ALG_ROTATE,    "rotate30", 30.0,  0.0 },
+    { ALG_ROTATECLR, "rotclr30", 30.0,  0.0 },
+    { ALG_PIXEL,     "pixel4",    4.0,  4.0 },
+    { ALG_SPREAD,    "spread5",   5.0,  5.0 },
+    { ALG_MEDIAN,    "median3",   3.0,  0.0 },
+    { ALG_MEDIAN,    "median5",   5.0,  0.0 },
+    { ALG_MEDIAN,    "median15", 15.0,  0.0 } };
+
+  BARG    ba;
+  GAMMODS gm;
+  byte    rdisp[256], gdisp[256], bdisp[256];
+  int     i, saveconv;
+
+  xvbzero((char *) &ba, sizeof(ba));
+  ba.w = synW;  ba.h = synH;
+  ba.r = synR;  ba.g = synG;  ba.b = synB;
+  ba.work = (byte *) malloc((size_t) synW * synH * 3);
+  if (!ba.work) FatalError("out of memory in benchKernels()");
+
+  /* Conv24to8 */
+  saveconv = conv24;
+  ba.pic = syn24;  ba.ptype = PIC24;
+  for (i=0; i < (int) (sizeof(convs) / sizeof(convs[0])); i++) {
+    ba.i1 = convs[i].mode;
+    bench("Conv24to8", convs[i].name, "synthetic", kConv24to8, &ba);
+  }
+  conv24 = saveconv;
+
+  /* Smooth24 and Resample24:  half size, and 1.5 times */
+  ba.pic = syn24;  ba.ptype = PIC24;
+  ba.i1 = synW / 2;  ba.i2 = synH / 2;
+  bench("Smooth24",   "24bit-shrink", "synthetic", kSmooth24,   &ba);
+  bench("Resample24", "24bit-shrink", "synthetic", kResample24, &ba);
+  ba.i1 = synW * 3 / 2;  ba.i2 = synH * 3 / 2;
+  bench("Smooth24",   "24bit-expand", "synthetic", kSmooth24,   &ba);
+  bench("Resample24", "24bit-expand", "synthetic", kResample24, &ba);
+  ba.pic = syn8;  ba.ptype = PIC8;
+  ba.i1 = synW / 2;  ba.i2 = synH / 2;
+  bench("Smooth24",   "8bit-shrink",  "synthetic", kSmooth24,   &ba);
+
+  /* DoColorDither, to a 6x6x6 color cube */
+  for (i=0; i<216; i++) {
+    rdisp[i] = (i / 36)     * 51;
+    gdisp[i] = (i / 6 % 6)  * 51;
+    bdisp[i] = (i % 6)      * 51;
+  }
+  ba.pic = syn24;  ba.ptype = PIC24;
+  ba.r = rdisp;  ba.g = gdisp;  ba.b = bdisp;  ba.i1 = 216;
+  bench("DoColorDither", "cube216", "synthetic", kColorDither, &ba);
+  ba.r = synR;  ba.g = synG;  ba.b = synB;
+
+  /* FSDither */
+  ba.pic = syn24;  ba.ptype = PIC24;
+  bench("FSDither", "24bit", "synthetic", kFSDither, &ba);
+  ba.pic = syn8;  ba.ptype = PIC8;
+  bench("FSDither", "8bit",  "synthetic", kFSDither, &ba);
+
+  /* ApplyGamMods24 (GammifyPic24):  RGB curves only, and HSV changes too */
+  InitGamMods(&gm);
+  for (i=0; i<256; i++)
+    gm.rfunc[i] = (byte) (255.0 * pow(i / 255.0, 1.0 / 1.6) + 0.5);
+  ba.pic = syn24;  ba.ptype = PIC24;  ba.gm = &gm;
+  bench("ApplyGamMods24", "rgb", "synthetic", kGamMods, &ba);
+
+  for (i=0; i<360; i++) gm.hremap[i] = (i + 30) % 360;
+  gm.satval = -25.0;
+  bench("ApplyGamMods24", "hsv+rgb", "synthetic", kGamMods, &ba);
+
+  gm.approx = 1;
+  bench("ApplyGamMods24", "lattice", "synthetic", kGamMods, &ba);
+
+  /* RotatePic and FlipPic, on a scratch copy */
+  ba.pic = syn24;  ba.ptype = PIC24;
+  xvbcopy((char *) syn24, (char *) ba.work, (size_t) synW * synH * 3);
+  bench("RotatePic", "24bit", "synthetic", kRotatePic, &ba);
+  ba.pic = syn8;  ba.ptype = PIC8;
+  xvbcopy((char *) syn8, (char *) ba.work, (size_t) synW * synH);
+  bench("RotatePic", "8bit",  "synthetic", kRotatePic, &ba);
+
+  ba.pic = syn24;  ba.ptype = PIC24;
+  xvbcopy((char *) syn24, (char *) ba.work, (size_t) synW * synH * 3);
+  ba.i1 = 0;
+  bench("FlipPic", "24bit-horiz", "synthetic", kFlipPic, &ba);
+  ba.i1 = 1;
+  bench("FlipPic", "24bit-vert",  "synthetic", kFlipPic, &ba);
+
+  /* the xvalg.c filters */
+  ba.pic = syn24;  ba.ptype = PIC24;
+  for (i=0; i < (int) (sizeof(algs) / sizeof(algs[0])); i++) {
+    ba.i1 = algs[i].alg;  ba.d1 = algs[i].p1;  ba.d2 = algs[i].p2;
+    bench("DoAlg", algs[i].name, "synthetic", kAlg, &ba);
+  }
+
+  free(ba.work);
+}
+
+
+/***************************************************/
+static int kConv24to8(BARG *ba)
+{
+  byte *pic8, r[256], g[256], b[256];
+
+  conv24 = ba->i1;
+  pic8 = Conv24to8(ba->pic, ba->w, ba->h, 256, r, g, b);
+  if (!pic8) return 0;
+
+  free(pic8);
+  ba->npix = (long) ba->w * ba->h;
+  return 1;
+}
+
+
+/***************************************************/
+static int kSmooth24(BARG *ba)
+{
+  byte *pic;
+
+  pic = Smooth24(ba->pic, (ba->ptype == PIC24), ba->w, ba->h, ba->i1, ba->i2,
+		 ba->r, ba->g, ba->b);
+  if (!pic) return 0;
+
+  free(pic);
+  ba->npix = (long) ba->i1 * ba->i2;
+  return 1;
+}
+
+
+/***************************************************/
+static int kResample24(BARG *ba)
+{
+  byte *pic;
+
+  pic = Resample24(ba->pic, (ba->ptype == PIC24), ba->w, ba->h, ba->i1, ba->i2,
+		   ba->r, ba->g, ba->b);
+  if (!pic) return 0;
+
+  free(pic);
+  ba->npix = (long) ba->i1 * ba->i2;
+  return 1;
+}
+
+
+/***************************************************/
+static int kColorDither(BARG *ba)
+{
+  byte *pic;
+
+  pic = DoColorDither(ba->pic, NULL, ba->w, ba->h, NULL, NULL, NULL,
+		      ba->r, ba->g, ba->b, ba->i1);
+  if (!pic) return 0;
+
+  free(pic);
+  ba->npix = (long) ba->w * ba->h;
+  return 1;
+}
+
+
+/***************************************************/
+static int kFSDither(BARG *ba)
+{
+  byte *pic;
+
+  pic = FSDither(ba->pic, ba->ptype, ba->w, ba->h, ba->r, ba->g, ba->b, 0, 1);
+  if (!pic) return 0;
+
+  free(pic);
+  ba->npix = (long) ba->w * ba->h;
+  return 1;
+}
+
+
+/***************************************************/
+static int kGamMods(BARG *ba)
+{
+  byte *pic;
+
+  pic = ApplyGamMods24(ba->pic, ba->w, ba->h, ba->gm);
+  if (!pic) return 0;
+
+  free(pic);
+  ba->npix = (long) ba->w * ba->h;
+  return 1;
+}
+
+
+/***************************************************/
+static int kRotatePic(BARG *ba)
+{
+  int w, h;
+
+  w = ba->w;  h = ba->h;
+  RotatePic(ba->work, ba->ptype, &w, &h, 0);     /* rotates ba->work, */
+  RotatePic(ba->work, ba->ptype, &w, &h, 1);     /* and puts it back */
+
+  ba->npix = (long) ba->w * ba->h * 2;
+  return 1;
+}
+
+
+/***************************************************/
+static int kFlipPic(BARG *ba)
+{
+  FlipPic(ba->work, ba->ptype, ba->w, ba->h, ba->i1);
+  ba->npix = (long) ba->w * ba->h;
+  return 1;
+}
+
+
+/***************************************************/
+static int kAlg(BARG *ba)
+{
+  if (AlgApply24(ba->i1, ba->pic, ba->w, ba->h, ba->work, 0, 0, ba->w, ba->h,
+		 ba->d1, ba->d2)) return 0;
+
+  ba->npix = (long) ba->w * ba->h;
+  return 1;
+}
@@ -37,6 +37,12 @@
 #  error XV's BMP code requires 32-bit unsigned integer type, but u_int isn't
 #endif
 
+/* getint(), on 4 bytes of a row from BulkRow().  'n' is how many bytes of
+   the row actually came from the file:  past that, it's eofint()'s job */
+#define BUFINT(p,n) (((n) < 4) ? eofint(p, n) : \
+		     (((u_int) (p)[0])       | (((u_int) (p)[1]) << 8) | \
+		      (((u_int) (p)[2]) << 16) | (((u_int) (p)[3]) << 24)))
+
 static long filesize;
 
 static int   loadBMP1   PARM((FILE *, byte *, u_int, u_int, int));
@@ -47,6 +53,7 @@ static int   loadBMP24  PARM((FILE *, byte *, u_int, u_int, u_int, int));
 static int   loadBMP32  PARM((FILE *, byte *, u_int, u_int, u_int *, int));
 static u_int getshort   PARM((FILE *));
 static u_int getint     PARM((FILE *));
+static u_int eofint     PARM((byte *, size_t));
 static void  putshort   PARM((FILE *, int));
 static void  putint     PARM((FILE *, int));
 static void  writeBMP1  PARM((FILE *, byte *, int, int));
@@ -498,11 +505,12 @@ static int loadBMP4(FILE *fp, byte *pic8, u_int w, u_int h, u_int comp, int righ
 /*******************************************/
 static int loadBMP8(FILE *fp, byte *pic8, u_int w, u_int h, u_int comp, int rightsideup)
 {
-  int   i,j,c,c1,padw,x,y,rv;
+  int   i,c,c1,padw,x,y,rv;
   int   begin, end, inc;
   byte *pp = pic8 + ((h - 1) * w);
   size_t l = w*h;
   byte *pend;
+  BULKIN bi;
 
   rv = 0;
 
@@ -522,16 +530,15 @@ static int loadBMP8(FILE *fp, byte *pic8, u_int w, u_int h, u_int comp, int righ
 
     padw = ((w + 3)/4) * 4; /* 'w' padded to a multiple of 4pix (32 bits) */
 
-    for (i = begin; i != end && (pp - pic8 <= l); i += inc) {
-      pp = pic8 + (i * w);
+    BulkInit(&bi, fp, (size_t) padw * h, 0xff);
+    for (i = begin; i != end; i += inc) {
       if ((i&0x3f)==0) WaitCursor();
-
-      for (j=0; j<padw; j++) {
-	c = getc(fp);  if (c==EOF) rv = 1;
-	if (j<w) *pp++ = c;
-      }
-      if (FERROR(fp)) break;
+      xvbcopy((char *) BulkRow(&bi, (size_t) padw),
+	      (char *) pic8 + (size_t) i * w, (size_t) w);
+      if (bi.missing) break;   /* as before, the rest stays 0 */
     }
+    if (bi.missing || FERROR(fp)) rv = 1;
+    BulkDone(&bi);
   }
 
   else if (comp == BI_RLE8) {  /* read RLE8 compressed data */
@@ -587,11 +594,12 @@ static int loadBMP8(FILE *fp, byte *pic8, u_int w, u_int h, u_int comp, int righ
 /*******************************************/
 static int loadBMP16(FILE *fp, byte *pic24, u_int w, u_int h, u_int *mask, int rightsideup)
 {
-  int	 x, y, ybegin, yend, yinc;
-  byte	*pp = pic24 + ((h - 1) * w * 3);
-  size_t l = w*h*3;
+  int	 x, y, ybegin, yend, yinc, rv;
+  byte	*pp, *bp;
   u_int	 buf, colormask[6];
   int	 i, bit, bitshift[6], colorbits[6], bitshift2[6];
+  size_t rowbytes, nread;
+  BULKIN bi;
 
   if (mask == NULL) {  /* RGB555 */
     colormask[0] = 0x00007c00;
@@ -670,12 +678,18 @@ static int loadBMP16(FILE *fp, byte *pic24, u_int w, u_int h, u_int *mask, int r
     yinc = -1;
   }
 
-  for (y = ybegin; y != yend && (pp - pic24 <= l); y += yinc) {
-    pp = pic24 + (3 * w * y);
+  rowbytes = (size_t) ((w + 1) / 2) * 4;    /* padded to 2 pix (32 bits) */
+  BulkInit(&bi, fp, rowbytes * h, 0xff);
+
+  for (y = ybegin; y != yend; y += yinc) {
+    pp = pic24 + ((size_t) 3 * w * y);
+    nread = bi.missing;
+    bp = BulkRow(&bi, rowbytes);
+    nread = rowbytes - (bi.missing - nread);
     if ((y&0x3f)==0) WaitCursor();
 
-    for (x = w; x > 1; x -= 2) {
-      buf = getint(fp);
+    for (x = w; x > 1; x -= 2, bp += 4, nread -= (nread < 4) ? nread : 4) {
+      buf = BUFINT(bp, nread);
       *(pp++) = (buf & colormask[0]) >> bitshift[0] << bitshift2[0];
       *(pp++) = (buf & colormask[1]) >> bitshift[1] << bitshift2[1];
       *(pp++) = (buf & colormask[2]) >> bitshift[2] << bitshift2[2];
@@ -684,14 +698,16 @@ static int loadBMP16(FILE *fp, byte *pic24, u_int w, u_int h, u_int *mask, int r
       *(pp++) = (buf & colormask[5]) >> bitshift[5] << bitshift2[5];
     }
     if (w & 1) { /* padded to 2 pix */
-      buf = getint(fp);
+      buf = BUFINT(bp, nread);
       *(pp++) = (buf & colormask[0]) >> bitshift[0];
       *(pp++) = (buf & colormask[1]) >> bitshift[1];
       *(pp++) = (buf & colormask[2]) >> bitshift[2];
     }
   }
 
-  return FERROR(fp)? 1 : 0;
+  rv = FERROR(fp);
+  BulkDone(&bi);
+  return rv;
 }
 
 
@@ -699,14 +715,13 @@ static int loadBMP16(FILE *fp, byte *pic24, u_int w, u_int h, u_int *mask, int r
 /*******************************************/
 static int loadBMP24(FILE *fp, byte *pic24, u_int w, u_int h, u_int bits, int rightsideup)   /* also handles 32-bit BI_RGB */
 {
-  int   i,j,padb,rv,ibegin,iend,iinc;
-  byte *pp = pic24 + ((h - 1) * w * 3);
-  size_t l = w*h*3;
-
-  rv = 0;
+  int   i,padb,rv,ibegin,iend,iinc;
+  size_t rowbytes;
+  BULKIN bi;
 
   padb = (4 - ((w*3) % 4)) & 0x03;  /* # of pad bytes to read at EOscanline */
   if (bits==32) padb = 0;
+  rowbytes = (size_t) w * ((bits==32) ? 4 : 3) + padb;
 
   if (rightsideup) {
     ibegin = 0;
@@ -719,24 +734,17 @@ static int loadBMP24(FILE *fp, byte *pic24, u_int w, u_int h, u_int bits, int ri
     iinc = -1;
   }
 
+  BulkInit(&bi, fp, rowbytes * h, 0xff);
+
   for (i=ibegin; i != iend; i+=iinc) {
-    pp = pic24 + (i * w * 3);
     if ((i&0x3f)==0) WaitCursor();
-
-    for (j=0; j<w && (pp - pic24 <= l); j++) {
-      pp[2] = getc(fp);   /* blue */
-      pp[1] = getc(fp);   /* green */
-      pp[0] = getc(fp);   /* red */
-      if (bits==32) getc(fp);
-      pp += 3;
-    }
-
-    for (j=0; j<padb; j++) getc(fp);
-
-    rv = (FERROR(fp));
-    if (rv) break;
+    UnpackRGB24(BulkRow(&bi, rowbytes), pic24 + ((size_t) i * w * 3), (int) w,
+		(bits==32) ? UNPACK_BGRX32 : UNPACK_BGR24);
+    if (bi.missing) break;     /* as before, the rest stays 0 */
   }
 
+  rv = FERROR(fp);
+  BulkDone(&bi);
   return rv;
 }
 
@@ -745,10 +753,12 @@ static int loadBMP24(FILE *fp, byte *pic24, u_int w, u_int h, u_int bits, int ri
 /*******************************************/
 static int loadBMP32(FILE *fp, byte *pic24, u_int w, u_int h, u_int *colormask, int rightsideup) /* 32-bit BI_BITFIELDS only */
 {
-  int	 x, y, ybegin, yend, yinc;
-  byte	*pp;
+  int	 x, y, ybegin, yend, yinc, rv;
+  byte	*pp, *bp;
   u_int	 buf;
   int	 i, bit, bitshift[3], colorbits[3], bitshift2[3];
+  size_t nread;
+  BULKIN bi;
 
   for (i = 0; i < 3; ++i) {
     buf = colormask[i];
@@ -797,19 +807,26 @@ static int loadBMP32(FILE *fp, byte *pic24, u_int w, u_int h, u_int *colormask,
     yinc = -1;
   }
 
+  BulkInit(&bi, fp, (size_t) w * h * 4, 0xff);
+
   for (y = ybegin; y != yend; y += yinc) {
-    pp = pic24 + (3 * w * y);
+    pp = pic24 + ((size_t) 3 * w * y);
+    nread = bi.missing;
+    bp = BulkRow(&bi, (size_t) w * 4);
+    nread = (size_t) w * 4 - (bi.missing - nread);
     if ((y&0x3f)==0) WaitCursor();
 
-    for(x = w; x > 0; x --) {
-      buf = getint(fp);
+    for(x = w; x > 0; x --, bp += 4, nread -= (nread < 4) ? nread : 4) {
+      buf = BUFINT(bp, nread);
       *(pp++) = (buf & colormask[0]) >> bitshift[0] << bitshift2[0];
       *(pp++) = (buf & colormask[1]) >> bitshift[1] << bitshift2[1];
       *(pp++) = (buf & colormask[2]) >> bitshift[2] << bitshift2[2];
     }
   }
 
-  return FERROR(fp)? 1 : 0;
+  rv = FERROR(fp);
+  BulkDone(&bi);
+  return rv;
 }
 
 
@@ -835,6 +852,22 @@ static u_int getint(FILE *fp)
 }
 
 
+/*******************************************/
+static u_int eofint(byte *p, size_t n)
+{
+  /* what getint() would've returned for 4 bytes of which only the first 'n'
+     were there:  getc()'s EOFs (-1) get added in, shifted, not or-ed */
+
+  int c[4], i;
+
+  for (i=0; i<4; i++) c[i] = ((size_t) i < n) ? p[i] : EOF;
+  return  ((u_int) c[0]) +
+	 (((u_int) c[1]) << 8) +
+	 (((u_int) c[2]) << 16) +
+	 (((u_int) c[3]) << 24);
+}
+
+
 /*******************************************/
 static void putshort(FILE *fp, int i)
 {
@@ -1612,7 +1612,7 @@ static void drawIcon(BROWINFO *br, int num)
   }
 
   else if (bf->ftype == BF_HAVEIMG && bf->ximage) {
-    XPutImage(theDisp, br->iconW, theGC, bf->ximage, 0,0, ix,iy,
+    xvPutImage(br->iconW, theGC, bf->ximage, 0,0, ix,iy,
 	      (u_int) bf->w, (u_int) bf->h);
   }
 
@@ -0,0 +1,107 @@
+/*
+ * xvbulk.c - reads the pixel data of uncompressed images in big blocks,
+ *            and hands it out a row at a time
+ *
+ *  Contains:
+ *            void  BulkInit(bi, fp, nbytes, fill)
+ *            byte *BulkRow(bi, len)
+ *            void  BulkDone(bi)
+ *
+ * The loaders for the simple uncompressed formats used to getc() their
+ * way through every byte of the image, which for a few hundred megabytes
+ * of BMP or PPM is mostly stdio overhead.  Instead, once the header's been
+ * read, a loader calls BulkInit() with the number of bytes of pixel data
+ * it's going to read, and BulkRow() for each row's worth of it (padding
+ * and all), and converts the row in one go.  The data is fread() a
+ * megabyte or so at a time straight into a buffer, and BulkRow() normally
+ * just returns a pointer into that.
+ *
+ * Nothing past 'nbytes' is ever read from the file, so whatever comes after
+ * the pixel data can still be read from 'fp' as usual afterwards.
+ *
+ * The file isn't mmap()ed:  the loaders may be reading a pipe or something
+ * xvuncomp.c has uncompressed into memory, and a file that gets truncated
+ * while it's mapped kills the program with a SIGBUS rather than just giving
+ * a short read.  Reading big blocks gets nearly all of the benefit anyway.
+ *
+ * If the file runs out early, the rest of the bytes read as 'fill' (0 for
+ * loaders that used to fread() into a calloc()ed image, 0xff for ones that
+ * stored getc()'s EOF in a byte), and bi->missing says how many of them
+ * there were.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+
+#define BULKBLOCK  (1024*1024)       /* how much to read at a time */
+
+
+/***************************************************/
+void BulkInit(BULKIN *bi, FILE *fp, size_t nbytes, int fill)
+{
+  /* gets ready to read 'nbytes' bytes of pixel data from the current
+     position in 'fp' */
+
+  bi->fp      = fp;
+  bi->buf     = (byte *) NULL;
+  bi->bufsize = bi->pos = bi->end = 0;
+  bi->left    = nbytes;
+  bi->missing = 0;
+  bi->fill    = fill;
+}
+
+
+/***************************************************/
+byte *BulkRow(BULKIN *bi, size_t len)
+{
+  /* returns a pointer to the next 'len' bytes of the file.  They stay put
+     until the next call */
+
+  size_t have, want, got;
+  byte  *p;
+
+  have = bi->end - bi->pos;
+
+  if (have < len) {
+    /* move what's left to the front, and fill up the rest */
+    if (have && bi->pos) xvbcopy((char *) bi->buf + bi->pos, (char *) bi->buf,
+				 have);
+    bi->pos = 0;  bi->end = have;
+
+    if (len > bi->bufsize) {
+      size_t nsize = (len > BULKBLOCK) ? len : BULKBLOCK;
+
+      p = (byte *) realloc(bi->buf, nsize);
+      if (!p) FatalError("couldn't malloc buffer in BulkRow()");
+      bi->buf = p;  bi->bufsize = nsize;
+    }
+
+    want = bi->bufsize - have;
+    if (want > bi->left) want = bi->left;
+
+    got = (want) ? fread(bi->buf + have, (size_t) 1, want, bi->fp) : 0;
+    bi->left = (got < want) ? 0 : bi->left - got;    /* EOF or error */
+    bi->end += got;
+
+    if (bi->end < len) {
+      memset(bi->buf + bi->end, bi->fill, len - bi->end);
+      bi->missing += len - bi->end;
+      bi->end = len;
+    }
+  }
+
+  p = bi->buf + bi->pos;
+  bi->pos += len;
+  return p;
+}
+
+
+/***************************************************/
+void BulkDone(BULKIN *bi)
+{
+  if (bi->buf) free(bi->buf);
+  bi->buf = (byte *) NULL;
+  bi->bufsize = bi->pos = bi->end = 0;
+}
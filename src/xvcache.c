@@ -0,0 +1,341 @@
+/*
+ * xvcache.c - keeps recently decoded images around, so that flipping back
+ *             and forth between files doesn't mean decoding them every time
+ *
+ *  Contains:
+ *            int  CacheGet(fname, quick, page, pinfo)
+ *            void CachePut(fname, quick, page, pinfo, copy)
+ *            int  CacheHas(fname, quick, page, loadw, loadh, lo)
+ *            void CacheForget(fname)
+ *
+ * Entries are keyed by the file's full path, its size and modification
+ * time, the 'quick' flag that was passed to ReadPicFile(), the page number
+ * (for the page files of multi-page documents), and the settings that change
+ * what the loaders give back (a LOADOPTS:  whether LoadJFIF() was doing its
+ * own 24->8 conversion, the PhotoCD size, fax resolution, and ghostscript
+ * settings).  At most 'cacheMB' megabytes of image data are kept (set with
+ * '-cachemb'), least recently used first out.
+ *
+ * A JPEG that was decoded at a reduced size (see ReducedLoadSize()) is only
+ * handed out to someone who asks for the same 'loadw,loadh'.  Full-size
+ * images will do for anyone.
+ *
+ * The size/mtime check catches most changes to a file, but not ones made
+ * within the same second that keep the size the same, so anything that
+ * knows a file has changed (the poll code, fkey commands, deleting or
+ * saving a file) calls CacheForget() on it as well.
+ *
+ * The pic in a PICINFO belongs to whoever displays it, and gets modified
+ * in place, so the cache always hands out copies.  Going the other way,
+ * whoever's done with a pic hands it over, rather than having it copied:
+ * the prefetcher (xvprefetch.c), which puts things in from another thread,
+ * and openPic(), when it converts a pic to 8 or 24 bits.  openPic() has
+ * the cache keep a copy of pics it's going to display as they are, unless
+ * they're big (more than 1/CACHECOPYFRAC of the cache).  Those are left to
+ * the prefetcher, as the copy would double the memory it takes to show them.
+ *
+ * The settings are read with LoadOptsNow(), which only the main thread can
+ * do.  Anyone else passes a copy, in pinfo->opts.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+#  define LOCK_CACHE()    pthread_mutex_lock(&cacheLock)
+#  define UNLOCK_CACHE()  pthread_mutex_unlock(&cacheLock)
+#else
+#  define LOCK_CACHE()
+#  define UNLOCK_CACHE()
+#endif
+
+
+#define MAXCACHE     64    /* max # of entries, regardless of size */
+#define CACHECOPYFRAC 8    /* see above */
+
+
+typedef struct { char    name[MAXPATHLEN];   /* full path.  "" = unused */
+		 int     quick, page;
+		 LOADOPTS opts;
+		 off_t   size;
+		 time_t  mtime;
+		 unsigned long lastuse;
+		 size_t  bytes;              /* memory used by pinfo */
+		 PICINFO pinfo;
+	       } CENTRY;
+
+
+static CENTRY         cache[MAXCACHE];
+static size_t         cacheBytes = 0;
+static unsigned long  useCount   = 0;
+
+static CENTRY *findEntry  PARM((const char *, int, int, int, int,
+				LOADOPTS *, struct stat *));
+static void    freeEntry  PARM((CENTRY *));
+static void    freePinfo  PARM((PICINFO *));
+static size_t  pinfoBytes PARM((PICINFO *));
+static int     dupPinfo   PARM((PICINFO *, PICINFO *, int));
+
+
+/***************************************************/
+int CacheGet(char *fname, int quick, int page, PICINFO *pinfo)
+{
+  /* if there's an up-to-date copy of 'fname' in the cache, copies it into
+     'pinfo', and returns '1'.  Otherwise returns '0'.  pinfo->loadw,loadh
+     should be set up as they would be for ReadPicFile() */
+
+  struct stat st;
+  CENTRY     *e;
+  LOADOPTS    lo;
+  int         rv;
+
+  if (stat(fname, &st) != 0) return 0;
+
+  if (pinfo->opts) lo = *pinfo->opts;
+  else LoadOptsNow(&lo);
+
+  LOCK_CACHE();
+  rv = 0;
+  e  = findEntry(fname, quick, page, pinfo->loadw, pinfo->loadh, &lo, &st);
+  if (e && dupPinfo(&e->pinfo, pinfo, 1)) {
+    e->lastuse = ++useCount;
+    rv = 1;
+  }
+  UNLOCK_CACHE();
+
+  if (DEBUG && rv) fprintf(stderr,"CacheGet(%s): hit\n", fname);
+  return rv;
+}
+
+
+/***************************************************/
+int CacheHas(char *fname, int quick, int page, int loadw, int loadh, LOADOPTS *lo)
+{
+  /* returns '1' if CacheGet() would find 'fname'.  'lo' is the settings to
+     look for, or NULL for the current ones */
+
+  struct stat st;
+  LOADOPTS    now;
+  int         rv;
+
+  if (stat(fname, &st) != 0) return 0;
+
+  if (!lo) { LoadOptsNow(&now);  lo = &now; }
+
+  LOCK_CACHE();
+  rv = (findEntry(fname, quick, page, loadw, loadh, lo, &st) != NULL);
+  UNLOCK_CACHE();
+
+  return rv;
+}
+
+
+/***************************************************/
+void CachePut(char *fname, int quick, int page, PICINFO *pinfo, int how)
+{
+  /* adds the freshly loaded 'pinfo' to the cache, throwing out older
+     entries to make room.  'how' is CACHE_TAKE, for the cache to take over
+     pinfo's pic, comment, etc. (and free them right away if it doesn't
+     want them), CACHE_COPY, for it to keep a copy of them (if they're not
+     too big to bother), or CACHE_TAKEPIC, to take the pic, and copy the
+     rest.  Anything taken is set to NULL in pinfo.  Multi-page files aren't
+     cached, as loading them makes the page files as a side effect */
+
+  struct stat st;
+  CENTRY      ent, *e, *lru;
+  size_t      bytes, limit;
+  int         i;
+
+  bytes = pinfoBytes(pinfo);
+  limit = (size_t) cacheMB * 1024 * 1024;
+
+  if (!pinfo->pic || pinfo->w <= 0 || pinfo->h <= 0 || bytes > limit ||
+      pinfo->numpages > 1 || pinfo->pagebname[0] ||
+      (how == CACHE_COPY && bytes > limit / CACHECOPYFRAC) ||
+      strlen(fname) >= sizeof(ent.name) || stat(fname, &st) != 0) {
+    if (how == CACHE_TAKE) freePinfo(pinfo);
+    else if (how == CACHE_TAKEPIC && pinfo->pic) {
+      free(pinfo->pic);
+      pinfo->pic = (byte *) NULL;
+    }
+    return;
+  }
+
+  /* build the new entry first, without holding the lock */
+  strcpy(ent.name, fname);
+  ent.quick = quick;  ent.page = page;
+  if (pinfo->opts) ent.opts = *pinfo->opts;
+  else LoadOptsNow(&ent.opts);
+  ent.size  = st.st_size;  ent.mtime = st.st_mtime;
+  ent.bytes = bytes;
+
+  if (how == CACHE_COPY) {
+    if (!dupPinfo(pinfo, &ent.pinfo, 1)) return;
+  }
+  else if (how == CACHE_TAKEPIC) {
+    if (!dupPinfo(pinfo, &ent.pinfo, 0)) {
+      free(pinfo->pic);  pinfo->pic = (byte *) NULL;
+      return;
+    }
+    ent.pinfo.pic = pinfo->pic;
+    pinfo->pic = (byte *) NULL;
+  }
+  else {
+    xvbcopy((char *) pinfo, (char *) &ent.pinfo, sizeof(PICINFO));
+    pinfo->pic = (byte *) NULL;  pinfo->comment = (char *) NULL;
+    pinfo->exifInfo = (byte *) NULL;
+  }
+  ent.pinfo.opts = (LOADOPTS *) NULL;
+
+
+  LOCK_CACHE();
+
+  for (i=0; i<MAXCACHE; i++) {       /* replace any old version of it */
+    e = &cache[i];
+    if (e->name[0] && e->quick == quick && e->page == page &&
+	strcmp(e->name, fname) == 0) freeEntry(e);
+  }
+
+  while (1) {
+    for (i=0, e=lru=(CENTRY *) NULL; i<MAXCACHE; i++) {
+      if (!cache[i].name[0]) { if (!e) e = &cache[i]; }
+      else if (!lru || cache[i].lastuse < lru->lastuse) lru = &cache[i];
+    }
+
+    if (e && cacheBytes + bytes <= limit) break;
+    if (!lru) break;                 /* can't happen */
+
+    if (DEBUG) fprintf(stderr,"CachePut: dropping %s\n", lru->name);
+    freeEntry(lru);
+  }
+
+  xvbcopy((char *) &ent, (char *) e, sizeof(CENTRY));
+  e->lastuse  = ++useCount;
+  cacheBytes += bytes;
+
+  UNLOCK_CACHE();
+}
+
+
+/***************************************************/
+void CacheForget(char *fname)
+{
+  /* throws out everything cached for 'fname' */
+
+  int i;
+
+  LOCK_CACHE();
+  for (i=0; i<MAXCACHE; i++) {
+    if (cache[i].name[0] && strcmp(cache[i].name, fname) == 0)
+      freeEntry(&cache[i]);
+  }
+  UNLOCK_CACHE();
+}
+
+
+
+/***************************************************/
+static CENTRY *findEntry(const char *fname, int quick, int page,
+			 int loadw, int loadh, LOADOPTS *lo, struct stat *st)
+{
+  /* cacheLock must be held.  Stale entries are thrown out */
+
+  int i;
+
+  for (i=0; i<MAXCACHE; i++) {
+    CENTRY *e = &cache[i];
+
+    if (!e->name[0] || e->quick != quick || e->page != page ||
+	strcmp(e->name, fname) != 0) continue;
+
+    if (e->size != st->st_size || e->mtime != st->st_mtime) {
+      freeEntry(e);
+      continue;
+    }
+
+    if (!SameLoadOpts(&e->opts, lo)) continue;
+
+    if (e->pinfo.reduced > 1 &&
+	(e->pinfo.loadw != loadw || e->pinfo.loadh != loadh)) continue;
+
+    return e;
+  }
+
+  return (CENTRY *) NULL;
+}
+
+
+/***************************************************/
+static void freeEntry(CENTRY *e)
+{
+  cacheBytes -= e->bytes;
+  freePinfo(&e->pinfo);
+  e->name[0] = '\0';
+}
+
+
+/***************************************************/
+static void freePinfo(PICINFO *pinfo)
+{
+  if (pinfo->pic)      free(pinfo->pic);
+  if (pinfo->comment)  free(pinfo->comment);
+  if (pinfo->exifInfo) free(pinfo->exifInfo);
+  pinfo->pic      = (byte *) NULL;
+  pinfo->comment  = (char *) NULL;
+  pinfo->exifInfo = (byte *) NULL;
+}
+
+
+/***************************************************/
+static size_t pinfoBytes(PICINFO *pinfo)
+{
+  size_t bytes;
+
+  bytes = (size_t) pinfo->w * pinfo->h * ((pinfo->type == PIC24) ? 3 : 1);
+  if (pinfo->comment)  bytes += strlen(pinfo->comment) + 1;
+  if (pinfo->exifInfo) bytes += (size_t) pinfo->exifInfoSize;
+  return bytes + sizeof(CENTRY);
+}
+
+
+/***************************************************/
+static int dupPinfo(PICINFO *src, PICINFO *dst, int withpic)
+{
+  /* makes 'dst' a copy of 'src', with its own comment, etc., and pic, if
+     'withpic' is set (otherwise dst->pic is NULL).  Returns '0' (with
+     nothing allocated) if it runs out of memory */
+
+  size_t picbytes;
+
+  picbytes = (size_t) src->w * src->h * ((src->type == PIC24) ? 3 : 1);
+
+  xvbcopy((char *) src, (char *) dst, sizeof(PICINFO));
+  dst->opts     = (LOADOPTS *) NULL;
+  dst->pic      = (byte *) NULL;
+  dst->comment  = (char *) NULL;
+  dst->exifInfo = (byte *) NULL;
+
+  if (withpic) {
+    dst->pic = (byte *) malloc(picbytes);
+    if (!dst->pic) return 0;
+    xvbcopy((char *) src->pic, (char *) dst->pic, picbytes);
+  }
+
+  if (src->comment) {
+    dst->comment = (char *) malloc(strlen(src->comment) + 1);
+    if (!dst->comment) { freePinfo(dst);  return 0; }
+    strcpy(dst->comment, src->comment);
+  }
+
+  if (src->exifInfo && src->exifInfoSize > 0) {
+    dst->exifInfo = (byte *) malloc((size_t) src->exifInfoSize);
+    if (!dst->exifInfo) { freePinfo(dst);  return 0; }
+    xvbcopy((char *) src->exifInfo, (char *) dst->exifInfo,
+	    (size_t) src->exifInfoSize);
+  }
+
+  return 1;
+}
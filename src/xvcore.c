@@ -0,0 +1,313 @@
+/*
+ * xvcore.c - the bits of xv that libxvcore needs, without any X
+ *
+ *  Contains:
+ *            void XVCoreInit()
+ *            void XVCoreCallbacks(msgfunc, progfunc)
+ *
+ *      and headless versions of:
+ *            void SetISTR(stnum, fmt, ...)
+ *            void Warning()
+ *            void FatalError(identifier)
+ *            void Quit(i)
+ *            void WaitCursor()
+ *            void SetCursors(n)
+ *            void ProgressMeter(min, max, val, str)
+ *            void ErrPopUp(st, bstr)
+ *            void OpenAlert(st)
+ *            void CloseAlert()
+ *            int  IncrStart(pinfo)
+ *            void IncrRows(y0, y1)
+ *            void IncrDone(ok)
+ *            void LockLoaders()
+ *            void UnlockLoaders()
+ *
+ * libxvcore is the loaders (ReadPicFile()), Conv24to8(), Smooth24() and
+ * friends, ApplyGamMods24(), RotatePic()/FlipPic(), and the xvalg.c
+ * filters (AlgApply24()), compiled with XV_HEADLESS so they don't need the
+ * X11 headers or libraries.  That code was written to report what it's
+ * doing through the info box, pop-ups, and the progress gauge.  Here, all
+ * of that goes to whatever callbacks the program using the library has set
+ * up with XVCoreCallbacks(), or to stderr, if it hasn't.
+ *
+ * This file also defines the globals (see xv.h), like xv.c does for xv.
+ * Call XVCoreInit() before anything else, then adjust any of them (conv24,
+ * ncols, DEBUG, nthreads, gsDev, ...) as needed.
+ *
+ * FatalError() is still fatal:  it reports XVC_FATAL, and exits.  (The code
+ * that calls it doesn't expect it to return.)
+ */
+
+#include "copyright.h"
+
+#define MAIN
+#define NEEDSARGS
+#include "xv.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+
+static XVCMSGFUNC  msgFunc  = (XVCMSGFUNC) NULL;
+static XVCPROGFUNC progFunc = (XVCPROGFUNC) NULL;
+
+static int incrHigh = 0;       /* height of the image being loaded */
+static int incrPct  = -1;      /* and how far along it was last reported */
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t loadLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  loadCond = PTHREAD_COND_INITIALIZER;
+static pthread_t       loadOwner;
+static int             loadDepth = 0;
+#endif
+
+static void report   PARM((int, const char *));
+static void progress PARM((int, int, const char *));
+
+
+/***************************************************/
+void XVCoreInit(void)
+{
+  /* sets the globals the library code looks at to the same defaults xv
+     uses.  Should be called once, from the thread that'll be loading
+     files */
+
+  const char *tmpstr;
+
+  cmd = "xvcore";
+
+  InitThreads();
+  GenerateFSGamma();
+  TraceInit((const char *) NULL);    /* if $XV_TRACE is set */
+
+  DEBUG = 0;
+
+  tmpstr = (const char *) getenv("TMPDIR");
+  if (!tmpstr) tmpstr = "/tmp";
+  tmpdir = (char *) malloc(strlen(tmpstr) + 1);
+  if (!tmpdir) FatalError("can't malloc 'tmpdir'\n");
+  strcpy(tmpdir, tmpstr);
+
+  gsDev = "ppmraw";
+#ifdef GS_DEV
+  gsDev = GS_DEV;
+#endif
+  gsRes = 72;
+  gsGeomStr = NULL;
+
+  ncols = 256;  numcols = 0;  noqcheck = 0;
+  conv24 = CONV24_SLOW;  octdither = 1;  ordered332 = 0;
+  defaspect = normaspect = 1.0;
+  resampFilter = RF_LANCZOS3;
+  nthreads = 0;  dpiMult = 1;
+  clearR = clearG = clearB = 0;
+  have_imagebg = 0;
+  picType = PIC8;
+}
+
+
+/***************************************************/
+void XVCoreCallbacks(XVCMSGFUNC mfunc, XVCPROGFUNC pfunc)
+{
+  /* 'mfunc' gets the messages (at an XVC_* level), and 'pfunc' is told
+     how far along the slower operations are.  Either can be NULL:  messages
+     go to stderr, and progress isn't reported */
+
+  msgFunc  = mfunc;
+  progFunc = pfunc;
+}
+
+
+/***************************************************/
+static void report(int level, const char *msg)
+{
+  if (!msg || !*msg) return;
+
+  if (msgFunc) (*msgFunc)(level, msg);
+  else if (level > XVC_INFO || DEBUG) fprintf(stderr, "%s: %s\n", cmd, msg);
+}
+
+
+/***************************************************/
+static void progress(int done, int total, const char *what)
+{
+  if (progFunc && IsMainThread()) (*progFunc)(done, total, what);
+}
+
+
+/***************************************************/
+/* SetISTR( ISTR, format, arg1, arg2, ...)	   */
+
+#if defined(__STDC__) && !defined(NOSTDHDRS)
+void SetISTR(int stnum, ...)
+{
+  va_list args;
+  char    *fmt;
+  char    str[256];
+
+  va_start(args, stnum);
+#else
+/*VARARGS0*/
+void SetISTR(va_alist)
+va_dcl
+{
+  va_list args;
+  char    *fmt;
+  char    str[256];
+  int     stnum;
+
+  va_start(args);
+
+  stnum = va_arg(args, int);
+#endif
+
+  /* only the info and warning lines ever said anything worth passing on */
+  if (stnum != ISTR_INFO && stnum != ISTR_WARNING) {
+    va_end(args);
+    return;
+  }
+
+  fmt = va_arg(args, char *);
+  if (fmt) vsnprintf(str, sizeof(str), fmt, args);
+  else str[0] = '\0';
+  va_end(args);
+
+  report((stnum == ISTR_WARNING) ? XVC_WARNING : XVC_INFO, str);
+}
+
+
+/***************************************************/
+void Warning(void)
+{
+  /* xv pauses here, so the user can read the warning.  It's already been
+     reported */
+}
+
+
+/***************************************************/
+void FatalError(const char *identifier)
+{
+  report(XVC_FATAL, identifier);
+  if (msgFunc) fprintf(stderr, "%s: %s\n", cmd, identifier);
+  Quit(-1);
+}
+
+
+/***************************************************/
+void Quit(int i)
+{
+  exit(i);
+}
+
+
+/***************************************************/
+void WaitCursor(void)
+{
+}
+
+
+/***************************************************/
+void SetCursors(int n)
+{
+  XV_UNUSED(n);
+}
+
+
+/***************************************************/
+void ProgressMeter(int min, int max, int val, const char *str)
+{
+  if (min >= max) return;
+  progress(val - min, max - min, str);
+}
+
+
+/***************************************************/
+void ErrPopUp(const char *st, const char *bstr)
+{
+  XV_UNUSED(bstr);
+  report(XVC_ERROR, st);
+}
+
+
+/***************************************************/
+void OpenAlert(const char *st)
+{
+  report(XVC_INFO, st);
+}
+
+
+/***************************************************/
+void CloseAlert(void)
+{
+}
+
+
+/***************************************************/
+int IncrStart(PICINFO *pinfo)
+{
+  /* nothing to show the rows in, but they make a handy progress report.
+     Returns '0', so the loaders do things the way they would for an image
+     that isn't being displayed */
+
+  incrHigh = (pinfo && pinfo->pic && IsMainThread()) ? pinfo->h : 0;
+  incrPct  = -1;
+  return 0;
+}
+
+
+/***************************************************/
+void IncrRows(int y0, int y1)
+{
+  int pct;
+
+  XV_UNUSED(y0);
+  if (incrHigh <= 0) return;
+
+  pct = (int) (((long) y1 * 100) / incrHigh);
+  if (pct != incrPct) {
+    incrPct = pct;
+    progress(y1, incrHigh, "Loading");
+  }
+}
+
+
+/***************************************************/
+void IncrDone(int ok)
+{
+  XV_UNUSED(ok);
+  if (incrHigh > 0 && incrPct < 100) progress(incrHigh, incrHigh, "Loading");
+  incrHigh = 0;
+}
+
+
+/***************************************************/
+void LockLoaders(void)
+{
+  /* called by ReadPicFile().  The loaders keep their state in statics, so
+     only one thread at a time can be in one.  Can be nested (LoadPS()
+     calls ReadPicFile() on the files gs makes) */
+
+#ifdef HAVE_PTHREAD
+  pthread_t self = pthread_self();
+
+  pthread_mutex_lock(&loadLock);
+  if (!loadDepth || !pthread_equal(loadOwner, self)) {
+    while (loadDepth) pthread_cond_wait(&loadCond, &loadLock);
+    loadOwner = self;
+  }
+  loadDepth++;
+  pthread_mutex_unlock(&loadLock);
+#endif
+}
+
+
+/***************************************************/
+void UnlockLoaders(void)
+{
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&loadLock);
+  if (--loadDepth == 0) pthread_cond_signal(&loadCond);
+  pthread_mutex_unlock(&loadLock);
+#endif
+}
@@ -91,6 +91,7 @@ static XRectangle butrect;
 static const char *dispMList[] = { "Raw\tr",
 				   "Dithered\td",
 				   "Smooth\ts",
+				   "Lanczos-3\tl",
 				   MBSEP,
 				   "Read/Write Colors",
 				   MBSEP,
@@ -119,7 +120,9 @@ static const char *conv24MList[] = { "8-bit mode\t\2448",
 				     MBSEP,
 				     "Quick 24->8",
 				     "Slow 24->8",
-				     "Best 24->8" };
+				     "Best 24->8",
+				     "Octree 24->8",
+				     "Ordered 24->8" };
 
 static const char *mskMList[] = { "Undo All\t\244u",
 				  MBSEP,
@@ -144,7 +147,8 @@ static const char *algMList[] = { "Undo All\t\244u",
 				  "Clear Rotate...\t\244T",
 				  "Pixelize...\t\244p",
 				  "Spread...\t\244S",
-				  "DeSpeckle...\t\244k"};
+				  "DeSpeckle...\t\244k",
+				  "Gaussian Blur...\t\244G"};
 
 static const char *sizeMList[] = { "Normal\tn",
 				   "Max Size\tm",
@@ -483,6 +487,12 @@ void CreateCtrl(const char *geom)
   /* have to create menu buttons after XMapSubWindows, as we *don't* want
      the popup menus mapped */
 
+  if (resampFilter != RF_LANCZOS3) {   /* name the menu item after filter */
+    static char resampItem[32];
+    sprintf(resampItem, "%s\tl", ResampleFilterName(resampFilter));
+    dispMList[DMB_RESAMP] = resampItem;
+  }
+
   MBCreate(&dispMB,   ctrlW, 0,0, MBWIDTH4,MBHEIGHT,
  	   "Display",    dispMList,   DMB_MAX,    BCLS);
   MBCreate(&conv24MB, ctrlW, 1,0, MBWIDTH4,MBHEIGHT,
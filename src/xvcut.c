@@ -35,8 +35,6 @@
  *
  *      static void  makePasteSel    (data);
  *
- *             void  CropRect2Rect    (int*,int*,int*,int*, int,int,int,int);
- *
  * coordinate system transforms between pic, cpic, and epic coords
  *             void  CoordE2C(ex, ey, &cx, &cy);
  *             void  CoordC2E(cx, cy, &ex, &ey);
@@ -205,6 +203,8 @@ void DoImgPaste(void)
 
   if (!PasteAllowed()) { XBell(theDisp, 0);  return; }
 
+  FullResPic();     /* before the selection rect gets made */
+
   cimg = getFromClip();
   if (!cimg) return;
 
@@ -1076,28 +1076,6 @@ static int countNewCols(byte *newpic, int w, int h, byte *newcmap, int is24, int
 }
 
 
-/********************************************/
-void CropRect2Rect(int *xp, int *yp, int *wp, int *hp, int cx, int cy, int cw, int ch)
-{
-  /* crops rect xp,yp,wp,hp to be entirely within bounds of cx,cy,cw,ch */
-
-  int x1,y1,x2,y2;
-
-  x1 = *xp;            y1 = *yp;
-  x2 = *xp + *wp - 1;  y2 = *yp + *hp - 1;
-  RANGE(x1, cx, cx+cw-1);
-  RANGE(y1, cy, cy+ch-1);
-  RANGE(x2, cx, cx+cw-1);
-  RANGE(y2, cy, cy+ch-1);
-
-  if (x2<x1) x2=x1;
-  if (y2<y1) y2=y1;
-
-  *xp = x1;           *yp = y1;
-  *wp = (x2 - x1)+1;  *hp = (y2 - y1)+1;
-}
-
-
 /********************************************/
 /* SELECTION manipulation functions         */
 /********************************************/
@@ -1183,6 +1161,10 @@ int DoSelection(XButtonEvent *ev)
   if (ev->type   != ButtonPress) return 0;
   if (ev->window != mainW)       return 0;
 
+  /* selections are in pic coords, and those change if a reduced-size JPEG
+     gets swapped for the real thing, so do that first */
+  FullResPic();
+
   rv = 0;
 
   CoordE2P(ev->x, ev->y, &px, &py);
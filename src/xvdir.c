@@ -2451,7 +2451,7 @@ static byte *handleBWandReduced(byte *pic, int ptype, int pw, int ph, int color,
       byte *p24, *thepic;
 
       thepic = pic;
-      p24 = GammifyPic24(thepic, pw, ph);
+      p24 = GammifyPic24(thepic, pw, ph, 0);
       if (p24) thepic = p24;
 
       /* generate a FSDithered 1-byte per pixel image */
@@ -2481,7 +2481,8 @@ static byte *handleBWandReduced(byte *pic, int ptype, int pw, int ph, int color,
   /* if DITHER or SMOOTH, and color==FULLCOLOR or GREY,
      make color=REDUCED, so it will be written with the correct colortable  */
 
-  if ((epicMode == EM_DITH || epicMode == EM_SMOOTH) && color != F_REDUCED) {
+  if ((epicMode == EM_DITH || epicMode == EM_SMOOTH || epicMode == EM_RESAMP)
+      && color != F_REDUCED) {
     if (color == F_FULLCOLOR) {
       *rpp = rdisp;  *gpp = gdisp;  *bpp = bdisp;
     }
@@ -2535,7 +2536,8 @@ static byte *handleNormSel(int *pptype, int *pwide, int *phigh, int *pfree)
   *pfree = 0;  *pptype = picType;
 
   if (savenormCB.val) { thepic = cpic;  pw = cWIDE;  ph = cHIGH; }
-                 else { thepic = epic;  pw = eWIDE;  ph = eHIGH; }
+                 else { UntileEpic();
+			thepic = epic;  pw = eWIDE;  ph = eHIGH; }
 
   *pwide = pw;  *phigh = ph;
 
@@ -2592,6 +2594,8 @@ byte *GenSavePic(int *ptypeP, int *wP, int *hP, int *freeP, int *ncP, byte **rma
   byte *pic1, *pic2;
   int   ptype, w, h, pfree;
 
+  FullResPic();
+
   pic1 = handleNormSel(&ptype, &w, &h, &pfree);
 
   pic2 = handleBWandReduced(pic1, ptype, w,h, MBWhich(&colMB),
@@ -2605,7 +2609,7 @@ byte *GenSavePic(int *ptypeP, int *wP, int *hP, int *freeP, int *ncP, byte **rma
 
 
   if (ptype == PIC24) {
-    pic2 = GammifyPic24(pic1, w, h);
+    pic2 = GammifyPic24(pic1, w, h, 0);
     if (pic2) {
       if (pfree) free(pic1);
       pic1  = pic2;
@@ -1015,10 +1015,11 @@ static void SelectDispMB(int i)
 
   if (dispMB.dim[i]) return;    /* disabled */
 
-  if (i>=DMB_RAW && i<=DMB_SMOOTH) {
-    if      (i==DMB_RAW)  epicMode = EM_RAW;
-    else if (i==DMB_DITH) epicMode = EM_DITH;
-    else                  epicMode = EM_SMOOTH;
+  if (i>=DMB_RAW && i<=DMB_RESAMP) {
+    if      (i==DMB_RAW)    epicMode = EM_RAW;
+    else if (i==DMB_DITH)   epicMode = EM_DITH;
+    else if (i==DMB_SMOOTH) epicMode = EM_SMOOTH;
+    else                    epicMode = EM_RESAMP;
 
     SetEpicMode();
     GenerateEpic(eWIDE, eHIGH);
@@ -1107,9 +1108,9 @@ static void Select24to8MB(int i)
     conv24MB.flags[i] = !conv24MB.flags[i];
   }
 
-  else if (i>=CONV24_FAST && i<=CONV24_BEST) {
+  else if (i>=CONV24_FAST && i<=CONV24_ORDERED) {
     conv24 = i;
-    for (i=CONV24_FAST; i<=CONV24_BEST; i++) {
+    for (i=CONV24_FAST; i<=CONV24_ORDERED; i++) {
       conv24MB.flags[i] = (i==conv24);
     }
   }
@@ -1154,6 +1155,9 @@ static void SelectSizeMB(int i)
   if (i<0 || i>=SZMB_MAX) return;
   if (sizeMB.dim[i]) return;
 
+  /* 'normal' is the real size, not that of a reduced-size JPEG */
+  if (i == SZMB_NORM || i == SZMB_INTEXP) FullResPic();
+
   switch (i) {
   case SZMB_NORM:
     if (cWIDE>maxWIDE || cHIGH>maxHIGH) {
@@ -1927,7 +1931,7 @@ static void handleKeyEvent(XEvent *event, int *donep, int *retvalp)
       else if (ks==XK_u) DoAlg(ALG_NONE);
 
       else if (ks==XK_f) DoMask(MSK_FLMASK);
-      else if (ks==XK_g) DoMask(MSK_Q0MASK);
+      else if (ks==XK_g && !shift) DoMask(MSK_Q0MASK);
       else if (ks==XK_h) DoMask(MSK_WIN);
       else if (ks==XK_i) DoMask(MSK_MEKO);
       else if (ks==XK_j) DoMask(MSK_CPMASK);
@@ -1949,6 +1953,8 @@ static void handleKeyEvent(XEvent *event, int *donep, int *retvalp)
 
       else if (ks==XK_S || (ks==XK_s && shift)) DoAlg(ALG_SPREAD);
 
+      else if (ks==XK_G || (ks==XK_g && shift)) DoAlg(ALG_GAUSS);
+
       else if (ks==XK_t || ks==XK_T) {
 	if (ctrl || shift || ks==XK_T)          DoAlg(ALG_ROTATE);
         else                                    DoAlg(ALG_ROTATECLR);
@@ -2005,6 +2011,7 @@ static void handleKeyEvent(XEvent *event, int *donep, int *retvalp)
       case 'r':    SelectDispMB(DMB_RAW);           break;
       case 'd':    SelectDispMB(DMB_DITH);          break;
       case 's':    SelectDispMB(DMB_SMOOTH);        break;
+      case 'l':    SelectDispMB(DMB_RESAMP);        break;
 
 	/* things in sizeMB */
       case 'n':    SelectSizeMB(SZMB_NORM);         break;
@@ -2286,8 +2293,10 @@ void DrawWindow(int x, int y, int w, int h)
   if (x+w < eWIDE) w++;  /* add one for broken servers (?) */
   if (y+h < eHIGH) h++;
 
-  if (theImage)
-    XPutImage(theDisp,mainW,theGC,theImage,x,y,x,y, (u_int) w, (u_int) h);
+  if (epicTiled)
+    DrawEpicTiles(x, y, w, h);
+  else if (theImage)
+    xvPutImage(mainW,theGC,theImage,x,y,x,y, (u_int) w, (u_int) h);
   else
     if (DEBUG) fprintf(stderr,"Tried to DrawWindow when theImage was NULL\n");
 }
@@ -2775,18 +2784,28 @@ void SetEpicMode(void)
     dispMB.dim[DMB_RAW]    = 1;
     dispMB.dim[DMB_DITH]   = !(ncols>0 && picType == PIC8);
     dispMB.dim[DMB_SMOOTH] = 0;
+    dispMB.dim[DMB_RESAMP] = 0;
   }
 
   else if (epicMode == EM_DITH) {
     dispMB.dim[DMB_RAW]    = 0;
     dispMB.dim[DMB_DITH]   = 1;
     dispMB.dim[DMB_SMOOTH] = 0;
+    dispMB.dim[DMB_RESAMP] = 0;
   }
 
   else if (epicMode == EM_SMOOTH) {
     dispMB.dim[DMB_RAW]    = 0;
     dispMB.dim[DMB_DITH]   = 1;
     dispMB.dim[DMB_SMOOTH] = 1;
+    dispMB.dim[DMB_RESAMP] = 0;
+  }
+
+  else if (epicMode == EM_RESAMP) {
+    dispMB.dim[DMB_RAW]    = 0;
+    dispMB.dim[DMB_DITH]   = 1;
+    dispMB.dim[DMB_SMOOTH] = 0;
+    dispMB.dim[DMB_RESAMP] = 1;
   }
 }
 
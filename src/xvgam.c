@@ -32,6 +32,8 @@
 
 #define MAXUNDO 32
 
+#define GAMPROXYMAX (256*1024)   /* most pixels gammified per drag step */
+
 #define BUTTH   (23 * dpiMult)
 #define N_HMAP   6     /* # of Hue modification remappings */
 
@@ -121,8 +123,8 @@ static int    hremap[360];
 
 static int    defAutoApply;
 static int    hsvnonlinear = 0;
-
-static void printUTime       PARM((const char *));
+static int    gamDragging  = 0;   /* a ctrl is being dragged:  show a proxy */
+static int    gamProxied   = 0;   /* what's shown was done on a proxy */
 
 static void computeHSVlinear PARM((void));
 static void changedGam       PARM((void));
@@ -152,6 +154,7 @@ static void makeResources    PARM((void));
 static void dragGamma        PARM((void));
 static void dragHueDial      PARM((void));
 static void dragEditColor    PARM((void));
+static byte *gamProxy24       PARM((byte *, int, int, GAMMODS *));
 
 static void HDCreate         PARM((HDIAL *, Window, int, int, int, int,
 				   int, int, const char *, u_long, u_long));
@@ -182,30 +185,6 @@ static void build_hremap     PARM((void));
 #define RGBF_HIGH  (500 * dpiMult)
 
 
-#undef TIMING_TEST
-
-#ifdef TIMING_TEST
-#include <sys/resource.h>
-#endif
-
-
-/***************************/
-static void printUTime(const char *str)
-{
-#ifdef TIMING_TEST
-  int i;
-  struct rusage ru;
-
-  i = getrusage(RUSAGE_SELF, &ru);
-  fprintf(stderr,"%s: utime = %ld.%ld seconds\n",
-	    str, ru.ru_utime.tv_sec, ru.ru_utime.tv_usec);
-#else
-  XV_UNUSED(str);
-#endif
-}
-
-
-
 /***************************************************/
 void CreateGam(const char *geom, double gam, double rgam, double ggam, double bgam, int defpreset)
 {
@@ -662,6 +641,10 @@ int GamCheckEvent(XEvent *xev)
       }
 
       else rv = 0;
+
+      /* if a drag left a proxy showing (with 'auto-apply' off, or the ctrl
+	 put back where it was), do it properly now the button's up */
+      if (gamProxied) applyGamma(0);
     }
 
     else if (e->button == Button2) {
@@ -1313,36 +1296,6 @@ void ApplyECctrls(void)
 
 
 
-/*********************/
-void GenerateFSGamma(void)
-{
-  /* this function generates the Floyd-Steinberg gamma curve (fsgamcr)
-
-     This function generates a 4 point spline curve to be used as a
-     non-linear grey 'colormap'.  Two of the points are nailed down at 0,0
-     and 255,255, and can't be changed.  You specify the other two.  If
-     you specify points on the line (0,0 - 255,255), you'll get the normal
-     linear reponse curve.  If you specify points of 50,0 and 200,255, you'll
-     get grey values of 0-50 to map to black (0), and grey values of 200-255
-     to map to white (255) (roughly).  Values between 50 and 200 will cover
-     the output range 0-255.  The reponse curve will be slightly 's' shaped. */
-
-  int i,j;
-  static int x[4] = {0,16,240,255};
-  static int y[4] = {0, 0,255,255};
-  double yf[4];
-
-  InitSpline(x, y, 4, yf);
-
-  for (i=0; i<256; i++) {
-    j = (int) EvalSpline(x, y, yf, 4, (double) i);
-    if (j<0) j=0;
-    else if (j>255) j=255;
-    fsgamcr[i] = j;
-  }
-}
-
-
 /*********************/
 static void doCmd(int cmd)
 {
@@ -1590,7 +1543,7 @@ static void applyGamma(int cmapchange)
   int i,j;
   byte oldr[256], oldg[256], oldb[256];
 
-  if (!pic || !epic) return;   /* called before image exists.  ignore */
+  if (!pic || (!epic && !epicTiled)) return;   /* no image yet.  ignore */
 
   if (picType == PIC8) {
     /* save current 'desired' colormap */
@@ -1896,85 +1849,6 @@ void Gammify1(int col)
 }
 
 
-/*********************/
-void rgb2hsv(int r, int g, int b, double *hr, double *sr, double *vr)
-{
-  double rd, gd, bd, h, s, v, max, min, del, rc, gc, bc;
-
-  /* convert RGB to HSV */
-  rd = r / 255.0;            /* rd,gd,bd range 0-1 instead of 0-255 */
-  gd = g / 255.0;
-  bd = b / 255.0;
-
-  /* compute maximum of rd,gd,bd */
-  if (rd>=gd) { if (rd>=bd) max = rd;  else max = bd; }
-         else { if (gd>=bd) max = gd;  else max = bd; }
-
-  /* compute minimum of rd,gd,bd */
-  if (rd<=gd) { if (rd<=bd) min = rd;  else min = bd; }
-         else { if (gd<=bd) min = gd;  else min = bd; }
-
-  del = max - min;
-  v = max;
-  if (max != 0.0) s = (del) / max;
-             else s = 0.0;
-
-  h = NOHUE;
-  if (s != 0.0) {
-    rc = (max - rd) / del;
-    gc = (max - gd) / del;
-    bc = (max - bd) / del;
-
-    if      (rd==max) h = bc - gc;
-    else if (gd==max) h = 2 + rc - bc;
-    else if (bd==max) h = 4 + gc - rc;
-
-    h = h * 60;
-    if (h<0) h += 360;
-  }
-
-  *hr = h;  *sr = s;  *vr = v;
-}
-
-
-
-/*********************/
-void hsv2rgb(double h, double s, double v, int *rr, int *gr, int *br)
-{
-  int    j;
-  double rd, gd, bd;
-  double f, p, q, t;
-
-  /* convert HSV back to RGB */
-  if (h==NOHUE || s==0.0) { rd = v;  gd = v;  bd = v; }
-  else {
-    if (h==360.0) h = 0.0;
-    h = h / 60.0;
-    j = (int) floor(h);
-    if (j<0) j=0;          /* either h or floor seem to go neg on some sys */
-    f = h - j;
-    p = v * (1-s);
-    q = v * (1 - (s*f));
-    t = v * (1 - (s*(1 - f)));
-
-    switch (j) {
-    case 0:  rd = v;  gd = t;  bd = p;  break;
-    case 1:  rd = q;  gd = v;  bd = p;  break;
-    case 2:  rd = p;  gd = v;  bd = t;  break;
-    case 3:  rd = p;  gd = q;  bd = v;  break;
-    case 4:  rd = t;  gd = p;  bd = v;  break;
-    case 5:  rd = v;  gd = p;  bd = q;  break;
-    default: rd = v;  gd = t;  bd = p;  break;  /* never happen */
-    }
-  }
-
-  *rr = (int) floor((rd * 255.0) + 0.5);
-  *gr = (int) floor((gd * 255.0) + 0.5);
-  *br = (int) floor((bd * 255.0) + 0.5);
-}
-
-
-
 /*********************/
 static void ctrls2gamstate(struct gamstate *gs)
 {
@@ -2360,7 +2234,9 @@ static void dragGamma (void)
 
   if (dragCB.val && dragCB.active) {
     hsvnonlinear = 1;   /* force HSV calculations during drag */
+    gamDragging = 1;
     applyGamma(0);
+    gamDragging = 0;
   }
 }
 
@@ -2377,7 +2253,9 @@ static void dragHueDial(void)
     dials2hmap();
     build_hremap();
     hsvnonlinear = 1;   /* force HSV calculations during drag */
+    gamDragging = 1;
     applyGamma(0);
+    gamDragging = 0;
   }
 }
 
@@ -3127,162 +3005,101 @@ static void build_hremap(void)
 
 
 /*********************/
-byte *GammifyPic24(byte *pic24, int wide, int high)
+byte *GammifyPic24(byte *pic24, int wide, int high, int forshow)
 {
   /* applies HSV/RGB modifications to each pixel in given 24-bit image.
      creates and returns a new picture, or NULL on failure.
      Also, checks to see if the result will be the same as the input, and
-     if so, also returns NULL, as a time-saving maneuver */
-
-  byte *pp, *op;
-  int   i,j;
-  int   rv, gv, bv;
-  byte *outpic;
-  int   min, max, del, h, s, v;
-  int   f, p, q, t, vs100, vsf10000;
-  int   hsvmod, rgbmod;
-
-  outpic = (byte *) NULL;
-  if (!enabCB.val) return outpic;              /* mods turned off */
-
-  printUTime("start of GammifyPic24");
-
-  /* check for HSV/RGB control linearity */
-
-  hsvmod = rgbmod = 0;
-
-  /* check HUE remapping */
-  for (i=0; i<360 && hremap[i] == i; i++);
-  if (i!=360) hsvmod++;
+     if so, also returns NULL, as a time-saving maneuver.
 
-  if (whtHD.enabCB.val && whtHD.satval) hsvmod++;
+     If 'forshow' is set, the picture is only going to be displayed, so
+     it can use the faster, approximate, way of doing the HSV mods (see
+     ApplyGamMods24()).  Things that get saved are done exactly.  And if
+     one of the ctrls is being dragged, a big picture is only done at a
+     reduced size (see gamProxy24()), which gets redone properly when the
+     mouse button is released */
 
-  if (satDial.val != 0.0) hsvmod++;
+  GAMMODS gm;
+  int     i;
 
-  /* check intensity graf */
-  for (i=0; i<256; i++) {
-    if (intGraf.func[i] != i) break;
-  }
-  if (i<256) hsvmod++;
+  if (forshow) gamProxied = 0;
+  if (!enabCB.val) return (byte *) NULL;       /* mods turned off */
 
+  for (i=0; i<360; i++) gm.hremap[i] = hremap[i];
+  gm.whtenab = whtHD.enabCB.val;
+  gm.whthue  = whtHD.stval;
+  gm.whtsat  = whtHD.satval;
+  gm.satval  = satDial.val;
+  gm.approx  = forshow;
 
-  /* check R,G,B grafs simultaneously */
   for (i=0; i<256; i++) {
-    if (rGraf.func[i] != i ||
-	gGraf.func[i] != i ||
-	bGraf.func[i] != i) break;
+    gm.intfunc[i] = intGraf.func[i];
+    gm.rfunc[i]   = rGraf.func[i];
+    gm.gfunc[i]   = gGraf.func[i];
+    gm.bfunc[i]   = bGraf.func[i];
   }
-  if (i<256) rgbmod++;
-
-
-  if (!hsvmod && !rgbmod) return outpic;  /* apparently, it's linear */
-
-
-
-  WaitCursor();
-
-  printUTime("NonLINEAR");
-
-  outpic = (byte *) malloc((size_t) wide * high * 3);
-  if (!outpic) return outpic;
-
-  pp = pic24;  op = outpic;
-  for (i=wide * high; i; i--) {
 
-    if ((i&0x7fff)==0) WaitCursor();
+  if (forshow && gamDragging && (long) wide * high > GAMPROXYMAX)
+    return gamProxy24(pic24, wide, high, &gm);
 
-    rv = *pp++;  gv = *pp++;  bv = *pp++;
-
-    if (hsvmod) {
-      /* convert RGB to HSV */
-      /* the HSV computed will be int's ranging -1..359, 0..100, 0..255 */
-
-      max = (rv>gv) ? rv : gv;      /* compute maximum of rv,gv,bv */
-      if (max<bv) max = bv;
-
-      min = (rv<gv) ? rv : gv;      /* compute minimum of rd,gd,bd */
-      if (min>bv) min=bv;
-
-      del = max - min;
-      v = max;
-      if (max != 0) s = (del * 100) / max;
-               else s = 0;
-
-      h = NOHUE;
-      if (s) {
-	if      (rv==max) h =       ((gv - bv) * 100) / del;
-	else if (gv==max) h = 200 + ((bv - rv) * 100) / del;
-	else if (bv==max) h = 400 + ((rv - gv) * 100) / del;
-
-
-	/* h is in range -100..500  (= -1.0 .. 5.0) */
-	if (h<0) h += 600;          /* h is in range 000..600  (0.0 .. 6.0) */
-	h = (h * 60) / 100;         /* h is in range 0..360 */
-	if (h>=360) h -= 360;
-      }
+  return ApplyGamMods24(pic24, wide, high, &gm);
+}
 
 
-      /* apply HSV mods */
+/*********************/
+static byte *gamProxy24(byte *pic24, int wide, int high, GAMMODS *gm)
+{
+  /* like ApplyGamMods24(), but only does every k'th pixel of every k'th
+     row (k chosen so there are no more than GAMPROXYMAX of them), and
+     blows the result back up to wide*high in k*k blocks.  Keeps dragging
+     the ctrls interactive on a big image */
 
+  byte *small, *gsmall, *outpic, *sp, *dp, *rp;
+  int   k, sw, sh, x, y, i;
 
-      /* map near-black to black to avoid weird effects */
-      if (v <= 16) s = 0;
+  for (k=2; ((long) (wide+k-1)/k) * ((high+k-1)/k) > GAMPROXYMAX; k++);
+  sw = (wide + k - 1) / k;
+  sh = (high + k - 1) / k;
 
-      /* apply intGraf.func[] function to 'v' (the intensity) */
-      v = intGraf.func[v];
+  small = (byte *) malloc((size_t) sw * sh * 3);
+  if (!small) return ApplyGamMods24(pic24, wide, high, gm);
 
-      /* do Hue remapping */
-      if (h>=0) h = hremap[h];
-      else {  /* NOHUE */
-	if (whtHD.enabCB.val && (whtHD.stval || whtHD.satval)) {
-	  h = whtHD.stval;
-	  s = whtHD.satval;
-	}
-      }
+  for (y=0, dp=small; y<sh; y++) {
+    sp = pic24 + (size_t) y * k * wide * 3;
+    for (x=0; x<sw; x++, sp += k*3) {
+      *dp++ = sp[0];  *dp++ = sp[1];  *dp++ = sp[2];
+    }
+  }
 
-      /* apply satDial value to s */
-      s = s + (int)satDial.val;
-      if (s<  0) s =   0;
-      if (s>100) s = 100;
+  gsmall = ApplyGamMods24(small, sw, sh, gm);
+  free(small);
+  if (!gsmall) return gsmall;                 /* nothing to do */
 
+  /* (NULL would mean 'no changes', so do it properly instead) */
+  outpic = (byte *) malloc((size_t) wide * high * 3);
+  if (!outpic) {
+    free(gsmall);
+    return ApplyGamMods24(pic24, wide, high, gm);
+  }
 
-      /* convert HSV back to RGB */
+  for (y=0; y<high; y++) {
+    dp = outpic + (size_t) y * wide * 3;
 
+    if (y % k) {                              /* same as the row above */
+      xvbcopy((char *) (dp - wide*3), (char *) dp, (size_t) wide * 3);
+      continue;
+    }
 
-      if (h==NOHUE || !s) { rv = gv = bv = v; }
-      else {
-	if (h==360) h = 0;
-
-	h        = (h*100) / 60;    /* h is in range 000..599 (0.0 - 5.99) */
-	j        = h - (h%100);     /* j = 000, 100, 200, 300, 400, 500 */
-	f        = h - j;           /* 'fractional' part of h (00..99) */
-	vs100    = (v*s)/100;
-	vsf10000 = (v*s*f)/10000;
-
-	p = v - vs100;
-	q = v - vsf10000;
-	t = v - vs100 + vsf10000;
-
-	switch (j) {
-	case 000:  rv = v;  gv = t;  bv = p;  break;
-	case 100:  rv = q;  gv = v;  bv = p;  break;
-	case 200:  rv = p;  gv = v;  bv = t;  break;
-	case 300:  rv = p;  gv = q;  bv = v;  break;
-	case 400:  rv = t;  gv = p;  bv = v;  break;
-	case 500:  rv = v;  gv = p;  bv = q;  break;
-	default:   rv = gv = bv = 0;  /* never happens */
-	}
+    rp = gsmall + (size_t) (y / k) * sw * 3;
+    for (x=0; x<wide; rp+=3) {
+      for (i=0; i<k && x<wide; i++, x++) {
+	*dp++ = rp[0];  *dp++ = rp[1];  *dp++ = rp[2];
       }
-    }   /* if hsvmod */
-
-
-    *op++ = rGraf.func[rv];
-    *op++ = gGraf.func[gv];
-    *op++ = bGraf.func[bv];
+    }
   }
 
-  printUTime("end of GammifyPic24");
-
+  free(gsmall);
+  gamProxied = 1;
   return outpic;
 }
 
@@ -0,0 +1,634 @@
+/*
+ * xvgamma.c - applies the color editor's HSV and RGB modifications to
+ *             24-bit pics
+ *
+ *  Contains:
+ *            void  InitGamMods(gm)
+ *            byte *ApplyGamMods24(pic24, wide, high, gm)
+ *            void  rgb2hsv(r, g, b, *h, *s, *v)
+ *            void  hsv2rgb(h, s, v, *r, *g, *b)
+ *            void  GenerateFSGamma()
+ *            void  InitSpline(x, y, n, y2)
+ *          double  EvalSpline(xa, ya, y2a, n, x)
+ *
+ * The color editor (xvgam.c) collects its current settings into a GAMMODS
+ * and hands it to ApplyGamMods24().  Keeping the pixel work over here means
+ * it doesn't need any of the editor's windows, so it's also part of the
+ * headless libxvcore (see xvcore.c).  So are the color space conversions
+ * and spline curves it (and the dithering code) uses.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+static pthread_mutex_t latLock = PTHREAD_MUTEX_INITIALIZER;
+#  define LOCK_LAT()    pthread_mutex_lock(&latLock)
+#  define UNLOCK_LAT()  pthread_mutex_unlock(&latLock)
+#else
+#  define LOCK_LAT()
+#  define UNLOCK_LAT()
+#endif
+
+#define NOHUE -1
+
+#define GAMLAT 33             /* points along each side of the 3-D table */
+
+/* a lattice, and the mods it was worked out for */
+typedef struct { GAMMODS  gm;
+		 CARD32  *lat;               /* see gamLattice() */
+		 byte     latidx[256];
+		 int      latwt[256];
+		 int      refs;              /* ApplyGamMods24()s using it */
+	       } LATTICE;
+
+/* state shared by the threads working on one ApplyGamMods24() */
+typedef struct { byte    *pic24, *outpic;
+		 int      wide;
+		 GAMMODS *gm;
+		 int      hsvmod;            /* there are HSV changes */
+		 CARD32  *lattice;           /* see gamLattice(), or NULL */
+		 byte    *latidx;
+		 int     *latwt;
+	       } GAMJOB;
+
+/* the last lattice built.  The tiles of a big picture (see xvimage.c), and
+   redraws with the same settings, all get the same one */
+static LATTICE *latCache = (LATTICE *) NULL;
+
+static void     gamModPixel PARM((GAMMODS *, int *, int *, int *));
+static void     gamRows     PARM((void *, int, int));
+static LATTICE *getLattice  PARM((GAMMODS *, long));
+static void     putLattice  PARM((LATTICE *));
+static int      sameMods    PARM((GAMMODS *, GAMMODS *));
+static CARD32  *gamLattice  PARM((GAMMODS *, byte *, int *));
+static void     gamLatRows  PARM((void *, int, int));
+
+
+/*********************/
+void InitGamMods(GAMMODS *gm)
+{
+  /* sets 'gm' to modifications that don't modify anything */
+
+  int i;
+
+  for (i=0; i<360; i++) gm->hremap[i] = i;
+  gm->whtenab = gm->whthue = gm->whtsat = 0;
+  gm->satval  = 0.0;
+  gm->approx  = 0;
+
+  for (i=0; i<256; i++)
+    gm->intfunc[i] = gm->rfunc[i] = gm->gfunc[i] = gm->bfunc[i] = (byte) i;
+}
+
+
+/*********************/
+byte *ApplyGamMods24(byte *pic24, int wide, int high, GAMMODS *gm)
+{
+  /* applies the HSV/RGB modifications in 'gm' to each pixel in the given
+     24-bit image.  creates and returns a new picture, or NULL on failure.
+     Also, checks to see if the result will be the same as the input, and
+     if so, also returns NULL, as a time-saving maneuver.
+
+     If there are HSV changes, and gm->approx is set, the whole thing is
+     worked out for a GAMLAT^3 lattice of colors, and the pixels are
+     interpolated from that, which is a good deal faster, and very
+     nearly the same.  The lattice is kept for the next call with the same
+     mods.  The rows are split up across threads either way */
+
+  GAMJOB   gj;
+  LATTICE *gl;
+  byte    *outpic;
+  int      i, hsvmod, rgbmod;
+
+  outpic = (byte *) NULL;
+
+  /* check for HSV/RGB control linearity */
+
+  hsvmod = rgbmod = 0;
+
+  /* check HUE remapping */
+  for (i=0; i<360 && gm->hremap[i] == i; i++);
+  if (i!=360) hsvmod++;
+
+  if (gm->whtenab && gm->whtsat) hsvmod++;
+
+  if (gm->satval != 0.0) hsvmod++;
+
+  /* check intensity graf */
+  for (i=0; i<256; i++) {
+    if (gm->intfunc[i] != i) break;
+  }
+  if (i<256) hsvmod++;
+
+
+  /* check R,G,B grafs simultaneously */
+  for (i=0; i<256; i++) {
+    if (gm->rfunc[i] != i ||
+	gm->gfunc[i] != i ||
+	gm->bfunc[i] != i) break;
+  }
+  if (i<256) rgbmod++;
+
+
+  if (!hsvmod && !rgbmod) return outpic;  /* apparently, it's linear */
+
+
+
+  WaitCursor();
+
+  outpic = (byte *) malloc((size_t) wide * high * 3);
+  if (!outpic) return outpic;
+
+  TraceBegin("ApplyGamMods24", (gm->approx && hsvmod) ? "lattice" : NULL);
+
+  gj.pic24   = pic24;   gj.outpic = outpic;
+  gj.wide    = wide;    gj.gm     = gm;
+  gj.hsvmod  = hsvmod;
+  gj.lattice = (CARD32 *) NULL;
+
+  gl = (LATTICE *) NULL;
+  if (hsvmod && gm->approx) gl = getLattice(gm, (long) wide * high);
+  if (gl) {
+    gj.lattice = gl->lat;  gj.latidx = gl->latidx;  gj.latwt = gl->latwt;
+  }
+
+  DoRowBands(high, gj.lattice ? gamLatRows : gamRows, (void *) &gj);
+
+  if (gl) putLattice(gl);
+
+  TraceEnd("ApplyGamMods24");
+
+  return outpic;
+}
+
+
+/*********************/
+static void gamModPixel(GAMMODS *gm, int *rp, int *gp, int *bp)
+{
+  /* applies the HSV modifications in 'gm' to *rp,*gp,*bp */
+
+  int   rv, gv, bv, j;
+  int   min, max, del, h, s, v;
+  int   f, p, q, t, vs100, vsf10000;
+
+  rv = *rp;  gv = *gp;  bv = *bp;
+
+  /* convert RGB to HSV */
+  /* the HSV computed will be int's ranging -1..359, 0..100, 0..255 */
+
+  max = (rv>gv) ? rv : gv;      /* compute maximum of rv,gv,bv */
+  if (max<bv) max = bv;
+
+  min = (rv<gv) ? rv : gv;      /* compute minimum of rd,gd,bd */
+  if (min>bv) min=bv;
+
+  del = max - min;
+  v = max;
+  if (max != 0) s = (del * 100) / max;
+	   else s = 0;
+
+  h = NOHUE;
+  if (s) {
+    if      (rv==max) h =       ((gv - bv) * 100) / del;
+    else if (gv==max) h = 200 + ((bv - rv) * 100) / del;
+    else if (bv==max) h = 400 + ((rv - gv) * 100) / del;
+
+
+    /* h is in range -100..500  (= -1.0 .. 5.0) */
+    if (h<0) h += 600;          /* h is in range 000..600  (0.0 .. 6.0) */
+    h = (h * 60) / 100;         /* h is in range 0..360 */
+    if (h>=360) h -= 360;
+  }
+
+
+  /* apply HSV mods */
+
+
+  /* map near-black to black to avoid weird effects */
+  if (v <= 16) s = 0;
+
+  /* apply intensity function to 'v' */
+  v = gm->intfunc[v];
+
+  /* do Hue remapping */
+  if (h>=0) h = gm->hremap[h];
+  else {  /* NOHUE */
+    if (gm->whtenab && (gm->whthue || gm->whtsat)) {
+      h = gm->whthue;
+      s = gm->whtsat;
+    }
+  }
+
+  /* apply saturation change to s */
+  s = s + (int) gm->satval;
+  if (s<  0) s =   0;
+  if (s>100) s = 100;
+
+
+  /* convert HSV back to RGB */
+
+
+  if (h==NOHUE || !s) { rv = gv = bv = v; }
+  else {
+    if (h==360) h = 0;
+
+    h        = (h*100) / 60;    /* h is in range 000..599 (0.0 - 5.99) */
+    j        = h - (h%100);     /* j = 000, 100, 200, 300, 400, 500 */
+    f        = h - j;           /* 'fractional' part of h (00..99) */
+    vs100    = (v*s)/100;
+    vsf10000 = (v*s*f)/10000;
+
+    p = v - vs100;
+    q = v - vsf10000;
+    t = v - vs100 + vsf10000;
+
+    switch (j) {
+    case 000:  rv = v;  gv = t;  bv = p;  break;
+    case 100:  rv = q;  gv = v;  bv = p;  break;
+    case 200:  rv = p;  gv = v;  bv = t;  break;
+    case 300:  rv = p;  gv = q;  bv = v;  break;
+    case 400:  rv = t;  gv = p;  bv = v;  break;
+    case 500:  rv = v;  gv = p;  bv = q;  break;
+    default:   rv = gv = bv = 0;  /* never happens */
+    }
+  }
+
+  *rp = rv;  *gp = gv;  *bp = bv;
+}
+
+
+/*********************/
+static void gamRows(void *data, int y0, int y1)
+{
+  /* does rows [y0,y1) of an ApplyGamMods24() pixel by pixel */
+
+  GAMJOB  *gj = (GAMJOB *) data;
+  GAMMODS *gm = gj->gm;
+  byte    *pp, *op;
+  int      i, y, rv, gv, bv;
+
+  for (y=y0; y<y1; y++) {
+    if (y0 == 0 && (y&0x3f) == 0) WaitCursor();
+
+    pp = gj->pic24  + (size_t) y * gj->wide * 3;
+    op = gj->outpic + (size_t) y * gj->wide * 3;
+
+    for (i=gj->wide; i; i--) {
+      rv = *pp++;  gv = *pp++;  bv = *pp++;
+
+      if (gj->hsvmod) gamModPixel(gm, &rv, &gv, &bv);
+
+      *op++ = gm->rfunc[rv];
+      *op++ = gm->gfunc[gv];
+      *op++ = gm->bfunc[bv];
+    }
+  }
+}
+
+
+/*********************/
+static LATTICE *getLattice(GAMMODS *gm, long npixels)
+{
+  /* returns a lattice for 'gm', or NULL if it isn't worth building one
+     for 'npixels' pixels (or it can't).  It's only built if there isn't
+     already one for the same mods.  Give it back with putLattice() */
+
+  LATTICE *gl, *old;
+
+  LOCK_LAT();
+  gl = latCache;
+  if (gl && sameMods(&gl->gm, gm)) {
+    gl->refs++;
+    UNLOCK_LAT();
+    return gl;
+  }
+  UNLOCK_LAT();
+
+  /* not worth it unless there are more pixels than lattice points */
+  if (npixels <= GAMLAT*GAMLAT*GAMLAT) return (LATTICE *) NULL;
+
+  gl = (LATTICE *) malloc(sizeof(LATTICE));
+  if (!gl) return gl;
+
+  gl->gm   = *gm;
+  gl->refs = 1;
+  gl->lat  = gamLattice(gm, gl->latidx, gl->latwt);
+  if (!gl->lat) { free(gl);  return (LATTICE *) NULL; }
+
+  LOCK_LAT();
+  old = latCache;
+  latCache = gl;
+  if (old && !old->refs) { free(old->lat);  free(old); }
+  UNLOCK_LAT();
+
+  return gl;
+}
+
+
+/*********************/
+static void putLattice(LATTICE *gl)
+{
+  /* a lattice that's been replaced in latCache while it was in use is
+     freed by whoever's the last to give it back */
+
+  LOCK_LAT();
+  gl->refs--;
+  if (!gl->refs && gl != latCache) { free(gl->lat);  free(gl); }
+  UNLOCK_LAT();
+}
+
+
+/*********************/
+static int sameMods(GAMMODS *a, GAMMODS *b)
+{
+  /* returns '1' if 'a' and 'b' do the same thing to a pixel.  ('approx'
+     doesn't count, and there may be padding, so no memcmp() of the lot) */
+
+  return (a->whtenab == b->whtenab && a->whthue == b->whthue &&
+	  a->whtsat  == b->whtsat  && a->satval == b->satval &&
+	  !xvbcmp((char *) a->hremap,  (char *) b->hremap,  sizeof(a->hremap)) &&
+	  !xvbcmp((char *) a->intfunc, (char *) b->intfunc, (size_t) 256) &&
+	  !xvbcmp((char *) a->rfunc,   (char *) b->rfunc,   (size_t) 256) &&
+	  !xvbcmp((char *) a->gfunc,   (char *) b->gfunc,   (size_t) 256) &&
+	  !xvbcmp((char *) a->bfunc,   (char *) b->bfunc,   (size_t) 256));
+}
+
+
+/*********************/
+static CARD32 *gamLattice(GAMMODS *gm, byte *latidx, int *latwt)
+{
+  /* works out the final color for each point of a GAMLAT^3 lattice over
+     the RGB cube, and returns it (malloced), or NULL if it can't.  The
+     points are every 8 values, with the last one at 255 (rather than 256),
+     so the corners, and all of the grays, come out exact.  Also fills in
+     which cell each component value falls in (latidx), and how far along
+     it (latwt, 0..256).
+
+     Each point is two words:  red and blue (blue in the top 16 bits), and
+     green, so gamLatRows() can do red and blue with one multiply */
+
+  CARD32 *lat, *lp;
+  int     c, ri, gi, bi, rv, gv, bv;
+
+  lat = (CARD32 *) malloc((size_t) GAMLAT * GAMLAT * GAMLAT * 2 * sizeof(CARD32));
+  if (!lat) return lat;
+
+  for (c=0; c<256; c++) {
+    if (c < (GAMLAT-2)*8) { latidx[c] = c >> 3;  latwt[c] = (c & 7) * 32; }
+    else { latidx[c] = GAMLAT-2;  latwt[c] = ((c - (GAMLAT-2)*8) * 256) / 7; }
+  }
+
+#define LATVAL(i)  (((i) < GAMLAT-1) ? (i)*8 : 255)
+
+  lp = lat;
+  for (ri=0; ri<GAMLAT; ri++) {
+    for (gi=0; gi<GAMLAT; gi++) {
+      for (bi=0; bi<GAMLAT; bi++) {
+	rv = LATVAL(ri);  gv = LATVAL(gi);  bv = LATVAL(bi);
+	gamModPixel(gm, &rv, &gv, &bv);
+	*lp++ = (CARD32) gm->rfunc[rv] | ((CARD32) gm->bfunc[bv] << 16);
+	*lp++ = (CARD32) gm->gfunc[gv];
+      }
+    }
+  }
+
+#undef LATVAL
+
+  return lat;
+}
+
+
+/*********************/
+static void gamLatRows(void *data, int y0, int y1)
+{
+  /* does rows [y0,y1) of an ApplyGamMods24() by interpolating in
+     gj->lattice.  Uses tetrahedral interpolation:  the cell is split into
+     six tetrahedra along its gray diagonal, and each pixel is a weighted
+     sum of the four corners of the one it's in.  The weights add up to
+     256, so each sum fits in 16 bits, which lets red and blue share a
+     word */
+
+  GAMJOB *gj = (GAMJOB *) data;
+  byte   *pp, *op;
+  CARD32 *lat, *lp, *l1, *l2, *l3, rb, g;
+  byte   *latidx;
+  int    *latwt;
+  int     i, y, fr, fg, fb, o1, o2, w0, w1, w2, w3, f[3];
+  const struct tetra *t;
+
+#define SB  2                          /* lattice strides, in CARD32s */
+#define SG  (GAMLAT*2)
+#define SR  (GAMLAT*GAMLAT*2)
+
+  /* which fraction is biggest (a), next (b), and smallest (c), and the
+     offsets of the corners after stepping along a, then b, indexed by
+     (r>=g, g>=b, r>=b).  Looked up, rather than tested for, as noisy
+     images make those tests hard to predict.  Two can't happen */
+  static const struct tetra { int a, b, c, o1, o2; } tetra[8] = {
+    { 2, 1, 0, SB, SG+SB },            /* b > g > r */
+    { 2, 1, 0, SB, SG+SB },            /* (g < r <= b, g >= b) */
+    { 1, 2, 0, SG, SG+SB },            /* g >= b > r */
+    { 1, 0, 2, SG, SR+SG },            /* g > r >= b */
+    { 2, 0, 1, SB, SR+SB },            /* b > r >= g */
+    { 0, 2, 1, SR, SR+SB },            /* r >= b > g */
+    { 0, 1, 2, SR, SR+SG },            /* (r >= g >= b, r < b) */
+    { 0, 1, 2, SR, SR+SG } };          /* r >= g >= b */
+
+  /* (in locals, as the stores to 'op' could, as far as the compiler knows,
+     have changed any of them) */
+  lat = gj->lattice;  latidx = gj->latidx;  latwt = gj->latwt;
+
+  for (y=y0; y<y1; y++) {
+    if (y0 == 0 && (y&0x3f) == 0) WaitCursor();
+
+    pp = gj->pic24  + (size_t) y * gj->wide * 3;
+    op = gj->outpic + (size_t) y * gj->wide * 3;
+
+    for (i=gj->wide; i; i--, pp+=3) {
+      lp = lat + latidx[pp[0]] * SR + latidx[pp[1]] * SG + latidx[pp[2]] * SB;
+      fr = latwt[pp[0]];  fg = latwt[pp[1]];  fb = latwt[pp[2]];
+
+      /* step along the axes from the biggest fraction to the smallest */
+      f[0] = fr;  f[1] = fg;  f[2] = fb;
+      t = &tetra[((fr >= fg) << 2) | ((fg >= fb) << 1) | (fr >= fb)];
+      w0 = f[t->a];  w1 = f[t->b];  w2 = f[t->c];
+      o1 = t->o1;    o2 = t->o2;
+
+      w3 = w2;  w2 = w1 - w2;  w1 = w0 - w1;  w0 = 256 - w0;
+      l1 = lp + o1;  l2 = lp + o2;  l3 = lp + SR+SG+SB;
+
+      rb = lp[0]*w0 + l1[0]*w1 + l2[0]*w2 + l3[0]*w3 + (128 | (128<<16));
+      g  = lp[1]*w0 + l1[1]*w1 + l2[1]*w2 + l3[1]*w3 + 128;
+
+      *op++ = (byte) ((rb >> 8) & 0xff);
+      *op++ = (byte) (g >> 8);
+      *op++ = (byte) (rb >> 24);
+    }
+  }
+
+#undef SB
+#undef SG
+#undef SR
+}
+
+
+/*********************/
+void rgb2hsv(int r, int g, int b, double *hr, double *sr, double *vr)
+{
+  double rd, gd, bd, h, s, v, max, min, del, rc, gc, bc;
+
+  /* convert RGB to HSV */
+  rd = r / 255.0;            /* rd,gd,bd range 0-1 instead of 0-255 */
+  gd = g / 255.0;
+  bd = b / 255.0;
+
+  /* compute maximum of rd,gd,bd */
+  if (rd>=gd) { if (rd>=bd) max = rd;  else max = bd; }
+         else { if (gd>=bd) max = gd;  else max = bd; }
+
+  /* compute minimum of rd,gd,bd */
+  if (rd<=gd) { if (rd<=bd) min = rd;  else min = bd; }
+         else { if (gd<=bd) min = gd;  else min = bd; }
+
+  del = max - min;
+  v = max;
+  if (max != 0.0) s = (del) / max;
+             else s = 0.0;
+
+  h = NOHUE;
+  if (s != 0.0) {
+    rc = (max - rd) / del;
+    gc = (max - gd) / del;
+    bc = (max - bd) / del;
+
+    if      (rd==max) h = bc - gc;
+    else if (gd==max) h = 2 + rc - bc;
+    else if (bd==max) h = 4 + gc - rc;
+
+    h = h * 60;
+    if (h<0) h += 360;
+  }
+
+  *hr = h;  *sr = s;  *vr = v;
+}
+
+
+
+/*********************/
+void hsv2rgb(double h, double s, double v, int *rr, int *gr, int *br)
+{
+  int    j;
+  double rd, gd, bd;
+  double f, p, q, t;
+
+  /* convert HSV back to RGB */
+  if (h==NOHUE || s==0.0) { rd = v;  gd = v;  bd = v; }
+  else {
+    if (h==360.0) h = 0.0;
+    h = h / 60.0;
+    j = (int) floor(h);
+    if (j<0) j=0;          /* either h or floor seem to go neg on some sys */
+    f = h - j;
+    p = v * (1-s);
+    q = v * (1 - (s*f));
+    t = v * (1 - (s*(1 - f)));
+
+    switch (j) {
+    case 0:  rd = v;  gd = t;  bd = p;  break;
+    case 1:  rd = q;  gd = v;  bd = p;  break;
+    case 2:  rd = p;  gd = v;  bd = t;  break;
+    case 3:  rd = p;  gd = q;  bd = v;  break;
+    case 4:  rd = t;  gd = p;  bd = v;  break;
+    case 5:  rd = v;  gd = p;  bd = q;  break;
+    default: rd = v;  gd = t;  bd = p;  break;  /* never happen */
+    }
+  }
+
+  *rr = (int) floor((rd * 255.0) + 0.5);
+  *gr = (int) floor((gd * 255.0) + 0.5);
+  *br = (int) floor((bd * 255.0) + 0.5);
+}
+
+
+/*********************/
+void GenerateFSGamma(void)
+{
+  /* this function generates the Floyd-Steinberg gamma curve (fsgamcr)
+
+     This function generates a 4 point spline curve to be used as a
+     non-linear grey 'colormap'.  Two of the points are nailed down at 0,0
+     and 255,255, and can't be changed.  You specify the other two.  If
+     you specify points on the line (0,0 - 255,255), you'll get the normal
+     linear reponse curve.  If you specify points of 50,0 and 200,255, you'll
+     get grey values of 0-50 to map to black (0), and grey values of 200-255
+     to map to white (255) (roughly).  Values between 50 and 200 will cover
+     the output range 0-255.  The reponse curve will be slightly 's' shaped. */
+
+  int i,j;
+  static int x[4] = {0,16,240,255};
+  static int y[4] = {0, 0,255,255};
+  double yf[4];
+
+  InitSpline(x, y, 4, yf);
+
+  for (i=0; i<256; i++) {
+    j = (int) EvalSpline(x, y, yf, 4, (double) i);
+    if (j<0) j=0;
+    else if (j>255) j=255;
+    fsgamcr[i] = j;
+  }
+}
+
+
+/*********************/
+void InitSpline(int *x, int *y, int n, double *y2)
+{
+  /* given arrays of data points x[0..n-1] and y[0..n-1], computes the
+     values of the second derivative at each of the data points
+     y2[0..n-1] for use in the splint function */
+
+  int i,k;
+  double p,qn,sig,un,u[MAX_GHANDS];
+
+  y2[0] = u[0] = 0.0;
+
+  for (i=1; i<n-1; i++) {
+    sig = ((double) x[i]-x[i-1]) / ((double) x[i+1] - x[i-1]);
+    p = sig * y2[i-1] + 2.0;
+    y2[i] = (sig-1.0) / p;
+    u[i] = (((double) y[i+1]-y[i]) / (x[i+1]-x[i])) -
+           (((double) y[i]-y[i-1]) / (x[i]-x[i-1]));
+    u[i] = (6.0 * u[i]/(x[i+1]-x[i-1]) - sig*u[i-1]) / p;
+  }
+  qn = un = 0.0;
+
+  y2[n-1] = (un-qn*u[n-2]) / (qn*y2[n-2]+1.0);
+  for (k=n-2; k>=0; k--)
+    y2[k] = y2[k]*y2[k+1]+u[k];
+}
+
+
+
+/*********************/
+double EvalSpline(int *xa, int *ya, double *y2a, int n, double x)
+{
+  int klo,khi,k;
+  double h,b,a;
+
+  klo = 0;
+  khi = n-1;
+  while (khi-klo > 1) {
+    k = (khi+klo) >> 1;
+    if (xa[k] > x) khi = k;
+    else klo = k;
+  }
+  h = xa[khi] - xa[klo];
+  if (h==0.0) FatalError("bad xvalues in splint\n");
+  a = (xa[khi]-x)/h;
+  b = (x-xa[klo])/h;
+  return (a*ya[klo] + b*ya[khi] + ((a*a*a-a)*y2a[klo] +(b*b*b-b)*y2a[khi])
+	  * (h*h) / 6.0);
+}
@@ -0,0 +1,183 @@
+/*
+ * xvgeom.c - rotating, flipping, and cutting pieces out of raw pics
+ *
+ *  Contains:
+ *            void  RotatePic(pic, ptype, wp, hp, dir)
+ *            void  FlipPic(pic, ptype, w, h, dir)
+ *            byte *XVGetSubImage(pic, ptype, w, h, sx, sy, sw, sh)
+ *            void  CropRect2Rect(xp, yp, wp, hp, cx, cy, cw, ch)
+ *
+ * These work on any PIC8 or PIC24 array, not just the ones xv is showing,
+ * and are part of the headless libxvcore (see xvcore.c).  The code that
+ * applies them to the displayed image is in xvimage.c
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+
+/************************/
+void RotatePic(byte *pic, int ptype, int *wp, int *hp, int dir)
+{
+  /* rotates a w*h array of bytes 90 deg clockwise (dir=0)
+     or counter-clockwise (dir != 0).  swaps w and h */
+
+  byte        *pic1, *pix1, *pix;
+  int          i,j,bperpix;
+  unsigned int w,h;
+
+  bperpix = (ptype == PIC8) ? 1 : 3;
+
+  w = *wp;  h = *hp;
+  pix1 = pic1 = (byte *) malloc((size_t) (w*h*bperpix));
+  if (!pic1) FatalError("Not enough memory to rotate!");
+
+  TraceBegin("RotatePic", (const char *) NULL);
+
+  /* do the rotation */
+  if (dir==0) {
+    for (i=0; i<w; i++) {       /* CW */
+      if (bperpix == 1) {
+	for (j=h-1, pix=pic+(h-1)*w + i;  j>=0;  j--, pix1++, pix-=w)
+	  *pix1 = *pix;
+      }
+      else {
+	int bperlin = w*bperpix;
+	int k;
+
+	for (j=h-1, pix=pic+(h-1)*w*bperpix + i*bperpix;
+	     j>=0;  j--, pix -= bperlin)
+	  for (k=0; k<bperpix; k++) *pix1++ = pix[k];
+      }
+    }
+  }
+  else {
+    for (i=w-1; i>=0; i--) {    /* CCW */
+      if (bperpix == 1) {
+	for (j=0, pix=pic+i; j<h; j++, pix1++, pix+=w)
+	  *pix1 = *pix;
+      }
+      else {
+	int k;
+	int bperlin = w*bperpix;
+
+	for (j=0, pix=pic+i*bperpix; j<h; j++, pix+=bperlin)
+	  for (k=0; k<bperpix; k++) *pix1++ = pix[k];
+      }
+    }
+  }
+
+
+  /* copy the rotated buffer into the original buffer */
+  xvbcopy((char *) pic1, (char *) pic, (size_t) (w*h*bperpix));
+
+  free(pic1);
+
+  /* swap w and h */
+  *wp = h;  *hp = w;
+
+  TraceEnd("RotatePic");
+}
+
+
+/************************/
+void FlipPic(byte *pic, int ptype, int w, int h, int dir)
+{
+  /* flips a w*h array of bytes horizontally (dir=0) or vertically (dir!=0) */
+
+  byte *plin;
+  int   i,j,k,l,bperpix,bperlin;
+
+  bperpix = (ptype == PIC8) ? 1 : 3;
+  bperlin = w * bperpix;
+
+  TraceBegin("FlipPic", (const char *) NULL);
+
+  if (dir==0) {                /* horizontal flip */
+    byte *leftp, *rightp;
+
+    for (i=0; i<h; i++) {
+      plin   = pic + i*bperlin;
+      leftp  = plin;
+      rightp = plin + (w-1)*bperpix;
+
+      for (j=0; j<w/2; j++, rightp -= (2*bperpix)) {
+	for (l=0; l<bperpix; l++, leftp++, rightp++) {
+	  k = *leftp;  *leftp = *rightp;  *rightp = k;
+	}
+      }
+    }
+  }
+
+  else {                      /* vertical flip */
+    byte *topp, *botp;
+
+    for (i=0; i<w; i++) {
+      topp = pic + i*bperpix;
+      botp = pic + (h-1)*bperlin + i*bperpix;
+
+      for (j=0; j<h/2; j++, topp+=(w-1)*bperpix, botp-=(w+1)*bperpix) {
+	for (l=0; l<bperpix; l++, topp++, botp++) {
+	  k = *topp;  *topp = *botp;  *botp = k;
+	}
+      }
+    }
+  }
+
+  TraceEnd("FlipPic");
+}
+
+
+/***********************************************************/
+byte *XVGetSubImage(byte *pic, int ptype, int w, int h, int sx, int sy, int sw, int sh)
+{
+  /* mallocs and returns the selected subimage (sx,sy,sw,sh) of pic.
+     selection is guaranteed to be within pic boundaries.
+     NEVER RETURNS NULL */
+
+  byte *rpic, *sp, *dp;
+  int   bperpix,x,y;
+
+  /* sanity check: */
+  if (sx<0 || sy<0 || sx+sw > w || sy+sh > h || sw<1 || sh<1) {
+    fprintf(stderr,"XVGetSubImage:  w,h=%d,%d  sel = %d,%d %dx%d\n",
+	    w, h, sx, sy, sw, sh);
+    FatalError("XVGetSubImage:  value out of range (shouldn't happen!)");
+  }
+
+
+  bperpix = (ptype==PIC8) ? 1 : 3;
+  rpic = (byte *) malloc((size_t) bperpix * sw * sh);
+  if (!rpic) FatalError("out of memory in XVGetSubImage");
+
+  for (y=0; y<sh; y++) {
+    sp = pic  + ((y+sy)*w + sx) * bperpix;
+    dp = rpic + (y * sw) * bperpix;
+    for (x=0; x<(sw*bperpix); x++, dp++, sp++) *dp = *sp;
+  }
+
+  return rpic;
+}
+
+
+/************************/
+void CropRect2Rect(int *xp, int *yp, int *wp, int *hp, int cx, int cy, int cw, int ch)
+{
+  /* crops rect xp,yp,wp,hp to be entirely within bounds of cx,cy,cw,ch */
+
+  int x1,y1,x2,y2;
+
+  x1 = *xp;            y1 = *yp;
+  x2 = *xp + *wp - 1;  y2 = *yp + *hp - 1;
+  RANGE(x1, cx, cx+cw-1);
+  RANGE(y1, cy, cy+ch-1);
+  RANGE(x2, cx, cx+cw-1);
+  RANGE(y2, cy, cy+ch-1);
+
+  if (x2<x1) x2=x1;
+  if (y2<y1) y2=y1;
+
+  *xp = x1;           *yp = y1;
+  *wp = (x2 - x1)+1;  *hp = (y2 - y1)+1;
+}
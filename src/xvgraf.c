@@ -12,8 +12,8 @@
  *   Str2Graf()         -  parses an xrdb string into GRAF settings
  *   GetGrafState()     -  copies GRAF data into GRAF_STATE structure
  *   SetGrafState()     -  sets GRAF data based on GRAF_STATE
- *   InitSpline()       -  called to generate y' table for EvalSpline
- *   EvalSpline()       -  evalutes spline function at given point
+ *
+ * The spline functions (InitSpline(), EvalSpline()) are in xvgamma.c
  */
 
 #include "copyright.h"
@@ -840,57 +840,3 @@ int SetGrafState(GRAF *gp, GRAF_STATE *gsp)
 
   return rv;
 }
-
-
-/*********************/
-void InitSpline(int *x, int *y, int n, double *y2)
-{
-  /* given arrays of data points x[0..n-1] and y[0..n-1], computes the
-     values of the second derivative at each of the data points
-     y2[0..n-1] for use in the splint function */
-
-  int i,k;
-  double p,qn,sig,un,u[MAX_GHANDS];
-
-  y2[0] = u[0] = 0.0;
-
-  for (i=1; i<n-1; i++) {
-    sig = ((double) x[i]-x[i-1]) / ((double) x[i+1] - x[i-1]);
-    p = sig * y2[i-1] + 2.0;
-    y2[i] = (sig-1.0) / p;
-    u[i] = (((double) y[i+1]-y[i]) / (x[i+1]-x[i])) -
-           (((double) y[i]-y[i-1]) / (x[i]-x[i-1]));
-    u[i] = (6.0 * u[i]/(x[i+1]-x[i-1]) - sig*u[i-1]) / p;
-  }
-  qn = un = 0.0;
-
-  y2[n-1] = (un-qn*u[n-2]) / (qn*y2[n-2]+1.0);
-  for (k=n-2; k>=0; k--)
-    y2[k] = y2[k]*y2[k+1]+u[k];
-}
-
-
-
-/*********************/
-double EvalSpline(int *xa, int *ya, double *y2a, int n, double x)
-{
-  int klo,khi,k;
-  double h,b,a;
-
-  klo = 0;
-  khi = n-1;
-  while (khi-klo > 1) {
-    k = (khi+klo) >> 1;
-    if (xa[k] > x) khi = k;
-    else klo = k;
-  }
-  h = xa[khi] - xa[klo];
-  if (h==0.0) FatalError("bad xvalues in splint\n");
-  a = (xa[khi]-x)/h;
-  b = (x-xa[klo])/h;
-  return (a*ya[klo] + b*ya[khi] + ((a*a*a-a)*y2a[klo] +(b*b*b-b)*y2a[khi])
-	  * (h*h) / 6.0);
-}
-
-
-
@@ -10,13 +10,16 @@
  *            void AutoCrop()
  *            void DoCrop(x,y,w,h)
  *            void Rotate(int)
- *            void RotatePic();
  *            void InstallNewPic(void);
  *            void DrawEpic(void);
- *            byte *FSDither()
  *            void CreateXImage()
+ *         XImage *Pic8ToXImage()
+ *         XImage *Pic24ToXImage()
  *            void Set824Menus( pictype );
  *            void Change824Mode( pictype );
+ *            void FreeEpic();
+ *            void DrawEpicTiles(x,y,w,h);
+ *            void UntileEpic();
  *            int  DoPad(mode, str, wide, high, opaque, omode);
  *            int  LoadPad(pinfo, fname);
  */
@@ -56,6 +59,21 @@ static int  doPadLoad         PARM((char *, int, int, int, int));
 static int  doPadPaste        PARM((byte *, int, int, int, int));
 static int  ReadImageFile1    PARM((char *, PICINFO *));
 
+static int     epicTileable   PARM((void));
+static void    freeEpicTiles  PARM((void));
+static XImage *getEpicTile    PARM((int, int));
+static XImage *makeEpicTile   PARM((int, int, int));
+static void    freeEpicTile   PARM((XImage *));
+
+static XImage *createZImage   PARM((u_int, u_int, int));
+#ifdef HAVE_XSHM
+static int     epicTilePool   PARM((void));
+static int     shmAvailable   PARM((void));
+static XShmSegmentInfo *CreateShmSegment PARM((size_t));
+static XImage *CreateShmImage PARM((u_int, u_int));
+static int  shmErrorHandler   PARM((Display *, XErrorEvent *));
+#endif
+
 
 /* The following array represents the pixel values for each shade
  * of the primary color components.
@@ -113,6 +131,7 @@ static byte screen_set[3][256];
  */
 
 static void screen_init PARM((void));
+static int  screen_packfmt PARM((int));
 
 static void screen_init(void)
 {
@@ -174,6 +193,47 @@ static void screen_init(void)
 }
 
 
+/* The following routine checks whether the screen_rgb array describes one
+ * of the handful of TrueColor pixel layouts that nearly every display uses
+ * nowadays (see PACK_* in xv.h).  If so, Pic24ToXImage() can hand whole
+ * rows to PackRGB24(), which does the same thing as the screen_rgb lookups
+ * with SIMD code where possible, instead of going pixel by pixel.
+ */
+
+static int screen_packfmt(int bperpix)
+{
+  static const int fmts32[] = { PACK_XRGB32, PACK_XBGR32, PACK_RGB30 };
+  const int *fmts;
+  int   nfmts, f, i, fmt;
+  unsigned long r, g, b;
+
+  if (bperpix == 32)      { fmts = fmts32;  nfmts = 3; }
+  else if (bperpix == 16) { fmt  = PACK_RGB565;  fmts = &fmt;  nfmts = 1; }
+  else return PACK_NONE;
+
+  for (f=0; f<nfmts; f++) {
+    for (i=0; i<256; i++) {
+      switch (fmts[f]) {
+      case PACK_XRGB32:  r = i<<16;  g = i<<8;  b = i;  break;
+      case PACK_XBGR32:  r = i;  g = i<<8;  b = i<<16;  break;
+      case PACK_RGB30:   r = ((i<<2) | (i>>6)) << 20;
+			 g = ((i<<2) | (i>>6)) << 10;
+			 b =  (i<<2) | (i>>6);  break;
+      case PACK_RGB565:  r = (i>>3) << 11;  g = (i>>2) << 5;  b = i>>3;  break;
+      default:           r = g = b = 0;  break;
+      }
+
+      if (screen_rgb[0][i] != r || screen_rgb[1][i] != g ||
+	  screen_rgb[2][i] != b) break;
+    }
+
+    if (i == 256) return fmts[f];
+  }
+
+  return PACK_NONE;
+}
+
+
 #ifdef ENABLE_FIXPIX_SMOOTH
 
 /* The following code is based in part on:
@@ -335,12 +395,12 @@ void Resize(int w, int h)
   if (psUp) PSResize();   /* if PSDialog is open, mention size change  */
 
   /* if same size, and Ximage created, do nothing */
-  if (w==eWIDE && h==eHIGH && theImage!=NULL) return;
+  if (w==eWIDE && h==eHIGH && (theImage!=NULL || epicTiled)) return;
 
   if (DEBUG) fprintf(stderr,"Resize(%d,%d)  eSIZE=%d,%d  cSIZE=%d,%d\n",
 		     w,h,eWIDE,eHIGH,cWIDE,cHIGH);
 
-  if (epicMode == EM_SMOOTH) {  /* turn off smoothing */
+  if (epicMode == EM_SMOOTH || epicMode == EM_RESAMP) { /* turn off smoothing */
     epicMode = EM_RAW;  SetEpicMode();
   }
 
@@ -357,6 +417,8 @@ void GenerateCpic(void)
   int   i, j, bperpix;
   byte *pp, *cp;
 
+  FreePyramid();               /* out of date, either way */
+
   if (cpic == pic) return;     /* no cropping, nothing to do */
 
   cp = cpic;
@@ -391,17 +453,34 @@ void GenerateEpic(int w, int h)
 
 
   FreeEpic();                   /* get rid of the old one */
+
+  /* if it's going to be bigger than a reduced-size JPEG, get the real one */
+  if (w > cWIDE || h > cHIGH) FullResPic();
+
   eWIDE = w;  eHIGH = h;
 
 
-  if (epicMode == EM_SMOOTH) {
-    if (picType == PIC8) {
-      epic = SmoothResize(cpic, cWIDE, cHIGH, eWIDE, eHIGH,
-			  rMap,gMap,bMap, rdisp,gdisp,bdisp, numcols);
-    }
-    else {  /* PIC24 */
-      epic = Smooth24(cpic, 1, cWIDE, cHIGH, eWIDE, eHIGH, NULL, NULL, NULL);
+  if (epicMode == EM_SMOOTH || epicMode == EM_RESAMP) {
+    /* shrink from the smallest cpic pyramid level that's still big enough,
+       rather than from cpic itself.  (Same as SmoothResize() and
+       ResampleResize() on cpic if not shrinking by at least half) */
+
+    byte *srcpic, *pic24;
+    int   sw, sh, is24;
+
+    srcpic = PyramidLevel(eWIDE, eHIGH, &sw, &sh, &is24);
+
+    if (epicMode == EM_SMOOTH)
+      pic24 = Smooth24  (srcpic, is24, sw, sh, eWIDE, eHIGH, rMap,gMap,bMap);
+    else
+      pic24 = Resample24(srcpic, is24, sw, sh, eWIDE, eHIGH, rMap,gMap,bMap);
+
+    if (pic24 && picType == PIC8) {
+      epic = DoColorDither(pic24, NULL, eWIDE, eHIGH, rMap, gMap, bMap,
+			   rdisp, gdisp, bdisp, numcols);
+      free(pic24);
     }
+    else epic = pic24;
 
     if (epic) return;   /* success */
     else {
@@ -412,6 +491,14 @@ void GenerateEpic(int w, int h)
   }
 
 
+  /* if the raw epic would be huge, and mostly off-screen, don't build it.
+     DrawWindow() will build the parts that are actually shown */
+  if (epicTileable()) {
+    epicTiled = 1;
+    return;
+  }
+
+
   /* generate a 'raw' epic, as we'll need it for ColorDither if EM_DITH */
 
   if (eWIDE==cWIDE && eHIGH==cHIGH) {  /* 1:1 expansion.  point epic at cpic */
@@ -790,12 +877,12 @@ void UnCrop(void)
 
   BTSetActive(&but[BUNCROP],0);
 
-  if (epicMode == EM_SMOOTH) {   /* turn off smoothing */
+  if (epicMode == EM_SMOOTH || epicMode == EM_RESAMP) { /* turn off smoothing */
     epicMode = EM_RAW;  SetEpicMode();
   }
 
   /* dispose of old cpic and epic */
-  FreeEpic();
+  FreeEpic();  FreePyramid();
   if (cpic && cpic !=  pic) free(cpic);
   cpic = NULL;
 
@@ -1077,7 +1164,7 @@ void DoCrop(int x, int y, int w, int h)
   if (y+h > pHIGH) h = pHIGH-y;
 
 
-  FreeEpic();
+  FreeEpic();  FreePyramid();
   if (cpic && cpic !=  pic) free(cpic);
   cpic = NULL;
 
@@ -1165,7 +1252,9 @@ void DoRotate(int dir)
   int i;
 
   /* dir=0: 90 degrees clockwise, else 90 degrees counter-clockwise */
+  FullResPic();
   WaitCursor();
+  FreePyramid();
 
   if (origPic!=NULL) {
         int tmp_pw,tmp_ph;
@@ -1197,6 +1286,7 @@ void DoRotate(int dir)
     WaitCursor();
     RotatePic(epic, picType, &eWIDE, &eHIGH,dir);
   }
+  else if (epicTiled) { i = eWIDE;  eWIDE = eHIGH;  eHIGH = i; }
   else { eWIDE = cWIDE;  eHIGH = cHIGH; }
 
 
@@ -1208,67 +1298,6 @@ void DoRotate(int dir)
 }
 
 
-/************************/
-void RotatePic(byte *pic, int ptype, int *wp, int *hp, int dir)
-{
-  /* rotates a w*h array of bytes 90 deg clockwise (dir=0)
-     or counter-clockwise (dir != 0).  swaps w and h */
-
-  byte        *pic1, *pix1, *pix;
-  int          i,j,bperpix;
-  unsigned int w,h;
-
-  bperpix = (ptype == PIC8) ? 1 : 3;
-
-  w = *wp;  h = *hp;
-  pix1 = pic1 = (byte *) malloc((size_t) (w*h*bperpix));
-  if (!pic1) FatalError("Not enough memory to rotate!");
-
-  /* do the rotation */
-  if (dir==0) {
-    for (i=0; i<w; i++) {       /* CW */
-      if (bperpix == 1) {
-	for (j=h-1, pix=pic+(h-1)*w + i;  j>=0;  j--, pix1++, pix-=w)
-	  *pix1 = *pix;
-      }
-      else {
-	int bperlin = w*bperpix;
-	int k;
-
-	for (j=h-1, pix=pic+(h-1)*w*bperpix + i*bperpix;
-	     j>=0;  j--, pix -= bperlin)
-	  for (k=0; k<bperpix; k++) *pix1++ = pix[k];
-      }
-    }
-  }
-  else {
-    for (i=w-1; i>=0; i--) {    /* CCW */
-      if (bperpix == 1) {
-	for (j=0, pix=pic+i; j<h; j++, pix1++, pix+=w)
-	  *pix1 = *pix;
-      }
-      else {
-	int k;
-	int bperlin = w*bperpix;
-
-	for (j=0, pix=pic+i*bperpix; j<h; j++, pix+=bperlin)
-	  for (k=0; k<bperpix; k++) *pix1++ = pix[k];
-      }
-    }
-  }
-
-
-  /* copy the rotated buffer into the original buffer */
-  xvbcopy((char *) pic1, (char *) pic, (size_t) (w*h*bperpix));
-
-  free(pic1);
-
-  /* swap w and h */
-  *wp = h;  *hp = w;
-}
-
-
-
 /***********************************/
 void Flip(int dir)
 {
@@ -1277,69 +1306,27 @@ void Flip(int dir)
    * Note:  flips pic, cpic, and epic.  Doesn't touch Ximage, nor does it draw
    */
 
+  FullResPic();
   WaitCursor();
+  FreePyramid();
 
   if (HaveSelection()) {            /* only flip selection region */
     flipSel(dir);
     return;
   }
 
-  FlipPic(pic, pWIDE, pHIGH, dir);
+  FlipPic(pic, picType, pWIDE, pHIGH, dir);
 
   /* flip clipped version */
   if (cpic && cpic != pic) {
     WaitCursor();
-    FlipPic(cpic, cWIDE, cHIGH, dir);
+    FlipPic(cpic, picType, cWIDE, cHIGH, dir);
   }
 
   /* flip expanded version */
   if (epic && epic != cpic) {
     WaitCursor();
-    FlipPic(epic, eWIDE, eHIGH, dir);
-  }
-}
-
-
-/************************/
-void FlipPic(byte *pic, int w, int h, int dir)
-{
-  /* flips a w*h array of bytes horizontally (dir=0) or vertically (dir!=0) */
-
-  byte *plin;
-  int   i,j,k,l,bperpix,bperlin;
-
-  bperpix = (picType == PIC8) ? 1 : 3;
-  bperlin = w * bperpix;
-
-  if (dir==0) {                /* horizontal flip */
-    byte *leftp, *rightp;
-
-    for (i=0; i<h; i++) {
-      plin   = pic + i*bperlin;
-      leftp  = plin;
-      rightp = plin + (w-1)*bperpix;
-
-      for (j=0; j<w/2; j++, rightp -= (2*bperpix)) {
-	for (l=0; l<bperpix; l++, leftp++, rightp++) {
-	  k = *leftp;  *leftp = *rightp;  *rightp = k;
-	}
-      }
-    }
-  }
-
-  else {                      /* vertical flip */
-    byte *topp, *botp;
-
-    for (i=0; i<w; i++) {
-      topp = pic + i*bperpix;
-      botp = pic + (h-1)*bperlin + i*bperpix;
-
-      for (j=0; j<h/2; j++, topp+=(w-1)*bperpix, botp-=(w+1)*bperpix) {
-	for (l=0; l<bperpix; l++, topp++, botp++) {
-	  k = *topp;  *topp = *botp;  *botp = k;
-	}
-      }
-    }
+    FlipPic(epic, picType, eWIDE, eHIGH, dir);
   }
 }
 
@@ -1403,7 +1390,7 @@ void InstallNewPic(void)
      regens cpic and epic, and redraws image */
 
   /* toss old cpic and epic, if any */
-  FreeEpic();
+  FreeEpic();  FreePyramid();
   if (cpic && cpic != pic) free(cpic);
   cpic = NULL;
 
@@ -1439,7 +1426,7 @@ void KillOldPics(void)
 {
   /* throw away all previous images */
 
-  FreeEpic();
+  FreeEpic();  FreePyramid();
   if (cpic && cpic != pic) free(cpic);
   if (pic) free(pic);
   xvDestroyImage(theImage);   theImage = NULL;
@@ -1579,145 +1566,210 @@ static void floydDitherize1(XImage *ximage, byte *pic824, int ptype, int wide, i
 
 
 
+/***********************************/
+void CreateXImage(void)
+{
+  xvDestroyImage(theImage);   theImage = NULL;
+
+  if (epicTiled) {            /* tiles get rebuilt as they're drawn */
+    freeEpicTiles();
+    return;
+  }
+
+  if (!epic) GenerateEpic(eWIDE, eHIGH);  /* shouldn't happen... */
+
+  if (picType == PIC24) {  /* generate egampic */
+    if (egampic && egampic != epic) free(egampic);
+    egampic = GammifyPic24(epic, eWIDE, eHIGH, 1);
+    if (!egampic) egampic = epic;
+  }
+
+
+  if (picType == PIC8)
+    theImage = Pic8ToXImage(epic,     (u_int) eWIDE, (u_int) eHIGH,
+			    cols, rMap, gMap, bMap);
+  else if (picType == PIC24)
+    theImage = Pic24ToXImage(egampic, (u_int) eWIDE, (u_int) eHIGH);
+}
+
+
+
 
+#ifdef HAVE_XSHM
+/* images smaller than this aren't worth a shared memory segment */
+#define SHM_MINSIZE  (64*1024)
 
-/************************/
-byte *FSDither(byte *inpic, int intype, int w, int h, byte *rmap, byte *gmap, byte *bmap,
-	      int bval, int wval)
+static int shmState = 0;     /* 0 = not yet tried, 1 = usable, -1 = not */
+static int shmAttachErr;     /* set by shmErrorHandler() */
+
+/* the segment the epic tiles are built in (see epicTilePool()), and, if
+   set, where createZImage() should put the next image in it */
+static XShmSegmentInfo *etileShm   = (XShmSegmentInfo *) NULL;
+static char            *zimageAddr = (char *) NULL;
+
+
+/***********************************/
+static int shmErrorHandler(Display *disp, XErrorEvent *err)
 {
-  /* takes an input pic of size w*h, and type 'intype' (PIC8 or PIC24),
-   *                (if PIC8, colormap specified by rmap,gmap,bmap)
-   * and does the floyd-steinberg dithering algorithm on it.
-   * generates (mallocs) a w*h 1-byte-per-pixel 'outpic', using 'bval'
-   * and 'wval' as the 'black' and 'white' pixel values, respectively
-   */
+  /* XShmAttach() fails with BadAccess on remote displays, which isn't
+     something we can find out beforehand.  Just note that it happened */
 
-  int    i, j, err, w1, h1, npixels, linebufsize;
-  byte  *pp, *outpic, rgb[256];
-  int   *thisline, *nextline, *thisptr, *nextptr, *tmpptr;
+  XV_UNUSED(disp);
+  XV_UNUSED(err);
 
+  shmAttachErr = 1;
+  return 0;
+}
 
-  npixels = w * h;
-  linebufsize = w * sizeof(int);
-  if (w <= 0 || h <= 0 || npixels/w != h || linebufsize/w != sizeof(int)) {
-    SetISTR(ISTR_WARNING, "Invalid image dimensions for dithering");
-    return (byte *)NULL;
-  }
 
-  outpic = (byte *) malloc((size_t) npixels);
-  if (!outpic) return outpic;
+/***********************************/
+static int shmAvailable(void)
+{
+  /* returns '1' if MIT-SHM segments are worth trying */
 
+  if (noshm || shmState < 0) return 0;
 
-  if (intype == PIC8) {       /* monoify colormap */
-    for (i=0; i<256; i++)
-      rgb[i] = MONO(rmap[i], gmap[i], bmap[i]);
+  if (shmState == 0) {
+    shmState = (XShmQueryExtension(theDisp)) ? 1 : -1;
+    if (DEBUG) fprintf(stderr,"MIT-SHM extension %savailable\n",
+		       (shmState > 0) ? "" : "not ");
   }
 
+  return (shmState > 0);
+}
 
-  thisline = (int *) malloc(linebufsize);
-  nextline = (int *) malloc(linebufsize);
-  if (!thisline || !nextline)
-    FatalError("ran out of memory in FSDither()\n");
 
+/***********************************/
+static XShmSegmentInfo *CreateShmSegment(size_t size)
+{
+  /* creates a 'size'-byte MIT-SHM segment, and attaches it to both us and
+     the X server.  Returns its (malloc'd) info, or NULL if that can't be
+     done.  Takes two round trips to the server */
 
-  w1 = w-1;  h1 = h-1;
+  XShmSegmentInfo *shminfo;
+  int            (*oldhandler) PARM((Display *, XErrorEvent *));
 
-  /* load up first line of picture */
-  pp = inpic;
-  if (intype == PIC24) {
-    for (j=0, tmpptr=nextline; j<w; j++, pp+=3)
-      *tmpptr++ = fsgamcr[MONO(pp[0], pp[1], pp[2])];
+  shminfo = (XShmSegmentInfo *) malloc(sizeof(XShmSegmentInfo));
+  if (!shminfo) return (XShmSegmentInfo *) NULL;
+
+  shminfo->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (shminfo->shmid < 0) {
+    free(shminfo);
+    return (XShmSegmentInfo *) NULL;
   }
-  else {
-    for (j=0, tmpptr=nextline; j<w; j++, pp++)
-      *tmpptr++ = fsgamcr[rgb[*pp]];
+
+  shminfo->shmaddr = (char *) shmat(shminfo->shmid, NULL, 0);
+  if (shminfo->shmaddr == (char *) -1) {
+    shmctl(shminfo->shmid, IPC_RMID, NULL);
+    free(shminfo);
+    return (XShmSegmentInfo *) NULL;
   }
 
+  shminfo->readOnly = False;
 
-  for (i=0; i<h; i++) {
-    if ((i&0x3f) == 0) WaitCursor();
+  XSync(theDisp, False);
+  shmAttachErr = 0;
+  oldhandler = XSetErrorHandler(shmErrorHandler);
+  XShmAttach(theDisp, shminfo);
+  XSync(theDisp, False);
+  XSetErrorHandler(oldhandler);
 
-    /* get next line of picture */
-    tmpptr = thisline;  thisline = nextline;  nextline = tmpptr;  /* swap */
-    if (i!=h1) {
-      if (intype == PIC24) {
-	pp = inpic + (i+1) * w * 3;
-	for (j=0, tmpptr=nextline; j<w; j++, pp+=3)
-	  *tmpptr++ = fsgamcr[MONO(pp[0], pp[1], pp[2])];
-      }
-      else {
-	pp = inpic + (i+1) * w;
-	for (j=0, tmpptr = nextline; j<w; j++, pp++)
-	  *tmpptr++ = fsgamcr[rgb[*pp]];
-      }
-    }
+  /* mark segment for deletion now.  It goes away once both we and the
+     server have detached from it, even if we crash */
+  shmctl(shminfo->shmid, IPC_RMID, NULL);
 
-    pp  = outpic + i * w;
-    thisptr = thisline;  nextptr = nextline;
+  if (shmAttachErr) {
+    if (DEBUG) fprintf(stderr,"XShmAttach() failed.  Not using MIT-SHM\n");
+    shmState = -1;             /* remote display.  don't try again */
+    shmdt(shminfo->shmaddr);
+    free(shminfo);
+    return (XShmSegmentInfo *) NULL;
+  }
 
-    if ((i&1) == 0) {  /* go right */
-      for (j=0; j<w; j++, pp++, thisptr++, nextptr++) {
-	if (*thisptr<128) { err = *thisptr;     *pp = (byte) bval; }
-	             else { err = *thisptr-255; *pp = (byte) wval; }
+  return shminfo;
+}
 
-	if (j<w1) thisptr[1] += ((err*7)/16);
 
-	if (i<h1) {
-	  nextptr[0] += ((err*5)/16);
-	  if (j>0)  nextptr[-1] += ((err*3)/16);
-	  if (j<w1) nextptr[ 1] += (err/16);
-	}
-      }
-    }
+/***********************************/
+static XImage *CreateShmImage(unsigned int wide, unsigned int high)
+{
+  /* tries to create a dispDEEP-deep ZPixmap XImage whose data lives in a
+     MIT-SHM segment shared with the X server.  Returns NULL (without
+     complaint) if the extension isn't available, the display isn't local,
+     the image is small, or we run out of segments.  The segment's info is
+     kept in xim->obdata, which is how xvDestroyImage() and xvPutImage()
+     recognize these images */
 
-    else {   /* go left */
-      pp += (w-1);  thisptr += (w-1);  nextptr += (w-1);
-      for (j=w-1; j>=0; j--, pp--, thisptr--, nextptr--) {
-	if (*thisptr<128) { err = *thisptr;     *pp = (byte) bval; }
-	             else { err = *thisptr-255; *pp = (byte) wval; }
+  XImage          *xim;
+  XShmSegmentInfo *shminfo;
+  size_t           size;
 
-	if (j>0) thisptr[-1] += ((err*7)/16);
+  if (!shmAvailable()) return (XImage *) NULL;
 
-	if (i<h1) {
-	  nextptr[0] += ((err*5)/16);
-	  if (j>0)  nextptr[-1] += (err/16);
-	  if (j<w1) nextptr[ 1] += ((err*3)/16);
-	}
-      }
-    }
-  }
+  xim = XShmCreateImage(theDisp, theVisual, dispDEEP, ZPixmap, NULL,
+			(XShmSegmentInfo *) NULL, wide, high);
+  if (!xim) return (XImage *) NULL;
 
-  free(thisline);  free(nextline);
-  return outpic;
-}
+  size = (size_t) xim->bytes_per_line * high;
+  xim->obdata = NULL;          /* so XDestroyImage() won't free shminfo */
 
+  if (size < SHM_MINSIZE) {
+    XDestroyImage(xim);
+    return (XImage *) NULL;
+  }
 
+  shminfo = CreateShmSegment(size);
+  if (!shminfo) {
+    XDestroyImage(xim);
+    return (XImage *) NULL;
+  }
 
+  xim->data   = shminfo->shmaddr;
+  xim->obdata = (char *) shminfo;
 
+  if (DEBUG > 1)
+    fprintf(stderr,"CreateShmImage(): %dx%d image in shm segment %d\n",
+	    wide, high, shminfo->shmid);
+
+  return xim;
+}
+#endif /* HAVE_XSHM */
 
 
 /***********************************/
-void CreateXImage(void)
+static XImage *createZImage(unsigned int wide, unsigned int high, int pad)
 {
-  xvDestroyImage(theImage);   theImage = NULL;
+  /* creates a dispDEEP-deep ZPixmap XImage, *including* its (uninitialized)
+     data.  Uses a MIT-SHM segment when possible, otherwise malloc()s the
+     data.  'pad' is the scanline padding to use in the latter case.  Note
+     that the caller *must* use xim->bytes_per_line to walk the data, as a
+     shared image is padded however the server likes it */
 
-  if (!epic) GenerateEpic(eWIDE, eHIGH);  /* shouldn't happen... */
+  XImage *xim;
+  byte   *imagedata;
 
-  if (picType == PIC24) {  /* generate egampic */
-    if (egampic && egampic != epic) free(egampic);
-    egampic = GammifyPic24(epic, eWIDE, eHIGH);
-    if (!egampic) egampic = epic;
+#ifdef HAVE_XSHM
+  if (zimageAddr) {
+    xim = XShmCreateImage(theDisp, theVisual, dispDEEP, ZPixmap, zimageAddr,
+			  etileShm, wide, high);
+    if (!xim) FatalError("couldn't create xim!");
+    return xim;
   }
 
+  xim = CreateShmImage(wide, high);
+  if (xim) return xim;
+#endif
 
-  if (picType == PIC8)
-    theImage = Pic8ToXImage(epic,     (u_int) eWIDE, (u_int) eHIGH,
-			    cols, rMap, gMap, bMap);
-  else if (picType == PIC24)
-    theImage = Pic24ToXImage(egampic, (u_int) eWIDE, (u_int) eHIGH);
-}
+  xim = XCreateImage(theDisp, theVisual, dispDEEP, ZPixmap, 0, NULL,
+		     wide, high, pad, 0);
+  if (!xim) FatalError("couldn't create xim!");
 
+  imagedata = (byte *) malloc((size_t) xim->bytes_per_line * high);
+  if (!imagedata) FatalError("couldn't malloc imagedata");
 
+  xim->data = (char *) imagedata;
+  return xim;
+}
 
 
 /***********************************/
@@ -1778,14 +1830,12 @@ XImage *Pic8ToXImage(byte *pic8, unsigned int wide, unsigned int high, long unsi
 
   case 8: {
     byte  *imagedata, *ip, *pp;
-    int   j, imWIDE, nullCount;
-
-    nullCount = (4 - (wide % 4)) & 0x03;  /* # of padding bytes per line */
-    imWIDE = wide + nullCount;
+    int   j, bperline, nullCount;
 
-    /* Now create the image data - pad each scanline as necessary */
-    imagedata = (byte *) malloc((size_t) (imWIDE * high));
-    if (!imagedata) FatalError("couldn't malloc imagedata");
+    xim = createZImage(wide, high, 32);
+    imagedata = (byte *) xim->data;
+    bperline  = xim->bytes_per_line;
+    nullCount = bperline - wide;       /* # of padding bytes per line */
 
     pp = (dithpic) ? dithpic : pic8;
 
@@ -1801,11 +1851,6 @@ XImage *Pic8ToXImage(byte *pic8, unsigned int wide, unsigned int high, long unsi
 
       for (j=0; j<nullCount; j++, ip++) *ip = 0;
     }
-
-    xim = XCreateImage(theDisp,theVisual,dispDEEP,ZPixmap,0,
-		       (char *) imagedata,  wide,  high,
-		       32, imWIDE);
-    if (!xim) FatalError("couldn't create xim!");
   }
     break;
 
@@ -1972,14 +2017,11 @@ XImage *Pic8ToXImage(byte *pic8, unsigned int wide, unsigned int high, long unsi
   case 12:
   case 15:
   case 16: {
-    byte  *imagedata, *ip, *pp;
-
-    imagedata = (byte *) malloc((size_t) (2*wide*high));
-    if (!imagedata) FatalError("couldn't malloc imagedata");
+    byte  *imagedata, *ip, *pp, *tip;
+    int    j;
 
-    xim = XCreateImage(theDisp,theVisual,dispDEEP,ZPixmap,0,
-		       (char *) imagedata,  wide,  high, 16, 0);
-    if (!xim) FatalError("couldn't create xim!");
+    xim = createZImage(wide, high, 16);
+    imagedata = (byte *) xim->data;
 
     if (dispDEEP == 12 && xim->bits_per_pixel != 16) {
       char buf[128];
@@ -1991,25 +2033,27 @@ XImage *Pic8ToXImage(byte *pic8, unsigned int wide, unsigned int high, long unsi
     pp = (dithpic) ? dithpic : pic8;
 
     if (xim->byte_order == MSBFirst) {
-      for (i=wide*high, ip=imagedata; i>0; i--,pp++) {
-	if (((i+1)&0x1ffff) == 0) WaitCursor();
-
-	if (dithpic) xcol = ((*pp) ? white : black) & 0xffff;
-		else xcol = xcolors[*pp] & 0xffff;
+      for (i=0, ip=imagedata; i<high; i++, ip += xim->bytes_per_line) {
+	if (((i+1)&0x7f) == 0) WaitCursor();
+	for (j=0, tip=ip; j<wide; j++, pp++) {
+	  if (dithpic) xcol = ((*pp) ? white : black) & 0xffff;
+		  else xcol = xcolors[*pp] & 0xffff;
 
-	*ip++ = (xcol>>8) & 0xff;
-	*ip++ = (xcol) & 0xff;
+	  *tip++ = (xcol>>8) & 0xff;
+	  *tip++ = (xcol) & 0xff;
+	}
       }
     }
     else {   /* LSBFirst */
-      for (i=wide*high, ip=imagedata; i>0; i--,pp++) {
-	if (((i+1)&0x1ffff) == 0) WaitCursor();
-
-	if (dithpic) xcol = ((*pp) ? white : black) & 0xffff;
-	        else xcol = xcolors[*pp];
+      for (i=0, ip=imagedata; i<high; i++, ip += xim->bytes_per_line) {
+	if (((i+1)&0x7f) == 0) WaitCursor();
+	for (j=0, tip=ip; j<wide; j++, pp++) {
+	  if (dithpic) xcol = ((*pp) ? white : black) & 0xffff;
+		  else xcol = xcolors[*pp];
 
-	*ip++ = (xcol) & 0xff;
-	*ip++ = (xcol>>8) & 0xff;
+	  *tip++ = (xcol) & 0xff;
+	  *tip++ = (xcol>>8) & 0xff;
+	}
       }
     }
   }
@@ -2023,12 +2067,8 @@ XImage *Pic8ToXImage(byte *pic8, unsigned int wide, unsigned int high, long unsi
     byte  *imagedata, *ip, *pp, *tip;
     int    j, do32;
 
-    imagedata = (byte *) malloc((size_t) (4*wide*high));
-    if (!imagedata) FatalError("couldn't malloc imagedata");
-
-    xim = XCreateImage(theDisp,theVisual,dispDEEP,ZPixmap,0,
-		       (char *) imagedata,  wide,  high, 32, 0);
-    if (!xim) FatalError("couldn't create xim!");
+    xim = createZImage(wide, high, 32);
+    imagedata = (byte *) xim->data;
 
     do32 = (xim->bits_per_pixel == 32);
 
@@ -2071,12 +2111,8 @@ XImage *Pic8ToXImage(byte *pic8, unsigned int wide, unsigned int high, long unsi
     byte  *imagedata, *ip, *pp, *tip;
     int    j;
 
-    imagedata = (byte *) malloc((size_t) (4*wide*high));
-    if (!imagedata) FatalError("couldn't malloc imagedata");
-
-    xim = XCreateImage(theDisp,theVisual,dispDEEP,ZPixmap,0,
-		       (char *) imagedata,  wide,  high, 32, 0);
-    if (!xim) FatalError("couldn't create xim!");
+    xim = createZImage(wide, high, 32);
+    imagedata = (byte *) xim->data;
 
     if (xim->bits_per_pixel != 32)
         FatalError("Unhandled case for 30-bit depth: bits_per_pixel is not 32-bit..");
@@ -2192,21 +2228,15 @@ XImage *Pic24ToXImage(byte *pic24, unsigned int wide, unsigned int high)
     /************************************************************************/
 
     unsigned long xcol;
-    int           bperpix, bperline;
+    int           bperpix, bperline, packfmt;
     byte         *imagedata, *lip, *ip, *pp;
 
 
-    xim = XCreateImage(theDisp, theVisual, dispDEEP, ZPixmap, 0, NULL,
-		        wide,  high, 32, 0);
-    if (!xim) FatalError("couldn't create X image!");
+    xim = createZImage(wide, high, 32);
 
-    bperline = xim->bytes_per_line;
-    bperpix  = xim->bits_per_pixel;
-
-    imagedata = (byte *) malloc((size_t) (high * bperline));
-    if (!imagedata) FatalError("couldn't malloc imagedata");
-
-    xim->data = (char *) imagedata;
+    bperline  = xim->bytes_per_line;
+    bperpix   = xim->bits_per_pixel;
+    imagedata = (byte *) xim->data;
 
     if (bperpix != 8 && bperpix != 16 && bperpix != 24 && bperpix != 32) {
       char buf[128];
@@ -2288,6 +2318,15 @@ XImage *Pic24ToXImage(byte *pic24, unsigned int wide, unsigned int high)
 
     lip = imagedata;  pp = pic24;
 
+    packfmt = screen_packfmt(bperpix);
+    if (packfmt != PACK_NONE) {
+      for (i=0; i<high; i++, lip+=bperline, pp+=wide*3) {
+	if (((i+1)&0x7f) == 0) WaitCursor();
+	PackRGB24(pp, lip, (int) wide, packfmt);
+      }
+      return xim;
+    }
+
     switch (bperpix) {
       case 8:
         for (i=0; i<high; i++, lip+=bperline) {
@@ -2393,14 +2432,11 @@ XImage *Pic24ToXImage(byte *pic24, unsigned int wide, unsigned int high)
 
     case 8: {
       byte  *imagedata, *ip, *pp;
-      int   j, imWIDE, nullCount;
+      int   j, nullCount;
 
-      nullCount = (4 - (wide % 4)) & 0x03;  /* # of padding bytes per line */
-      imWIDE = wide + nullCount;
-
-      /* Now create the image data - pad each scanline as necessary */
-      imagedata = (byte *) malloc((size_t) (imWIDE * high));
-      if (!imagedata) FatalError("couldn't malloc imagedata");
+      xim = createZImage(wide, high, 32);
+      imagedata = (byte *) xim->data;
+      nullCount = xim->bytes_per_line - wide;  /* # of padding bytes/line */
 
       for (i=0, pp=pic8, ip=imagedata; i<high; i++) {
 	if (((i+1)&0x7f) == 0) WaitCursor();
@@ -2412,11 +2448,6 @@ XImage *Pic24ToXImage(byte *pic24, unsigned int wide, unsigned int high)
 
 	for (j=0; j<nullCount; j++, ip++)  *ip = 0;
       }
-
-      xim = XCreateImage(theDisp, theVisual, dispDEEP, ZPixmap, 0,
-			 (char *) imagedata,  wide,  high,
-			 32, imWIDE);
-      if (!xim) FatalError("couldn't create xim!");
     }
       break;
 
@@ -2731,6 +2762,8 @@ void Change824Mode(int mode)
 {
   if (mode == picType) return;   /* same mode, do nothing */
 
+  FullResPic();
+
   Set824Menus(mode);
 
   if (!pic) {  /* done all we wanna do when there's no pic */
@@ -2780,6 +2813,283 @@ void FreeEpic(void)
   if (egampic && egampic != epic) free(egampic);
   if (epic && epic != cpic) free(epic);
   epic = egampic = NULL;
+
+  freeEpicTiles();
+  epicTiled = 0;
+}
+
+
+/***********************************************************/
+/* Tiled epics.  With '-nolimits', or an image window that's bigger than the
+ * screen, a 'raw' epic can get enormous, even though most of it can never be
+ * seen.  In that case GenerateEpic() doesn't build it, and sets 'epicTiled'
+ * instead.  DrawWindow() then calls DrawEpicTiles(), which builds XImages
+ * of EPIC_TILE x EPIC_TILE pieces of the (virtual) epic as they get exposed,
+ * and keeps the most recently used ones around.  Only done in cases where
+ * building the image in pieces gives the exact same pixels as building it
+ * all at once (ie, no dithering).  The few things that need to look at the
+ * whole epic call UntileEpic() first.
+ *
+ * With MIT-SHM, the tiles are all built in one shared memory segment, with a
+ * slot for each entry in etiles[], so that it's only attached to the server
+ * once, rather than once per tile.
+ */
+
+#define EPIC_TILE      256                 /* tile size, in epic pixels    */
+#define EPIC_MAXTILES  256                 /* max # of tiles to keep       */
+#define EPIC_TILEMIN   (16*1024*1024)      /* don't tile smaller epics     */
+
+typedef struct { int           tx, ty;     /* tile position, in tiles      */
+		 unsigned long lastused;
+		 XImage       *xim;
+	       } EPICTILE;
+
+static EPICTILE      etiles[EPIC_MAXTILES];
+static int           netiles   = 0;
+static unsigned long etileTime = 0;
+static int           noTiles   = 0;        /* set by UntileEpic() */
+
+#ifdef HAVE_XSHM
+static size_t        etileSlot;            /* bytes per slot in etileShm   */
+static int           etilePoolTried = 0;
+static byte          etileDrawn[EPIC_MAXTILES];  /* slot has been put since
+						    the last XSync() */
+#endif
+
+
+/***********************************************************/
+static int epicTileable(void)
+{
+  /* returns '1' if the epic described by eWIDE,eHIGH (and epicMode, etc.)
+     should be built in tiles */
+
+  double esize;
+
+  if (noTiles || useroot || epicMode != EM_RAW) return 0;
+  if (eWIDE == cWIDE && eHIGH == cHIGH) return 0;   /* epic == cpic */
+  if (eWIDE <= dispWIDE && eHIGH <= dispHIGH) return 0;
+
+  esize = (double) eWIDE * (double) eHIGH * ((picType == PIC8) ? 1 : 3);
+  if (esize < EPIC_TILEMIN) return 0;
+
+  /* Pic8ToXImage() and Pic24ToXImage() must not dither, or there'd be seams
+     between the tiles */
+  if (dispDEEP < 8) return 0;
+
+  if (picType == PIC8) return (ncols > 0);
+
+  if (theVisual->class != TrueColor && theVisual->class != DirectColor)
+    return 0;
+
+#ifdef ENABLE_FIXPIX_SMOOTH
+  if (do_fixpix_smooth) return 0;
+#endif
+
+  return 1;
+}
+
+
+/***********************************************************/
+static void freeEpicTiles(void)
+{
+  int i;
+
+  for (i=0; i<netiles; i++) freeEpicTile(etiles[i].xim);
+  netiles = 0;
+}
+
+
+/***********************************************************/
+static void freeEpicTile(XImage *xim)
+{
+#ifdef HAVE_XSHM
+  if (xim && etileShm && xim->obdata == (char *) etileShm) {
+    /* just a slot in the shared segment, which stays around */
+    xim->obdata = NULL;
+    xim->data   = NULL;
+    XDestroyImage(xim);
+    return;
+  }
+#endif
+
+  xvDestroyImage(xim);
+}
+
+
+#ifdef HAVE_XSHM
+/***********************************************************/
+static int epicTilePool(void)
+{
+  /* creates etileShm, big enough for EPIC_MAXTILES tiles, the first time
+     it's needed.  Returns '1' if it exists.  It's kept until xv exits */
+
+  XImage *xim;
+
+  if (etileShm) return 1;
+  if (etilePoolTried) return 0;
+  etilePoolTried = 1;
+
+  if (!shmAvailable()) return 0;
+
+  xim = XShmCreateImage(theDisp, theVisual, dispDEEP, ZPixmap, NULL,
+			(XShmSegmentInfo *) NULL, EPIC_TILE, EPIC_TILE);
+  if (!xim) return 0;
+  etileSlot = (size_t) xim->bytes_per_line * EPIC_TILE;
+  xim->obdata = NULL;
+  XDestroyImage(xim);
+
+  etileShm = CreateShmSegment(etileSlot * EPIC_MAXTILES);
+
+  if (DEBUG && etileShm)
+    fprintf(stderr,"epicTilePool(): %d tiles in shm segment %d\n",
+	    EPIC_MAXTILES, etileShm->shmid);
+
+  return (etileShm != NULL);
+}
+#endif
+
+
+/***********************************************************/
+static XImage *getEpicTile(int tx, int ty)
+{
+  /* returns the XImage for tile tx,ty, building it if it isn't in the
+     cache.  If the cache is full, the least recently used tile is tossed */
+
+  int i, lru;
+
+  for (i=0; i<netiles; i++) {
+    if (etiles[i].tx == tx && etiles[i].ty == ty) {
+      etiles[i].lastused = ++etileTime;
+#ifdef HAVE_XSHM
+      etileDrawn[i] = 1;
+#endif
+      return etiles[i].xim;
+    }
+  }
+
+  if (netiles < EPIC_MAXTILES) i = netiles++;
+  else {
+    for (i=lru=0; i<netiles; i++) {
+      if (etiles[i].lastused < etiles[lru].lastused) lru = i;
+    }
+    i = lru;
+    freeEpicTile(etiles[i].xim);
+  }
+
+  etiles[i].tx = tx;  etiles[i].ty = ty;
+  etiles[i].lastused = ++etileTime;
+  etiles[i].xim = makeEpicTile(tx, ty, i);
+
+  return etiles[i].xim;
+}
+
+
+/***********************************************************/
+static XImage *makeEpicTile(int tx, int ty, int slot)
+{
+  /* builds an XImage for one tile of the epic, using the same scaling
+     equations as GenerateEpic().  'slot' is its place in etiles[] */
+
+  int     x0, y0, w, h, ex, ey, cx, cy, j, bperpix;
+  byte   *tpic, *gpic, *tp, *clptr, *cp;
+  XImage *xim;
+
+  x0 = tx * EPIC_TILE;  w = eWIDE - x0;  if (w > EPIC_TILE) w = EPIC_TILE;
+  y0 = ty * EPIC_TILE;  h = eHIGH - y0;  if (h > EPIC_TILE) h = EPIC_TILE;
+
+  bperpix = (picType == PIC8) ? 1 : 3;
+
+  tpic = (byte *) malloc((size_t) (w * h * bperpix));
+  if (!tpic) FatalError("makeEpicTile():  unable to malloc tile");
+
+  for (ey=y0, tp=tpic;  ey<y0+h;  ey++) {
+    cy = (cHIGH * ey) / eHIGH;
+    clptr = cpic + (cy * cWIDE * bperpix);
+
+    for (ex=x0; ex<x0+w; ex++) {
+      cx = (cWIDE * ex) / eWIDE;
+      cp = clptr + cx * bperpix;
+      for (j=0; j<bperpix; j++) *tp++ = *cp++;
+    }
+  }
+
+#ifdef HAVE_XSHM
+  if (epicTilePool()) {
+    /* XShmPutImage() doesn't wait for the server to read the pixels, so
+       make sure it's done with the old tile before overwriting it.  One
+       XSync() covers all the slots drawn so far */
+    if (etileDrawn[slot]) {
+      XSync(theDisp, False);
+      xvbzero((char *) etileDrawn, sizeof(etileDrawn));
+    }
+    zimageAddr = etileShm->shmaddr + slot * etileSlot;
+    etileDrawn[slot] = 1;
+  }
+#else
+  XV_UNUSED(slot);
+#endif
+
+  if (picType == PIC8)
+    xim = Pic8ToXImage(tpic, (u_int) w, (u_int) h, cols, rMap, gMap, bMap);
+  else {
+    /* (the color lattice it uses is only built for the first tile) */
+    gpic = GammifyPic24(tpic, w, h, 1);
+    xim  = Pic24ToXImage(gpic ? gpic : tpic, (u_int) w, (u_int) h);
+    if (gpic) free(gpic);
+  }
+
+#ifdef HAVE_XSHM
+  zimageAddr = (char *) NULL;
+#endif
+
+  free(tpic);
+  return xim;
+}
+
+
+/***********************************************************/
+void DrawEpicTiles(int x, int y, int w, int h)
+{
+  /* draws the x,y,w,h rectangle (in epic coords) of a tiled epic into mainW */
+
+  int     tx, ty, x0, y0, x1, y1, ix, iy, iw, ih;
+  XImage *xim;
+
+  if (x < 0) { w += x;  x = 0; }
+  if (y < 0) { h += y;  y = 0; }
+  if (x+w > eWIDE) w = eWIDE - x;
+  if (y+h > eHIGH) h = eHIGH - y;
+  if (w <= 0 || h <= 0) return;
+
+  for (ty = y / EPIC_TILE;  ty <= (y+h-1) / EPIC_TILE;  ty++) {
+    for (tx = x / EPIC_TILE;  tx <= (x+w-1) / EPIC_TILE;  tx++) {
+      xim = getEpicTile(tx, ty);
+      if (!xim) continue;
+
+      x0 = tx * EPIC_TILE;  x1 = x0 + (int) xim->width;
+      y0 = ty * EPIC_TILE;  y1 = y0 + (int) xim->height;
+
+      ix = (x > x0) ? x : x0;  iw = ((x+w < x1) ? x+w : x1) - ix;
+      iy = (y > y0) ? y : y0;  ih = ((y+h < y1) ? y+h : y1) - iy;
+
+      xvPutImage(mainW, theGC, xim, ix-x0, iy-y0, ix, iy,
+		 (u_int) iw, (u_int) ih);
+    }
+  }
+}
+
+
+/***********************************************************/
+void UntileEpic(void)
+{
+  /* builds the entire epic (and theImage), for things that need all of it */
+
+  if (!epicTiled) return;
+
+  noTiles = 1;
+  GenerateEpic(eWIDE, eHIGH);
+  CreateXImage();
+  noTiles = 0;
 }
 
 
@@ -2812,36 +3122,6 @@ unsigned long ul;
 
 
 
-/***********************************************************/
-byte *XVGetSubImage(byte *pic, int ptype, int w, int h, int sx, int sy, int sw, int sh)
-{
-  /* mallocs and returns the selected subimage (sx,sy,sw,sh) of pic.
-     selection is guaranteed to be within pic boundaries.
-     NEVER RETURNS NULL */
-
-  byte *rpic, *sp, *dp;
-  int   bperpix,x,y;
-
-  /* sanity check: */
-  if (sx<0 || sy<0 || sx+sw > w || sy+sh > h || sw<1 || sh<1) {
-    fprintf(stderr,"XVGetSubImage:  w,h=%d,%d  sel = %d,%d %dx%d\n",
-	    w, h, sx, sy, sw, sh);
-    FatalError("XVGetSubImage:  value out of range (shouldn't happen!)");
-  }
-
-
-  bperpix = (ptype==PIC8) ? 1 : 3;
-  rpic = (byte *) malloc((size_t) bperpix * sw * sh);
-  if (!rpic) FatalError("out of memory in XVGetSubImage");
-
-  for (y=0; y<sh; y++) {
-    sp = pic  + ((y+sy)*w + sx) * bperpix;
-    dp = rpic + (y * sw) * bperpix;
-    for (x=0; x<(sw*bperpix); x++, dp++, sp++) *dp = *sp;
-  }
-
-  return rpic;
-}
 
 
 
@@ -2861,6 +3141,8 @@ int DoPad(int mode, char *str, int wide, int high, int opaque, int omode)
 
   int   rv;
 
+  FullResPic();
+
   if (padPic)      free(padPic);
   if (holdcomment) free(holdcomment);
   if (holdfname)   free(holdcomment);
@@ -0,0 +1,201 @@
+/*
+ * xvincr.c - shows big images in the image window while they're still
+ *            being loaded
+ *
+ *  Contains:
+ *            int  IncrStart(pinfo)
+ *            void IncrRows(y0, y1)
+ *            void IncrDone(ok)
+ *
+ * A loader that produces its image a band of rows at a time (or, for
+ * interlaced files, a pass at a time) calls IncrStart() once it has
+ * allocated pinfo->pic, IncrRows() whenever some more rows are finished,
+ * and IncrDone() when it's done, whether it succeeded or not.  Every so
+ * often, the rows that have come in since the last time are shrunk (by
+ * plain sampling) to fit the current image window, and drawn there.  Once
+ * the load is done, openPic() displays the image properly, as usual.
+ *
+ * This is only done for images of at least INCR_MINPIX pixels, when there
+ * already is an image window, and on TrueColor and DirectColor visuals,
+ * where drawing doesn't involve allocating colors.  Loads from other
+ * threads (the prefetcher) and 'quick' loads don't get displayed.
+ */
+
+#include "copyright.h"
+
+#define NEEDSTIME
+#include "xv.h"
+
+
+#define INCR_MINPIX  (1L<<20)   /* don't bother for images smaller than this */
+#define INCR_MSEC    100        /* min. time between draws */
+
+
+static PICINFO *ipinfo = (PICINFO *) NULL;   /* image being loaded, or NULL */
+static int      dwide, dhigh, dxoff, dyoff;  /* where it's being drawn */
+static int     *colmap = (int *) NULL;       /* dest col -> source col */
+static int      drawn;                       /* have drawn something */
+static int      pendy0, pendy1;              /* rows not yet drawn */
+static struct timeval lastDraw;
+
+static void drawPending PARM((void));
+static long msecSince   PARM((struct timeval *));
+
+
+/***************************************************/
+int IncrStart(PICINFO *pinfo)
+{
+  /* called by a loader, once pinfo->pic, w, h, type and (for PIC8) the
+     colormap are set.  Returns '1' if the rows will be getting displayed */
+
+  int i;
+
+  if (!IsMainThread()) return 0;
+  ipinfo = (PICINFO *) NULL;
+
+  if (!mainW || useroot || dispDEEP == 1 ||
+      (theVisual->class != TrueColor && theVisual->class != DirectColor))
+    return 0;
+
+  if (!pinfo->pic || (long) pinfo->w * pinfo->h < INCR_MINPIX) return 0;
+  if (eWIDE <= 0 || eHIGH <= 0) return 0;
+
+  /* fit it into the window as it is now, keeping its aspect ratio */
+  dwide = eWIDE;
+  dhigh = (int) (((double) pinfo->h * eWIDE) / pinfo->w + 0.5);
+  if (dhigh > eHIGH) {
+    dhigh = eHIGH;
+    dwide = (int) (((double) pinfo->w * eHIGH) / pinfo->h + 0.5);
+  }
+  if (dwide < 1) dwide = 1;
+  if (dhigh < 1) dhigh = 1;
+  dxoff = (eWIDE - dwide) / 2;
+  dyoff = (eHIGH - dhigh) / 2;
+
+  if (colmap) free(colmap);
+  colmap = (int *) malloc(dwide * sizeof(int));
+  if (!colmap) return 0;
+  for (i=0; i<dwide; i++) colmap[i] = (int) (((double) i * pinfo->w) / dwide);
+
+  ipinfo = pinfo;
+  drawn  = 0;
+  pendy0 = pinfo->h;  pendy1 = 0;
+  gettimeofday(&lastDraw, NULL);
+
+  return 1;
+}
+
+
+/***************************************************/
+void IncrRows(int y0, int y1)
+{
+  /* rows y0 through y1-1 of the image have been (re)decoded */
+
+  if (!ipinfo || !IsMainThread()) return;
+
+  if (y0 < pendy0) pendy0 = y0;
+  if (y1 > pendy1) pendy1 = y1;
+
+  if (msecSince(&lastDraw) >= INCR_MSEC) {
+    drawPending();
+    gettimeofday(&lastDraw, NULL);
+  }
+}
+
+
+/***************************************************/
+void IncrDone(int ok)
+{
+  /* called when the loader's finished with the image.  If it failed, and
+     we've scribbled over the old image, gets that redrawn */
+
+  if (!ipinfo || !IsMainThread()) return;
+
+  if (ok) drawPending();     /* it may be a while before it's displayed */
+  else if (drawn) {
+    XClearArea(theDisp, mainW, 0, 0, (u_int) eWIDE, (u_int) eHIGH, True);
+    XFlush(theDisp);
+  }
+
+  ipinfo = (PICINFO *) NULL;
+}
+
+
+
+/***************************************************/
+static void drawPending(void)
+{
+  XImage *xim;
+  byte   *strip, *sp, *src, *rmap, *gmap, *bmap;
+  int     i, j, dy0, dy1, sy, is24;
+
+  if (pendy0 >= pendy1) return;
+
+  /* dest rows whose source rows are in [pendy0,pendy1) */
+  dy0 = (int) (((double) pendy0 * dhigh + ipinfo->h - 1) / ipinfo->h);
+  dy1 = (int) (((double) pendy1 * dhigh + ipinfo->h - 1) / ipinfo->h);
+  if (dy1 > dhigh) dy1 = dhigh;
+  pendy0 = ipinfo->h;  pendy1 = 0;
+  if (dy0 >= dy1) return;
+
+  strip = (byte *) malloc((size_t) dwide * (dy1-dy0) * 3);
+  if (!strip) return;
+
+  is24 = (ipinfo->type == PIC24);
+  rmap = ipinfo->r;  gmap = ipinfo->g;  bmap = ipinfo->b;
+
+  for (i=dy0, sp=strip; i<dy1; i++) {
+    sy  = (int) (((double) i * ipinfo->h) / dhigh);
+    src = ipinfo->pic + (size_t) sy * ipinfo->w * (is24 ? 3 : 1);
+
+    if (is24) {
+      for (j=0; j<dwide; j++, sp+=3) {
+	byte *p = src + colmap[j]*3;
+	sp[0] = p[0];  sp[1] = p[1];  sp[2] = p[2];
+      }
+    }
+    else {
+      for (j=0; j<dwide; j++, sp+=3) {
+	int c = src[colmap[j]];
+	sp[0] = rmap[c];  sp[1] = gmap[c];  sp[2] = bmap[c];
+      }
+    }
+  }
+
+  xim = Pic24ToXImage(strip, (u_int) dwide, (u_int) (dy1-dy0));
+  free(strip);
+  if (!xim) return;
+
+  if (!drawn) {      /* first time:  clear out the borders */
+    XSetForeground(theDisp, theGC, black);
+    if (dxoff) {
+      XFillRectangle(theDisp, mainW, theGC, 0, 0, (u_int) dxoff,
+		     (u_int) eHIGH);
+      XFillRectangle(theDisp, mainW, theGC, dxoff+dwide, 0,
+		     (u_int) (eWIDE-dxoff-dwide), (u_int) eHIGH);
+    }
+    if (dyoff) {
+      XFillRectangle(theDisp, mainW, theGC, 0, 0, (u_int) eWIDE,
+		     (u_int) dyoff);
+      XFillRectangle(theDisp, mainW, theGC, 0, dyoff+dhigh, (u_int) eWIDE,
+		     (u_int) (eHIGH-dyoff-dhigh));
+    }
+    drawn = 1;
+  }
+
+  xvPutImage(mainW, theGC, xim, 0, 0, dxoff, dyoff+dy0,
+	     (u_int) dwide, (u_int) (dy1-dy0));
+  xvDestroyImage(xim);
+  XFlush(theDisp);
+}
+
+
+/***************************************************/
+static long msecSince(struct timeval *tv)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - tv->tv_sec) * 1000L +
+         (now.tv_usec - tv->tv_usec) / 1000L;
+}
@@ -285,6 +285,11 @@ va_dcl
   stnum = va_arg(args, int);
 #endif
 
+  if (!IsMainThread()) {    /* a background load (see xvprefetch.c) */
+    va_end(args);
+    return;
+  }
+
   if (stnum>=0 && stnum < NISTR) {
     fmt = va_arg(args, char *);
     if (fmt) vsnprintf(istrs[stnum], sizeof(istrs[stnum]), fmt, args);
@@ -0,0 +1,269 @@
+/*
+ * xvinvcmap.c - remembers which displayed color DoColorDither() picked for
+ *               each part of the color cube, from one image to the next
+ *
+ *  Contains:
+ *            void   InvCmapInit(fname)
+ *            short *InvCmapGet(rdisp, gdisp, bdisp, maplen)
+ *            void   InvCmapRelease(cells)
+ *            void   InvCmapSave()
+ *
+ * DoColorDither() divides the color cube into INVCMAPCELLS cells (5 bits of
+ * red and green, 4 of blue), and finds the closest displayed color for
+ * each one the first time it's needed.  When xv is using a fixed set of
+ * colors (the std colormap, or '-ncols', or '-nofreecols' in a slideshow)
+ * every image gets dithered to the same colors, so those tables are kept
+ * here, keyed by the colors themselves, and handed back out the next time
+ * the same colors come along.
+ *
+ * If a file has been given (with '-cmapcache', or the 'cmapCache'
+ * resource), the tables are read from it at startup, and written back to
+ * it when xv exits, so they survive from one run to the next as well.
+ *
+ * A table is only handed to one DoColorDither() at a time.  Anyone else who
+ * wants it meanwhile gets NULL, and makes their own.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+static pthread_mutex_t invLock = PTHREAD_MUTEX_INITIALIZER;
+#  define LOCK_INV()    pthread_mutex_lock(&invLock)
+#  define UNLOCK_INV()  pthread_mutex_unlock(&invLock)
+#else
+#  define LOCK_INV()
+#  define UNLOCK_INV()
+#endif
+
+
+#define MAXINVCMAPS 4               /* sets of colors it remembers */
+#define INVMAGIC    "XV inverse colormap cache 1\n"
+
+
+typedef struct { byte   r[256], g[256], b[256];
+		 int    len;        /* # of colors.  0 = unused */
+		 short *cells;      /* INVCMAPCELLS of closest color + 1, or 0 */
+		 int    busy;       /* handed out, and not released yet */
+		 unsigned long lastuse;
+	       } INVCMAP;
+
+
+static INVCMAP        invcmaps[MAXINVCMAPS];
+static unsigned long  invUseCount = 0;
+static char          *invFile     = (char *) NULL;
+
+static INVCMAP *invEntry  PARM((byte *, byte *, byte *, int));
+static int      invRead   PARM((FILE *, INVCMAP *));
+
+
+/***************************************************/
+void InvCmapInit(const char *fname)
+{
+  /* loads the tables saved in 'fname' (if it exists), and arranges for
+     them to be saved back there when xv exits */
+
+  FILE   *fp;
+  INVCMAP tmp;
+  char    magic[sizeof(INVMAGIC)];
+  int     i;
+
+  if (!fname || !*fname || invFile) return;
+
+  invFile = (char *) malloc(strlen(fname) + 1);
+  if (!invFile) FatalError("out of memory in InvCmapInit()");
+  strcpy(invFile, fname);
+  atexit(InvCmapSave);
+
+  fp = xv_fopen(fname, "r");
+  if (!fp) return;
+
+  if (fread(magic, (size_t) 1, strlen(INVMAGIC), fp) != strlen(INVMAGIC) ||
+      strncmp(magic, INVMAGIC, strlen(INVMAGIC)) != 0) {
+    fprintf(stderr,"%s: '%s' isn't an xv colormap cache.  Ignored.\n",
+	    cmd, fname);
+    fclose(fp);
+    return;
+  }
+
+  LOCK_INV();
+  for (i=0; i<MAXINVCMAPS; i++) {
+    xvbzero((char *) &tmp, sizeof(tmp));
+    if (!invRead(fp, &tmp)) break;
+    invcmaps[i] = tmp;
+    invcmaps[i].lastuse = ++invUseCount;
+  }
+  UNLOCK_INV();
+
+  fclose(fp);
+  if (DEBUG) fprintf(stderr,"InvCmapInit(%s): %d tables\n", fname, i);
+}
+
+
+/***************************************************/
+short *InvCmapGet(byte *rdisp, byte *gdisp, byte *bdisp, int maplen)
+{
+  /* returns the table for these colors, or an empty one (in place of the
+     one used least recently) if there isn't one yet.  Returns NULL if
+     it's in use, or out of memory.  Give it back with InvCmapRelease() */
+
+  INVCMAP *e;
+  short   *rv;
+  int      i;
+
+  if (maplen < 1 || maplen > 256) return (short *) NULL;
+
+  LOCK_INV();
+  e = invEntry(rdisp, gdisp, bdisp, maplen);
+
+  if (!e) {
+    for (i=0; i<MAXINVCMAPS; i++) {
+      if (invcmaps[i].busy) continue;
+      if (!e || invcmaps[i].lastuse < e->lastuse) e = &invcmaps[i];
+    }
+
+    if (e && !e->cells)
+      e->cells = (short *) malloc(INVCMAPCELLS * sizeof(short));
+
+    if (e && e->cells) {
+      xvbzero((char *) e->cells, INVCMAPCELLS * sizeof(short));
+      xvbcopy((char *) rdisp, (char *) e->r, (size_t) maplen);
+      xvbcopy((char *) gdisp, (char *) e->g, (size_t) maplen);
+      xvbcopy((char *) bdisp, (char *) e->b, (size_t) maplen);
+      e->len = maplen;
+    }
+    else e = (INVCMAP *) NULL;
+  }
+
+  else if (e->busy) e = (INVCMAP *) NULL;
+
+  rv = (short *) NULL;
+  if (e) {
+    e->busy    = 1;
+    e->lastuse = ++invUseCount;
+    rv = e->cells;
+  }
+  UNLOCK_INV();
+
+  return rv;
+}
+
+
+/***************************************************/
+void InvCmapRelease(short *cells)
+{
+  int i;
+
+  LOCK_INV();
+  for (i=0; i<MAXINVCMAPS; i++)
+    if (invcmaps[i].cells == cells) invcmaps[i].busy = 0;
+  UNLOCK_INV();
+}
+
+
+/***************************************************/
+void InvCmapSave(void)
+{
+  /* writes the tables to the file given to InvCmapInit().  Registered
+     with atexit() */
+
+  FILE    *fp;
+  INVCMAP *e;
+  int      i, j, ok;
+
+  if (!invFile) return;
+
+  fp = xv_fopen(invFile, "w");
+  if (!fp) {
+    fprintf(stderr,"%s: can't write colormap cache '%s'\n", cmd, invFile);
+    return;
+  }
+
+  fputs(INVMAGIC, fp);
+
+  LOCK_INV();
+  for (i=0, e=invcmaps; i<MAXINVCMAPS; i++, e++) {
+    if (!e->len || !e->cells || e->busy) continue;
+
+    putc(e->len - 1, fp);
+    fwrite((char *) e->r, (size_t) 1, (size_t) e->len, fp);
+    fwrite((char *) e->g, (size_t) 1, (size_t) e->len, fp);
+    fwrite((char *) e->b, (size_t) 1, (size_t) e->len, fp);
+
+    /* a byte per cell:  0 = not known, else the color + 1, which won't
+       fit if there are 256 colors, so those are two bytes */
+    for (j=0; j<INVCMAPCELLS; j++) {
+      if (e->len < 256) putc(e->cells[j], fp);
+      else { putc((e->cells[j] >> 8) & 0xff, fp);  putc(e->cells[j] & 0xff, fp); }
+    }
+  }
+  UNLOCK_INV();
+
+  ok = !ferror(fp);
+  if (fclose(fp) == EOF) ok = 0;
+  if (!ok) {
+    fprintf(stderr,"%s: error writing colormap cache '%s'\n", cmd, invFile);
+    unlink(invFile);
+  }
+}
+
+
+/***************************************************/
+static INVCMAP *invEntry(byte *rdisp, byte *gdisp, byte *bdisp, int maplen)
+{
+  /* returns the entry for these colors, or NULL.  called with invLock
+     held */
+
+  INVCMAP *e;
+  int      i;
+
+  for (i=0, e=invcmaps; i<MAXINVCMAPS; i++, e++) {
+    if (e->len == maplen && e->cells &&
+	!xvbcmp((char *) rdisp, (char *) e->r, (size_t) maplen) &&
+	!xvbcmp((char *) gdisp, (char *) e->g, (size_t) maplen) &&
+	!xvbcmp((char *) bdisp, (char *) e->b, (size_t) maplen)) return e;
+  }
+
+  return (INVCMAP *) NULL;
+}
+
+
+/***************************************************/
+static int invRead(FILE *fp, INVCMAP *e)
+{
+  /* reads one table (as written by InvCmapSave()) into 'e'.  Returns '0'
+     at the end of the file, or if it doesn't make sense */
+
+  int i, c, hi;
+
+  if ((c = getc(fp)) == EOF) return 0;
+  e->len = c + 1;
+
+  if (fread((char *) e->r, (size_t) 1, (size_t) e->len, fp) != (size_t) e->len ||
+      fread((char *) e->g, (size_t) 1, (size_t) e->len, fp) != (size_t) e->len ||
+      fread((char *) e->b, (size_t) 1, (size_t) e->len, fp) != (size_t) e->len)
+    return 0;
+
+  e->cells = (short *) malloc(INVCMAPCELLS * sizeof(short));
+  if (!e->cells) return 0;
+
+  for (i=0; i<INVCMAPCELLS; i++) {
+    hi = 0;
+    if (e->len == 256 && (hi = getc(fp)) == EOF) break;
+    if ((c = getc(fp)) == EOF) break;
+
+    c |= hi << 8;
+    if (c > e->len) break;
+    e->cells[i] = c;
+  }
+
+  if (i < INVCMAPCELLS) {
+    free(e->cells);
+    e->cells = (short *) NULL;
+    return 0;
+  }
+
+  return 1;
+}
@@ -54,10 +54,13 @@ struct my_error_mgr {
 typedef struct my_error_mgr *my_error_ptr;
 
 /*** local functions ***/
+#ifndef XV_HEADLESS
 static    void         drawJD             PARM((int, int, int, int));
 static    void         clickJD            PARM((int, int));
 static    void         doCmd              PARM((int));
 static    void         writeJPEG          PARM((void));
+static    int          writeJFIF          PARM((FILE *, byte *, int,int,int));
+#endif
 #if JPEG_LIB_VERSION > 60
 METHODDEF(void)        xv_error_exit      PARM((j_common_ptr));
 METHODDEF(void)        xv_error_output    PARM((j_common_ptr));
@@ -75,25 +78,26 @@ METHODDEF(boolean)     xv_process_app1    PARM((j_decompress_ptr));
 METHODDEF boolean      xv_process_comment PARM((j_decompress_ptr));
 METHODDEF boolean      xv_process_app1    PARM((j_decompress_ptr));
 #endif
-static    int          writeJFIF          PARM((FILE *, byte *, int,int,int));
 
 
 
 /*** local variables ***/
-static char *filename = NULL;
 static const char *fbasename = NULL;
 static char *comment = NULL;
 static byte *exifInfo = NULL;
 static int   exifInfoSize = 0;   /* not a string => must track size explicitly */
 
+#ifndef XV_HEADLESS
+static char *filename = NULL;
 static int   colorType;
-
 static DIAL  qDial, smDial;
 static BUTT  jbut[J_NBUTTS];
+#endif
 
 char errbuffer[JMSG_LENGTH_MAX];
 
 
+#ifndef XV_HEADLESS   /* libxvcore (see xvcore.c) only loads JPEGs */
 /***************************************************************************/
 /* JPEG SAVE DIALOG ROUTINES ***********************************************/
 /***************************************************************************/
@@ -429,10 +433,7 @@ static void writeJPEG(void)
   if (CloseOutFileWhy(fp, filename, rv, errbuffer) == 0) DirBox(0);
   SetCursors(-1);
 }
-
-
-
-
+#endif /* !XV_HEADLESS */
 
 
 /***************************************************************************/
@@ -512,6 +513,8 @@ int LoadJFIF(char *fname, PICINFO *pinfo, int quick)
   byte                            *pic;
   long                             filesize;
   int                              i,w,h,bperpix,bperline,count;
+  LOADOPTS                         lopts;
+  int                              lconv;
 
 
   /* Initialize variables below instead of in the declarations above to avoid the warning */
@@ -528,6 +531,7 @@ int LoadJFIF(char *fname, PICINFO *pinfo, int quick)
   colorspace_name = "Color";
 
   pinfo->type  = PIC8;
+  pinfo->reduced = 0;
 
   if ((fp = xv_fopen(fname, "r")) == NULL) return 0;
 
@@ -549,6 +553,7 @@ L1:
     if (comment)  free(comment);
     if (exifInfo) free(exifInfo);
 
+    IncrDone(0);
     pinfo->pic      = (byte *) NULL;
     pinfo->comment  = (char *) NULL;
     pinfo->exifInfo = (byte *) NULL;
@@ -605,6 +610,38 @@ L1:
     h = cinfo.output_height;
   }
 
+  else if (pinfo->loadw > 0 && pinfo->loadh > 0 && cinfo.num_components != 1) {
+    /* it's going to be shrunk to fit in loadw x loadh.  Have libjpeg do as
+       much of that as it can, by leaving out the high-frequency DCT
+       coefficients, as long as the result is still at least as big as
+       what'll be shown.  (Not for greyscale images, as openPic() sorts
+       their colormaps, and FullResPic() couldn't swap in the full-size
+       image later) */
+
+    int    fac, lw, lh;
+    double r, wr, hr;
+
+    lw = pinfo->loadw;  lh = pinfo->loadh;
+    if (get_exif_orientation(exifInfo, exifInfoSize) >= ORIENT_TRANSPOSE) {
+      lw = pinfo->loadh;  lh = pinfo->loadw;     /* will be turned 90 deg */
+    }
+
+    wr = ((double) w) / lw;
+    hr = ((double) h) / lh;
+    r  = (wr>hr) ? wr : hr;       /* it'll be shrunk by this much */
+
+    for (fac=8; fac>1 && fac>r; fac/=2);
+
+    if (fac > 1) {
+      cinfo.scale_num   = 1;
+      cinfo.scale_denom = fac;
+      jpeg_calc_output_dimensions(&cinfo);
+      w = cinfo.output_width;
+      h = cinfo.output_height;
+      pinfo->reduced = fac;
+    }
+  }
+
 
   cinfo.quantize_colors = FALSE;     /* default: give 24-bit image to XV */
   switch (cinfo.num_components) {
@@ -622,7 +659,10 @@ L1:
       cinfo.out_color_space = JCS_CMYK;
       colorspace_name = "4-Plane Color";
 L2:
-      if (!quick && picType == PIC8 && conv24MB.flags[CONV24_LOCK] == 1) {
+      if (pinfo->opts) lconv = pinfo->opts->conv24;
+      else { LoadOptsNow(&lopts);  lconv = lopts.conv24; }
+
+      if (!quick && lconv) {
         /*
          * we're locked into 8-bit mode:
          *   if CONV24_FAST, use JPEG's one-pass quantizer
@@ -632,10 +672,10 @@ L2:
         cinfo.desired_number_of_colors = 256;
         cinfo.colormap = NULL;
 
-        if (conv24 == CONV24_FAST || conv24 == CONV24_SLOW) {
+        if (lconv-1 == CONV24_FAST || lconv-1 == CONV24_SLOW) {
           cinfo.quantize_colors = TRUE;
           state824 = 1; /* image was converted from 24 to 8 bits */
-          cinfo.two_pass_quantize = (conv24 == CONV24_SLOW);
+          cinfo.two_pass_quantize = (lconv-1 == CONV24_SLOW);
         }
       }
       break;
@@ -673,6 +713,13 @@ L2:
 
   pinfo->orientation = get_exif_orientation(exifInfo, exifInfoSize);
 
+  /* show the rows as they come in, if it's big (not for CMYK, though, as
+     it doesn't become RGB until the end) */
+  if (!quick && !cinfo.quantize_colors && bperpix <= 3) {
+    pinfo->pic = pic;  pinfo->w = w;  pinfo->h = h;
+    IncrStart(pinfo);
+  }
+
   while (cinfo.output_scanline < cinfo.output_height) {
 #if 0
     /* can never happen because output_scanline is unsigned */
@@ -684,6 +731,7 @@ L2:
 #endif
     rowptr[0] = (JSAMPROW) &pic[cinfo.output_scanline * w * bperpix];
     (void) jpeg_read_scanlines(&cinfo, rowptr, (JDIMENSION) 1);
+    IncrRows((int) cinfo.output_scanline - 1, (int) cinfo.output_scanline);
   }
 
 
@@ -783,6 +831,7 @@ L2:
   exifInfo = (byte *) NULL;
   exifInfoSize = 0;
 
+  IncrDone(1);
   return 1;
 }
 
@@ -878,6 +927,7 @@ METHODDEF boolean  xv_process_app1(j_decompress_ptr cinfo)
 }
 
 
+#ifndef XV_HEADLESS
 /***************************************************************************/
 /* WRITE ROUTINES **********************************************************/
 /***************************************************************************/
@@ -1003,6 +1053,7 @@ static int writeJFIF(FILE *fp, byte *pic, int w, int h, int coltype)
 
   return 0;
 }
+#endif /* !XV_HEADLESS */
 
 
 
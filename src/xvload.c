@@ -0,0 +1,668 @@
+/*
+ * xvload.c - figures out what sort of file something is, and loads it
+ *
+ *  Contains:
+ *            int   ReadFileType(fname)
+ *            int   ReadPicFile(fname, ftype, pinfo, quick)
+ *            void  LoadOptsNow(lo)
+ *            int   SameLoadOpts(lo1, lo2)
+ *            char *QuoteFileName(safe_name, orig_name, max_len)
+ *            int   UncompressFile(name, uncompname, filetype)
+ *            int   RemoveMacbinary(src, dst)
+ *            void  KillPageFiles(bname, numpages)
+ *
+ * These used to live in xv.c.  They're the front door to all of the
+ * loaders, and have nothing to do with X, so they're also part of the
+ * headless libxvcore (see xvcore.c).
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+
+#ifdef HAVE_G3
+int           lowresfax = 0;    /* temporary(?) kludge */
+int           highresfax = 0;
+#endif
+
+#ifdef HAVE_PCD
+int           PcdSize    = -1;  /* force dialog to ask */
+#endif
+
+#ifdef HAVE_JP2K
+static byte jp2k_magic[12] =
+  { 0, 0, 0, 0x0c, 'j', 'P', ' ', ' ', 0x0d, 0x0a, 0x87, 0x0a };
+#endif
+
+extern byte ZXheader[128];	/* [JCE] Spectrum screen magic number is
+                                  defined in xvzx.c */
+
+static int doUncompress PARM((char *, char *, int));
+
+
+/********************************/
+int ReadFileType(char *fname)
+{
+  /* opens fname (which *better* be an actual file by this point!) and
+     reads the first couple o' bytes.  Figures out what the file's likely
+     to be, and returns the appropriate RFT_*** code */
+
+
+  byte  probe[PROBESIZE];    /* first PROBESIZE bytes of file */
+  byte *magicno;             /* first 30 bytes of what we're looking at */
+  int   rv=RFT_UNKNOWN, n;
+#ifdef MACBINARY
+  int   macbin_alrchk = False;
+#endif
+
+  if (!fname) return RFT_ERROR;   /* shouldn't happen */
+
+  /* the file stays open, for the loader (see xvprobe.c) */
+  n = ProbeFile(fname, probe, (int) sizeof(probe));
+  if (n < 0) return RFT_ERROR;
+
+  if (strlen(fname) > 4 &&
+      strcasecmp(fname+strlen(fname)-5, ".wbmp")==0)          rv = RFT_WBMP;
+
+  if (n<=0) return RFT_UNKNOWN;
+
+  /* it is just barely possible that a few files could legitimately be as small
+     as 30 bytes (e.g., binary P{B,G,P}M format), so zero out rest of "magic
+     number" buffer and don't quit immediately if we read something small but
+     not empty */
+  if (n<30) memset(probe+n, 0, (size_t) (30-n));
+  magicno = probe;
+
+#ifdef MACBINARY
+  macb_file = False;
+  while (1) {
+#endif
+
+#ifdef HAVE_MGCSFX
+  if (is_mgcsfx(fname, magicno, 30) != 0) rv = RFT_MGCSFX;
+  else
+#endif
+       if (strncmp((char *) magicno,"GIF87a", (size_t) 6)==0 ||
+	   strncmp((char *) magicno,"GIF89a", (size_t) 6)==0) rv = RFT_GIF;
+
+  else if (strncmp((char *) magicno,"VIEW", (size_t) 4)==0 ||
+	   strncmp((char *) magicno,"WEIV", (size_t) 4)==0)   rv = RFT_PM;
+
+#ifdef HAVE_PIC2
+  else if (magicno[0]=='P' && magicno[1]=='2' &&
+	   magicno[2]=='D' && magicno[3]=='T')                rv = RFT_PIC2;
+#endif
+
+  else if (magicno[0] == 'P' && magicno[1]>='1' &&
+	   (magicno[1]<='6' || magicno[1]=='8'))              rv = RFT_PBM;
+
+  /* note: have to check XPM before XBM, as first 2 chars are the same */
+  else if (strncmp((char *) magicno, "/* XPM */", (size_t) 9)==0) rv = RFT_XPM;
+
+  else if (strncmp((char *) magicno,"#define", (size_t) 7)==0 ||
+	   (magicno[0] == '/' && magicno[1] == '*'))          rv = RFT_XBM;
+
+  else if (magicno[0]==0x59 && (magicno[1]&0x7f)==0x26 &&
+	   magicno[2]==0x6a && (magicno[3]&0x7f)==0x15)       rv = RFT_SUNRAS;
+
+  else if (magicno[0] == 'B' && magicno[1] == 'M')            rv = RFT_BMP;
+
+  else if (magicno[0]==0x52 && magicno[1]==0xcc)              rv = RFT_UTAHRLE;
+
+  else if ((magicno[0]==0x01 && magicno[1]==0xda) ||
+	   (magicno[0]==0xda && magicno[1]==0x01))            rv = RFT_IRIS;
+
+  else if (magicno[0]==0x1f && magicno[1]==0x9d)              rv = RFT_COMPRESS;
+
+#ifdef GUNZIP
+  else if (magicno[0]==0x1f && magicno[1]==0x8b)              rv = RFT_COMPRESS;
+#endif
+
+#ifdef BUNZIP2
+  else if (magicno[0]==0x42 && magicno[1]==0x5a)              rv = RFT_BZIP2;
+#endif
+
+#ifdef XZ
+  else if (magicno[0]==0xfd &&
+           magicno[1]=='7' && magicno[2]=='z' &&
+           magicno[3]=='X' && magicno[4]=='Z')                rv = RFT_XZ;
+#endif
+
+  else if (magicno[0]==0x0a && magicno[1] <= 5)               rv = RFT_PCX;
+
+  else if (strncmp((char *) magicno,   "FORM", (size_t) 4)==0 &&
+	   strncmp((char *) magicno+8, "ILBM", (size_t) 4)==0) rv = RFT_IFF;
+
+  else if (magicno[0]==0 && magicno[1]==0 &&
+	   magicno[2]==2 && magicno[3]==0 &&
+	   magicno[4]==0 && magicno[5]==0 &&
+	   magicno[6]==0 && magicno[7]==0)                    rv = RFT_TARGA;
+
+  else if (magicno[4]==0x00 && magicno[5]==0x00 &&
+	   magicno[6]==0x00 && magicno[7]==0x07)              rv = RFT_XWD;
+
+  else if (strncmp((char *) magicno,"SIMPLE  ", (size_t) 8)==0 &&
+	   magicno[29] == 'T')                                rv = RFT_FITS;
+
+  /* [JCE] Spectrum screen */
+  else if (memcmp(magicno, ZXheader, (size_t) 18)==0)         rv = RFT_ZX;
+
+#ifdef HAVE_JPEG
+  else if (magicno[0]==0xff && magicno[1]==0xd8 &&
+	   magicno[2]==0xff)                                  rv = RFT_JFIF;
+#endif
+
+#ifdef HAVE_JP2K
+  else if (magicno[0]==0xff && magicno[1]==0x4f &&
+           magicno[2]==0xff && magicno[3]==0x51)              rv = RFT_JPC;
+
+  else if (memcmp(magicno, jp2k_magic, sizeof(jp2k_magic))==0) rv = RFT_JP2;
+#endif
+
+#ifdef HAVE_TIFF
+  else if ((magicno[0]=='M' && magicno[1]=='M') ||
+	   (magicno[0]=='I' && magicno[1]=='I'))              rv = RFT_TIFF;
+#endif
+
+#ifdef HAVE_PNG
+  else if (magicno[0]==0x89 && magicno[1]=='P' &&
+           magicno[2]=='N'  && magicno[3]=='G')               rv = RFT_PNG;
+#endif
+
+#ifdef HAVE_WEBP
+  else if (magicno[0]=='R'  && magicno[1]=='I' &&
+           magicno[2]=='F'  && magicno[3]=='F' &&
+           magicno[8]=='W'  && magicno[9]=='E' &&
+           magicno[10]=='B' && magicno[11]=='P')               rv = RFT_WEBP;
+#endif
+
+#ifdef HAVE_PDS
+  else if (strncmp((char *) magicno,  "NJPL1I00", (size_t) 8)==0 ||
+	   strncmp((char *) magicno+2,"NJPL1I",   (size_t) 6)==0 ||
+           strncmp((char *) magicno,  "CCSD3ZF",  (size_t) 7)==0 ||
+	   strncmp((char *) magicno+2,"CCSD3Z",   (size_t) 6)==0 ||
+	   strncmp((char *) magicno,  "LBLSIZE=", (size_t) 8)==0)
+      rv = RFT_PDSVICAR;
+#endif
+
+#ifdef GS_PATH   /* Ghostscript handles both PostScript and PDF */
+  else if (strncmp((char *) magicno, "%!",     (size_t) 2)==0 ||
+	   strncmp((char *) magicno, "\004%!", (size_t) 3)==0 ||
+           strncmp((char *) magicno, "%PDF",   (size_t) 4)==0) rv = RFT_PS;
+#endif
+
+#ifdef HAVE_MAG
+  else if (strncmp((char *) magicno,"MAKI02  ", (size_t) 8)==0) rv = RFT_MAG;
+#endif
+
+#ifdef HAVE_MAKI
+  else if (strncmp((char *) magicno,"MAKI01A ", (size_t) 8)==0 ||
+	   strncmp((char *) magicno,"MAKI01B ", (size_t) 8)==0) rv = RFT_MAKI;
+#endif
+
+#ifdef HAVE_PIC
+  else if (magicno[0]=='P' && magicno[1]=='I'&&magicno[2]=='C') rv = RFT_PIC;
+#endif
+
+#ifdef HAVE_PI
+  else if (magicno[0]=='P' && magicno[1]=='i')                rv = RFT_PI;
+#endif
+
+#ifdef HAVE_HIPS
+  else if (strstr((char *) magicno, "./digest"))              rv = RFT_HIPS;
+#endif
+
+#ifdef HAVE_PCD
+  else if (magicno[0]==0xff && magicno[1]==0xff &&
+           magicno[2]==0xff && magicno[3]==0xff)              rv = RFT_PCD;
+#endif
+
+#ifdef HAVE_G3
+  else if ((magicno[0]==  1 && magicno[1]==  1 &&
+            magicno[2]== 77 && magicno[3]==154 &&
+            magicno[4]==128 && magicno[5]==  0 &&
+            magicno[6]==  1 && magicno[7]== 77) ||
+            (rv == RFT_UNKNOWN &&
+             (highresfax || lowresfax || (strlen(fname)>3 && !strcmp(fname+strlen(fname)-3,".g3"))))) {
+               rv = RFT_G3;
+  }
+#endif
+
+#ifdef MACBINARY
+    /* Now we try to handle MacBinary files, but the method is VERY dirty... */
+    if (macbin_alrchk == True) {
+      macb_file = True;
+      break;
+    }
+
+    if (rv != RFT_UNKNOWN)
+      break;
+
+    /* Skip MACBSIZE and recheck */
+    macbin_alrchk = True;
+    magicno = probe + MACBSIZE;
+
+    if (n<MACBSIZE+30) return RFT_UNKNOWN;  /* less than 30 bytes long... */
+  }
+#endif
+  return rv;
+}
+
+
+
+/********************************/
+int ReadPicFile(char *fname, int ftype, PICINFO *pinfo, int quick)
+{
+  /* if quick is set, we're being called to generate icons, or something
+     like that.  We should load the image as quickly as possible.  Previously,
+     this affected only the LoadPS routine, which, if quick is set, only
+     generates the page file for the first page of the document.  Now it
+     also affects PCD, which loads only a thumbnail. */
+
+  int rv = 0;
+
+  /* the loaders keep their state in file statics, so only one file gets
+     decoded at a time, even with the prefetcher running */
+  LockLoaders();
+  TraceBegin("ReadPicFile", fname);
+
+  /* by default, most formats aren't multi-page */
+  pinfo->numpages = 1;
+  pinfo->pagebname[0] = '\0';
+
+  switch (ftype) {
+  case RFT_GIF:     rv = LoadGIF   (fname, pinfo);         break;
+  case RFT_PM:      rv = LoadPM    (fname, pinfo);         break;
+#ifdef HAVE_MGCSFX
+  case RFT_PBM:     rv = LoadPBM   (fname, pinfo, -1);     break;
+#else
+  case RFT_PBM:     rv = LoadPBM   (fname, pinfo);         break;
+#endif
+  case RFT_XBM:     rv = LoadXBM   (fname, pinfo);         break;
+  case RFT_SUNRAS:  rv = LoadSunRas(fname, pinfo);         break;
+  case RFT_BMP:     rv = LoadBMP   (fname, pinfo);         break;
+  case RFT_UTAHRLE: rv = LoadRLE   (fname, pinfo);         break;
+  case RFT_IRIS:    rv = LoadIRIS  (fname, pinfo);         break;
+  case RFT_PCX:     rv = LoadPCX   (fname, pinfo);         break;
+  case RFT_IFF:     rv = LoadIFF   (fname, pinfo);         break;
+  case RFT_TARGA:   rv = LoadTarga (fname, pinfo);         break;
+  case RFT_XPM:     rv = LoadXPM   (fname, pinfo);         break;
+  case RFT_XWD:     rv = LoadXWD   (fname, pinfo);         break;
+  case RFT_FITS:    rv = LoadFITS  (fname, pinfo, quick);  break;
+  case RFT_ZX:      rv = LoadZX    (fname, pinfo);         break; /* [JCE] */
+  case RFT_WBMP:    rv = LoadWBMP  (fname, pinfo);         break;
+
+#ifdef HAVE_PCD
+  /* if quick is switched on, use the smallest image size; don't ask the user */
+  case RFT_PCD:     rv = LoadPCD   (fname, pinfo, quick ? 0 : PcdSize);  break;
+#endif
+
+#ifdef HAVE_JPEG
+  case RFT_JFIF:    rv = LoadJFIF  (fname, pinfo, quick);  break;
+#endif
+
+#ifdef HAVE_JP2K
+  case RFT_JPC:     rv = LoadJPC   (fname, pinfo, quick);  break;
+  case RFT_JP2:     rv = LoadJP2   (fname, pinfo, quick);  break;
+#endif
+
+#ifdef HAVE_TIFF
+  case RFT_TIFF:    rv = LoadTIFF  (fname, pinfo, quick);  break;
+#endif
+
+#ifdef HAVE_PNG
+  case RFT_PNG:     rv = LoadPNG   (fname, pinfo);         break;
+#endif
+
+#ifdef HAVE_WEBP
+  case RFT_WEBP:     rv = LoadWEBP (fname, pinfo);       break;
+#endif
+
+#ifdef HAVE_PDS
+  case RFT_PDSVICAR: rv = LoadPDS  (fname, pinfo);         break;
+#endif
+
+#ifdef HAVE_G3
+  case RFT_G3:      rv = LoadG3    (fname, pinfo);         break;
+#endif
+
+#ifdef GS_PATH
+  case RFT_PS:      rv = LoadPS    (fname, pinfo, quick);  break;
+#endif
+
+#ifdef HAVE_MAG
+  case RFT_MAG:     rv = LoadMAG   (fname, pinfo);         break;
+#endif
+
+#ifdef HAVE_MAKI
+  case RFT_MAKI:    rv = LoadMAKI  (fname, pinfo);         break;
+#endif
+
+#ifdef HAVE_PIC
+  case RFT_PIC:     rv = LoadPIC   (fname, pinfo);         break;
+#endif
+
+#ifdef HAVE_PI
+  case RFT_PI:      rv = LoadPi    (fname, pinfo);         break;
+#endif
+
+#ifdef HAVE_PIC2
+  case RFT_PIC2:    rv = LoadPIC2  (fname, pinfo, quick);  break;
+#endif
+
+#ifdef HAVE_HIPS
+  case RFT_HIPS:    rv = LoadHIPS  (fname, pinfo);         break;
+#endif
+
+#ifdef HAVE_MGCSFX
+  case RFT_MGCSFX:  rv = LoadMGCSFX (fname, pinfo);        break;
+#endif
+
+  }
+
+  TraceBegin("reorient_image", (const char *) NULL);
+  reorient_image(pinfo);
+  TraceEnd("reorient_image");
+
+  ProbeRelease();     /* in case the loader didn't want ReadFileType()'s FILE */
+  TraceEnd("ReadPicFile");
+  UnlockLoaders();
+  return rv;
+}
+
+
+/********************************/
+void LoadOptsNow(LOADOPTS *lo)
+{
+  /* fills in 'lo' with the current settings of everything (other than
+     'quick', and pinfo->loadw,loadh) that changes what ReadPicFile() gives
+     back.  Looks at globals that belong to the main thread, so only the
+     main thread should call it.  Anyone else should be handed a copy (in
+     pinfo->opts) */
+
+  xvbzero((char *) lo, sizeof(LOADOPTS));
+
+  /* when we're locked into 8-bit mode, LoadJFIF() does the 24->8
+     conversion itself */
+  if (conv24MB.flags[CONV24_LOCK] && picType == PIC8) lo->conv24 = 1 + conv24;
+
+#ifdef HAVE_PCD
+  lo->pcdsize = PcdSize;
+#endif
+#ifdef HAVE_G3
+  lo->fax = lowresfax | (highresfax << 1);
+#endif
+
+  lo->gsres  = gsRes * ((gsGeomStr == NULL) ? dpiMult : 1);
+  lo->gsdev  = gsDev;
+  lo->gsgeom = gsGeomStr;
+}
+
+
+/********************************/
+int SameLoadOpts(LOADOPTS *lo1, LOADOPTS *lo2)
+{
+  return (lo1->conv24  == lo2->conv24  &&
+	  lo1->pcdsize == lo2->pcdsize &&
+	  lo1->fax     == lo2->fax     &&
+	  lo1->gsres   == lo2->gsres   &&
+	  strcmp(lo1->gsdev ? lo1->gsdev : "", lo2->gsdev ? lo2->gsdev : "") == 0 &&
+	  strcmp(lo1->gsgeom ? lo1->gsgeom : "", lo2->gsgeom ? lo2->gsgeom : "") == 0);
+}
+
+/********************************/
+char *QuoteFileName(char *safe_name, const char *orig_name, int max_len)
+{
+  /* Returns a quoted version of orig_name safe for use in command lines. */
+  /* The return value is safe_name to simplify use in sprintf calls. */
+  /* safe_name should be at least 3 * length(orig_name) + 4 */
+  /* Use XV_MAXQUOTEDPATHLEN */
+
+  int i, len;
+
+  if (max_len < 10) {
+    fprintf(stderr, "Error quoting file name\n");
+    Quit(1);
+    return NULL;
+  }
+
+  len = 0;
+  safe_name[ len++ ] = XV_SINGLE_QUOTE;
+  i = 0;
+  while (orig_name[i] != '\0' && len + 4 < max_len) {
+    if (orig_name[i] == XV_SINGLE_QUOTE) {
+      if (len < max_len) safe_name[ len++ ] = XV_SINGLE_QUOTE;
+      while (orig_name[i] == XV_SINGLE_QUOTE && len + 4 < max_len) {
+        if (len < max_len) safe_name[ len++ ] = '\\';
+        if (len < max_len) safe_name[ len++ ] = XV_SINGLE_QUOTE;
+        i++;
+      }
+      if (len < max_len) safe_name[ len++ ] = XV_SINGLE_QUOTE;
+    } else {
+      if (len < max_len) safe_name[ len++ ] = orig_name[ i ];
+      i++;
+    }
+  }
+
+  safe_name[ len++ ] = XV_SINGLE_QUOTE;
+  safe_name[ len ] = '\0';
+
+  return safe_name;
+}
+
+/********************************/
+int UncompressFile(char *name, char *uncompname, int filetype)
+{
+  /* returns '1' on success, with name of uncompressed file in uncompname
+     returns '0' on failure */
+
+  int rv;
+
+  TraceBegin("UncompressFile", name);
+  rv = doUncompress(name, uncompname, filetype);
+  TraceEnd("UncompressFile");
+  return rv;
+}
+
+
+/********************************/
+static int doUncompress(char *name, char *uncompname, int filetype)
+{
+  char namez[128], *fname, buf[ 512 + 2 * XV_MAXQUOTEDPATHLEN ];
+  char quoted_name[ XV_MAXQUOTEDPATHLEN ], quoted_uncompname[ XV_MAXQUOTEDPATHLEN ];
+#ifndef USE_MKSTEMP
+  int tmpfd;
+#endif
+
+  /* do it ourselves, if we can.  The programs are the fallback */
+  if (MemUncompress(name, uncompname)) return 1;
+
+  fname = name;
+  namez[0] = '\0';
+
+
+#if !defined(VMS) && !defined(GUNZIP)
+  /* see if compressed file name ends with '.Z'.  If it *doesn't* we need
+     temporarily rename it so it *does*, uncompress it, and rename *back*
+     to what it was.  necessary because uncompress doesn't handle files
+     that don't end with '.Z' */
+
+  if (strlen(name) >= (size_t) 2            &&
+      strcmp(name + strlen(name)-2,".Z")!=0 &&
+      strcmp(name + strlen(name)-2,".z")!=0) {
+    strcpy(namez, name);
+    strcat(namez,".Z");
+
+    if (rename(name, namez) < 0) {
+      sprintf(buf, "Error renaming '%s' to '%s':  %s",
+	      name, namez, ERRSTR(errno));
+      ErrPopUp(buf, "\nBummer!");
+      return 0;
+    }
+
+    fname = namez;
+  }
+#endif   /* not VMS and not GUNZIP */
+
+
+#ifndef VMS
+  sprintf(uncompname, "%s/xvuXXXXXX", tmpdir);
+#else
+  strcpy(uncompname, "[]xvuXXXXXX");
+#endif
+
+#ifdef USE_MKSTEMP
+  close(mkstemp(uncompname));
+#else
+  mktemp(uncompname);
+  tmpfd = open(uncompname,O_WRONLY|O_CREAT|O_EXCL,S_IRWUSR);
+  if (tmpfd < 0) FatalError("UncompressFile(): can't create temporary file");
+  close(tmpfd);
+#endif
+
+  /* FIXME: need to replace any ticks in filename (with the
+   * ugly sequence '\"'\"' because backslash won't work inside
+   * single quotes) before calling system().  Maybe one of the
+   * exec() variants would be better...
+   */
+  /* QuoteFileName handles single quotes.
+   * It also adds the outer quotes for flexibility for more efficient quoting or other operating systems.
+   */
+  buf[0] = '\0';
+#ifndef VMS
+  if (filetype == RFT_COMPRESS)
+    sprintf(buf,"%s -c %s > %s", UNCOMPRESS, QuoteFileName(quoted_name, fname, XV_MAXQUOTEDPATHLEN), QuoteFileName(quoted_uncompname, uncompname, XV_MAXQUOTEDPATHLEN));
+# ifdef BUNZIP2
+  else if (filetype == RFT_BZIP2)
+    sprintf(buf,"%s -c %s > %s", BUNZIP2, QuoteFileName(quoted_name, fname, XV_MAXQUOTEDPATHLEN), QuoteFileName(quoted_uncompname, uncompname, XV_MAXQUOTEDPATHLEN));
+# endif
+# ifdef XZ
+  else if (filetype == RFT_XZ)
+    sprintf(buf,"%s -c %s > %s", XZ, QuoteFileName(quoted_name, fname, XV_MAXQUOTEDPATHLEN), QuoteFileName(quoted_uncompname, uncompname, XV_MAXQUOTEDPATHLEN));
+# endif
+#else /* it IS VMS */
+  /* QuoteFileName currently doesn't know the quote rules for VMS */
+  /* VMS uses double quotes around the file name. */
+  /* Use two double quotes for an embedded double quote. */
+  /* It might depend if the CLI is DCL or a shell. */
+# ifdef GUNZIP
+  sprintf(buf,"%s '%s' '%s'", UNCOMPRESS, fname, uncompname);
+# else
+  sprintf(buf,"%s '%s'", UNCOMPRESS, fname);
+# endif
+#endif
+
+  SetISTR(ISTR_INFO, "Uncompressing '%s'...", BaseName(fname));
+#ifndef VMS
+  if (system(buf))
+#else
+  if (!system(buf))
+#endif
+  {
+    SetISTR(ISTR_INFO, "Unable to uncompress '%s'.", BaseName(fname));
+    Warning();
+    return 0;
+  }
+
+#ifndef VMS
+  /* if we renamed the file to end with a .Z for the sake of 'uncompress',
+     rename it back to what it once was... */
+
+  if (strlen(namez)) {
+    if (rename(namez, name) < 0) {
+      sprintf(buf, "Error renaming '%s' to '%s':  %s",
+	      namez, name, ERRSTR(errno));
+      ErrPopUp(buf, "\nBummer!");
+    }
+  }
+#else
+  /*
+    sprintf(buf,"Rename %s %s", fname, uncompname);
+    SetISTR(ISTR_INFO,"Renaming '%s'...", fname);
+    if (!system(buf)) {
+    SetISTR(ISTR_INFO,"Unable to rename '%s'.", fname);
+    Warning();
+    return 0;
+    }
+   */
+#endif /* not VMS */
+
+  return 1;
+}
+
+
+#ifdef MACBINARY
+/********************************/
+int RemoveMacbinary(src, dst)
+     char *src, *dst;
+{
+  char buffer[8192]; /* XXX */
+  int n, eof;
+#ifndef USE_MKSTEMP
+  int tmpfd;
+#endif
+  FILE *sfp, *dfp;
+
+  sprintf(dst, "%s/xvmXXXXXX", tmpdir);
+#ifdef USE_MKSTEMP
+  close(mkstemp(dst));
+#else
+  mktemp(dst);
+  tmpfd = open(dst,O_WRONLY|O_CREAT|O_EXCL,S_IRWUSR);
+  if (tmpfd < 0) FatalError("RemoveMacbinary(): can't create temporary file");
+#endif
+
+  SetISTR(ISTR_INFO, "Removing MacBinary...");
+
+  sfp = xv_fopen(src, "r");
+#ifdef USE_MKSTEMP
+  dfp = xv_fopen(dst, "w");
+#else
+  dfp = fdopen(tmpfd, "w");
+#endif
+  if (!sfp || !dfp) {
+    SetISTR(ISTR_INFO, "Unable to remove a InfoFile header form '%s'.", src);
+    Warning();
+    return 0;
+  }
+  fseek(sfp, MACBSIZE, SEEK_SET);
+  while ((n = fread(buffer, 1, sizeof(buffer), sfp)) == 8192) /* XXX */
+    fwrite(buffer, 1, n, dfp);
+  if ((eof = feof(sfp)))
+    fwrite(buffer, 1, n, dfp);
+  fclose(sfp);
+  fflush(dfp);
+  fclose(dfp);
+#ifndef USE_MKSTEMP
+  close(tmpfd);
+#endif
+  if (!eof) {
+    SetISTR(ISTR_INFO, "Unable to remove a InfoFile header form '%s'.", src);
+    Warning();
+    return 0;
+  }
+
+  return 1;
+}
+#endif
+
+
+/********************************/
+void KillPageFiles(char *bname, int numpages)
+{
+  /* deletes any page files (numbered 1 through numpages) that might exist */
+  char tmp[128];
+  int  i;
+
+  if (strlen(bname) == 0) return;   /* no page files */
+
+  for (i=1; i<=numpages; i++) {
+    sprintf(tmp, "%s%d", bname, i);
+    unlink(tmp);
+  }
+
+  /* GRR 20070506:  basename file doesn't go away, at least on Linux and for
+   *   GIF and TIFF images, so explicitly unlink() it, too */
+  unlink(bname);
+}
@@ -38,14 +38,6 @@ static void wincp 		PARM ((int, int, byte *, byte *));
 int start24bitAlg 		PARM ((byte **, byte **));
 void end24bitAlg 		PARM ((byte *, byte *));
 void saveOrigPic 		PARM ((void));
-void printUTime 		PARM ((char *));
-
-#undef TIMING_TEST
-
-#ifdef TIMING_TEST
-#include <sys/time.h>
-#include <sys/resource.h>
-#endif
 
 /************************/
 void
@@ -313,8 +305,6 @@ doMEKOmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int se
     register int xmax, ymax;
     MKT *mt;
 
-    printUTime ("start of MEKOmask.");
-
     XV_UNUSED(h);
 
     xmax = selw / 16;
@@ -324,6 +314,8 @@ doMEKOmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int se
     if (mt == NULL)
 	return;
 
+    TraceBegin ("MEKOmask", (const char *) NULL);
+
     for (i = 0; i < xmax * ymax; i++)
     {
 	ProgressMeter (1, (xmax * ymax) - 1, i, "MEKOmask");
@@ -348,7 +340,7 @@ doMEKOmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int se
     }
 
     free (mt);
-    printUTime ("end of MEKOmask.");
+    TraceEnd ("MEKOmask");
 }
 
 static void
@@ -437,7 +429,7 @@ doCPmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int selw
     register int xmax, ymax;
     CPS *cps;
 
-    printUTime ("start of CPmask.");
+    TraceBegin ("CPmask", (const char *) NULL);
 
     XV_UNUSED(h);
     xmax = selw / 8;
@@ -458,7 +450,7 @@ doCPmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int selw
     }
 
     free (cps);
-    printUTime ("end of CPmask.");
+    TraceEnd ("CPmask");
 }
 
 static void
@@ -509,7 +501,7 @@ doFLmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int selw
     register int i;
     register int *ar, xmax, ymax;
 
-    printUTime ("start of FLMASK.");
+    TraceBegin ("FLmask", (const char *) NULL);
 
     XV_UNUSED(h);
 
@@ -532,7 +524,7 @@ doFLmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int selw
     }
 
     free (ar);
-    printUTime ("end of FLMASK.");
+    TraceEnd ("FLmask");
 }
 
 static int *
@@ -622,7 +614,7 @@ doColReverse (byte *pic24, int w, int h, byte *results, int selx, int sely, int
     register byte *rp;
     register int x, y;
 
-    printUTime ("start of Reverse.");
+    TraceBegin ("ColReverse", (const char *) NULL);
 
     XV_UNUSED(h);
 
@@ -649,7 +641,7 @@ doColReverse (byte *pic24, int w, int h, byte *results, int selx, int sely, int
 		*rp = *p24 ^ 0x80;
 	}
     }
-    printUTime ("end of Reverse.");
+    TraceEnd ("ColReverse");
 }
 
 /************************/
@@ -661,7 +653,7 @@ doQ0mask (byte *pic24, int w, int h, byte *results, int selx, int sely, int selw
     int x, y;
     int skip, y0, x0;
 
-    printUTime ("start of Q0mask.");
+    TraceBegin ("Q0mask", (const char *) NULL);
 
     XV_UNUSED(h);
 
@@ -684,7 +676,7 @@ doQ0mask (byte *pic24, int w, int h, byte *results, int selx, int sely, int selw
 	    rp[2] = (byte) ~ p24[skip + 2];
 	}
     }
-    printUTime ("end of Q0 MASK.");
+    TraceEnd ("Q0mask");
 }
 
 /************************/
@@ -695,7 +687,7 @@ doWINmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int sel
     register byte *rp;
     register int x, y;
 
-    printUTime ("start of WIN mask.");
+    TraceBegin ("WINmask", (const char *) NULL);
 
     XV_UNUSED(h);
 
@@ -728,7 +720,7 @@ doWINmask (byte *pic24, int w, int h, byte *results, int selx, int sely, int sel
 	    wincp (15, 3, p24, rp);
 	}
     }
-    printUTime ("end of WIN mask.");
+    TraceEnd ("WINmask");
 }
 
 static void
@@ -747,7 +739,7 @@ doRGBchange (byte *pic24, int w, int h, byte *results, int selx, int sely, int s
     register byte *rp;
     register int x, y;
 
-    printUTime ("start of RGB change.");
+    TraceBegin ("RGBchange", (const char *) NULL);
 
     XV_UNUSED(h);
 
@@ -767,7 +759,7 @@ doRGBchange (byte *pic24, int w, int h, byte *results, int selx, int sely, int s
 	    *(rp + 2) = *(p24);
 	}
     }
-    printUTime ("end of Reverse.");
+    TraceEnd ("RGBchange");
 }
 
 
@@ -816,7 +808,7 @@ doMaskCr (byte *pic24, int w, int h, int selx, int sely, int selw, int selh)
     int x1, x2, y1, y2;
     int xp1, xp2, yp1, yp2;
 
-    printUTime ("start of MaskCrop.");
+    TraceBegin ("MaskCrop", (const char *) NULL);
 
     XV_UNUSED(h);
 
@@ -877,7 +869,7 @@ doMaskCr (byte *pic24, int w, int h, int selx, int sely, int selw, int selh)
 	}
 	if(xp2-xp1 > 4 && yp2-yp1 > 4 && xp1*xp2*yp1*yp2 != 0) break;
 
-	if (tmp <= 0.01) return;
+	if (tmp <= 0.01) { TraceEnd ("MaskCrop");  return; }
 	else tmp = tmp / 2.0;
     }
 
@@ -892,5 +884,5 @@ doMaskCr (byte *pic24, int w, int h, int selx, int sely, int selw, int selh)
     /* crop1(x1,y1,x2,y2,0);  <-- DO_CROP  */
     MaskSelect (x1, x2, y1, y2);
 
-    printUTime ("end of MaskSearch.");
+    TraceEnd ("MaskCrop");
 }
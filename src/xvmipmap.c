@@ -0,0 +1,197 @@
+/*
+ * xvmipmap.c - a pyramid of successively halved copies of 'cpic'
+ *
+ *  Contains:
+ *            byte *PyramidLevel(dwide, dhigh, &lwide, &lhigh, &is24)
+ *            void  FreePyramid()
+ *
+ * Smoothing or resampling a big cpic down to window size reads every pixel
+ * of cpic, every time the window size changes.  Instead, GenerateEpic()
+ * asks for the smallest pyramid level that's still at least as big as the
+ * epic it wants, and shrinks that.  Levels are built the first time
+ * they're needed, each one by 2x2 averaging of the one above it, and are
+ * thrown away (by FreePyramid()) whenever cpic changes.
+ *
+ * Level 0 is cpic itself.  The other levels are always 24-bit, even for
+ * PIC8 images, as averaging colormap indices makes no sense.  (For PIC8
+ * images, they're built using the 'desired' colormap, rMap,gMap,bMap, and
+ * so are also rebuilt whenever that changes.)
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+
+#define MAXLEVELS  24
+#define MINLEVSIZE 16       /* don't bother halving things smaller than this */
+
+
+typedef struct { byte *pic;
+		 int   w, h;
+	       } PYRLEVEL;
+
+/* passed to halveRows() */
+typedef struct { byte *src, *dst;
+		 int   sw, sh, dw;
+		 int   is24;
+		 byte *rmap, *gmap, *bmap;
+	       } HALVEJOB;
+
+
+static PYRLEVEL levels[MAXLEVELS];
+static int      nlevels = 0;            /* # of levels, including cpic */
+static byte    *pyrCpic = NULL;         /* the cpic that levels[] is of */
+static int      pyrType;
+static byte     pyrR[256], pyrG[256], pyrB[256];   /* PIC8:  colors used */
+
+static int  pyramidValid PARM((void));
+static int  addLevel     PARM((void));
+static void halveRows    PARM((void *, int, int));
+
+
+/***************************************************/
+byte *PyramidLevel(int dwide, int dhigh, int *lwide, int *lhigh, int *is24)
+{
+  /* returns the smallest level of the cpic pyramid that's at least
+     dwide*dhigh, building it if necessary.  Its size is returned in
+     lwide,lhigh.  'is24' is set if it's a 24-bit pic, otherwise it's an
+     8-bit pic (cpic itself) with colors rMap,gMap,bMap */
+
+  int i;
+
+  if (!pyramidValid()) {
+    FreePyramid();
+    pyrCpic = cpic;  pyrType = picType;
+    levels[0].pic = cpic;  levels[0].w = cWIDE;  levels[0].h = cHIGH;
+    nlevels = 1;
+
+    if (picType == PIC8) {
+      xvbcopy((char *) rMap, (char *) pyrR, (size_t) 256);
+      xvbcopy((char *) gMap, (char *) pyrG, (size_t) 256);
+      xvbcopy((char *) bMap, (char *) pyrB, (size_t) 256);
+    }
+  }
+
+  /* find the level, halving the last one as needed */
+  for (i=0; ; i++) {
+    if (i+1 == nlevels) {
+      if ((levels[i].w+1)/2 < dwide || (levels[i].h+1)/2 < dhigh) break;
+      if (levels[i].w < MINLEVSIZE || levels[i].h < MINLEVSIZE) break;
+      if (!addLevel()) break;
+    }
+
+    if (levels[i+1].w < dwide || levels[i+1].h < dhigh) break;
+  }
+
+  *lwide = levels[i].w;  *lhigh = levels[i].h;
+  *is24  = (i > 0 || picType == PIC24);
+
+  if (DEBUG && i) fprintf(stderr,"PyramidLevel(%d,%d):  level %d, %dx%d\n",
+			  dwide, dhigh, i, levels[i].w, levels[i].h);
+  return levels[i].pic;
+}
+
+
+/***************************************************/
+void FreePyramid(void)
+{
+  /* called whenever cpic is modified, or goes away */
+
+  int i;
+
+  for (i=1; i<nlevels; i++) free(levels[i].pic);
+  nlevels = 0;
+  pyrCpic = NULL;
+}
+
+
+/***************************************************/
+static int pyramidValid(void)
+{
+  if (!nlevels || pyrCpic != cpic || pyrType != picType ||
+      levels[0].w != cWIDE || levels[0].h != cHIGH) return 0;
+
+  if (picType == PIC8 && (xvbcmp((char *) rMap, (char *) pyrR, 256) ||
+			  xvbcmp((char *) gMap, (char *) pyrG, 256) ||
+			  xvbcmp((char *) bMap, (char *) pyrB, 256)))
+    return 0;
+
+  return 1;
+}
+
+
+/***************************************************/
+static int addLevel(void)
+{
+  /* builds level 'nlevels' from the one above it.  returns '0' on failure */
+
+  HALVEJOB  hj;
+  PYRLEVEL *src, *dst;
+
+  if (nlevels >= MAXLEVELS) return 0;
+
+  src = &levels[nlevels-1];
+  dst = &levels[nlevels];
+
+  dst->w = (src->w + 1) / 2;
+  dst->h = (src->h + 1) / 2;
+  dst->pic = (byte *) malloc((size_t) dst->w * dst->h * 3);
+  if (!dst->pic) return 0;
+
+  hj.src  = src->pic;  hj.sw = src->w;  hj.sh = src->h;
+  hj.dst  = dst->pic;  hj.dw = dst->w;
+  hj.is24 = (nlevels > 1 || picType == PIC24);
+  hj.rmap = rMap;  hj.gmap = gMap;  hj.bmap = bMap;
+
+  DoRowBands(dst->h, halveRows, (void *) &hj);
+
+  nlevels++;
+  return 1;
+}
+
+
+/***************************************************/
+static void halveRows(void *data, int y0, int y1)
+{
+  /* each dest pixel is the (rounded) average of the 2x2 block of source
+     pixels it covers.  On odd-sized sources, the last row/column of dest
+     pixels only cover 1 source row/column, and are averaged accordingly */
+
+  HALVEJOB *hj = (HALVEJOB *) data;
+  byte *dp, *s0, *s1;
+  int   i, j, k, sx0, sx1, bpp, sum[3];
+
+  bpp = (hj->is24) ? 3 : 1;
+
+  for (i=y0; i<y1; i++) {
+    if (y0 == 0 && (i&63) == 0) WaitCursor();
+
+    s0 = hj->src + (size_t) (2*i) * hj->sw * bpp;
+    s1 = (2*i+1 < hj->sh) ? s0 + hj->sw * bpp : s0;
+    dp = hj->dst + (size_t) i * hj->dw * 3;
+
+    for (j=0; j<hj->dw; j++) {
+      sx0 = 2*j;
+      sx1 = (sx0+1 < hj->sw) ? sx0+1 : sx0;  /* dup'd edge pixels still
+						 average out correctly */
+
+      if (hj->is24) {
+	for (k=0; k<3; k++)
+	  sum[k] = s0[sx0*3+k] + s0[sx1*3+k] + s1[sx0*3+k] + s1[sx1*3+k];
+      }
+      else {
+	sum[0] = hj->rmap[s0[sx0]] + hj->rmap[s0[sx1]] +
+	         hj->rmap[s1[sx0]] + hj->rmap[s1[sx1]];
+	sum[1] = hj->gmap[s0[sx0]] + hj->gmap[s0[sx1]] +
+	         hj->gmap[s1[sx0]] + hj->gmap[s1[sx1]];
+	sum[2] = hj->bmap[s0[sx0]] + hj->bmap[s0[sx1]] +
+	         hj->bmap[s1[sx0]] + hj->bmap[s1[sx1]];
+      }
+
+      *dp++ = (byte) ((sum[0] + 2) >> 2);
+      *dp++ = (byte) ((sum[1] + 2) >> 2);
+      *dp++ = (byte) ((sum[2] + 2) >> 2);
+    }
+  }
+}
@@ -12,6 +12,7 @@
  *     void   GenExpose(win, x, y, w, h);
  *     void   RemapKeyCheck(ks, buf, stlen)
  *     void   xvDestroyImage(XImage *);
+ *     void   xvPutImage(Drawable, GC, XImage *, sx, sy, dx, dy, w, h);
  *     void   DimRect(win, x, y, w, h, bg);
  *     void   Draw3dRect(win, x,y,w,h, inout, bwidth, hicol, locol);
  *     void   SetCropString()
@@ -43,6 +44,10 @@
 #  include <unistd.h>	/* getwd() */
 #endif
 
+/* the headless libxvcore (see xvcore.c) gets the non-X routines from
+   the end of this file, and its own versions of the rest */
+#ifndef XV_HEADLESS
+
 #include "bits/fc_left"
 #include "bits/fc_leftm"
 #include "bits/fc_left1"
@@ -379,6 +384,22 @@ void xvDestroyImage(XImage *image)
      systems.  Also, can be called with a NULL image pointer */
 
   if (image) {
+#ifdef HAVE_XSHM
+    if (image->obdata) {
+      /* image lives in a shared memory segment (see CreateShmImage()) */
+      XShmSegmentInfo *shminfo = (XShmSegmentInfo *) image->obdata;
+
+      XShmDetach(theDisp, shminfo);
+      XSync(theDisp, False);           /* make sure server is done with it */
+      shmdt(shminfo->shmaddr);
+      free(shminfo);
+      image->obdata = NULL;
+      image->data   = NULL;
+      XDestroyImage(image);
+      return;
+    }
+#endif
+
     /* free data by hand, since XDestroyImage is vague about it */
     if (image->data) free(image->data);
     image->data = NULL;
@@ -387,6 +408,31 @@ void xvDestroyImage(XImage *image)
 }
 
 
+/***********************************/
+void xvPutImage(Drawable d, GC gc, XImage *image, int sx, int sy, int dx, int dy, u_int w, u_int h)
+{
+  /* called in place of XPutImage().  Uses XShmPutImage() if 'image' was
+     created in a shared memory segment */
+
+#ifdef HAVE_XSHM
+  if (image->obdata) {
+    /* XPutImage() quietly clips the source rect to the image, but the
+       server rejects an XShmPutImage() that goes past its edges */
+    if (sx < 0) { w += sx;  dx -= sx;  sx = 0; }
+    if (sy < 0) { h += sy;  dy -= sy;  sy = 0; }
+    if (sx + (int) w > image->width)  w = image->width  - sx;
+    if (sy + (int) h > image->height) h = image->height - sy;
+    if ((int) w <= 0 || (int) h <= 0) return;
+
+    XShmPutImage(theDisp, d, gc, image, sx, sy, dx, dy, w, h, False);
+    return;
+  }
+#endif
+
+  XPutImage(theDisp, d, gc, image, sx, sy, dx, dy, w, h);
+}
+
+
 /***********************************/
 void DimRect(Window win, int x, int y, u_int w, u_int h, u_long bg)
 {
@@ -661,6 +707,8 @@ void WaitCursor(void)
   XWMHints xwmh;
   time_t   nowT;
 
+  if (!IsMainThread()) return;
+
   if (!waiting) {
     time(&lastwaittime);
     waiting=1;
@@ -771,6 +819,7 @@ static void set_cursors(Cursor mainc, Cursor otherc)
   if (mgcsfxW) XDefineCursor(theDisp, mgcsfxW, otherc);
 #endif
 }
+#endif /* !XV_HEADLESS */
 
 
 /***************************************************/
@@ -787,6 +836,7 @@ const char *BaseName(const char *fname)
 }
 
 
+#ifndef XV_HEADLESS
 /***************************************************/
 void DrawTempGauge(Window win, int x, int y, int w, int h, double ratio, u_long fg, u_long bg, u_long hi, u_long lo, const char *str)
 {
@@ -908,6 +958,8 @@ void ProgressMeter(int min, int max, int val, const char *str)
   Window        win;
   int           xpos,ypos;
 
+  if (!IsMainThread()) return;
+
   if (useroot) { win=ctrlW;  xpos=10;  ypos=3; }
           else { win=mainW;  xpos=5;   ypos=5; }
   if (!win) return;
@@ -950,6 +1002,7 @@ void XVDeletedFile(char *fullname)
 
   BRDeletedFile(fullname);
   DIRDeletedFile(fullname);
+  CacheForget(fullname);
 }
 
 
@@ -961,7 +1014,9 @@ void XVCreatedFile(char *fullname)
 
   BRCreatedFile(fullname);
   DIRCreatedFile(fullname);
+  CacheForget(fullname);
 }
+#endif /* !XV_HEADLESS */
 
 
 /***************************************************/
@@ -1093,6 +1148,14 @@ FILE *xv_fopen(const char *fname, const char *mode)
 {
   FILE *fp;
 
+  if (mode[0] == 'r' && !strchr(mode, '+')) {
+    /* still open from ReadFileType()? */
+    if ((fp = ProbeTake(fname)))   return fp;
+
+    /* something MemUncompress() has uncompressed into memory? */
+    if ((fp = MemFileOpen(fname))) return fp;
+  }
+
 #ifndef VMS
   fp = fopen(fname, mode);
 #else
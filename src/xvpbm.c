@@ -43,7 +43,7 @@ static int loadppm  PARM((FILE *, PICINFO *, int, int));
 static int loadpam  PARM((FILE *, PICINFO *, int, int));
 static int getint   PARM((FILE *, PICINFO *));
 static int getbit   PARM((FILE *, PICINFO *));
-static int getshort PARM((FILE *));
+static void getshorts PARM((BULKIN *, byte *, int, int));
 static int pbmError PARM((const char *, const char *));
 
 static const char *bname;
@@ -339,11 +339,14 @@ static int loadpgm(FILE *fp, PICINFO *pinfo, int raw, int maxv)
   }
   else { /* raw */
     if (holdmaxv>255) {
-      for (i=0, pix=pic8; i<h; i++) {
+      BULKIN bi;
+
+      BulkInit(&bi, fp, (size_t) npixels * 2, 0);
+      for (i=0, pix=pic8; i<h; i++, pix+=w) {
 	if ((i&0x3f)==0) WaitCursor();
-	for (j=0; j<w; j++, pix++)
-	  *pix = (byte) (getshort(fp) >> bitshift);
+	getshorts(&bi, pix, w, bitshift);
       }
+      BulkDone(&bi);
     }
     else {
 #ifdef FIX_PIPE_ERROR
@@ -416,11 +419,14 @@ static int loadppm(FILE *fp, PICINFO *pinfo, int raw, int maxv)
   }
   else { /* raw */
     if (holdmaxv>255) {
-      for (i=0, pix=pic24; i<h; i++) {
+      BULKIN bi;
+
+      BulkInit(&bi, fp, (size_t) bufsize * 2, 0);
+      for (i=0, pix=pic24; i<h; i++, pix+=w*3) {
 	if ((i&0x3f)==0) WaitCursor();
-	for (j=0; j<w*3; j++,pix++)
-	  *pix = (byte) (getshort(fp) >> bitshift);
+	getshorts(&bi, pix, w*3, bitshift);
       }
+      BulkDone(&bi);
     }
     else {
 #ifdef FIX_PIPE_ERROR
@@ -646,18 +652,18 @@ static int getint(FILE *fp, PICINFO *pinfo)
 
 
 /*******************************************/
-static int getshort(FILE *fp)
+static void getshorts(BULKIN *bi, byte *pix, int n, int bitshift)
 {
-  /* used in RAW mode to read 16-bit values */
+  /* used in RAW mode to read 16-bit values, a row at a time.  Stores the
+     next 'n' of them, >> bitshift, in 'pix' */
 
-  int c1, c2;
+  byte  *p;
+  size_t missing;
+  int    i, ngot, c1, c2;
 
-  c1 = getc(fp);
-  if (c1 == EOF) return 0;
-  c2 = getc(fp);
-  if (c2 == EOF) return 0;
-
-  numgot++;
+  missing = bi->missing;
+  p = BulkRow(bi, (size_t) n * 2);
+  ngot = n - (int) ((bi->missing - missing + 1) / 2);   /* ran out? */
 
   /* Sometime after 1995, NetPBM's ppm(5) man page was changed to say, "Each
    * sample is represented in pure binary by either 1 or 2 bytes.  If the
@@ -666,11 +672,18 @@ static int getshort(FILE *fp)
    * images created for viewing with all previous versions of XV, however,
    * so both approaches are left available as a compile-time option.  (Could
    * make it runtime-selectable, too, but unclear whether anybody cares.) */
+
+  for (i=0; i<ngot; i++, p+=2) {
+    c1 = p[0];  c2 = p[1];
 #ifdef ASSUME_RAW_PPM_LSB_FIRST  /* legacy approach */
-  return (c2 << 8) | c1;
+    pix[i] = (byte) (((c2 << 8) | c1) >> bitshift);
 #else /* MSB first */
-  return (c1 << 8) | c2;
+    pix[i] = (byte) (((c1 << 8) | c2) >> bitshift);
 #endif
+  }
+  for ( ; i<n; i++) pix[i] = 0;     /* truncated file */
+
+  numgot += ngot;
 }
 
 
@@ -61,7 +61,9 @@ static int gethuffdata();
 #define wcurfactor 16  /* Call WaitCursor() every n rows */
 
 static int  size;    /* Set by window routines */
+#ifndef XV_HEADLESS
 static int  leaveitup;/* Cleared by docmd() when OK or CANCEL pressed */
+#endif
 static int  goforit;  /* Set to 1 if OK or 0 if CANCEL */
 static FILE  *fp;
 static CBUTT  lutCB;
@@ -114,7 +116,7 @@ static  byte  Y[351] = {
   255
 };
 
-#ifndef NOSIGNAL
+#if !defined(NOSIGNAL) && !defined(XV_HEADLESS)
 extern XtAppContext context;
 #endif
 
@@ -251,6 +253,7 @@ data for 16 base:
   - for base, the 16base chroma planes are then halved
 */
 
+#ifndef XV_HEADLESS
   PCDSetParamOptions(bname);
   if (theSize == -1)
   {
@@ -278,6 +281,9 @@ data for 16 base:
     WaitCursor();
   }
   else
+#else
+  if (theSize == -1) theSize = 1;   /* nobody to ask.  base/4 it is */
+#endif
   {
     size = theSize;
     goforit = 1;
@@ -614,6 +620,7 @@ pcdError(const char *fname, const char *st)
 }
 
 
+#ifndef XV_HEADLESS
 /**** Stuff for PCDDialog box ****/
 
 #define TWIDE (380*dpiMult)
@@ -851,6 +858,7 @@ static void PCDSetParams(void)
   default: size = 0;     break;
   }
 }
+#endif /* !XV_HEADLESS */
 
 /*
  * Read the Huffman tables which consist of an unsigned byte # of entries
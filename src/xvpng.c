@@ -62,12 +62,14 @@
 #define CR       13   /* a.k.a. '\r' on ASCII machines */
 
 /*** local functions ***/
+#ifndef XV_HEADLESS
 static    void drawPD         PARM((int, int, int, int));
 static    void clickPD        PARM((int, int));
 static    void doCmd          PARM((int));
 static    void writePNG       PARM((void));
 static    int  WritePNG       PARM((FILE *, byte *, int, int, int,
                                     byte *, byte *, byte *, int));
+#endif
 
 static    void png_xv_error   PARM((png_structp png_ptr,
                                     png_const_charp message));
@@ -75,16 +77,18 @@ static    void png_xv_warning PARM((png_structp png_ptr,
                                     png_const_charp message));
 
 /*** local variables ***/
-static char *filename;
 static const char *fbasename;
-static int   colorType;
 static int   read_anything;
 static double Display_Gamma = DISPLAY_GAMMA;
 
+#ifndef XV_HEADLESS
+static char *filename;
+static int   colorType;
 static DIAL  cDial, gDial;
 static BUTT  pbut[P_NBUTTS];
 static CBUTT interCB;
 static CBUTT FdefCB, FnoneCB, FsubCB, FupCB, FavgCB, FPaethCB;
+#endif
 
 
 #ifdef PNG_NO_STDIO
@@ -115,6 +119,7 @@ png_default_write_data(png_structp png_ptr, png_bytep data, png_size_t length)
 #endif /* PNG_NO_STDIO */
 
 
+#ifndef XV_HEADLESS   /* libxvcore (see xvcore.c) only loads PNGs */
 /**************************************************************************/
 /* PNG SAVE DIALOG ROUTINES ***********************************************/
 /**************************************************************************/
@@ -875,6 +880,7 @@ int WritePNG(FILE *fp, byte *pic, int ptype, int w, int h, byte *rmap, byte *gma
 
   return 0;
 }
+#endif /* !XV_HEADLESS */
 
 
 /*******************************************/
@@ -891,6 +897,7 @@ int LoadPNG(char *fname, PICINFO *pinfo)
   int linesize, bufsize;
   int filesize;
   int pass;
+  int incr;
   int gray_to_rgb;
   size_t commentsize;
   /* temp storage vars for libpng15 migration */
@@ -938,6 +945,7 @@ int LoadPNG(char *fname, PICINFO *pinfo)
   if (setjmp(png_jmpbuf(png_ptr))) {
     fclose(fp);
     png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
+    IncrDone(read_anything);
     if (!read_anything) {
       if (pinfo->pic) {
         free(pinfo->pic);
@@ -1116,14 +1124,23 @@ int LoadPNG(char *fname, PICINFO *pinfo)
 
   /*png_start_read_image(png_ptr); -- causes a warning and seems to be unnecessary */
 
+  incr = IncrStart(pinfo);    /* show it as it comes in, if it's big */
+
   for (i = 0; i < pass; i++) {
     byte *p = pinfo->pic;
     for (j = 0; j < pinfo->h; j++) {
-      png_read_row(png_ptr, p, NULL);
+      /* if an interlaced image is being shown as it loads, have libpng fill
+         in the pixels that the later passes will set with copies of their
+         neighbors, rather than leaving them black.  Once all the passes are
+         done, the image is the same either way */
+      if (incr && pass > 1) png_read_row(png_ptr, NULL, p);
+                       else png_read_row(png_ptr, p, NULL);
       read_anything = 1;
       if ((j & 0x1f) == 0) WaitCursor();
+      if (pass == 1) IncrRows(j, j+1);
       p += linesize;
     }
+    if (pass > 1) IncrRows(0, pinfo->h);
   }
 
   png_read_end(png_ptr, info_ptr);
@@ -1154,6 +1171,7 @@ int LoadPNG(char *fname, PICINFO *pinfo)
 
   fclose(fp);
 
+  IncrDone(1);
   return 1;
 }
 
@@ -0,0 +1,366 @@
+/*
+ * xvprefetch.c - decodes the files on either side of the current one in
+ *                the background, so that 'Next' and 'Prev' don't have to
+ *
+ *  Contains:
+ *            void PrefetchNear(filenum)
+ *            void PrefetchWait(fname)
+ *            void LockLoaders()
+ *            void UnlockLoaders()
+ *
+ * Once openPic() has put file #n on the screen, it calls PrefetchNear(n),
+ * which queues up the next 'prefetchNext' and previous 'prefetchPrev' files
+ * in 'namelist'.  A background thread runs them through ReadPicFile() while
+ * the user is looking at #n, and puts the results in the image cache
+ * (xvcache.c), where openPic() will find them.  Before it looks, openPic()
+ * calls PrefetchWait(), in case the file it wants is still being decoded.
+ * Nothing is prefetched if the cache is turned off ('-cachemb 0').
+ *
+ * The loaders weren't written with threads in mind, and are full of file
+ * statics, so ReadPicFile() takes a lock, and only one file is ever being
+ * decoded at a time.  SetISTR(), WaitCursor() and ProgressMeter() do nothing
+ * when called from any thread but the main one.  Only formats whose loaders
+ * don't do anything else of that sort (popups, temp files, asking the user
+ * things) are prefetched:  JPEG and PNG.  Compressed files, pipes and stdin
+ * are always loaded the normal way.
+ *
+ * PrefetchNear() doesn't touch the files themselves.  Finding out whether
+ * they're there, what type they are, and whether they're already cached is
+ * all left to the background thread, as that can be slow on a network
+ * filesystem, and it'd hold up the main thread on every 'Next'.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+
+#define MAXPREFETCH  16      /* max # of files queued up at once */
+
+
+#ifdef HAVE_PTHREAD
+
+/* values of PFENTRY.state */
+#define PF_FREE     0
+#define PF_QUEUED   1
+#define PF_LOADING  2
+
+typedef struct { char    name[MAXPATHLEN];   /* full path */
+		 char    alt[MAXPATHLEN];    /* used if 'name' can't be read */
+		 char    file[MAXPATHLEN];   /* whichever it was */
+		 int     ftype;              /* RFT_* */
+		 int     state;              /* PF_* */
+		 int     prio;               /* lower numbers get loaded first */
+		 off_t   size;               /* the file, before it was loaded */
+		 time_t  mtime;
+		 int     loadw, loadh;       /* as openPic() will want it */
+		 LOADOPTS opts;              /* ditto */
+	       } PFENTRY;
+
+static void    *prefetchMain  PARM((void *));
+static int      wantFile      PARM((int, PFENTRY *));
+static int      probeEntry    PARM((PFENTRY *));
+static PFENTRY *findEntry     PARM((const char *));
+static PFENTRY *nextJob       PARM((void));
+
+static pthread_mutex_t pfLock   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  workCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  doneCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  loadCond = PTHREAD_COND_INITIALIZER;
+
+static PFENTRY   pf[MAXPREFETCH];
+static int       pfStarted = 0;      /* background thread is running */
+
+static pthread_t loadOwner;          /* LockLoaders() state */
+static int       loadDepth = 0;
+
+#endif /* HAVE_PTHREAD */
+
+
+/***************************************************/
+void PrefetchNear(int filenum)
+{
+  /* called after file #filenum has been displayed.  Forgets about anything
+     queued that isn't next to it any more, and queues up whatever is */
+
+#ifdef HAVE_PTHREAD
+  static PFENTRY want[MAXPREFETCH];    /* big, and only the main thread */
+  PFENTRY *e;
+  int      i, j, k, nwant, nnext, nprev;
+
+  if (cacheMB <= 0) return;
+
+  nnext = prefetchNext;  nprev = prefetchPrev;
+  if (nnext + nprev > MAXPREFETCH) {
+    nnext = (MAXPREFETCH * nnext) / (nnext + nprev);
+    nprev = MAXPREFETCH - nnext;
+  }
+
+  /* work out what we'd like, in order, without holding the lock.  Nearest
+     first, and 'next' before 'prev', since that's what gets hit most.  Some
+     of it may not be there, or be cached already.  prefetchMain() finds
+     that out */
+
+  nwant = 0;
+  for (k=1; k<=nnext || k<=nprev; k++) {
+    if (k<=nnext && wantFile(filenum+k, &want[nwant])) nwant++;
+    if (k<=nprev && wantFile(filenum-k, &want[nwant])) nwant++;
+  }
+
+
+  pthread_mutex_lock(&pfLock);
+
+  for (i=0; i<MAXPREFETCH; i++) {
+    if (pf[i].state == PF_QUEUED) pf[i].state = PF_FREE;
+  }
+
+  for (j=0; j<nwant; j++) {
+    e = findEntry(want[j].name);
+    if (e) continue;                 /* being loaded right now */
+
+    for (i=0; i<MAXPREFETCH && pf[i].state != PF_FREE; i++);
+    if (i == MAXPREFETCH) break;
+
+    e = &pf[i];
+    xvbcopy((char *) &want[j], (char *) e, sizeof(PFENTRY));
+    e->state = PF_QUEUED;
+    e->prio  = j;
+  }
+
+  if (!pfStarted && nwant) {
+    pthread_t      tid;
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&tid, &attr, prefetchMain, NULL) == 0) pfStarted = 1;
+    pthread_attr_destroy(&attr);
+  }
+
+  pthread_cond_signal(&workCond);
+  pthread_mutex_unlock(&pfLock);
+
+#else
+  XV_UNUSED(filenum);
+#endif /* HAVE_PTHREAD */
+}
+
+
+/***************************************************/
+void PrefetchWait(char *fname)
+{
+  /* called by openPic() before it looks in the cache for 'fname'.  If it's
+     being decoded in the background, waits for it to be finished.  If it's
+     just queued up, takes it off the queue, as openPic() is about to load
+     it itself */
+
+#ifdef HAVE_PTHREAD
+  PFENTRY *e;
+
+  if (!pfStarted) return;
+
+  pthread_mutex_lock(&pfLock);
+
+  e = findEntry(fname);
+  if (e && e->state == PF_QUEUED) e->state = PF_FREE;
+  else if (e) {
+    if (DEBUG) fprintf(stderr,"PrefetchWait(%s): waiting\n", fname);
+    while (e->state == PF_LOADING) pthread_cond_wait(&doneCond, &pfLock);
+  }
+
+  pthread_mutex_unlock(&pfLock);
+
+#else
+  XV_UNUSED(fname);
+#endif /* HAVE_PTHREAD */
+}
+
+
+/***************************************************/
+void LockLoaders(void)
+{
+  /* called by ReadPicFile().  Waits until no other thread is in a loader.
+     Can be nested (LoadPS() calls ReadPicFile() on the files gs makes) */
+
+#ifdef HAVE_PTHREAD
+  pthread_t self = pthread_self();
+
+  pthread_mutex_lock(&pfLock);
+  if (!loadDepth || !pthread_equal(loadOwner, self)) {
+    while (loadDepth) pthread_cond_wait(&loadCond, &pfLock);
+    loadOwner = self;
+  }
+  loadDepth++;
+  pthread_mutex_unlock(&pfLock);
+#endif
+}
+
+
+/***************************************************/
+void UnlockLoaders(void)
+{
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&pfLock);
+  if (--loadDepth == 0) pthread_cond_signal(&loadCond);
+  pthread_mutex_unlock(&pfLock);
+#endif
+}
+
+
+
+#ifdef HAVE_PTHREAD
+
+/***************************************************/
+static int wantFile(int filenum, PFENTRY *e)
+{
+  /* fills in the name(s) of 'e' for namelist[filenum], if it's something
+     we might be able to prefetch.  Returns '0' if not.  Resolves relative
+     names the same way openPic() does, except that the access() check is
+     left to probeEntry().  Doesn't look at the file */
+
+  char *name;
+
+  if (filenum < 0 || filenum >= numnames) return 0;
+  if (conv24MB.flags[CONV24_LOCK] && picType == PIC8) return 0;
+
+  name = namelist[filenum];
+  if (ISPIPE(name[0]) || strcmp(name, STDINSTR) == 0) return 0;
+
+  xvbzero((char *) e, sizeof(PFENTRY));
+
+  if (name[0] == '/') snprintf(e->name, sizeof(e->name), "%s", name);
+  else {
+    snprintf(e->name, sizeof(e->name), "%s/%s", initdir, name);
+    if (strlen(searchdir))
+      snprintf(e->alt, sizeof(e->alt), "%s/%s", searchdir, name);
+  }
+
+  /* the settings belong to the main thread, so the background thread
+     works from a copy of them, taken now */
+  ReducedLoadSize(&e->loadw, &e->loadh);
+  LoadOptsNow(&e->opts);
+  return 1;
+}
+
+
+/***************************************************/
+static int probeEntry(PFENTRY *e)
+{
+  /* called by prefetchMain().  Works out which file 'e' is, and fills in
+     e->file, size, mtime and ftype.  Returns '1' if it's a regular file, of
+     a type we prefetch, that isn't cached already */
+
+  struct stat st;
+
+  if (e->alt[0] && access(e->name, R_OK) != 0) strcpy(e->file, e->alt);
+  else strcpy(e->file, e->name);
+
+  if (stat(e->file, &st) != 0 || !S_ISREG(st.st_mode)) return 0;
+  e->size  = st.st_size;
+  e->mtime = st.st_mtime;
+
+  if (CacheHas(e->file, 0, 0, e->loadw, e->loadh, &e->opts)) return 0;
+
+  /* ProbeFile() doesn't keep files open for anyone but the main thread,
+     so this is opened again by ReadPicFile() */
+  e->ftype = ReadFileType(e->file);
+#ifdef HAVE_JPEG
+  if (e->ftype == RFT_JFIF) return 1;
+#endif
+#ifdef HAVE_PNG
+  if (e->ftype == RFT_PNG)  return 1;
+#endif
+
+  return 0;
+}
+
+
+/***************************************************/
+static PFENTRY *findEntry(const char *name)
+{
+  int i;
+
+  for (i=0; i<MAXPREFETCH; i++) {
+    if (pf[i].state != PF_FREE && (strcmp(pf[i].name, name) == 0 ||
+				   strcmp(pf[i].alt,  name) == 0))
+      return &pf[i];
+  }
+  return (PFENTRY *) NULL;
+}
+
+
+/***************************************************/
+static PFENTRY *nextJob(void)
+{
+  /* returns the queued entry that's wanted soonest, or NULL */
+
+  PFENTRY *e;
+  int      i;
+
+  for (i=0, e=(PFENTRY *) NULL; i<MAXPREFETCH; i++) {
+    if (pf[i].state == PF_QUEUED && (!e || pf[i].prio < e->prio)) e = &pf[i];
+  }
+  return e;
+}
+
+
+/***************************************************/
+static void *prefetchMain(void *arg)
+{
+  PFENTRY    *e;
+  PICINFO     pinfo;
+  struct stat st;
+  int         ok;
+
+  XV_UNUSED(arg);
+
+  while (1) {
+    pthread_mutex_lock(&pfLock);
+    while ((e = nextJob()) == NULL) pthread_cond_wait(&workCond, &pfLock);
+    e->state = PF_LOADING;
+    pthread_mutex_unlock(&pfLock);
+
+    /* 'e' won't be touched by anyone else while it's PF_LOADING */
+
+    ok = probeEntry(e);
+    if (ok) {
+      /* same setup as openPic() */
+      xvbzero((char *) &pinfo, sizeof(PICINFO));
+      pinfo.numpages    = 1;
+      pinfo.orientation = ORIENT_NONE;
+      pinfo.loadw       = e->loadw;
+      pinfo.loadh       = e->loadh;
+      pinfo.opts        = &e->opts;
+
+      ok = ReadPicFile(e->file, e->ftype, &pinfo, 0);
+
+      /* if the file changed while we were reading it, who knows what we
+	 got */
+      if (ok && (stat(e->file, &st) != 0 || st.st_size != e->size ||
+		 st.st_mtime != e->mtime)) {
+	if (pinfo.pic)      free(pinfo.pic);
+	if (pinfo.comment)  free(pinfo.comment);
+	if (pinfo.exifInfo) free(pinfo.exifInfo);
+	ok = 0;
+      }
+
+      if (ok) CachePut(e->file, 0, 0, &pinfo, CACHE_TAKE);
+
+      if (DEBUG) fprintf(stderr,"prefetch: %s %s\n", e->file,
+			 ok ? "loaded" : "failed");
+    }
+
+    pthread_mutex_lock(&pfLock);
+    e->state = PF_FREE;
+    pthread_cond_broadcast(&doneCond);
+    pthread_mutex_unlock(&pfLock);
+  }
+
+  return NULL;   /* never gets here */
+}
+
+#endif /* HAVE_PTHREAD */
@@ -0,0 +1,91 @@
+/*
+ * xvprobe.c - lets ReadFileType() and the loader share one open() of a file
+ *
+ *  Contains:
+ *            int   ProbeFile(fname, buf, bufsize)
+ *            FILE *ProbeTake(fname)
+ *            void  ProbeRelease()
+ *
+ * Loading a file used to mean opening it (at least) twice:  ReadFileType()
+ * opened it to look at the magic number, and closed it again, and then the
+ * loader opened it again, as did the MacBinary check.  On NFS and the like,
+ * every open() is a trip to the server.
+ *
+ * Now ReadFileType() calls ProbeFile(), which reads the first PROBESIZE
+ * bytes of the file, rewinds it, and holds on to it.  When the loader (or
+ * anything else) goes to open the same file for reading through xv_fopen(),
+ * it gets handed that FILE, rather than a new one.  Whoever takes it closes
+ * it, as they would've closed their own.  If nobody takes it, it's closed
+ * by the next ProbeFile(), or by ProbeRelease(), which ReadPicFile() calls
+ * when it's done, and openPic() calls if it didn't need to load the file.
+ *
+ * Only one file is held at a time, and only by the main thread.  Anything
+ * else (the prefetcher) just opens its files the normal way.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+
+static FILE *heldFP = (FILE *) NULL;
+static char  heldName[MAXPATHLEN];
+
+
+/***************************************************/
+int ProbeFile(char *fname, byte *buf, int bufsize)
+{
+  /* reads (up to) the first 'bufsize' bytes of fname into 'buf', and
+     returns how many there were.  Returns -1 if the file can't be opened */
+
+  FILE *fp;
+  int   n;
+
+  ProbeRelease();
+
+  fp = xv_fopen(fname, "r");
+  if (!fp) return -1;
+
+  n = fread(buf, (size_t) 1, (size_t) bufsize, fp);
+
+  if (!IsMainThread() || strlen(fname) >= sizeof(heldName) ||
+      fseek(fp, 0L, SEEK_SET) != 0) {
+    fclose(fp);
+  }
+  else {
+    clearerr(fp);
+    heldFP = fp;
+    strcpy(heldName, fname);
+  }
+
+  return n;
+}
+
+
+/***************************************************/
+FILE *ProbeTake(const char *fname)
+{
+  /* called by xv_fopen().  If fname is the file ProbeFile() is holding
+     open, returns it (at the start), and forgets about it */
+
+  FILE *fp;
+
+  if (!heldFP || !IsMainThread() || strcmp(fname, heldName) != 0)
+    return (FILE *) NULL;
+
+  fp = heldFP;
+  heldFP = (FILE *) NULL;
+
+  if (DEBUG > 1) fprintf(stderr,"ProbeTake(%s): reusing probe\n", fname);
+  return fp;
+}
+
+
+/***************************************************/
+void ProbeRelease(void)
+{
+  if (!heldFP || !IsMainThread()) return;
+
+  fclose(heldFP);
+  heldFP = (FILE *) NULL;
+}
@@ -15,6 +15,13 @@
 
 #include "xv.h"
 
+#ifdef GS_PATH
+static void buildCmdStr    PARM((char *, char *, char *, int, int));
+#endif
+
+
+#ifndef XV_HEADLESS   /* libxvcore (see xvcore.c) only has LoadPS() */
+
 #define PSWIDE (431*dpiMult)
 #define PSHIGH (350*dpiMult)
 #define PMAX   (200*dpiMult)    /* size of square that a 'page' has to fit into */
@@ -74,10 +81,6 @@ static void epsPreview     PARM((FILE *, byte *, int, int, int, int,
 				 byte *, byte *, byte *, int));
 static int  writeBWStip    PARM((FILE *, byte *, const char *, int, int, int));
 
-#ifdef GS_PATH
-static void buildCmdStr    PARM((char *, char *, char *, int, int));
-#endif
-
 
 /* local variables */
 static Window pageF;
@@ -1517,6 +1520,7 @@ static int writeBWStip(FILE *fp, byte *pic, const char *prompt, int w, int h, in
   return err;
 }
 
+#endif /* !XV_HEADLESS */
 
 
 
@@ -0,0 +1,457 @@
+/*
+ * xvresamp.c - high-quality (separable, windowed) resizing for XV
+ *
+ *  Contains:
+ *            byte *ResampleResize(src8, swide, shigh, dwide, dhigh,
+ *                               rmap, gmap, bmap, rdmap, gdmap, bdmap, maplen)
+ *            byte *Resample24(pic824, is24, swide, shigh, dwide, dhigh,
+ *                               rmap, gmap, bmap)
+ *            int   ResampleFilterNum(name)
+ *      const char *ResampleFilterName(filter)
+ *
+ * Resizes with one of a few well-known reconstruction filters (selected by
+ * 'resampFilter'), in two passes:  vertically, then horizontally.  The
+ * filter weights are computed (in floating point) once per source size,
+ * destination size and filter, and kept around as tables of fixed-point
+ * ints, so the per-pixel work is all integer multiply-adds, arranged so
+ * that the compiler can vectorize the inner loops.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+static pthread_mutex_t tabLock = PTHREAD_MUTEX_INITIALIZER;
+#  define LOCK_TAB()    pthread_mutex_lock(&tabLock)
+#  define UNLOCK_TAB()  pthread_mutex_unlock(&tabLock)
+#else
+#  define LOCK_TAB()
+#  define UNLOCK_TAB()
+#endif
+
+
+#ifndef M_PI
+#  define M_PI  3.1415926535897932385
+#endif
+
+#define WBITS   14               /* fractional bits in the weights */
+#define WONE    (1<<WBITS)
+
+
+/* one axis worth of weights:  dest pixel 'i' is the sum of
+   weights[i*ntaps + k] * src[start[i] + k], for k = 0..ntaps-1 */
+typedef struct { int  src, dst, filter;
+		 int  ntaps;
+		 int  refs;         /* Resample24()s using it right now */
+		 int *start;
+		 int *weights;
+	       } RSTAB;
+
+
+/* state shared by the threads working on one Resample24() */
+typedef struct { byte  *spic, *tpic, *dpic;   /* source, temp, dest pics */
+		 int    swide, shigh, dwide, dhigh;
+		 RSTAB *xtab, *ytab;
+		 int    failed;
+	       } RSJOB;
+
+
+static double filterSupport PARM((int));
+static double filterFunc    PARM((int, double));
+static double bcSpline      PARM((double, double, double));
+static double sinc          PARM((double));
+static RSTAB *getTable      PARM((int, int, int, int));
+static RSTAB *makeTable     PARM((int, int, int));
+static void   releaseTable  PARM((RSTAB *));
+static void   freeTable     PARM((RSTAB *));
+static void   resampYRows   PARM((void *, int, int));
+static void   resampXRows   PARM((void *, int, int));
+
+
+static const char *filterNames[RF_MAX] = { "Lanczos-3", "Mitchell",
+					   "Catmull-Rom" };
+static const char *filterArgs[RF_MAX]  = { "lanczos",   "mitchell",
+					   "catrom" };
+
+static RSTAB *tabCache[2] = { NULL, NULL };    /* last x and y tables */
+
+
+/***************************************************/
+int ResampleFilterNum(const char *name)
+{
+  /* returns the RF_* number for a filter name (as used by -resample), or
+     -1 if it isn't one */
+
+  int i;
+
+  for (i=0; i<RF_MAX; i++) {
+    if (!strncmp(name, filterArgs[i], strlen(name)) && strlen(name) >= 3)
+      return i;
+  }
+
+  return -1;
+}
+
+
+/***************************************************/
+const char *ResampleFilterName(int filter)
+{
+  if (filter < 0 || filter >= RF_MAX) filter = RF_LANCZOS3;
+  return filterNames[filter];
+}
+
+
+
+/***************************************************/
+byte *ResampleResize(byte *srcpic8, int swide, int shigh, int dwide, int dhigh,
+		     byte *rmap, byte *gmap, byte *bmap,
+		     byte *rdmap, byte *gdmap, byte *bdmap, int maplen)
+{
+  /* the 8-bit equivalent of Resample24(), a la SmoothResize().  Returns a
+     dwide*dhigh 8-bit pic, dithered using the colors in rdmap,gdmap,bdmap,
+     or NULL on failure */
+
+  byte *pic24, *pic8;
+
+  pic24 = Resample24(srcpic8, 0, swide, shigh, dwide, dhigh, rmap,gmap,bmap);
+
+  if (pic24) {
+    pic8 = DoColorDither(pic24, NULL, dwide, dhigh, rmap, gmap, bmap,
+			 rdmap, gdmap, bdmap, maplen);
+    free(pic24);
+    return pic8;
+  }
+
+  return (byte *) NULL;
+}
+
+
+
+/***************************************************/
+byte *Resample24(byte *pic824, int is24, int swide, int shigh, int dwide, int dhigh, byte *rmap, byte *gmap, byte *bmap)
+{
+  /* resizes pic824 (a swide*shigh 24-bit pic if 'is24', otherwise an 8-bit
+     pic with colormap rmap,gmap,bmap) into a dwide*dhigh 24-bit pic, using
+     the 'resampFilter' filter.
+
+     returns the new pic, or NULL on failure (malloc) */
+
+  RSJOB rj;
+  byte *spic, *tpic, *dpic;
+  int   i;
+
+  spic = pic824;
+  if (!is24) {    /* expand to 24 bits first.  simplifies the inner loops */
+    byte *sp, *pp;
+
+    spic = (byte *) malloc((size_t) swide * shigh * 3);
+    if (!spic) return NULL;
+
+    for (i=swide*shigh, sp=pic824, pp=spic; i>0; i--, sp++) {
+      *pp++ = rmap[*sp];  *pp++ = gmap[*sp];  *pp++ = bmap[*sp];
+    }
+  }
+
+  tpic = (byte *) malloc((size_t) swide * dhigh * 3);
+  dpic = (byte *) malloc((size_t) dwide * dhigh * 3);
+
+  rj.xtab = getTable(swide, dwide, resampFilter, 0);
+  rj.ytab = getTable(shigh, dhigh, resampFilter, 1);
+
+  if (!tpic || !dpic || !rj.xtab || !rj.ytab) {
+    if (rj.xtab) releaseTable(rj.xtab);
+    if (rj.ytab) releaseTable(rj.ytab);
+    if (spic != pic824) free(spic);
+    if (tpic) free(tpic);
+    if (dpic) free(dpic);
+    fprintf(stderr,"unable to malloc in 'Resample24()'\n");
+    return NULL;
+  }
+
+  rj.spic  = spic;   rj.tpic  = tpic;   rj.dpic  = dpic;
+  rj.swide = swide;  rj.shigh = shigh;  rj.dwide = dwide;  rj.dhigh = dhigh;
+  rj.failed = 0;
+
+  TraceBegin("Resample24", (const char *) NULL);
+
+  DoRowBands(dhigh, resampYRows, (void *) &rj);    /* spic -> tpic */
+  if (spic != pic824) free(spic);
+
+  if (!rj.failed) DoRowBands(dhigh, resampXRows, (void *) &rj); /* -> dpic */
+  free(tpic);
+
+  releaseTable(rj.xtab);
+  releaseTable(rj.ytab);
+
+  TraceEnd("Resample24");
+
+  if (rj.failed) { free(dpic);  dpic = NULL; }
+  return dpic;
+}
+
+
+/***************************************************/
+static void resampYRows(void *data, int y0, int y1)
+{
+  /* vertical pass.  Each dest row is a weighted sum of ntaps source rows,
+     so the inner loop runs along (contiguous) rows */
+
+  RSJOB *rj = (RSJOB *) data;
+  RSTAB *yt;
+  byte  *sp, *dp;
+  int   *acc, *wp;
+  int    i, k, x, v, rowlen;
+
+  yt = rj->ytab;
+  rowlen = rj->swide * 3;
+
+  acc = (int *) malloc(rowlen * sizeof(int));
+  if (!acc) { rj->failed = 1;  return; }
+
+  for (i=y0; i<y1; i++) {
+    if (y0 == 0) {
+      ProgressMeter(0, y1-1, i, "Resample");
+      if ((i&15) == 0) WaitCursor();
+    }
+
+    for (x=0; x<rowlen; x++) acc[x] = WONE/2;    /* for rounding */
+
+    wp = yt->weights + i * yt->ntaps;
+    sp = rj->spic + (size_t) yt->start[i] * rowlen;
+
+    for (k=0; k<yt->ntaps; k++, sp+=rowlen) {
+      int w = wp[k];
+      if (!w) continue;
+      for (x=0; x<rowlen; x++) acc[x] += w * sp[x];
+    }
+
+    dp = rj->tpic + (size_t) i * rowlen;
+    for (x=0; x<rowlen; x++) {
+      v = acc[x];
+      dp[x] = (v < 0) ? 0 : (v >= (256<<WBITS)) ? 255 : (byte) (v >> WBITS);
+    }
+  }
+
+  free(acc);
+}
+
+
+/***************************************************/
+static void resampXRows(void *data, int y0, int y1)
+{
+  /* horizontal pass */
+
+  RSJOB *rj = (RSJOB *) data;
+  RSTAB *xt;
+  byte  *sp, *dp;
+  int   *wp;
+  int    i, j, k, ntaps, r, g, b;
+
+  xt = rj->xtab;
+  ntaps = xt->ntaps;
+
+  for (i=y0; i<y1; i++) {
+    if (y0 == 0 && (i&15) == 0) WaitCursor();
+
+    dp = rj->dpic + (size_t) i * rj->dwide * 3;
+
+    for (j=0, wp=xt->weights; j<rj->dwide; j++, wp+=ntaps) {
+      sp = rj->tpic + ((size_t) i * rj->swide + xt->start[j]) * 3;
+      r = g = b = WONE/2;
+
+      for (k=0; k<ntaps; k++, sp+=3) {
+	r += wp[k] * sp[0];
+	g += wp[k] * sp[1];
+	b += wp[k] * sp[2];
+      }
+
+      *dp++ = (r < 0) ? 0 : (r >= (256<<WBITS)) ? 255 : (byte) (r >> WBITS);
+      *dp++ = (g < 0) ? 0 : (g >= (256<<WBITS)) ? 255 : (byte) (g >> WBITS);
+      *dp++ = (b < 0) ? 0 : (b >= (256<<WBITS)) ? 255 : (byte) (b >> WBITS);
+    }
+  }
+}
+
+
+
+/***************************************************/
+static RSTAB *getTable(int src, int dst, int filter, int slot)
+{
+  /* returns the weight table for the given sizes and filter.  The last
+     table built for each axis ('slot') is kept around, as the same sizes
+     come up over and over again (slideshows, re-smoothing after color
+     changes, etc.)  Give it back with releaseTable() when done with it.
+     A table that's pushed out of tabCache[] while someone's still using
+     it is freed by the last releaseTable() */
+
+  RSTAB *tab, *old;
+  int    i;
+
+  LOCK_TAB();
+  for (i=0; i<2; i++) {    /* other axis might have the same sizes */
+    tab = tabCache[(i) ? 1-slot : slot];
+    if (tab && tab->src == src && tab->dst == dst && tab->filter == filter) {
+      tab->refs++;
+      UNLOCK_TAB();
+      return tab;
+    }
+  }
+  UNLOCK_TAB();
+
+  tab = makeTable(src, dst, filter);
+  if (!tab) return tab;
+  tab->refs = 1;
+
+  LOCK_TAB();
+  old = tabCache[slot];
+  tabCache[slot] = tab;
+  if (old && old != tabCache[1-slot] && !old->refs) freeTable(old);
+  UNLOCK_TAB();
+
+  return tab;
+}
+
+
+/***************************************************/
+static void releaseTable(RSTAB *tab)
+{
+  LOCK_TAB();
+  tab->refs--;
+  if (!tab->refs && tab != tabCache[0] && tab != tabCache[1])
+    freeTable(tab);
+  UNLOCK_TAB();
+}
+
+
+/***************************************************/
+static RSTAB *makeTable(int src, int dst, int filter)
+{
+  RSTAB  *tab;
+  double  scale, fscale, support, center, *fw, sum;
+  int     i, j, k, lo, hi, start, ntaps, total, big, *wp;
+
+  scale   = (double) src / dst;
+  fscale  = (scale > 1.0) ? scale : 1.0;      /* widen filter to shrink */
+  support = filterSupport(filter) * fscale;
+
+  ntaps = (int) ceil(support) * 2 + 1;
+  if (ntaps > src) ntaps = src;
+
+  tab = (RSTAB *) malloc(sizeof(RSTAB));
+  fw  = (double *) malloc(ntaps * sizeof(double));
+  if (!tab || !fw) { if (tab) free(tab);  if (fw) free(fw);  return NULL; }
+
+  tab->src = src;  tab->dst = dst;  tab->filter = filter;
+  tab->ntaps   = ntaps;
+  tab->refs    = 0;
+  tab->start   = (int *) malloc(dst * sizeof(int));
+  tab->weights = (int *) calloc((size_t) dst * ntaps, sizeof(int));
+  if (!tab->start || !tab->weights) { free(fw);  freeTable(tab);  return NULL; }
+
+  for (i=0; i<dst; i++) {
+    /* pixel centers are at +0.5 */
+    center = (i + 0.5) * scale;
+    lo = (int) floor(center - support);   if (lo < 0)   lo = 0;
+    hi = (int) ceil (center + support);   if (hi > src) hi = src;
+
+    /* the table has a fixed # of taps, so slide the window back if it'd
+       run off the end of the source */
+    start = lo;
+    if (start + ntaps > src) start = src - ntaps;
+    if (hi > start + ntaps)  hi = start + ntaps;
+    tab->start[i] = start;
+
+    /* only weight the pixels that are actually there, then normalize */
+    for (k=0, sum=0.0; k<ntaps; k++) {
+      j = start + k;
+      fw[k] = 0.0;
+      if (j >= lo && j < hi)
+	fw[k] = filterFunc(filter, (j + 0.5 - center) / fscale);
+      sum += fw[k];
+    }
+
+    if (sum == 0.0) {   /* can't happen, but just in case... */
+      k = (int) center - start;
+      if (k < 0) k = 0;
+      if (k >= ntaps) k = ntaps-1;
+      fw[k] = sum = 1.0;
+    }
+
+    /* convert to fixed point, and dump the rounding error onto the biggest
+       weight, so that they add up to exactly WONE */
+    wp = tab->weights + i * ntaps;
+    for (k=total=big=0; k<ntaps; k++) {
+      wp[k] = (int) floor(fw[k] / sum * WONE + 0.5);
+      total += wp[k];
+      if (wp[k] > wp[big]) big = k;
+    }
+    wp[big] += WONE - total;
+  }
+
+  free(fw);
+  if (DEBUG) fprintf(stderr,"Resample: %d -> %d, %s, %d taps\n",
+		     src, dst, filterNames[filter], ntaps);
+  return tab;
+}
+
+
+/***************************************************/
+static void freeTable(RSTAB *tab)
+{
+  if (tab->start)   free(tab->start);
+  if (tab->weights) free(tab->weights);
+  free(tab);
+}
+
+
+/***************************************************/
+static double filterSupport(int filter)
+{
+  return (filter == RF_LANCZOS3) ? 3.0 : 2.0;
+}
+
+
+/***************************************************/
+static double filterFunc(int filter, double x)
+{
+  switch (filter) {
+  case RF_MITCHELL:  return bcSpline(x, 1.0/3.0, 1.0/3.0);
+  case RF_CATROM:    return bcSpline(x, 0.0, 0.5);
+  default:           /* RF_LANCZOS3 */
+    if (x <= -3.0 || x >= 3.0) return 0.0;
+    return sinc(x) * sinc(x / 3.0);
+  }
+}
+
+
+/***************************************************/
+static double bcSpline(double x, double B, double C)
+{
+  /* Mitchell & Netravali's two-parameter family of cubic filters */
+
+  if (x < 0.0) x = -x;
+
+  if (x < 1.0)
+    return ((12.0 - 9.0*B - 6.0*C) * x*x*x +
+	    (-18.0 + 12.0*B + 6.0*C) * x*x +
+	    (6.0 - 2.0*B)) / 6.0;
+
+  if (x < 2.0)
+    return ((-B - 6.0*C) * x*x*x +
+	    (6.0*B + 30.0*C) * x*x +
+	    (-12.0*B - 48.0*C) * x +
+	    (8.0*B + 24.0*C)) / 6.0;
+
+  return 0.0;
+}
+
+
+/***************************************************/
+static double sinc(double x)
+{
+  if (x == 0.0) return 1.0;
+  x *= M_PI;
+  return sin(x) / x;
+}
@@ -31,6 +31,7 @@ void MakeRootPic(void)
   unsigned int rpixw, rpixh;
 
   killRootPix();
+  UntileEpic();      /* the root pixmap needs all of it */
 
   rmode = rootMode;
   /* if eWIDE,eHIGH == dispWIDE,dispHIGH just use 'normal' mode to save mem */
@@ -68,35 +69,35 @@ void MakeRootPic(void)
 
 
   if (rmode == RM_NORMAL || rmode == RM_TILE) {
-    XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, 0,0,
+    xvPutImage(tmpPix, theGC, theImage, 0,0, 0,0,
 	      (u_int) eWIDE, (u_int) eHIGH);
   }
 
   else if (rmode == RM_MIRROR || rmode == RM_IMIRROR) {
     /* quadrant 2 */
-    XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, 0,0,
+    xvPutImage(tmpPix, theGC, theImage, 0,0, 0,0,
 	      (u_int) eWIDE, (u_int) eHIGH);
     if (epic == NULL) FatalError("epic == NULL in RM_MIRROR code...\n");
 
     /* quadrant 1 */
-    FlipPic(epic, eWIDE, eHIGH, 0);   /* flip horizontally */
+    FlipPic(epic, picType, eWIDE, eHIGH, 0);   /* flip horizontally */
     CreateXImage();
-    XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, eWIDE,0,
+    xvPutImage(tmpPix, theGC, theImage, 0,0, eWIDE,0,
 	      (u_int) eWIDE, (u_int) eHIGH);
 
     /* quadrant 4 */
-    FlipPic(epic, eWIDE, eHIGH, 1);   /* flip vertically */
+    FlipPic(epic, picType, eWIDE, eHIGH, 1);   /* flip vertically */
     CreateXImage();
-    XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, eWIDE,eHIGH,
+    xvPutImage(tmpPix, theGC, theImage, 0,0, eWIDE,eHIGH,
 	      (u_int) eWIDE, (u_int) eHIGH);
 
     /* quadrant 3 */
-    FlipPic(epic, eWIDE, eHIGH, 0);   /* flip horizontally */
+    FlipPic(epic, picType, eWIDE, eHIGH, 0);   /* flip horizontally */
     CreateXImage();
-    XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, 0,eHIGH,
+    xvPutImage(tmpPix, theGC, theImage, 0,0, 0,eHIGH,
 	      (u_int) eWIDE, (u_int) eHIGH);
 
-    FlipPic(epic, eWIDE, eHIGH, 1);   /* flip vertically  (back to orig) */
+    FlipPic(epic, picType, eWIDE, eHIGH, 1);   /* flip vertically  (back to orig) */
     CreateXImage();                   /* put back to original state */
   }
 
@@ -131,7 +132,7 @@ void MakeRootPic(void)
 	  if (y<0)           { offy = -y;  h1 -= offy;  y = 0; }
 	  if (y+h1>eHIGH)    { h1 = (eHIGH-y); }
 
-	  XPutImage(theDisp, tmpPix, theGC, theImage, offx, offy,
+	  xvPutImage(tmpPix, theGC, theImage, offx, offy,
 		    x, y, (u_int) w1, (u_int) h1);
 	}
       }
@@ -141,7 +142,7 @@ void MakeRootPic(void)
 
     else if (rmode == RM_UPLEFT) {
 
-      XPutImage(theDisp, tmpPix, theGC, theImage, 0,0, 0,0,
+      xvPutImage(tmpPix, theGC, theImage, 0,0, 0,0,
 		(u_int) eWIDE, (u_int) eHIGH);
     }
 
@@ -165,7 +166,7 @@ void MakeRootPic(void)
 
     /* draw the image centered on top of the background */
     if ((rmode != RM_CENTILE) && (rmode != RM_UPLEFT))
-      XPutImage(theDisp, tmpPix, theGC, theImage, 0,0,
+      xvPutImage(tmpPix, theGC, theImage, 0,0,
 		((int) dispWIDE-eWIDE)/2, ((int) dispHIGH-eHIGH)/2,
 		(u_int) eWIDE, (u_int) eHIGH);
   }
@@ -183,12 +184,12 @@ void MakeRootPic(void)
       y = eHIGH - ((dispHIGH/2)%eHIGH); /* Starting point in picture to copy */
       ay = 0;    /* Vertical anchor point */
       while (ay < dispHIGH) {
-	XPutImage(theDisp, tmpPix, theGC, theImage, 0,y,
+	xvPutImage(tmpPix, theGC, theImage, 0,y,
 		  0,ay, (u_int) eWIDE, (u_int) eHIGH);
 	ay += eHIGH - y;
 	y = 0;
 	if (rmode == RM_ECMIRR) {
-	  FlipPic(epic, eWIDE, eHIGH, 1);   flipv = !flipv;
+	  FlipPic(epic, picType, eWIDE, eHIGH, 1);   flipv = !flipv;
 	  CreateXImage();
 	}
       }
@@ -200,12 +201,12 @@ void MakeRootPic(void)
       x = eWIDE - ((dispWIDE/2)%eWIDE); /* Starting point in picture to copy */
       ax = 0;    /* Horizontal anchor point */
       while (ax < dispWIDE) {
-	XPutImage(theDisp, tmpPix, theGC, theImage, x,0,
+	xvPutImage(tmpPix, theGC, theImage, x,0,
 		  ax,0, (u_int) eWIDE, (u_int) eHIGH);
 	ax += eWIDE - x;
 	x = 0;
 	if (rmode == RM_ECMIRR) {
-	  FlipPic(epic, eWIDE, eHIGH, 0);   fliph = !fliph;
+	  FlipPic(epic, picType, eWIDE, eHIGH, 0);   fliph = !fliph;
 	  CreateXImage();
 	}
       }
@@ -221,19 +222,19 @@ void MakeRootPic(void)
 	x = eWIDE - ((dispWIDE/2)%eWIDE);/* Starting point in picture to cpy */
 	ax = 0;    /* Horizontal anchor point */
 	while (ax < dispWIDE) {
-	  XPutImage(theDisp, tmpPix, theGC, theImage, x,y,
+	  xvPutImage(tmpPix, theGC, theImage, x,y,
 		    ax,ay, (u_int) eWIDE, (u_int) eHIGH);
 	  if (rmode == RM_ECMIRR) {
-	    FlipPic(epic, eWIDE, eHIGH, 0);  fliph = !fliph;
+	    FlipPic(epic, picType, eWIDE, eHIGH, 0);  fliph = !fliph;
 	    CreateXImage();
 	  }
 	  ax += eWIDE - x;
 	  x = 0;
 	}
 	if (rmode == RM_ECMIRR) {
-	  FlipPic(epic, eWIDE, eHIGH, 1);   flipv = !flipv;
+	  FlipPic(epic, picType, eWIDE, eHIGH, 1);   flipv = !flipv;
 	  if (fliph) {   /* leftmost image is always non-hflipped */
-	    FlipPic(epic, eWIDE, eHIGH, 0);   fliph = !fliph;
+	    FlipPic(epic, picType, eWIDE, eHIGH, 0);   fliph = !fliph;
 	  }
 	  CreateXImage();
 	}
@@ -243,8 +244,8 @@ void MakeRootPic(void)
     }
 
     /* put epic back to normal */
-    if (fliph) FlipPic(epic, eWIDE, eHIGH, 0);
-    if (flipv) FlipPic(epic, eWIDE, eHIGH, 1);
+    if (fliph) FlipPic(epic, picType, eWIDE, eHIGH, 0);
+    if (flipv) FlipPic(epic, picType, eWIDE, eHIGH, 1);
   }
 
 
@@ -0,0 +1,567 @@
+/*
+ * xvsimd.c - vectorized versions of some of XV's innermost pixel loops
+ *
+ *  Contains:
+ *            int  SIMDFeatures()
+ *            void PackRGB24(src, dst, npix, fmt)
+ *            void UnpackRGB24(src, dst, npix, fmt)
+ *            void OrderedDither332(src, dst, npix, y)
+ *
+ * Everything in here has a plain C version, which is what gets used on
+ * non-x86 machines, with compilers that don't do GCC-style 'target'
+ * attributes, or if XV_NO_SIMD is defined.  Otherwise the fastest version
+ * the CPU can actually run is picked at runtime.  All versions produce
+ * bit-identical results.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && !defined(XV_NO_SIMD)
+#  define XV_X86_SIMD
+#  include <immintrin.h>
+#  define TARGET(isa) __attribute__((target(isa)))
+#endif
+
+
+static int  cpuFeatures = -1;
+
+static int  getCPUFeatures PARM((void));
+static void packRGB24_C    PARM((byte *, byte *, int, int));
+#ifdef XV_X86_SIMD
+static void packRGB24_SSSE3 PARM((byte *, byte *, int, int));
+static void packRGB24_AVX2  PARM((byte *, byte *, int, int));
+#endif
+static void unpackRGB24_C  PARM((byte *, byte *, int, int));
+#ifdef XV_X86_SIMD
+static void unpackRGB24_SSSE3 PARM((byte *, byte *, int, int));
+#endif
+static void ordered332_C   PARM((byte *, byte *, int, int, int));
+#ifdef XV_X86_SIMD
+static void ordered332_SSSE3 PARM((byte *, byte *, int, int));
+#endif
+
+
+/* 8x8 Bayer matrix, for OrderedDither332() */
+static const byte bayer8[8][8] = {
+  {  0, 32,  8, 40,  2, 34, 10, 42 },
+  { 48, 16, 56, 24, 50, 18, 58, 26 },
+  { 12, 44,  4, 36, 14, 46,  6, 38 },
+  { 60, 28, 52, 20, 62, 30, 54, 22 },
+  {  3, 35, 11, 43,  1, 33,  9, 41 },
+  { 51, 19, 59, 27, 49, 17, 57, 25 },
+  { 15, 47,  7, 39, 13, 45,  5, 37 },
+  { 63, 31, 55, 23, 61, 29, 53, 21 } };
+
+/* the threshold for a Bayer entry, spread evenly over 0..254 */
+#define THRESH(b)  ((b)*4 + 2)
+
+/* x/255, for 0 <= x < 65535, without dividing */
+#define DIV255(x)  (((x) + 1 + ((x) >> 8)) >> 8)
+
+
+/* expands an 8-bit channel value to 10 bits the same way the X server does
+   it for XAllocColor() on a 30-bit visual (ie, replicate the top bits) */
+#define X10(c)  (((c)<<2) | ((c)>>6))
+
+
+/***************************************************/
+static int getCPUFeatures(void)
+{
+  int features = 0;
+
+#ifdef XV_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) features |= SIMD_SSSE3;
+  if (__builtin_cpu_supports("avx2"))  features |= SIMD_AVX2;
+#endif
+
+  if (getenv("XV_NOSIMD")) features = 0;   /* for comparison purposes */
+
+  if (DEBUG) fprintf(stderr,"SIMD features: %s%s\n",
+		     (features & SIMD_SSSE3) ? "SSSE3 " : "",
+		     (features & SIMD_AVX2)  ? "AVX2"   : "");
+  return features;
+}
+
+
+/***************************************************/
+int SIMDFeatures(void)
+{
+  /* returns the SIMD_* bits for the instruction set extensions that the
+     kernels in here may use on this CPU */
+
+  if (cpuFeatures < 0) cpuFeatures = getCPUFeatures();
+  return cpuFeatures;
+}
+
+
+
+/***************************************************/
+void PackRGB24(byte *src, byte *dst, int npix, int fmt)
+{
+  /* converts 'npix' 24-bit RGB triples from 'src' into 'fmt' (one of the
+     PACK_* TrueColor pixel layouts) pixels, stored in 'dst' in native
+     byte order.  Used for the common cases in Pic24ToXImage(). */
+
+  int features = SIMDFeatures();
+
+#ifdef XV_X86_SIMD
+  if (features & SIMD_AVX2)  { packRGB24_AVX2 (src, dst, npix, fmt);  return; }
+  if (features & SIMD_SSSE3) { packRGB24_SSSE3(src, dst, npix, fmt);  return; }
+#else
+  XV_UNUSED(features);
+#endif
+
+  packRGB24_C(src, dst, npix, fmt);
+}
+
+
+/***************************************************/
+void UnpackRGB24(byte *src, byte *dst, int npix, int fmt)
+{
+  /* converts 'npix' pixels in the raw file layout 'fmt' (one of the
+     UNPACK_* layouts) from 'src' into RGB triples in 'dst'.  Used by the
+     loaders of uncompressed formats, a row at a time.  There's no AVX2
+     version, as this is limited by memory bandwidth long before that */
+
+  int features = SIMDFeatures();
+
+#ifdef XV_X86_SIMD
+  if (features & SIMD_SSSE3) {
+    unpackRGB24_SSSE3(src, dst, npix, fmt);
+    return;
+  }
+#else
+  XV_UNUSED(features);
+#endif
+
+  unpackRGB24_C(src, dst, npix, fmt);
+}
+
+
+/***************************************************/
+void OrderedDither332(byte *src, byte *dst, int npix, int y)
+{
+  /* dithers a row of 'npix' RGB triples (row 'y' of the image, starting at
+     its left edge) to 3 bits of red, 3 of green, and 2 of blue, with an
+     8x8 ordered dither, and stores the RRRGGGBB values in 'dst'.  Every
+     pixel is done on its own, so rows can be done in any order */
+
+  int features = SIMDFeatures();
+
+#ifdef XV_X86_SIMD
+  if (features & SIMD_SSSE3) {
+    ordered332_SSSE3(src, dst, npix, y);
+    return;
+  }
+#else
+  XV_UNUSED(features);
+#endif
+
+  ordered332_C(src, dst, npix, 0, y);
+}
+
+
+/***************************************************/
+static void packRGB24_C(byte *src, byte *dst, int npix, int fmt)
+{
+  CARD32 *dp32;
+  CARD16 *dp16;
+  int     i, r, g, b;
+
+  dp32 = (CARD32 *) dst;  dp16 = (CARD16 *) dst;
+
+  switch (fmt) {
+  case PACK_XRGB32:
+    for (i=0; i<npix; i++) {
+      r = *src++;  g = *src++;  b = *src++;
+      *dp32++ = ((CARD32) r << 16) | ((CARD32) g << 8) | (CARD32) b;
+    }
+    break;
+
+  case PACK_XBGR32:
+    for (i=0; i<npix; i++) {
+      r = *src++;  g = *src++;  b = *src++;
+      *dp32++ = ((CARD32) b << 16) | ((CARD32) g << 8) | (CARD32) r;
+    }
+    break;
+
+  case PACK_RGB565:
+    for (i=0; i<npix; i++) {
+      r = *src++;  g = *src++;  b = *src++;
+      *dp16++ = (CARD16) (((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3));
+    }
+    break;
+
+  case PACK_RGB30:
+    for (i=0; i<npix; i++) {
+      r = *src++;  g = *src++;  b = *src++;
+      *dp32++ = ((CARD32) X10(r) << 20) | ((CARD32) X10(g) << 10) |
+		 (CARD32) X10(b);
+    }
+    break;
+  }
+}
+
+
+
+/***************************************************/
+static void unpackRGB24_C(byte *src, byte *dst, int npix, int fmt)
+{
+  int i;
+
+  switch (fmt) {
+  case UNPACK_BGR24:
+    for (i=0; i<npix; i++, src+=3, dst+=3) {
+      dst[0] = src[2];  dst[1] = src[1];  dst[2] = src[0];
+    }
+    break;
+
+  case UNPACK_BGRX32:
+    for (i=0; i<npix; i++, src+=4, dst+=3) {
+      dst[0] = src[2];  dst[1] = src[1];  dst[2] = src[0];
+    }
+    break;
+
+  case UNPACK_XBGR32:
+    for (i=0; i<npix; i++, src+=4, dst+=3) {
+      dst[0] = src[3];  dst[1] = src[2];  dst[2] = src[1];
+    }
+    break;
+
+  case UNPACK_XRGB32:
+    for (i=0; i<npix; i++, src+=4, dst+=3) {
+      dst[0] = src[1];  dst[1] = src[2];  dst[2] = src[3];
+    }
+    break;
+  }
+}
+
+
+
+/***************************************************/
+static void ordered332_C(byte *src, byte *dst, int npix, int x, int y)
+{
+  /* 'x' is the column 'src' starts at */
+
+  const byte *bp;
+  int         i, t, r, g, b;
+
+  bp = bayer8[y & 7];
+
+  for (i=0; i<npix; i++, x++, src+=3) {
+    t = THRESH(bp[x & 7]);
+    r = src[0]*7 + t;  r = DIV255(r);
+    g = src[1]*7 + t;  g = DIV255(g);
+    b = src[2]*3 + t;  b = DIV255(b);
+    *dst++ = (byte) ((r << 5) | (g << 2) | b);
+  }
+}
+
+
+
+#ifdef XV_X86_SIMD
+
+/* The x86 kernels all start by spreading four RGB triples into four 32-bit
+ * 0x00RRGGBB (or 0x00BBGGRR) lanes with a single pshufb, and then build
+ * the final pixels from that with shifts and masks.  A 16-byte load
+ * covers 5 1/3 pixels of which only 4 are used, so the loops stop early
+ * enough that no load reaches past the end of 'src'; the C version does
+ * whatever is left over.
+ */
+
+#define SHUF_XRGB  2,1,0,-128,  5,4,3,-128,  8,7,6,-128,  11,10,9,-128
+#define SHUF_XBGR  0,1,2,-128,  3,4,5,-128,  6,7,8,-128,  9,10,11,-128
+
+
+/***************************************************/
+TARGET("ssse3")
+static __inline__ __m128i pack565_128(__m128i x)
+{
+  /* 0x00RRGGBB lanes -> 565 pixels, sign-extended from the low 16 bits
+     so that packs_epi32 won't saturate them */
+
+  x = _mm_or_si128(_mm_or_si128(
+	_mm_and_si128(_mm_srli_epi32(x, 8), _mm_set1_epi32(0xf800)),
+	_mm_and_si128(_mm_srli_epi32(x, 5), _mm_set1_epi32(0x07e0))),
+	_mm_and_si128(_mm_srli_epi32(x, 3), _mm_set1_epi32(0x001f)));
+
+  return _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+}
+
+
+/***************************************************/
+TARGET("ssse3")
+static __inline__ __m128i pack30_128(__m128i x)
+{
+  /* 0x00RRGGBB lanes -> 30-bit pixels */
+
+  __m128i m, r, g, b;
+
+  m = _mm_set1_epi32(0xff);
+  r = _mm_and_si128(_mm_srli_epi32(x, 16), m);
+  g = _mm_and_si128(_mm_srli_epi32(x,  8), m);
+  b = _mm_and_si128(x, m);
+
+  r = _mm_or_si128(_mm_slli_epi32(r, 2), _mm_srli_epi32(r, 6));
+  g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 6));
+  b = _mm_or_si128(_mm_slli_epi32(b, 2), _mm_srli_epi32(b, 6));
+
+  return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 20),
+				   _mm_slli_epi32(g, 10)), b);
+}
+
+
+/***************************************************/
+TARGET("ssse3")
+static void packRGB24_SSSE3(byte *src, byte *dst, int npix, int fmt)
+{
+  __m128i shuf, lo, hi;
+  int     i;
+
+  if (fmt == PACK_XBGR32) shuf = _mm_setr_epi8(SHUF_XBGR);
+                     else shuf = _mm_setr_epi8(SHUF_XRGB);
+
+  i = 0;
+  switch (fmt) {
+  case PACK_XRGB32:
+  case PACK_XBGR32:
+    for ( ; i+6 <= npix; i+=4, src+=12, dst+=16) {
+      lo = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) src), shuf);
+      _mm_storeu_si128((__m128i *) dst, lo);
+    }
+    break;
+
+  case PACK_RGB565:
+    for ( ; i+10 <= npix; i+=8, src+=24, dst+=16) {
+      lo = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)  src),     shuf);
+      hi = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (src+12)), shuf);
+      lo = _mm_packs_epi32(pack565_128(lo), pack565_128(hi));
+      _mm_storeu_si128((__m128i *) dst, lo);
+    }
+    break;
+
+  case PACK_RGB30:
+    for ( ; i+6 <= npix; i+=4, src+=12, dst+=16) {
+      lo = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) src), shuf);
+      _mm_storeu_si128((__m128i *) dst, pack30_128(lo));
+    }
+    break;
+  }
+
+  if (i < npix) packRGB24_C(src, dst, npix - i, fmt);
+}
+
+
+/***************************************************/
+TARGET("ssse3")
+static void unpackRGB24_SSSE3(byte *src, byte *dst, int npix, int fmt)
+{
+  /* one pshufb per 16 bytes in.  The 16-byte stores write a little past
+     the pixels they're doing, which is fine as long as there's more to
+     come after them, so (as in packRGB24_SSSE3()) the loops stop early and
+     leave the end to the C version */
+
+  __m128i shuf;
+  int     i, ssize;
+
+#define Z -128
+  switch (fmt) {
+  case UNPACK_BGR24:
+    shuf  = _mm_setr_epi8(2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, 15);
+    ssize = 3;
+    break;
+  case UNPACK_BGRX32:
+    shuf  = _mm_setr_epi8(2,1,0, 6,5,4, 10,9,8, 14,13,12, Z,Z,Z,Z);
+    ssize = 4;
+    break;
+  case UNPACK_XBGR32:
+    shuf  = _mm_setr_epi8(3,2,1, 7,6,5, 11,10,9, 15,14,13, Z,Z,Z,Z);
+    ssize = 4;
+    break;
+  case UNPACK_XRGB32:
+    shuf  = _mm_setr_epi8(1,2,3, 5,6,7, 9,10,11, 13,14,15, Z,Z,Z,Z);
+    ssize = 4;
+    break;
+  default:
+    return;
+  }
+#undef Z
+
+  i = 0;
+  if (ssize == 3) {                      /* 5 pixels per 16 bytes */
+    for ( ; i+6 <= npix; i+=5, src+=15, dst+=15)
+      _mm_storeu_si128((__m128i *) dst,
+		       _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) src), shuf));
+  }
+  else {                                 /* 4 pixels per 16 bytes */
+    for ( ; i+6 <= npix; i+=4, src+=16, dst+=12)
+      _mm_storeu_si128((__m128i *) dst,
+		       _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) src), shuf));
+  }
+
+  if (i < npix) unpackRGB24_C(src, dst, npix - i, fmt);
+}
+
+
+/***************************************************/
+TARGET("avx2")
+static __inline__ __m256i load2x12(byte *p)
+{
+  /* loads 8 RGB triples, 4 into each 128-bit lane (vpshufb works in-lane) */
+
+  return _mm256_inserti128_si256(
+	   _mm256_castsi128_si256(_mm_loadu_si128((__m128i *) p)),
+	   _mm_loadu_si128((__m128i *) (p + 12)), 1);
+}
+
+
+/***************************************************/
+TARGET("avx2")
+static __inline__ __m256i pack565_256(__m256i x)
+{
+  /* see pack565_128() */
+
+  x = _mm256_or_si256(_mm256_or_si256(
+	_mm256_and_si256(_mm256_srli_epi32(x, 8), _mm256_set1_epi32(0xf800)),
+	_mm256_and_si256(_mm256_srli_epi32(x, 5), _mm256_set1_epi32(0x07e0))),
+	_mm256_and_si256(_mm256_srli_epi32(x, 3), _mm256_set1_epi32(0x001f)));
+
+  return _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+}
+
+
+/***************************************************/
+TARGET("avx2")
+static __inline__ __m256i pack30_256(__m256i x)
+{
+  /* see pack30_128() */
+
+  __m256i m, r, g, b;
+
+  m = _mm256_set1_epi32(0xff);
+  r = _mm256_and_si256(_mm256_srli_epi32(x, 16), m);
+  g = _mm256_and_si256(_mm256_srli_epi32(x,  8), m);
+  b = _mm256_and_si256(x, m);
+
+  r = _mm256_or_si256(_mm256_slli_epi32(r, 2), _mm256_srli_epi32(r, 6));
+  g = _mm256_or_si256(_mm256_slli_epi32(g, 2), _mm256_srli_epi32(g, 6));
+  b = _mm256_or_si256(_mm256_slli_epi32(b, 2), _mm256_srli_epi32(b, 6));
+
+  return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 20),
+					 _mm256_slli_epi32(g, 10)), b);
+}
+
+
+/***************************************************/
+TARGET("avx2")
+static void packRGB24_AVX2(byte *src, byte *dst, int npix, int fmt)
+{
+  __m256i shuf, lo, hi;
+  int     i;
+
+  if (fmt == PACK_XBGR32) shuf = _mm256_setr_epi8(SHUF_XBGR, SHUF_XBGR);
+                     else shuf = _mm256_setr_epi8(SHUF_XRGB, SHUF_XRGB);
+
+  i = 0;
+  switch (fmt) {
+  case PACK_XRGB32:
+  case PACK_XBGR32:
+    for ( ; i+10 <= npix; i+=8, src+=24, dst+=32) {
+      lo = _mm256_shuffle_epi8(load2x12(src), shuf);
+      _mm256_storeu_si256((__m256i *) dst, lo);
+    }
+    break;
+
+  case PACK_RGB565:
+    for ( ; i+18 <= npix; i+=16, src+=48, dst+=32) {
+      lo = _mm256_shuffle_epi8(load2x12(src),    shuf);
+      hi = _mm256_shuffle_epi8(load2x12(src+24), shuf);
+      lo = _mm256_packs_epi32(pack565_256(lo), pack565_256(hi));
+      /* packs works per lane: lo0-3 hi0-3 lo4-7 hi4-7.  Put it in order */
+      lo = _mm256_permute4x64_epi64(lo, 0xd8);
+      _mm256_storeu_si256((__m256i *) dst, lo);
+    }
+    break;
+
+  case PACK_RGB30:
+    for ( ; i+10 <= npix; i+=8, src+=24, dst+=32) {
+      lo = _mm256_shuffle_epi8(load2x12(src), shuf);
+      _mm256_storeu_si256((__m256i *) dst, pack30_256(lo));
+    }
+    break;
+  }
+
+  if (i < npix) packRGB24_SSSE3(src, dst, npix - i, fmt);
+}
+
+/***************************************************/
+TARGET("ssse3")
+static void ordered332_SSSE3(byte *src, byte *dst, int npix, int y)
+{
+  /* eight pixels at a time, with each component in a 16-bit lane.  The
+     two overlapping loads (at src and src+8) cover exactly 24 bytes, so
+     nothing is read past the end of the row.  Eight pixels starting at a
+     multiple of 8 always use the same row of thresholds */
+
+  const byte *bp;
+  __m128i     lo, hi, r, g, b, t, one, seven, three;
+  int         i;
+
+  bp    = bayer8[y & 7];
+  t     = _mm_setr_epi16(THRESH(bp[0]), THRESH(bp[1]), THRESH(bp[2]),
+			 THRESH(bp[3]), THRESH(bp[4]), THRESH(bp[5]),
+			 THRESH(bp[6]), THRESH(bp[7]));
+  one   = _mm_set1_epi16(1);
+  seven = _mm_set1_epi16(7);
+  three = _mm_set1_epi16(3);
+
+  for (i=0; i+8 <= npix; i+=8, src+=24, dst+=8) {
+    lo = _mm_loadu_si128((__m128i *)  src);
+    hi = _mm_loadu_si128((__m128i *) (src+8));
+
+    r = _mm_or_si128(
+	  _mm_shuffle_epi8(lo, _mm_setr_epi8(0,-128, 3,-128, 6,-128, 9,-128,
+					     12,-128, 15,-128, -128,-128,
+					     -128,-128)),
+	  _mm_shuffle_epi8(hi, _mm_setr_epi8(-128,-128, -128,-128, -128,-128,
+					     -128,-128, -128,-128, -128,-128,
+					     10,-128, 13,-128)));
+    g = _mm_or_si128(
+	  _mm_shuffle_epi8(lo, _mm_setr_epi8(1,-128, 4,-128, 7,-128, 10,-128,
+					     13,-128, -128,-128, -128,-128,
+					     -128,-128)),
+	  _mm_shuffle_epi8(hi, _mm_setr_epi8(-128,-128, -128,-128, -128,-128,
+					     -128,-128, -128,-128, 8,-128,
+					     11,-128, 14,-128)));
+    b = _mm_or_si128(
+	  _mm_shuffle_epi8(lo, _mm_setr_epi8(2,-128, 5,-128, 8,-128, 11,-128,
+					     14,-128, -128,-128, -128,-128,
+					     -128,-128)),
+	  _mm_shuffle_epi8(hi, _mm_setr_epi8(-128,-128, -128,-128, -128,-128,
+					     -128,-128, -128,-128, 9,-128,
+					     12,-128, 15,-128)));
+
+    /* level = (c*n + t) / 255, as DIV255() */
+    r = _mm_add_epi16(_mm_mullo_epi16(r, seven), t);
+    g = _mm_add_epi16(_mm_mullo_epi16(g, seven), t);
+    b = _mm_add_epi16(_mm_mullo_epi16(b, three), t);
+    r = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(r, one),
+				     _mm_srli_epi16(r, 8)), 8);
+    g = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(g, one),
+				     _mm_srli_epi16(g, 8)), 8);
+    b = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(b, one),
+				     _mm_srli_epi16(b, 8)), 8);
+
+    r = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 5), _mm_slli_epi16(g, 2)),
+		     b);
+    _mm_storel_epi64((__m128i *) dst, _mm_packus_epi16(r, r));
+  }
+
+  if (i < npix) ordered332_C(src, dst, npix - i, i, y);
+}
+
+#endif /* XV_X86_SIMD */
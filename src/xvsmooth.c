@@ -10,18 +10,50 @@
  *                                rdisp, gdisp, bdisp, maplen)
  *            byte *Do332ColorDither(pic24, pic8, w, h, rmap,gmap,bmap,
  *                                rdisp, gdisp, bdisp, maplen)
+ *            byte *FSDither(inpic, intype, w, h, rmap,gmap,bmap, bval,wval)
  */
 
 #include "copyright.h"
 
 #include "xv.h"
 
-static int smoothX  PARM((byte *, byte *, int, int, int, int, int,
-			  byte *, byte *, byte *));
-static int smoothY  PARM((byte *, byte *, int, int, int, int, int,
-			  byte *, byte *, byte *));
-static int smoothXY PARM((byte *, byte *, int, int, int, int, int,
-			  byte *, byte *, byte *));
+/* state shared by the threads working on one Smooth24() */
+typedef struct { byte *pic24, *pic824;
+		 int   is24, swide, shigh, dwide, dhigh;
+		 byte *rmap, *gmap, *bmap;
+		 int  *xtab1, *xtab2, *xtab3;   /* per-column tables */
+		 int  *rowtab;                  /* see rowGroups() */
+		 int   failed;                  /* a band couldn't malloc */
+	       } SMOOTHJOB;
+
+static int  smoothX        PARM((SMOOTHJOB *));
+static int  smoothY        PARM((SMOOTHJOB *));
+static int  smoothXY       PARM((SMOOTHJOB *));
+static void smoothExpRows  PARM((void *, int, int));
+static void smoothXRows    PARM((void *, int, int));
+static void smoothYRows    PARM((void *, int, int));
+static void smoothXYRows   PARM((void *, int, int));
+static int *rowGroups      PARM((int, int));
+
+/* state shared by the threads working on one DoColorDither() */
+typedef struct { byte  *pic24, *pic8, *newpic;
+		 int    w, h;
+		 byte  *rmap, *gmap, *bmap, *rdisp, *gdisp, *bdisp;
+		 int    maplen;
+		 short *cache;             /* see xvinvcmap.c */
+		 int   *lines;             /* ring of 'nbufs' rows of errors */
+		 int    nbufs;
+		 int    fserrmap[512];     /* -255 .. 0 .. +255 */
+		 int    failed;            /* a band couldn't malloc */
+	       } DITHJOB;
+
+#define DITHWAVEMIN  (256*1024)    /* pixels it takes to be worth threads */
+
+static void ditherLoadRow  PARM((DITHJOB *, int));
+static int  ditherClosest  PARM((DITHJOB *, int));
+static void invFillRows    PARM((void *, int, int));
+static void colorDitherRow PARM((void *, int, int, int));
+static void orderedRows    PARM((void *, int, int));
 
 
 /***************************************************/
@@ -61,35 +93,33 @@ byte *Smooth24(byte *pic824, int is24, int swide, int shigh, int dwide, int dhig
      returns a dwide*dhigh 24bit image, or NULL on failure (malloc) */
   /* rmap,gmap,bmap should be 'desired' colors */
 
-  byte *pic24, *pp;
-  int  *cxtab, *pxtab;
-  int   y1Off, cyOff;
-  int   ex, ey, cx, cy, px, py, apx, apy, x1, y1;
-  int   cA, cB, cC, cD;
-  int   pA, pB, pC, pD;
-  int   retval, bperpix;
+  /* every row of the output only depends on the input, so all of the
+     methods below are split into bands of rows, which are done by
+     DoRowBands() */
 
-  cA = cB = cC = cD = 0;
-  pp = pic24 = (byte *) malloc((size_t) (dwide * dhigh * 3));
+  SMOOTHJOB sj;
+  byte     *pic24;
+  int      *cxtab, *pxtab;
+  int       ex, retval;
+
+  pic24 = (byte *) malloc((size_t) (dwide * dhigh * 3));
   if (!pic24) {
     fprintf(stderr,"unable to malloc pic24 in 'Smooth24()'\n");
     return pic24;
   }
 
-  bperpix = (is24) ? 3 : 1;
-
-  /* decide which smoothing routine to use based on type of expansion */
-  if      (dwide <  swide && dhigh <  shigh)
-    retval = smoothXY(pic24, pic824, is24, swide, shigh, dwide, dhigh,
-		      rmap, gmap, bmap);
+  sj.pic24 = pic24;  sj.pic824 = pic824;  sj.is24 = is24;
+  sj.swide = swide;  sj.shigh = shigh;  sj.dwide = dwide;  sj.dhigh = dhigh;
+  sj.rmap  = rmap;   sj.gmap  = gmap;   sj.bmap  = bmap;
+  sj.xtab1 = sj.xtab2 = sj.xtab3 = sj.rowtab = NULL;
+  sj.failed = 0;
 
-  else if (dwide <  swide && dhigh >= shigh)
-    retval = smoothX (pic24, pic824, is24, swide, shigh, dwide, dhigh,
-		      rmap, gmap, bmap);
+  TraceBegin("Smooth24", (const char *) NULL);
 
-  else if (dwide >= swide && dhigh <  shigh)
-    retval = smoothY (pic24, pic824, is24, swide, shigh, dwide, dhigh,
-		      rmap, gmap, bmap);
+  /* decide which smoothing routine to use based on type of expansion */
+  if      (dwide <  swide && dhigh <  shigh) retval = smoothXY(&sj);
+  else if (dwide <  swide && dhigh >= shigh) retval = smoothX (&sj);
+  else if (dwide >= swide && dhigh <  shigh) retval = smoothY (&sj);
 
   else {
     /* dwide >= swide && dhigh >= shigh */
@@ -104,10 +134,12 @@ byte *Smooth24(byte *pic824, int is24, int swide, int shigh, int dwide, int dhig
          px = ((ex * swide * 128) / dwide) - (cx * 128) - 64; */
 
     cxtab = (int *) malloc(dwide * sizeof(int));
-    if (!cxtab) { free(pic24);  return NULL; }
+    if (!cxtab) { free(pic24);  TraceEnd("Smooth24");  return NULL; }
 
     pxtab = (int *) malloc(dwide * sizeof(int));
-    if (!pxtab) { free(pic24);  free(cxtab);  return NULL; }
+    if (!pxtab) {
+      free(pic24);  free(cxtab);  TraceEnd("Smooth24");  return NULL;
+    }
 
     for (ex=0; ex<dwide; ex++) {
       cxtab[ex] = (ex * swide) / dwide;
@@ -115,114 +147,165 @@ byte *Smooth24(byte *pic824, int is24, int swide, int shigh, int dwide, int dhig
 	           - (cxtab[ex] * 128) - 64;
     }
 
-    for (ey=0; ey<dhigh; ey++) {
-      byte *pptr, rA, gA, bA, rB, gB, bB, rC, gC, bC, rD, gD, bD;
+    sj.xtab1 = cxtab;  sj.xtab2 = pxtab;
+    DoRowBands(dhigh, smoothExpRows, (void *) &sj);
+
+    free(cxtab);
+    free(pxtab);
+    retval = 0;    /* okay */
+  }
+
+  TraceEnd("Smooth24");
+
+  if (retval || sj.failed) {    /* one of the Smooth**() methods failed */
+    free(pic24);
+    pic24 = (byte *) NULL;
+  }
+
+  return pic24;
+}
+
+
+
+/***************************************************/
+static void smoothExpRows(void *data, int y0, int y1)
+{
+  /* rows y0..y1-1 of the 'expand in both directions' case of Smooth24 */
+
+  SMOOTHJOB *sj = (SMOOTHJOB *) data;
+  byte *pic824, *pp, *rmap, *gmap, *bmap;
+  int  *cxtab, *pxtab;
+  int   is24, swide, shigh, dwide, dhigh;
+  int   y1Off, cyOff;
+  int   ex, ey, cx, cy, px, py, apx, apy, x1, yy1;
+  int   cA, cB, cC, cD;
+  int   pA, pB, pC, pD;
+  int   bperpix;
 
-      ProgressMeter(0, (dhigh)-1, ey, "Smooth");
+  pic824 = sj->pic824;  is24 = sj->is24;
+  swide  = sj->swide;   shigh = sj->shigh;
+  dwide  = sj->dwide;   dhigh = sj->dhigh;
+  rmap   = sj->rmap;    gmap  = sj->gmap;   bmap = sj->bmap;
+  cxtab  = sj->xtab1;   pxtab = sj->xtab2;
 
-      cy = (ey * shigh) / dhigh;
-      py = (((ey * shigh) * 128) / dhigh) - (cy * 128) - 64;
-      if (py<0) { y1 = cy-1;  if (y1<0) y1=0; }
-           else { y1 = cy+1;  if (y1>shigh-1) y1=shigh-1; }
+  cA = cB = cC = cD = 0;
+  bperpix = (is24) ? 3 : 1;
+  pp = sj->pic24 + y0 * dwide * 3;
 
-      cyOff = cy * swide * bperpix;    /* current line */
-      y1Off = y1 * swide * bperpix;    /* up or down one line, depending */
+  for (ey=y0; ey<y1; ey++) {
+    byte *pptr, rA, gA, bA, rB, gB, bB, rC, gC, bC, rD, gD, bD;
 
+    if (y0 == 0) {
+      ProgressMeter(0, y1-1, ey, "Smooth");
       if ((ey&15) == 0) WaitCursor();
+    }
 
-      for (ex=0; ex<dwide; ex++) {
-	rA = rB = rC = rD = gA = gB = gC = gD = bA = bB = bC = bD = 0;
+    cy = (ey * shigh) / dhigh;
+    py = (((ey * shigh) * 128) / dhigh) - (cy * 128) - 64;
+    if (py<0) { yy1 = cy-1;  if (yy1<0) yy1=0; }
+         else { yy1 = cy+1;  if (yy1>shigh-1) yy1=shigh-1; }
 
-	cx = cxtab[ex];
-	px = pxtab[ex];
+    cyOff = cy  * swide * bperpix;    /* current line */
+    y1Off = yy1 * swide * bperpix;    /* up or down one line, depending */
 
-	if (px<0) { x1 = cx-1;  if (x1<0) x1=0; }
-	     else { x1 = cx+1;  if (x1>swide-1) x1=swide-1; }
+    for (ex=0; ex<dwide; ex++) {
+      rA = rB = rC = rD = gA = gB = gC = gD = bA = bB = bC = bD = 0;
 
-	if (is24) {
-	  pptr = pic824 + y1Off + x1*bperpix;   /* corner pixel */
-	  rA = *pptr++;  gA = *pptr++;  bA = *pptr++;
+      cx = cxtab[ex];
+      px = pxtab[ex];
 
-	  pptr = pic824 + y1Off + cx*bperpix;   /* up/down center pixel */
-	  rB = *pptr++;  gB = *pptr++;  bB = *pptr++;
+      if (px<0) { x1 = cx-1;  if (x1<0) x1=0; }
+           else { x1 = cx+1;  if (x1>swide-1) x1=swide-1; }
 
-	  pptr = pic824 + cyOff + x1*bperpix;   /* left/right center pixel */
-	  rC = *pptr++;  gC = *pptr++;  bC = *pptr++;
+      if (is24) {
+	pptr = pic824 + y1Off + x1*bperpix;   /* corner pixel */
+	rA = *pptr++;  gA = *pptr++;  bA = *pptr++;
 
-	  pptr = pic824 + cyOff + cx*bperpix;   /* center pixel */
-	  rD = *pptr++;  gD = *pptr++;  bD = *pptr++;
-	}
-	else {  /* 8-bit picture */
-	  cA = pic824[y1Off + x1];   /* corner pixel */
-	  cB = pic824[y1Off + cx];   /* up/down center pixel */
-	  cC = pic824[cyOff + x1];   /* left/right center pixel */
-	  cD = pic824[cyOff + cx];   /* center pixel */
-	}
+	pptr = pic824 + y1Off + cx*bperpix;   /* up/down center pixel */
+	rB = *pptr++;  gB = *pptr++;  bB = *pptr++;
 
-	/* quick check */
-	if (!is24 && cA == cB && cB == cC && cC == cD) {
-	  /* set this pixel to the same color as in pic8 */
-	  *pp++ = rmap[cD];  *pp++ = gmap[cD];  *pp++ = bmap[cD];
+	pptr = pic824 + cyOff + x1*bperpix;   /* left/right center pixel */
+	rC = *pptr++;  gC = *pptr++;  bC = *pptr++;
+
+	pptr = pic824 + cyOff + cx*bperpix;   /* center pixel */
+	rD = *pptr++;  gD = *pptr++;  bD = *pptr++;
+      }
+      else {  /* 8-bit picture */
+	cA = pic824[y1Off + x1];   /* corner pixel */
+	cB = pic824[y1Off + cx];   /* up/down center pixel */
+	cC = pic824[cyOff + x1];   /* left/right center pixel */
+	cD = pic824[cyOff + cx];   /* center pixel */
+      }
+
+      /* quick check */
+      if (!is24 && cA == cB && cB == cC && cC == cD) {
+	/* set this pixel to the same color as in pic8 */
+	*pp++ = rmap[cD];  *pp++ = gmap[cD];  *pp++ = bmap[cD];
+      }
+
+      else {
+	/* compute weighting factors */
+	apx = abs(px);  apy = abs(py);
+	pA = (apx * apy) >> 7; /* div 128 */
+	pB = (apy * (128 - apx)) >> 7; /* div 128 */
+	pC = (apx * (128 - apy)) >> 7; /* div 128 */
+	pD = 128 - (pA + pB + pC);
+
+	if (is24) {
+	  *pp++ = (((int) (pA * rA))>>7) + (((int) (pB * rB))>>7) +
+	          (((int) (pC * rC))>>7) + (((int) (pD * rD))>>7);
+
+	  *pp++ = (((int) (pA * gA))>>7) + (((int) (pB * gB))>>7) +
+	          (((int) (pC * gC))>>7) + (((int) (pD * gD))>>7);
+
+	  *pp++ = (((int) (pA * bA))>>7) + (((int) (pB * bB))>>7) +
+	          (((int) (pC * bC))>>7) + (((int) (pD * bD))>>7);
 	}
+	else {  /* 8-bit pic */
+	  *pp++ = (((int)(pA * rmap[cA]))>>7) + (((int)(pB * rmap[cB]))>>7) +
+	          (((int)(pC * rmap[cC]))>>7) + (((int)(pD * rmap[cD]))>>7);
 
-	else {
-	  /* compute weighting factors */
-	  apx = abs(px);  apy = abs(py);
-	  pA = (apx * apy) >> 7; /* div 128 */
-	  pB = (apy * (128 - apx)) >> 7; /* div 128 */
-	  pC = (apx * (128 - apy)) >> 7; /* div 128 */
-	  pD = 128 - (pA + pB + pC);
-
-	  if (is24) {
-	    *pp++ = (((int) (pA * rA))>>7) + (((int) (pB * rB))>>7) +
-	            (((int) (pC * rC))>>7) + (((int) (pD * rD))>>7);
-
-	    *pp++ = (((int) (pA * gA))>>7) + (((int) (pB * gB))>>7) +
-	            (((int) (pC * gC))>>7) + (((int) (pD * gD))>>7);
-
-	    *pp++ = (((int) (pA * bA))>>7) + (((int) (pB * bB))>>7) +
-	            (((int) (pC * bC))>>7) + (((int) (pD * bD))>>7);
-	  }
-	  else {  /* 8-bit pic */
-	    *pp++ = (((int)(pA * rmap[cA]))>>7) + (((int)(pB * rmap[cB]))>>7) +
-	            (((int)(pC * rmap[cC]))>>7) + (((int)(pD * rmap[cD]))>>7);
-
-	    *pp++ = (((int)(pA * gmap[cA]))>>7) + (((int)(pB * gmap[cB]))>>7) +
-	            (((int)(pC * gmap[cC]))>>7) + (((int)(pD * gmap[cD]))>>7);
-
-	    *pp++ = (((int)(pA * bmap[cA]))>>7) + (((int)(pB * bmap[cB]))>>7) +
-  	            (((int)(pC * bmap[cC]))>>7) + (((int)(pD * bmap[cD]))>>7);
-	  }
+	  *pp++ = (((int)(pA * gmap[cA]))>>7) + (((int)(pB * gmap[cB]))>>7) +
+	          (((int)(pC * gmap[cC]))>>7) + (((int)(pD * gmap[cD]))>>7);
+
+	  *pp++ = (((int)(pA * bmap[cA]))>>7) + (((int)(pB * bmap[cB]))>>7) +
+	          (((int)(pC * bmap[cC]))>>7) + (((int)(pD * bmap[cD]))>>7);
 	}
       }
     }
-
-    free(cxtab);
-    free(pxtab);
-    retval = 0;    /* okay */
   }
+}
 
-  if (retval) {    /* one of the Smooth**() methods failed */
-    free(pic24);
-    pic24 = (byte *) NULL;
-  }
 
-  return pic24;
+
+
+/***************************************************/
+static int *rowGroups(int shigh, int dhigh)
+{
+  /* for vertical shrinks (shigh > dhigh):  source row 'r' gets averaged
+     into dest row ((2*r+1)*dhigh) / (2*shigh).  Returns a dhigh+1 array
+     where entry 'i' is the first source row of dest row 'i' (and entry
+     dhigh is shigh), or NULL if the malloc fails */
+
+  int *tab, r;
+
+  tab = (int *) malloc((size_t) (dhigh+1) * sizeof(int));
+  if (!tab) return tab;
+
+  for (r=shigh-1; r>=0; r--) tab[((2 * r + 1) * dhigh) / (2 * shigh)] = r;
+  tab[dhigh] = shigh;
+
+  return tab;
 }
 
 
 
 
 /***************************************************/
-static int smoothX(byte *pic24, byte *pic824, int is24, int swide, int shigh, int dwide, int dhigh,
-		   byte *rmap, byte *gmap, byte *bmap)
+static int smoothX(SMOOTHJOB *sj)
 {
-  byte *cptr, *cptr1;
-  int  i, j;
-  int  *lbufR, *lbufG, *lbufB;
-  int  pixR, pixG, pixB, bperpix;
-  int  pcnt0, pcnt1, lastpix, pixcnt, thisline, ypcnt;
-  int  *pixarr, *paptr;
+  int  j, swide, dwide;
+  int  *pixarr;
 
   /* returns '0' if okay, '1' if failed (malloc) */
 
@@ -230,31 +313,63 @@ static int smoothX(byte *pic24, byte *pic824, int is24, int swide, int shigh, in
      maps pic8 into an dwide * dhigh 24-bit picture.  Only works correctly
      when swide>=dwide and shigh<=dhigh */
 
+  swide = sj->swide;  dwide = sj->dwide;
+
+  pixarr = (int *) calloc((size_t) swide+1, sizeof(int));
+  if (!pixarr) return 1;
+
+  for (j=0; j<=swide; j++)
+    pixarr[j] = ((2 * j + 1 ) * dwide) / ( 2 * swide);
+
+  sj->xtab1 = pixarr;
+  DoRowBands(sj->dhigh, smoothXRows, (void *) sj);
+
+  free(pixarr);
+  return 0;
+}
+
+
+/***************************************************/
+static void smoothXRows(void *data, int y0, int y1)
+{
+  SMOOTHJOB *sj = (SMOOTHJOB *) data;
+  byte *pic24, *pic824, *rmap, *gmap, *bmap, *cptr, *cptr1;
+  int   is24, swide, shigh, dwide, dhigh;
+  int  i, j;
+  int  *lbufR, *lbufG, *lbufB;
+  int  pixR, pixG, pixB, bperpix;
+  int  pcnt0, pcnt1, lastpix, pixcnt, thisline, ypcnt;
+  int  *pixarr, *paptr;
+
+  pic824 = sj->pic824;  is24 = sj->is24;
+  swide  = sj->swide;   shigh = sj->shigh;
+  dwide  = sj->dwide;   dhigh = sj->dhigh;
+  rmap   = sj->rmap;    gmap  = sj->gmap;   bmap = sj->bmap;
+  pixarr = sj->xtab1;
 
   /* malloc some arrays */
   lbufR  = (int *) calloc((size_t) swide,   sizeof(int));
   lbufG  = (int *) calloc((size_t) swide,   sizeof(int));
   lbufB  = (int *) calloc((size_t) swide,   sizeof(int));
-  pixarr = (int *) calloc((size_t) swide+1, sizeof(int));
 
-  if (!lbufR || !lbufG || !lbufB || !pixarr) {
+  if (!lbufR || !lbufG || !lbufB) {
     if (lbufR)  free(lbufR);
     if (lbufG)  free(lbufG);
     if (lbufB)  free(lbufB);
-    if (pixarr) free(pixarr);
-    return 1;
+    sj->failed = 1;
+    return;
   }
 
   bperpix = (is24) ? 3 : 1;
 
-  for (j=0; j<=swide; j++)
-    pixarr[j] = ((2 * j + 1 ) * dwide) / ( 2 * swide);
-
-  cptr = pic824;  cptr1 = cptr + swide * bperpix;
+  /* every dest row gets exactly dwide pixels written to it */
+  pic24 = sj->pic24 + y0 * dwide * 3;
 
-  for (i=0; i<dhigh; i++) {
-    ProgressMeter(0, (dhigh)-1, i, "Smooth");
-    if ((i&15) == 0) WaitCursor();
+  for (i=y0; i<y1; i++) {
+    if (y0 == 0) {
+      ProgressMeter(0, y1-1, i, "Smooth");
+      if ((i&15) == 0) WaitCursor();
+    }
 
     ypcnt = (((i*shigh)<<6) / dhigh) - 32;
     if (ypcnt<0) ypcnt = 0;
@@ -304,8 +419,7 @@ static int smoothX(byte *pic24, byte *pic824, int is24, int swide, int shigh, in
     }
   }
 
-  free(lbufR);  free(lbufG);  free(lbufB);  free(pixarr);
-  return 0;
+  free(lbufR);  free(lbufG);  free(lbufB);
 }
 
 
@@ -314,14 +428,10 @@ static int smoothX(byte *pic24, byte *pic824, int is24, int swide, int shigh, in
 
 
 /***************************************************/
-static int smoothY(byte *pic24, byte *pic824, int is24, int swide, int shigh, int dwide, int dhigh,
-		   byte *rmap, byte *gmap, byte *bmap)
+static int smoothY(SMOOTHJOB *sj)
 {
-  byte *clptr, *cptr, *cptr1;
-  int  i, j, bperpix;
-  int  *lbufR, *lbufG, *lbufB, *pct0, *pct1, *cxarr, *cxptr;
-  int  lastline, thisline, linecnt;
-  int  retval;
+  int  i, swide, dwide, retval;
+  int  *pct0, *pct1, *cxarr, *rowtab;
 
 
   /* returns '0' if okay, '1' if failed (malloc) */
@@ -332,17 +442,15 @@ static int smoothY(byte *pic24, byte *pic824, int is24, int swide, int shigh, in
 
   retval = 0;   /* no probs, yet... */
 
-  bperpix = (is24) ? 3 : 1;
+  swide = sj->swide;  dwide = sj->dwide;
 
-  lbufR = lbufG = lbufB = pct0 = pct1 = cxarr = NULL;
-  lbufR = (int *) calloc((size_t) dwide, sizeof(int));
-  lbufG = (int *) calloc((size_t) dwide, sizeof(int));
-  lbufB = (int *) calloc((size_t) dwide, sizeof(int));
-  pct0  = (int *) calloc((size_t) dwide, sizeof(int));
-  pct1  = (int *) calloc((size_t) dwide, sizeof(int));
-  cxarr = (int *) calloc((size_t) dwide, sizeof(int));
+  pct0 = pct1 = cxarr = NULL;
+  pct0   = (int *) calloc((size_t) dwide, sizeof(int));
+  pct1   = (int *) calloc((size_t) dwide, sizeof(int));
+  cxarr  = (int *) calloc((size_t) dwide, sizeof(int));
+  rowtab = rowGroups(sj->shigh, sj->dhigh);
 
-  if (!lbufR || !lbufG || !lbufB || !pct0 || ! pct1 || !cxarr) {
+  if (!pct0 || ! pct1 || !cxarr || !rowtab) {
     retval = 1;
     goto smyexit;
   }
@@ -358,58 +466,95 @@ static int smoothY(byte *pic24, byte *pic824, int is24, int swide, int shigh, in
     cxarr[i] = cx64 >> 6;
   }
 
+  sj->xtab1 = pct0;  sj->xtab2 = pct1;  sj->xtab3 = cxarr;
+  sj->rowtab = rowtab;
+  DoRowBands(sj->dhigh, smoothYRows, (void *) sj);
 
-  lastline = linecnt = 0;
 
-  for (i=0, clptr=pic824; i<shigh; i++, clptr+=swide*bperpix) {
-    ProgressMeter(0, shigh, i, "Smooth");
-    if ((i&15) == 0) WaitCursor();
+ smyexit:
+  if (pct0)   free(pct0);
+  if (pct1)   free(pct1);
+  if (cxarr)  free(cxarr);
+  if (rowtab) free(rowtab);
 
-    for (j=0, cxptr=cxarr; j<dwide; j++, cxptr++) {
-      cptr  = clptr + *cxptr * bperpix;
-      if (*cxptr < swide-1) cptr1 = cptr + 1*bperpix;
-                       else cptr1 = cptr;
+  return retval;
+}
 
-      if (is24) {
-	lbufR[j] += ((int)((*cptr++ * pct0[j]) + (*cptr1++ * pct1[j]))) >> 6;
-	lbufG[j] += ((int)((*cptr++ * pct0[j]) + (*cptr1++ * pct1[j]))) >> 6;
-	lbufB[j] += ((int)((*cptr++ * pct0[j]) + (*cptr1++ * pct1[j]))) >> 6;
-      }
-      else {  /* 8-bit input pic */
-	lbufR[j] += ((int)((rmap[*cptr]*pct0[j])+(rmap[*cptr1]*pct1[j]))) >> 6;
-	lbufG[j] += ((int)((gmap[*cptr]*pct0[j])+(gmap[*cptr1]*pct1[j]))) >> 6;
-	lbufB[j] += ((int)((bmap[*cptr]*pct0[j])+(bmap[*cptr1]*pct1[j]))) >> 6;
-      }
+
+/***************************************************/
+static void smoothYRows(void *data, int y0, int y1)
+{
+  SMOOTHJOB *sj = (SMOOTHJOB *) data;
+  byte *pic24, *pic824, *rmap, *gmap, *bmap, *clptr, *cptr, *cptr1;
+  int   is24, swide, dwide;
+  int  i, j, k, bperpix;
+  int  *lbufR, *lbufG, *lbufB, *pct0, *pct1, *cxarr, *cxptr, *rowtab;
+  int  linecnt;
+
+  pic824 = sj->pic824;  is24 = sj->is24;
+  swide  = sj->swide;   dwide = sj->dwide;
+  rmap   = sj->rmap;    gmap  = sj->gmap;   bmap = sj->bmap;
+  pct0   = sj->xtab1;   pct1  = sj->xtab2;  cxarr = sj->xtab3;
+  rowtab = sj->rowtab;
+
+  bperpix = (is24) ? 3 : 1;
+
+  lbufR = (int *) calloc((size_t) dwide, sizeof(int));
+  lbufG = (int *) calloc((size_t) dwide, sizeof(int));
+  lbufB = (int *) calloc((size_t) dwide, sizeof(int));
+
+  if (!lbufR || !lbufG || !lbufB) {
+    sj->failed = 1;
+    goto smyrexit;
+  }
+
+  pic24 = sj->pic24 + y0 * dwide * 3;
+
+  for (k=y0; k<y1; k++) {     /* dest row 'k' is the avg of rowtab[k].. */
+    if (y0 == 0) {
+      ProgressMeter(0, y1-1, k, "Smooth");
+      if ((k&15) == 0) WaitCursor();
     }
 
-    linecnt++;
+    xvbzero( (char *) lbufR, dwide * sizeof(int));  /* clear out line bufs */
+    xvbzero( (char *) lbufG, dwide * sizeof(int));
+    xvbzero( (char *) lbufB, dwide * sizeof(int));
+    linecnt = 0;
 
-    thisline = ((2 * i + 3) * dhigh) / (2 * shigh);
+    for (i=rowtab[k]; i<rowtab[k+1]; i++) {
+      clptr = pic824 + i * swide * bperpix;
 
-    if (thisline != lastline) {  /* copy a line to pic24 */
-      for (j=0; j<dwide; j++) {
-	*pic24++ = lbufR[j] / linecnt;
-	*pic24++ = lbufG[j] / linecnt;
-	*pic24++ = lbufB[j] / linecnt;
+      for (j=0, cxptr=cxarr; j<dwide; j++, cxptr++) {
+	cptr  = clptr + *cxptr * bperpix;
+	if (*cxptr < swide-1) cptr1 = cptr + 1*bperpix;
+	                 else cptr1 = cptr;
+
+	if (is24) {
+	  lbufR[j] += ((int)((*cptr++ * pct0[j]) + (*cptr1++ * pct1[j]))) >> 6;
+	  lbufG[j] += ((int)((*cptr++ * pct0[j]) + (*cptr1++ * pct1[j]))) >> 6;
+	  lbufB[j] += ((int)((*cptr++ * pct0[j]) + (*cptr1++ * pct1[j]))) >> 6;
+	}
+	else {  /* 8-bit input pic */
+	  lbufR[j] += ((int)((rmap[*cptr]*pct0[j])+(rmap[*cptr1]*pct1[j])))>>6;
+	  lbufG[j] += ((int)((gmap[*cptr]*pct0[j])+(gmap[*cptr1]*pct1[j])))>>6;
+	  lbufB[j] += ((int)((bmap[*cptr]*pct0[j])+(bmap[*cptr1]*pct1[j])))>>6;
+	}
       }
 
-      xvbzero( (char *) lbufR, dwide * sizeof(int));  /* clear out line bufs */
-      xvbzero( (char *) lbufG, dwide * sizeof(int));
-      xvbzero( (char *) lbufB, dwide * sizeof(int));
-      linecnt = 0;  lastline = thisline;
+      linecnt++;
+    }
+
+    for (j=0; j<dwide; j++) {   /* copy a line to pic24 */
+      *pic24++ = lbufR[j] / linecnt;
+      *pic24++ = lbufG[j] / linecnt;
+      *pic24++ = lbufB[j] / linecnt;
     }
   }
 
-
- smyexit:
+ smyrexit:
   if (lbufR) free(lbufR);
   if (lbufG) free(lbufG);
   if (lbufB) free(lbufB);
-  if (pct0)  free(pct0);
-  if (pct1)  free(pct1);
-  if (cxarr) free(cxarr);
-
-  return retval;
 }
 
 
@@ -418,15 +563,10 @@ static int smoothY(byte *pic24, byte *pic824, int is24, int swide, int shigh, in
 
 
 /***************************************************/
-static int smoothXY(byte *pic24, byte *pic824, int is24, int swide, int shigh, int dwide, int dhigh,
-		    byte *rmap, byte *gmap, byte *bmap)
+static int smoothXY(SMOOTHJOB *sj)
 {
-  byte *cptr;
-  int  i,j;
-  int  *lbufR, *lbufG, *lbufB;
-  int  pixR, pixG, pixB;
-  int  lastline, thisline, lastpix, linecnt, pixcnt;
-  int  *pixarr, *paptr;
+  int  j, swide, dwide;
+  int  *pixarr, *rowtab;
 
 
   /* returns '0' if okay, '1' if failed (malloc) */
@@ -435,61 +575,74 @@ static int smoothXY(byte *pic24, byte *pic824, int is24, int swide, int shigh, i
      when swide>=dwide and shigh>=dhigh (ie, the picture is shrunk on both
      axes) */
 
+  swide = sj->swide;  dwide = sj->dwide;
 
   /* malloc some arrays */
-  lbufR  = (int *) calloc((size_t) swide,   sizeof(int));
-  lbufG  = (int *) calloc((size_t) swide,   sizeof(int));
-  lbufB  = (int *) calloc((size_t) swide,   sizeof(int));
   pixarr = (int *) calloc((size_t) swide+1, sizeof(int));
-  if (!lbufR || !lbufG || !lbufB || !pixarr) {
-    if (lbufR)  free(lbufR);
-    if (lbufG)  free(lbufG);
-    if (lbufB)  free(lbufB);
+  rowtab = rowGroups(sj->shigh, sj->dhigh);
+  if (!pixarr || !rowtab) {
     if (pixarr) free(pixarr);
+    if (rowtab) free(rowtab);
     return 1;
   }
 
   for (j=0; j<=swide; j++)
     pixarr[j] = ((2 * j + 1) * dwide) / (2 * swide);
 
-  lastline = linecnt = pixR = pixG = pixB = 0;
-  cptr = pic824;
+  sj->xtab1 = pixarr;  sj->rowtab = rowtab;
+  DoRowBands(sj->dhigh, smoothXYRows, (void *) sj);
 
-  for (i=0; i<=shigh; i++) {
-    ProgressMeter(0, shigh, i, "Smooth");
-    if ((i&15) == 0) WaitCursor();
+  free(pixarr);  free(rowtab);
+  return 0;
+}
 
-    thisline = ((2 * i + 1) * dhigh) / (2 * shigh);
 
-    if ((thisline != lastline)) {      /* copy a line to pic24 */
-      pixR = pixG = pixB = pixcnt = lastpix = 0;
+/***************************************************/
+static void smoothXYRows(void *data, int y0, int y1)
+{
+  SMOOTHJOB *sj = (SMOOTHJOB *) data;
+  byte *pic24, *pic824, *rmap, *gmap, *bmap, *cptr;
+  int   is24, swide, dwide;
+  int  i, j, k;
+  int  *lbufR, *lbufG, *lbufB;
+  int  pixR, pixG, pixB;
+  int  lastpix, linecnt, pixcnt;
+  int  *pixarr, *paptr, *rowtab;
 
-      for (j=0, paptr=pixarr; j<=swide; j++,paptr++) {
-	if (*paptr != lastpix) {                 /* write a pixel to pic24 */
-	  if (!pixcnt) pixcnt = 1;    /* NEVER happens: quiets compilers */
-	  *pic24++ = (pixR/linecnt) / pixcnt;
-	  *pic24++ = (pixG/linecnt) / pixcnt;
-	  *pic24++ = (pixB/linecnt) / pixcnt;
-	  lastpix = *paptr;
-	  pixR = pixG = pixB = pixcnt = 0;
-	}
+  pic824 = sj->pic824;  is24 = sj->is24;
+  swide  = sj->swide;   dwide = sj->dwide;
+  rmap   = sj->rmap;    gmap  = sj->gmap;   bmap = sj->bmap;
+  pixarr = sj->xtab1;   rowtab = sj->rowtab;
 
-	if (j<swide) {
-	  pixR += lbufR[j];
-	  pixG += lbufG[j];
-	  pixB += lbufB[j];
-	  pixcnt++;
-	}
-      }
+  /* malloc some arrays */
+  lbufR  = (int *) calloc((size_t) swide,   sizeof(int));
+  lbufG  = (int *) calloc((size_t) swide,   sizeof(int));
+  lbufB  = (int *) calloc((size_t) swide,   sizeof(int));
+  if (!lbufR || !lbufG || !lbufB) {
+    if (lbufR)  free(lbufR);
+    if (lbufG)  free(lbufG);
+    if (lbufB)  free(lbufB);
+    sj->failed = 1;
+    return;
+  }
 
-      lastline = thisline;
-      xvbzero( (char *) lbufR, swide * sizeof(int));  /* clear out line bufs */
-      xvbzero( (char *) lbufG, swide * sizeof(int));
-      xvbzero( (char *) lbufB, swide * sizeof(int));
-      linecnt = 0;
+  /* every dest row gets exactly dwide pixels written to it */
+  pic24 = sj->pic24 + y0 * dwide * 3;
+
+  for (k=y0; k<y1; k++) {     /* dest row 'k' is the avg of rowtab[k].. */
+    if (y0 == 0) {
+      ProgressMeter(0, y1-1, k, "Smooth");
+      if ((k&15) == 0) WaitCursor();
     }
 
-    if (i<shigh) {
+    xvbzero( (char *) lbufR, swide * sizeof(int));  /* clear out line bufs */
+    xvbzero( (char *) lbufG, swide * sizeof(int));
+    xvbzero( (char *) lbufB, swide * sizeof(int));
+    linecnt = 0;
+
+    for (i=rowtab[k]; i<rowtab[k+1]; i++) {
+      cptr = pic824 + i * swide * ((is24) ? 3 : 1);
+
       if (is24) {
 	for (j=0; j<swide; j++) {
 	  lbufR[j] += *cptr++;
@@ -507,10 +660,30 @@ static int smoothXY(byte *pic24, byte *pic824, int is24, int swide, int shigh, i
 
       linecnt++;
     }
+
+    /* copy a line to pic24 */
+    pixR = pixG = pixB = pixcnt = lastpix = 0;
+
+    for (j=0, paptr=pixarr; j<=swide; j++,paptr++) {
+      if (*paptr != lastpix) {                 /* write a pixel to pic24 */
+	if (!pixcnt) pixcnt = 1;    /* NEVER happens: quiets compilers */
+	*pic24++ = (pixR/linecnt) / pixcnt;
+	*pic24++ = (pixG/linecnt) / pixcnt;
+	*pic24++ = (pixB/linecnt) / pixcnt;
+	lastpix = *paptr;
+	pixR = pixG = pixB = pixcnt = 0;
+      }
+
+      if (j<swide) {
+	pixR += lbufR[j];
+	pixG += lbufG[j];
+	pixB += lbufB[j];
+	pixcnt++;
+      }
+    }
   }
 
-  free(lbufR);  free(lbufG);  free(lbufB);  free(pixarr);
-  return 0;
+  free(lbufR);  free(lbufG);  free(lbufB);
 }
 
 
@@ -530,188 +703,252 @@ byte *DoColorDither(byte *pic24, byte *pic8, int w, int h, byte *rmap, byte *gma
      not the 'desired' colors
 
      if pic24 is NULL, uses the passed-in pic8 (an 8-bit image) as
-     the source, and the rmap,gmap,bmap arrays as the desired colors */
+     the source, and the rmap,gmap,bmap arrays as the desired colors
 
-  byte *np, *ep, *newpic;
-  short *cache;
-  int r2, g2, b2;
-  int *thisline, *nextline, *thisptr, *nextptr, *tmpptr;
-  int  i, j, rerr, gerr, berr, pwide3;
-  int  imax, jmax;
-  int key;
-  int fserrmap[512];   /* -255 .. 0 .. +255 */
+     the closest color to each cell of the color cube is kept in a table
+     from xvinvcmap.c, so the next image dithered with the same colors
+     doesn't have to search for them again.
+
+     big images are done by several threads at once, in a wave down the
+     image (see DoRowWave()), with the same results */
+
+  DITHJOB dj;
+  short  *invcmap;
+  int     i, j, nbufs;
 
   /* compute somewhat non-linear floyd-steinberg error mapping table */
   for (i=j=0; i<=0x40; i++,j++)
-    { fserrmap[256+i] = j;  fserrmap[256-i] = -j; }
+    { dj.fserrmap[256+i] = j;  dj.fserrmap[256-i] = -j; }
   for (     ; i<0x80; i++, j += !(i&1) ? 1 : 0)
-    { fserrmap[256+i] = j;  fserrmap[256-i] = -j; }
+    { dj.fserrmap[256+i] = j;  dj.fserrmap[256-i] = -j; }
   for (     ; i<=0xff; i++)
-    { fserrmap[256+i] = j;  fserrmap[256-i] = -j; }
+    { dj.fserrmap[256+i] = j;  dj.fserrmap[256-i] = -j; }
 
+  dj.pic24 = pic24;  dj.pic8 = pic8;  dj.w = w;  dj.h = h;
+  dj.rmap  = rmap;   dj.gmap = gmap;  dj.bmap = bmap;
+  dj.rdisp = rdisp;  dj.gdisp = gdisp;  dj.bdisp = bdisp;
+  dj.maplen = maplen;
 
-  pwide3 = w*3;  imax = h-1;  jmax = w-1;
-  ep = (pic24) ? pic24 : pic8;
+  /* the threads all look things up in the same table, so it has to be
+     filled in first, rather than as colors turn up */
+  nbufs = 2;
+  if (NumThreads() > 1 && (long) w * h >= DITHWAVEMIN) nbufs = NumThreads() + 2;
 
   /* attempt to malloc things */
-  newpic = (byte *)  malloc((size_t) (w * h));
-  cache  = (short *) calloc((size_t) (2<<14), sizeof(short));
-  thisline = (int *) malloc(pwide3 * sizeof(int));
-  nextline = (int *) malloc(pwide3 * sizeof(int));
-  if (!cache || !newpic || !thisline || !nextline) {
-    if (newpic)   free(newpic);
-    if (cache)    free(cache);
-    if (thisline) free(thisline);
-    if (nextline) free(nextline);
+  dj.newpic = (byte *)  malloc((size_t) (w * h));
+  dj.cache  = invcmap = InvCmapGet(rdisp, gdisp, bdisp, maplen);
+  if (!dj.cache) dj.cache = (short *) calloc((size_t) INVCMAPCELLS, sizeof(short));
+  dj.lines  = (int *) malloc((size_t) nbufs * w * 3 * sizeof(int));
+  if (!dj.cache || !dj.newpic || !dj.lines) {
+    if (dj.newpic) free(dj.newpic);
+    if (invcmap)   InvCmapRelease(invcmap);
+    else if (dj.cache) free(dj.cache);
+    if (dj.lines)  free(dj.lines);
 
     return (byte *) NULL;
   }
 
-  np = newpic;
+  TraceBegin("DoColorDither", (const char *) NULL);
+
+  if (nbufs > 2) DoRowBands(INVCMAPCELLS / 128, invFillRows, (void *) &dj);
 
   /* get first line of picture */
+  dj.nbufs = nbufs;
+  ditherLoadRow(&dj, 0);
 
-  if (pic24) {
-    for (j=pwide3, tmpptr=nextline; j; j--, ep++)
-      *tmpptr++ = (int) *ep;
+  DoRowWave(h, w, nbufs - 1, colorDitherRow, (void *) &dj);
+
+  free(dj.lines);
+  if (invcmap) InvCmapRelease(invcmap);
+          else free(dj.cache);
+
+  TraceEnd("DoColorDither");
+  return dj.newpic;
+}
+
+
+/********************************************/
+static void ditherLoadRow(DITHJOB *dj, int y)
+{
+  /* copies row 'y' of the source into its line buffer */
+
+  byte *ep;
+  int  *tmpptr, j;
+
+  tmpptr = dj->lines + (y % dj->nbufs) * dj->w * 3;
+
+  if (dj->pic24) {
+    ep = dj->pic24 + (size_t) y * dj->w * 3;
+    for (j=dj->w*3; j; j--, ep++) *tmpptr++ = (int) *ep;
   }
   else {
-    for (j=w, tmpptr=nextline; j; j--, ep++) {
-      *tmpptr++ = (int) rmap[*ep];
-      *tmpptr++ = (int) gmap[*ep];
-      *tmpptr++ = (int) bmap[*ep];
+    ep = dj->pic8 + (size_t) y * dj->w;
+    for (j=dj->w; j; j--, ep++) {
+      *tmpptr++ = (int) dj->rmap[*ep];
+      *tmpptr++ = (int) dj->gmap[*ep];
+      *tmpptr++ = (int) dj->bmap[*ep];
     }
   }
+}
 
 
-  for (i=0; i<h; i++) {
-    ProgressMeter(0, h-1, i, "Dither");
-    if ((i&15) == 0) WaitCursor();
+/********************************************/
+static int ditherClosest(DITHJOB *dj, int key)
+{
+  /* returns the displayed color for cell 'key' of the color cube.  Uses
+     the middle of the cell, rather than the pixel that wanted it, so the
+     answer is the same no matter which image (or pixel) asked first */
+
+  int rc, gc, bc, k, d, mind, closest;
+
+  rc = ((key >> 6) & 0xf8) | 0x04;
+  gc = ((key >> 1) & 0xf8) | 0x04;
+  bc = ((key << 4) & 0xf0) | 0x08;
+
+  mind = 10000;
+  for (k=closest=0; k<dj->maplen && mind>7; k++) {
+    d = abs(rc - dj->rdisp[k])
+      + abs(gc - dj->gdisp[k])
+      + abs(bc - dj->bdisp[k]);
+    if (d<mind) { mind = d;  closest = k; }
+  }
 
-    tmpptr = thisline;  thisline = nextline;  nextline = tmpptr;   /* swap */
+  return closest;
+}
 
-    if (i!=imax) {  /* get next line */
-      if (!pic24)
-	for (j=w, tmpptr=nextline; j; j--, ep++) {
-	  *tmpptr++ = (int) rmap[*ep];
-	  *tmpptr++ = (int) gmap[*ep];
-	  *tmpptr++ = (int) bmap[*ep];
-	}
-      else
-	for (j=pwide3, tmpptr=nextline; j; j--, ep++) *tmpptr++ = (int) *ep;
-    }
 
-    /* dither a line */
-    for (j=0, thisptr=thisline, nextptr=nextline; j<w; j++,np++) {
-      int k, d, mind, closest;
+/********************************************/
+static void invFillRows(void *data, int y0, int y1)
+{
+  /* fills in the cache cells [y0*128, y1*128) that aren't known yet */
 
-      r2 = *thisptr++;  g2 = *thisptr++;  b2 = *thisptr++;
+  DITHJOB *dj = (DITHJOB *) data;
+  int      key;
 
-      /* map r2,g2,b2 components (could be outside 0..255 range)
-	 into 0..255 range */
-
-      if (r2<0 || g2<0 || b2<0) {   /* are there any negatives in RGB? */
-	if (r2<g2) { if (r2<b2) k = 0; else k = 2; }
-	else { if (g2<b2) k = 1; else k = 2; }
-
-	switch (k) {
-	case 0:  g2 -= r2;  b2 -= r2;  d = (abs(r2) * 3) / 2;    /* RED */
-	         r2 = 0;
-	         g2 = (g2>d) ? g2 - d : 0;
-	         b2 = (b2>d) ? b2 - d : 0;
-	         break;
-
-	case 1:  r2 -= g2;  b2 -= g2;  d = (abs(g2) * 3) / 2;    /* GREEN */
-	         r2 = (r2>d) ? r2 - d : 0;
-	         g2 = 0;
-	         b2 = (b2>d) ? b2 - d : 0;
-	         break;
-
-	case 2:  r2 -= b2;  g2 -= b2;  d = (abs(b2) * 3) / 2;    /* BLUE */
-	         r2 = (r2>d) ? r2 - d : 0;
-	         g2 = (g2>d) ? g2 - d : 0;
-	         b2 = 0;
-	         break;
-	}
-      }
+  for (key=y0*128; key<y1*128; key++)
+    if (!dj->cache[key]) dj->cache[key] = ditherClosest(dj, key) + 1;
+}
 
-      if (r2>255 || g2>255 || b2>255) {   /* any overflows in RGB? */
-	if (r2>g2) { if (r2>b2) k = 0; else k = 2; }
-              else { if (g2>b2) k = 1; else k = 2; }
 
-	switch (k) {
-	case 0:   g2 = (g2*255)/r2;  b2 = (b2*255)/r2;  r2=255;  break;
-	case 1:   r2 = (r2*255)/g2;  b2 = (b2*255)/g2;  g2=255;  break;
-	case 2:   r2 = (r2*255)/b2;  g2 = (g2*255)/b2;  b2=255;  break;
-	}
-      }
+/********************************************/
+static void colorDitherRow(void *data, int i, int x0, int x1)
+{
+  /* dithers columns [x0,x1) of row 'i', for DoColorDither() */
 
-      key = ((r2&0xf8)<<6) | ((g2&0xf8)<<1) | (b2>>4);
-      if (key >= (2<<14)) FatalError("'key' overflow in DoColorDither()");
+  DITHJOB *dj = (DITHJOB *) data;
+  byte *np;
+  int r2, g2, b2;
+  int *thisptr, *nextptr;
+  int  j, rerr, gerr, berr;
+  int  imax, jmax;
+  int key;
 
-      if (cache[key]) { *np = (byte) (cache[key] - 1);	}
-      else {
-	/* not in cache, have to search the colortable */
-
-        mind = 10000;
-	for (k=closest=0; k<maplen && mind>7; k++) {
-	  d = abs(r2 - rdisp[k])
-	    + abs(g2 - gdisp[k])
-	    + abs(b2 - bdisp[k]);
-	  if (d<mind) { mind = d;  closest = k; }
-	}
-	cache[key] = closest + 1;
-	*np = closest;
+  imax = dj->h-1;  jmax = dj->w-1;
+
+  if (x0 == 0) {
+    ProgressMeter(0, imax, i, "Dither");
+    if ((i&15) == 0) WaitCursor();
+
+    if (i!=imax) ditherLoadRow(dj, i+1);   /* get next line */
+  }
+
+  np      = dj->newpic + (size_t) i * dj->w + x0;
+  thisptr = dj->lines + ( i    % dj->nbufs) * dj->w * 3 + x0 * 3;
+  nextptr = dj->lines + ((i+1) % dj->nbufs) * dj->w * 3 + x0 * 3;
+
+  /* dither a line */
+  for (j=x0; j<x1; j++,np++) {
+    int k, d;
+
+    r2 = *thisptr++;  g2 = *thisptr++;  b2 = *thisptr++;
+
+    /* map r2,g2,b2 components (could be outside 0..255 range)
+       into 0..255 range */
+
+    if (r2<0 || g2<0 || b2<0) {   /* are there any negatives in RGB? */
+      if (r2<g2) { if (r2<b2) k = 0; else k = 2; }
+      else { if (g2<b2) k = 1; else k = 2; }
+
+      switch (k) {
+      case 0:  g2 -= r2;  b2 -= r2;  d = (abs(r2) * 3) / 2;    /* RED */
+	       r2 = 0;
+	       g2 = (g2>d) ? g2 - d : 0;
+	       b2 = (b2>d) ? b2 - d : 0;
+	       break;
+
+      case 1:  r2 -= g2;  b2 -= g2;  d = (abs(g2) * 3) / 2;    /* GREEN */
+	       r2 = (r2>d) ? r2 - d : 0;
+	       g2 = 0;
+	       b2 = (b2>d) ? b2 - d : 0;
+	       break;
+
+      case 2:  r2 -= b2;  g2 -= b2;  d = (abs(b2) * 3) / 2;    /* BLUE */
+	       r2 = (r2>d) ? r2 - d : 0;
+	       g2 = (g2>d) ? g2 - d : 0;
+	       b2 = 0;
+	       break;
       }
+    }
 
+    if (r2>255 || g2>255 || b2>255) {   /* any overflows in RGB? */
+      if (r2>g2) { if (r2>b2) k = 0; else k = 2; }
+	    else { if (g2>b2) k = 1; else k = 2; }
 
-      /* propogate the error */
-      rerr = r2 - rdisp[*np];
-      gerr = g2 - gdisp[*np];
-      berr = b2 - bdisp[*np];
+      switch (k) {
+      case 0:   g2 = (g2*255)/r2;  b2 = (b2*255)/r2;  r2=255;  break;
+      case 1:   r2 = (r2*255)/g2;  b2 = (b2*255)/g2;  g2=255;  break;
+      case 2:   r2 = (r2*255)/b2;  g2 = (g2*255)/b2;  b2=255;  break;
+      }
+    }
 
+    key = ((r2&0xf8)<<6) | ((g2&0xf8)<<1) | (b2>>4);
+    if (key >= INVCMAPCELLS) FatalError("'key' overflow in DoColorDither()");
 
-      RANGE(rerr, -255, 255);
-      RANGE(gerr, -255, 255);
-      RANGE(berr, -255, 255);
-      rerr = fserrmap[256+rerr];
-      gerr = fserrmap[256+gerr];
-      berr = fserrmap[256+berr];
+    /* not in cache, have to search the colortable */
+    if (!dj->cache[key]) dj->cache[key] = ditherClosest(dj, key) + 1;
+    *np = (byte) (dj->cache[key] - 1);
 
 
+    /* propogate the error */
+    rerr = r2 - dj->rdisp[*np];
+    gerr = g2 - dj->gdisp[*np];
+    berr = b2 - dj->bdisp[*np];
 
-      if (j!=jmax) {  /* adjust RIGHT pixel */
-	thisptr[0] += (rerr*7)/16;
-	thisptr[1] += (gerr*7)/16;
-	thisptr[2] += (berr*7)/16;
-      }
 
-      if (i!=imax) {	/* do BOTTOM pixel */
-	nextptr[0] += (rerr*5)/16;
-	nextptr[1] += (gerr*5)/16;
-	nextptr[2] += (berr*5)/16;
+    RANGE(rerr, -255, 255);
+    RANGE(gerr, -255, 255);
+    RANGE(berr, -255, 255);
+    rerr = dj->fserrmap[256+rerr];
+    gerr = dj->fserrmap[256+gerr];
+    berr = dj->fserrmap[256+berr];
 
-	if (j>0) {  /* do BOTTOM LEFT pixel */
-	  nextptr[-3] += (rerr*3)/16;
-	  nextptr[-2] += (gerr*3)/16;
-	  nextptr[-1] += (berr*3)/16;
-	}
 
-	if (j!=jmax) {  /* do BOTTOM RIGHT pixel */
-	  nextptr[3] += rerr/16;
-	  nextptr[4] += gerr/16;
-	  nextptr[5] += berr/16;
-	}
-	nextptr += 3;
-      }
+
+    if (j!=jmax) {  /* adjust RIGHT pixel */
+      thisptr[0] += (rerr*7)/16;
+      thisptr[1] += (gerr*7)/16;
+      thisptr[2] += (berr*7)/16;
     }
-  }
 
+    if (i!=imax) {	/* do BOTTOM pixel */
+      nextptr[0] += (rerr*5)/16;
+      nextptr[1] += (gerr*5)/16;
+      nextptr[2] += (berr*5)/16;
 
-  free(thisline);  free(nextline);
-  free(cache);
+      if (j>0) {  /* do BOTTOM LEFT pixel */
+	nextptr[-3] += (rerr*3)/16;
+	nextptr[-2] += (gerr*3)/16;
+	nextptr[-1] += (berr*3)/16;
+      }
 
-  return newpic;
+      if (j!=jmax) {  /* do BOTTOM RIGHT pixel */
+	nextptr[3] += rerr/16;
+	nextptr[4] += gerr/16;
+	nextptr[5] += berr/16;
+      }
+      nextptr += 3;
+    }
+  }
 }
 
 
@@ -732,7 +969,10 @@ byte *Do332ColorDither(byte *pic24, byte *pic8, int w, int h, byte *rmap, byte *
      not the 'desired' colors
 
      if pic24 is NULL, uses the passed-in pic8 (an 8-bit image) as
-     the source, and the rmap,gmap,bmap arrays as the desired colors */
+     the source, and the rmap,gmap,bmap arrays as the desired colors
+
+     with '-ordered', uses an ordered dither instead, which is a lot
+     faster, and is done by several threads at once */
 
   byte *np, *ep, *newpic;
   int r2, g2, b2;
@@ -766,6 +1006,24 @@ byte *Do332ColorDither(byte *pic24, byte *pic8, int w, int h, byte *rmap, byte *
     return (byte *) NULL;
   }
 
+  if (ordered332) {
+    DITHJOB dj;
+
+    free(thisline);  free(nextline);
+
+    dj.pic24 = pic24;  dj.pic8 = pic8;  dj.newpic = newpic;
+    dj.w = w;  dj.h = h;
+    dj.rmap = rmap;  dj.gmap = gmap;  dj.bmap = bmap;
+    dj.failed = 0;
+
+    TraceBegin("OrderedDither332", (const char *) NULL);
+    DoRowBands(h, orderedRows, (void *) &dj);
+    TraceEnd("OrderedDither332");
+
+    if (dj.failed) { free(newpic);  return (byte *) NULL; }
+    return newpic;
+  }
+
   np = newpic;
   ep = (pic24) ? pic24 : pic8;
 
@@ -869,3 +1127,154 @@ byte *Do332ColorDither(byte *pic24, byte *pic8, int w, int h, byte *rmap, byte *
 
 
 
+/********************************************/
+static void orderedRows(void *data, int y0, int y1)
+{
+  /* Do332ColorDither()'s ordered dither, for rows [y0,y1) */
+
+  DITHJOB *dj = (DITHJOB *) data;
+  byte    *rowbuf, *sp, *dp;
+  int      x, y;
+
+  rowbuf = (byte *) NULL;
+  if (!dj->pic24) {
+    rowbuf = (byte *) malloc((size_t) dj->w * 3);
+    if (!rowbuf) { dj->failed = 1;  return; }
+  }
+
+  for (y=y0; y<y1; y++) {
+    if (y0 == 0) {
+      ProgressMeter(0, y1-1, y, "Dither");
+      if ((y&127) == 0) WaitCursor();
+    }
+
+    if (dj->pic24) sp = dj->pic24 + (size_t) y * dj->w * 3;
+    else {
+      byte *ep = dj->pic8 + (size_t) y * dj->w;
+      for (x=0, dp=rowbuf; x<dj->w; x++, ep++) {
+	*dp++ = dj->rmap[*ep];  *dp++ = dj->gmap[*ep];  *dp++ = dj->bmap[*ep];
+      }
+      sp = rowbuf;
+    }
+
+    OrderedDither332(sp, dj->newpic + (size_t) y * dj->w, dj->w, y);
+  }
+
+  if (rowbuf) free(rowbuf);
+}
+
+
+
+/****************************/
+byte *FSDither(byte *inpic, int intype, int w, int h, byte *rmap, byte *gmap, byte *bmap,
+	      int bval, int wval)
+{
+  /* takes an input pic of size w*h, and type 'intype' (PIC8 or PIC24),
+   *                (if PIC8, colormap specified by rmap,gmap,bmap)
+   * and does the floyd-steinberg dithering algorithm on it.
+   * generates (mallocs) a w*h 1-byte-per-pixel 'outpic', using 'bval'
+   * and 'wval' as the 'black' and 'white' pixel values, respectively
+   */
+
+  int    i, j, err, w1, h1, npixels, linebufsize;
+  byte  *pp, *outpic, rgb[256];
+  int   *thisline, *nextline, *thisptr, *nextptr, *tmpptr;
+
+
+  npixels = w * h;
+  linebufsize = w * sizeof(int);
+  if (w <= 0 || h <= 0 || npixels/w != h || linebufsize/w != sizeof(int)) {
+    SetISTR(ISTR_WARNING, "Invalid image dimensions for dithering");
+    return (byte *)NULL;
+  }
+
+  outpic = (byte *) malloc((size_t) npixels);
+  if (!outpic) return outpic;
+
+
+  if (intype == PIC8) {       /* monoify colormap */
+    for (i=0; i<256; i++)
+      rgb[i] = MONO(rmap[i], gmap[i], bmap[i]);
+  }
+
+
+  thisline = (int *) malloc(linebufsize);
+  nextline = (int *) malloc(linebufsize);
+  if (!thisline || !nextline)
+    FatalError("ran out of memory in FSDither()\n");
+
+  TraceBegin("FSDither", (const char *) NULL);
+
+
+  w1 = w-1;  h1 = h-1;
+
+  /* load up first line of picture */
+  pp = inpic;
+  if (intype == PIC24) {
+    for (j=0, tmpptr=nextline; j<w; j++, pp+=3)
+      *tmpptr++ = fsgamcr[MONO(pp[0], pp[1], pp[2])];
+  }
+  else {
+    for (j=0, tmpptr=nextline; j<w; j++, pp++)
+      *tmpptr++ = fsgamcr[rgb[*pp]];
+  }
+
+
+  for (i=0; i<h; i++) {
+    if ((i&0x3f) == 0) WaitCursor();
+
+    /* get next line of picture */
+    tmpptr = thisline;  thisline = nextline;  nextline = tmpptr;  /* swap */
+    if (i!=h1) {
+      if (intype == PIC24) {
+	pp = inpic + (i+1) * w * 3;
+	for (j=0, tmpptr=nextline; j<w; j++, pp+=3)
+	  *tmpptr++ = fsgamcr[MONO(pp[0], pp[1], pp[2])];
+      }
+      else {
+	pp = inpic + (i+1) * w;
+	for (j=0, tmpptr = nextline; j<w; j++, pp++)
+	  *tmpptr++ = fsgamcr[rgb[*pp]];
+      }
+    }
+
+    pp  = outpic + i * w;
+    thisptr = thisline;  nextptr = nextline;
+
+    if ((i&1) == 0) {  /* go right */
+      for (j=0; j<w; j++, pp++, thisptr++, nextptr++) {
+	if (*thisptr<128) { err = *thisptr;     *pp = (byte) bval; }
+	             else { err = *thisptr-255; *pp = (byte) wval; }
+
+	if (j<w1) thisptr[1] += ((err*7)/16);
+
+	if (i<h1) {
+	  nextptr[0] += ((err*5)/16);
+	  if (j>0)  nextptr[-1] += ((err*3)/16);
+	  if (j<w1) nextptr[ 1] += (err/16);
+	}
+      }
+    }
+
+    else {   /* go left */
+      pp += (w-1);  thisptr += (w-1);  nextptr += (w-1);
+      for (j=w-1; j>=0; j--, pp--, thisptr--, nextptr--) {
+	if (*thisptr<128) { err = *thisptr;     *pp = (byte) bval; }
+	             else { err = *thisptr-255; *pp = (byte) wval; }
+
+	if (j>0) thisptr[-1] += ((err*7)/16);
+
+	if (i<h1) {
+	  nextptr[0] += ((err*5)/16);
+	  if (j>0)  nextptr[-1] += (err/16);
+	  if (j<w1) nextptr[ 1] += ((err*3)/16);
+	}
+      }
+    }
+  }
+
+  free(thisline);  free(nextline);
+
+  TraceEnd("FSDither");
+  return outpic;
+}
@@ -45,7 +45,6 @@ static void sunRas1to8     PARM((byte *, byte *, int));
 static void sunRas8to1     PARM((byte *, byte *, int, int));
 static int  read_sun_long  PARM((int *, FILE *));
 static int  write_sun_long PARM((int, FILE *));
-static void fixBGR         PARM((unsigned char *, int, int));
 
 
 /*******************************************/
@@ -53,7 +52,8 @@ int LoadSunRas(char *fname, PICINFO *pinfo)
 {
   FILE	*fp;
   unsigned int	 linesize,lsize,csize,isize,i,w,h,d,npixels,nbytes;
-  byte	 *image, *line;
+  byte	 *image, *line, *lp;
+  BULKIN bi;
   struct rasterfile sunheader;
   const char *bname;
 
@@ -205,54 +205,53 @@ int LoadSunRas(char *fname, PICINFO *pinfo)
     FatalError("Can't allocate memory for image\n");
 
 
+  BulkInit(&bi, fp, (size_t) linesize * h, 0);
+
   for (i = 0; i < h; i++) {
     if ((i&0x1f) == 0) WaitCursor();
     if (sunheader.ras_type == RT_BYTE_ENCODED) {
       if (rle_read (line, 1, linesize, fp, (i==0)) != linesize) break;
+      lp = line;
     }
 
     else {
-      if (fread (line, (size_t) 1, (size_t) linesize, fp) != linesize) {
-	free(image);  free(line);  fclose(fp);
+      lp = BulkRow(&bi, (size_t) linesize);
+      if (bi.missing) {
+	BulkDone(&bi);  free(image);  free(line);  fclose(fp);
 	return (sunRasError (bname, "file read error"));
       }
     }
 
+    /* 24- and 32-bit ones are BGR, unless they're RT_FORMAT_RGB */
     switch (d) {
-    case 1:  sunRas1to8 (image + w * i, line, w);
-             break;
-    case 8:  xvbcopy((char *) line, (char *) image + w * i, (size_t) w);
+    case 1:  sunRas1to8 (image + w * i, lp, w);
              break;
-    case 24: xvbcopy((char *) line, (char *) image + w * i * 3, (size_t) w*3);
+    case 8:  xvbcopy((char *) lp, (char *) image + w * i, (size_t) w);
              break;
+    case 24:
+      if (sunheader.ras_type == RT_FORMAT_RGB)
+	xvbcopy((char *) lp, (char *) image + (size_t) w * i * 3,
+		(size_t) w*3);
+      else UnpackRGB24(lp, image + (size_t) w * i * 3, (int) w, UNPACK_BGR24);
+      break;
 
     case 32:
-      {
-	int k;
-	byte *ip, *op;
-	ip = line;
-	op = (byte *) (image + w * i * 3);
-	for (k = 0; k<w; k++) {
-	  ip++;            /* skip 'alpha' */
-	  *op++ = *ip++;   /* red   */
-	  *op++ = *ip++;   /* green */
-	  *op++ = *ip++;   /* blue  */
-	}
-      }
+      UnpackRGB24(lp, image + (size_t) w * i * 3, (int) w,
+		  (sunheader.ras_type == RT_FORMAT_RGB) ? UNPACK_XRGB32
+		                                        : UNPACK_XBGR32);
+      break;
     }
   }
 
+  BulkDone(&bi);
   free(line);
 
   if (DEBUG) fprintf(stderr,"Sun ras: image loaded!\n");
 
 
 
-  if (d == 24 || d == 32) {
-    if (sunheader.ras_type != RT_FORMAT_RGB) fixBGR(image,w,h);
-    pinfo->type = PIC24;
-  }
-  else pinfo->type = PIC8;
+  if (d == 24 || d == 32) pinfo->type = PIC24;
+                      else pinfo->type = PIC8;
 
   pinfo->pic = image;
   pinfo->w = w;
@@ -555,21 +554,3 @@ static int write_sun_long (int l, FILE *fp)
     return (0);
 }
 
-
-
-
-/* kr3 - fix up BGR order SUN 24-bit rasters to be RGB order */
-static void fixBGR(unsigned char *img, int w, int h)
-{
-  int i,npixels;
-  unsigned char tmp;
-
-  npixels = w*h;
-  for (i=0; i<npixels; i++) {
-    tmp = img[0];                   /* swap red and blue channels */
-    img[0] = img[2];
-    img[2] = tmp;
-    img += 3;                       /* bump to next pixel */
-  }
-}
-
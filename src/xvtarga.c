@@ -46,8 +46,9 @@ int LoadTarga(char *fname, PICINFO *pinfo)
   /* returns '1' on success */
 
   FILE  *fp;
-  int    i, row, c, c1, w, h, npixels, bufsize, flags, intlace, topleft, trunc;
-  byte *pic24, *pp;
+  int    i, row, c, c1, w, h, npixels, bufsize, flags, intlace, topleft;
+  byte  *pic24;
+  BULKIN bi;
 
   bname = BaseName(fname);
 
@@ -119,9 +120,10 @@ int LoadTarga(char *fname, PICINFO *pinfo)
   if (!pic24) FatalError("couldn't malloc 'pic24'");
 
 
-  trunc = 0;
+  /* read the data, swapping R and B as we go (file is in BGR, pic24 should
+     be in RGB) */
+  BulkInit(&bi, fp, (size_t) bufsize, 0);
 
-  /* read the data */
   for (i=0; i<h; i++) {
     if (intlace == 2) {        /* four pass interlace */
       if      (i < (1*h) / 4) row = 4 * i;
@@ -142,17 +144,14 @@ int LoadTarga(char *fname, PICINFO *pinfo)
     if (!topleft) row = (h - row - 1);     /* bottom-left origin: invert y */
 
 
-    c = fread(pic24 + (row*w*3), (size_t) 1, (size_t) w*3, fp);
-    if (c != w*3) trunc=1;
+    if ((i&0x3f)==0) WaitCursor();
+    UnpackRGB24(BulkRow(&bi, (size_t) w*3), pic24 + ((size_t) row*w*3), w,
+		UNPACK_BGR24);
   }
 
-  if (trunc) SetISTR(ISTR_WARNING,"%s:  File appears to be truncated.",bname);
-
-
-  /* swap R,B values (file is in BGR, pic24 should be in RGB) */
-  for (i=0, pp=pic24; i<npixels; i++, pp+=3) {
-    c = pp[0];  pp[0] = pp[2];  pp[2] = c;
-  }
+  if (bi.missing) SetISTR(ISTR_WARNING,"%s:  File appears to be truncated.",
+			  bname);
+  BulkDone(&bi);
 
 
   pinfo->pic     = pic24;
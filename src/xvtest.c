@@ -0,0 +1,508 @@
+/*
+ * xvtest.c - regression checks for libxvcore
+ *
+ *  usage:  xvtest [-only str]
+ *
+ * Runs each check, and says whether it passed, on stdout.  Exits with 0 if
+ * they all did, and 1 otherwise.  Run by 'ctest' (or 'make test').
+ *
+ * The checks are for bugs that have been fixed, and that wouldn't be
+ * noticed right away if they came back.  Some of them (the ones that used
+ * to touch freed memory) are most useful in a build with XV_ENABLE_ASAN.
+ *
+ * '-only' skips any check whose name doesn't contain 'str'.
+ *
+ * Built against libxvcore (see xvcore.c), so it doesn't need an X display.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#ifdef HAVE_ZLIB
+#  include <zlib.h>
+#endif
+
+
+typedef int (*TFUNC) PARM((void));
+
+typedef struct { const char *name;
+		 TFUNC       func;
+	       } TEST;
+
+
+static byte *makePic24    PARM((int, int));
+static int   tResampSwap  PARM((void));
+static int   tResampShare PARM((void));
+static int   tBmpTrunc    PARM((void));
+static int   tGamLattice  PARM((void));
+static int   tUncompMem   PARM((void));
+static int   tUncompBig   PARM((void));
+static int   bmpTrunc1    PARM((int, int));
+static void  putLE        PARM((byte *, u_int, int));
+static int   writeFile    PARM((const char *, byte *, size_t));
+static int   samePics     PARM((PICINFO *, PICINFO *));
+static byte *readFile     PARM((const char *, size_t *));
+#ifdef HAVE_ZLIB
+static int   writeGzip    PARM((const char *, byte *, size_t));
+#endif
+
+
+static TEST tests[] = {
+  { "resample-swapped-sizes", tResampSwap  },
+  { "resample-shared-sizes",  tResampShare },
+  { "bmp-truncated",          tBmpTrunc    },
+  { "gamma-lattice-reuse",    tGamLattice  },
+  { "uncompress-in-memory",   tUncompMem   },
+  { "uncompress-big",         tUncompBig   },
+};
+
+#define NTESTS  (int) (sizeof(tests) / sizeof(tests[0]))
+
+
+
+/***************************************************/
+int main(int argc, char **argv)
+{
+  int   i, nfailed, nrun;
+  char *onlystr;
+
+  XVCoreInit();
+  cmd = "xvtest";
+
+  onlystr = (char *) NULL;
+  for (i=1; i<argc; i++) {
+    if (!strcmp(argv[i], "-only") && i+1<argc) onlystr = argv[++i];
+    else {
+      fprintf(stderr, "usage:  %s [-only str]\n", cmd);
+      exit(1);
+    }
+  }
+
+  nfailed = nrun = 0;
+  for (i=0; i<NTESTS; i++) {
+    if (onlystr && !strstr(tests[i].name, onlystr)) continue;
+
+    nrun++;
+    if ((*tests[i].func)()) printf("ok      %s\n", tests[i].name);
+    else { printf("FAILED  %s\n", tests[i].name);  nfailed++; }
+    fflush(stdout);
+  }
+
+  printf("%d of %d checks failed\n", nfailed, nrun);
+  exit(nfailed ? 1 : 0);
+  return 1;
+}
+
+
+/***************************************************/
+static byte *makePic24(int w, int h)
+{
+  /* returns a w*h PIC24 with a bit of everything in it:  smooth ramps, and
+     some sharp edges for the filters to ring on */
+
+  byte *pic, *pp;
+  int   x, y;
+
+  pic = (byte *) malloc((size_t) w * h * 3);
+  if (!pic) FatalError("out of memory in makePic24()");
+
+  for (y=0, pp=pic; y<h; y++) {
+    for (x=0; x<w; x++) {
+      *pp++ = (byte) ((x * 255) / w);
+      *pp++ = (byte) ((y * 255) / h);
+      *pp++ = (byte) ((((x>>4) ^ (y>>4)) & 1) ? 230 : 20);
+    }
+  }
+
+  return pic;
+}
+
+
+
+/***************************************************/
+static int tResampSwap(void)
+{
+  /* Resample24() keeps the last x and y weight tables.  The second resize
+     here finds its x table (1200 -> 600) in the y slot, then builds a new
+     y table, which used to free the x table it was about to use */
+
+  byte *a, *b, *d1, *d2;
+  int   ok;
+
+  a = makePic24(1600, 1200);
+  b = makePic24(1200, 900);
+
+  d1 = Resample24(a, 1, 1600, 1200, 800, 600, NULL, NULL, NULL);
+  free(d1);
+  d1 = Resample24(b, 1, 1200,  900, 600, 450, NULL, NULL, NULL);
+
+  /* again, with neither table left over from the first resize */
+  d2 = Resample24(b, 1, 1200,  900, 600, 450, NULL, NULL, NULL);
+
+  ok = (d1 && d2 && !xvbcmp((char *) d1, (char *) d2, (size_t) 600*450*3));
+
+  free(a);  free(b);
+  if (d1) free(d1);
+  if (d2) free(d2);
+  return ok;
+}
+
+
+/***************************************************/
+static int tResampShare(void)
+{
+  /* a square resize uses the same table for both axes */
+
+  byte *a, *b, *d1, *d2, *d3;
+  int   ok;
+
+  a = makePic24(500, 500);
+  b = makePic24(500, 700);
+
+  d1 = Resample24(a, 1, 500, 500, 200, 200, NULL, NULL, NULL);
+  d2 = Resample24(b, 1, 500, 700, 200, 300, NULL, NULL, NULL);
+  d3 = Resample24(a, 1, 500, 500, 200, 200, NULL, NULL, NULL);
+
+  ok = (d1 && d2 && d3 &&
+	!xvbcmp((char *) d1, (char *) d3, (size_t) 200*200*3));
+
+  free(a);  free(b);
+  if (d1) free(d1);
+  if (d2) free(d2);
+  if (d3) free(d3);
+  return ok;
+}
+
+
+/***************************************************/
+static int tGamLattice(void)
+{
+  /* ApplyGamMods24() keeps the last color lattice it built, for the next
+     call with the same mods.  It mustn't use it for different ones */
+
+  GAMMODS gm1, gm2;
+  byte   *a, *d1, *d2, *d3;
+  int     i, ok;
+
+  InitGamMods(&gm1);
+  gm1.satval = 40.0;
+  gm1.approx = 1;
+  for (i=0; i<360; i++) gm1.hremap[i] = (i + 30) % 360;
+
+  gm2 = gm1;
+  gm2.satval = -40.0;
+
+  a  = makePic24(300, 200);
+  d1 = ApplyGamMods24(a, 300, 200, &gm1);
+  d2 = ApplyGamMods24(a, 300, 200, &gm2);
+  d3 = ApplyGamMods24(a, 300, 200, &gm1);
+
+  ok = (d1 && d2 && d3 &&
+	 xvbcmp((char *) d1, (char *) d2, (size_t) 300*200*3) &&
+	!xvbcmp((char *) d1, (char *) d3, (size_t) 300*200*3));
+
+  free(a);
+  if (d1) free(d1);
+  if (d2) free(d2);
+  if (d3) free(d3);
+  return ok;
+}
+
+
+/***************************************************/
+static int tBmpTrunc(void)
+{
+  /* the BMP loaders read their pixels with BulkRow() now, instead of
+     getc() and getint().  A file that stops partway through the pixels
+     should still load, exactly as it used to */
+
+  return (bmpTrunc1( 8, 0) && bmpTrunc1(16, 0) && bmpTrunc1(24, 0) &&
+	  bmpTrunc1(32, 0) && bmpTrunc1(32, 3));
+}
+
+
+/***************************************************/
+static int bmpTrunc1(int bits, int comp)
+{
+  /* writes a 'bits'-deep BMP (compression 'comp', BI_RGB or BI_BITFIELDS)
+     that ends 3 bytes into its 3rd row of pixels, and another, complete,
+     one that has what the old loaders read in place of the missing part.
+     They should load the same */
+
+  static const u_int masks[3] = { 0xff0000, 0x00ff00, 0x0000ff };
+  char     tname[MAXPATHLEN], ename[MAXPATHLEN];
+  byte    *file, *exp, *pp;
+  PICINFO  tpinfo, epinfo;
+  size_t   hdrlen, rowbytes, cut, len, i;
+  int      w, h, ncols, wordwise, ok, k;
+
+  w = 5;  h = 6;
+  ncols = (bits <= 8) ? (1 << bits) : 0;
+
+  switch (bits) {
+  case 8:   rowbytes = (size_t) ((w + 3) / 4) * 4;        break;
+  case 16:  rowbytes = (size_t) ((w + 1) / 2) * 4;        break;
+  case 24:  rowbytes = (size_t) ((w * 3 + 3) / 4) * 4;    break;
+  default:  rowbytes = (size_t) w * 4;                    break;
+  }
+
+  /* loadBMP16() and loadBMP32() (BI_BITFIELDS) read with getint(), and
+     carried on to the end.  The rest stopped after the short row */
+  wordwise = (bits == 16 || comp == 3);
+
+  hdrlen = 14 + 40 + ((comp == 3) ? 12 : 0) + (size_t) ncols * 4;
+  len    = hdrlen + rowbytes * h;
+  cut    = hdrlen + rowbytes * 2 + 3;
+
+  file = (byte *) calloc(len, (size_t) 1);
+  exp  = (byte *) calloc(len, (size_t) 1);
+  if (!file || !exp) FatalError("out of memory in bmpTrunc1()");
+
+  file[0] = 'B';  file[1] = 'M';
+  putLE(file+2,  (u_int) len, 4);
+  putLE(file+10, (u_int) hdrlen, 4);
+  putLE(file+14, 40, 4);                 /* biSize */
+  putLE(file+18, (u_int) w, 4);
+  putLE(file+22, (u_int) h, 4);
+  putLE(file+26, 1, 2);                  /* biPlanes */
+  putLE(file+28, (u_int) bits, 2);
+  putLE(file+30, (u_int) comp, 4);
+  pp = file + 54;
+  if (comp == 3) {
+    for (k=0; k<3; k++, pp+=4) putLE(pp, masks[k], 4);
+  }
+  for (k=0; k<ncols; k++, pp+=4) {
+    pp[0] = (byte) k;  pp[1] = (byte) (255-k);  pp[2] = (byte) (k*7);
+  }
+  for (i=hdrlen; i<len; i++) file[i] = (byte) (i * 37 + 11);
+
+  /* what getc() and getint() made of the missing bytes.  getint() added
+     up the four EOFs (-1) it got, shifted, rather than or-ing them */
+  xvbcopy((char *) file, (char *) exp, cut);
+  if (wordwise) {
+    for (i=hdrlen + ((cut-hdrlen) & ~(size_t) 3); i<len; i+=4) {
+      u_int v;
+      int   c[4];
+
+      for (k=0; k<4; k++) c[k] = (i+k < cut) ? file[i+k] : EOF;
+      v = ((u_int) c[0]) + (((u_int) c[1]) << 8) +
+	  (((u_int) c[2]) << 16) + (((u_int) c[3]) << 24);
+      putLE(exp+i, v, 4);
+    }
+  }
+  else {
+    for (i=cut; i<hdrlen + rowbytes*3; i++) exp[i] = 0xff;
+  }
+
+  sprintf(tname, "%s/xvtest%d-t.bmp", tmpdir, (int) getpid());
+  sprintf(ename, "%s/xvtest%d-e.bmp", tmpdir, (int) getpid());
+
+  xvbzero((char *) &tpinfo, sizeof(PICINFO));
+  xvbzero((char *) &epinfo, sizeof(PICINFO));
+
+  ok = (writeFile(tname, file, cut) && writeFile(ename, exp, len) &&
+	LoadBMP(tname, &tpinfo) && LoadBMP(ename, &epinfo) &&
+	samePics(&tpinfo, &epinfo));
+
+  if (!ok) fprintf(stderr, "bmp-truncated: %d-bit, compression %d\n",
+		   bits, comp);
+
+  unlink(tname);  unlink(ename);
+  if (tpinfo.pic) free(tpinfo.pic);
+  if (epinfo.pic) free(epinfo.pic);
+  free(file);  free(exp);
+  return ok;
+}
+
+
+/***************************************************/
+static int tUncompMem(void)
+{
+  /* MemUncompress() keeps a gzip'd BMP in memory.  Reading it should give
+     the same thing as the original.  And the data has to stay put while
+     a FILE is still reading it, even after its temp file's been unlinked
+     and the memory file thrown out */
+
+#ifdef HAVE_ZLIB
+  char     pname[MAXPATHLEN], gname[MAXPATHLEN];
+  char     u1[MAXPATHLEN], u2[MAXPATHLEN];
+  byte    *pic, *orig, *got;
+  size_t   olen;
+  PICINFO  p1, p2;
+  FILE    *fp;
+  int      ok;
+
+  sprintf(pname, "%s/xvtest%d.bmp",    tmpdir, (int) getpid());
+  sprintf(gname, "%s/xvtest%d.bmp.gz", tmpdir, (int) getpid());
+
+  pic = makePic24(64, 48);
+  fp  = fopen(pname, "w");
+  ok  = (fp && !WriteBMP(fp, pic, PIC24, 64, 48, (byte *) NULL,
+			 (byte *) NULL, (byte *) NULL, 0, F_FULLCOLOR));
+  if (fp && fclose(fp) == EOF) ok = 0;
+  free(pic);
+
+  orig = (ok) ? readFile(pname, &olen) : (byte *) NULL;
+  got  = (byte *) NULL;
+  u1[0] = u2[0] = '\0';
+  xvbzero((char *) &p1, sizeof(PICINFO));
+  xvbzero((char *) &p2, sizeof(PICINFO));
+
+  ok = (orig && writeGzip(gname, orig, olen) &&
+	MemUncompress(gname, u1) &&
+	LoadBMP(pname, &p1) && LoadBMP(u1, &p2) && samePics(&p1, &p2));
+
+  if (ok) {
+    fp = xv_fopen(u1, "r");
+    unlink(u1);
+    ok = (fp && MemUncompress(gname, u2));     /* throws out u1 */
+
+    got = (byte *) malloc(olen + 1);
+    if (!got) FatalError("out of memory in tUncompMem()");
+    if (ok) ok = (fread(got, (size_t) 1, olen + 1, fp) == olen &&
+		  !xvbcmp((char *) got, (char *) orig, olen));
+    if (fp) fclose(fp);
+  }
+
+  ProbeRelease();          /* ReadFileType() may still be holding u2 */
+  if (u1[0]) unlink(u1);
+  if (u2[0]) unlink(u2);
+  unlink(pname);  unlink(gname);
+  if (p1.pic) free(p1.pic);
+  if (p2.pic) free(p2.pic);
+  if (orig) free(orig);
+  if (got)  free(got);
+  return ok;
+
+#else
+  return 1;
+#endif
+}
+
+
+/***************************************************/
+static int tUncompBig(void)
+{
+  /* something too big to keep in memory is written to the temp file as
+     it's uncompressed, rather than all at once at the end */
+
+#ifdef HAVE_ZLIB
+  char    gname[MAXPATHLEN], uname[MAXPATHLEN];
+  byte   *data, *got;
+  size_t  len, glen, i;
+  int     ok;
+
+  len  = (size_t) 72*1024*1024 + 12345;
+  data = (byte *) malloc(len);
+  if (!data) FatalError("out of memory in tUncompBig()");
+  for (i=0; i<len; i++) data[i] = (byte) ((i * 7) ^ (i >> 13));
+
+  sprintf(gname, "%s/xvtest%d.gz", tmpdir, (int) getpid());
+  uname[0] = '\0';
+
+  got = (byte *) NULL;
+  ok = (writeGzip(gname, data, len) && MemUncompress(gname, uname) &&
+	(got = readFile(uname, &glen)) != NULL && glen == len &&
+	!xvbcmp((char *) got, (char *) data, len));
+
+  if (uname[0]) unlink(uname);
+  unlink(gname);
+  free(data);
+  if (got) free(got);
+  return ok;
+
+#else
+  return 1;
+#endif
+}
+
+
+/***************************************************/
+static void putLE(byte *p, u_int v, int n)
+{
+  for ( ; n>0; n--, v>>=8) *p++ = (byte) (v & 0xff);
+}
+
+
+/***************************************************/
+static int writeFile(const char *fname, byte *data, size_t len)
+{
+  FILE *fp;
+  int   ok;
+
+  fp = fopen(fname, "w");
+  if (!fp) return 0;
+  ok = (fwrite(data, (size_t) 1, len, fp) == len);
+  if (fclose(fp) == EOF) ok = 0;
+  return ok;
+}
+
+
+/***************************************************/
+static int samePics(PICINFO *a, PICINFO *b)
+{
+  size_t size;
+
+  if (!a->pic || !b->pic || a->type != b->type ||
+      a->w != b->w || a->h != b->h) return 0;
+
+  size = (size_t) a->w * a->h * ((a->type == PIC24) ? 3 : 1);
+  if (xvbcmp((char *) a->pic, (char *) b->pic, size)) return 0;
+
+  if (a->type == PIC8 &&
+      (xvbcmp((char *) a->r, (char *) b->r, (size_t) 256) ||
+       xvbcmp((char *) a->g, (char *) b->g, (size_t) 256) ||
+       xvbcmp((char *) a->b, (char *) b->b, (size_t) 256))) return 0;
+
+  return 1;
+}
+
+
+/***************************************************/
+static byte *readFile(const char *fname, size_t *lenp)
+{
+  /* returns all of 'fname' (malloced), and its length in *lenp, or NULL */
+
+  struct stat st;
+  FILE       *fp;
+  byte       *data;
+
+  if (stat(fname, &st) != 0) return (byte *) NULL;
+  fp = fopen(fname, "r");
+  if (!fp) return (byte *) NULL;
+
+  *lenp = (size_t) st.st_size;
+  data  = (byte *) malloc(*lenp + 1);
+  if (!data) FatalError("out of memory in readFile()");
+
+  if (fread(data, (size_t) 1, *lenp, fp) != *lenp) {
+    free(data);
+    data = (byte *) NULL;
+  }
+
+  fclose(fp);
+  return data;
+}
+
+
+#ifdef HAVE_ZLIB
+/***************************************************/
+static int writeGzip(const char *fname, byte *data, size_t len)
+{
+  gzFile gz;
+  size_t n;
+  int    ok;
+
+  gz = gzopen(fname, "wb1");
+  if (!gz) return 0;
+
+  for (ok=1; ok && len > 0; data += n, len -= n) {
+    n  = (len > (size_t) 1<<20) ? (size_t) 1<<20 : len;
+    ok = (gzwrite(gz, data, (unsigned) n) == (int) n);
+  }
+
+  if (gzclose(gz) != Z_OK) ok = 0;
+  return ok;
+}
+#endif
@@ -0,0 +1,355 @@
+/*
+ * xvthread.c - a pool of worker threads, used to split up the heavier
+ *              image processing loops into bands of rows
+ *
+ *  Contains:
+ *            void InitThreads()
+ *            int  IsMainThread()
+ *            int  NumThreads()
+ *            void DoRowBands(nrows, func, data)
+ *            void DoRowWave(nrows, ncols, window, func, data)
+ *
+ * If XV wasn't built with thread support, DoRowBands() just calls 'func'
+ * once, for all of the rows, and DoRowWave() does the rows in order.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+
+#define MAXTHREADS   64     /* no point in going crazy */
+#define BANDSPER      4     /* # of bands per thread, for load balancing */
+#define MINBANDROWS  16     /* don't split jobs up any finer than this */
+#define WAVECHUNK   128     /* columns DoRowWave() does at a time */
+#define WAVELAG       2     /* how far ahead the row above has to be */
+
+
+#ifdef HAVE_PTHREAD
+
+static void *workerMain PARM((void *));
+static int   takeBand   PARM((void));
+static void  doBand     PARM((int));
+
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  workCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  doneCond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t mainThread;      /* the one that talks to the X server */
+
+/* state of a DoRowWave() job */
+typedef struct { void  (*func) PARM((void *, int, int, int));
+		 void   *data;
+		 int     nrows, ncols, window;
+		 int     nextrow;          /* next row nobody has started on */
+		 int    *done;             /* # of columns finished, per row */
+		 pthread_mutex_t lock;
+		 pthread_cond_t  cond;
+	       } WAVEJOB;
+
+static void waveBand    PARM((void *, int, int));
+static void waveWaitFor PARM((WAVEJOB *, int, int));
+
+static int    poolSize  = -1;    /* # of worker threads.  -1 = not started */
+static int    poolBusy  = 0;     /* a DoRowBands() job is in progress */
+
+/* the current job */
+static void (*jobFunc) PARM((void *, int, int));
+static void  *jobData;
+static int    jobRows, jobBands;
+static int    nextBand;          /* next band nobody has started on */
+static int    bandsLeft;         /* bands that haven't been finished */
+
+#endif /* HAVE_PTHREAD */
+
+
+/***************************************************/
+void InitThreads(void)
+{
+  /* called once, at startup, from the main thread */
+
+#ifdef HAVE_PTHREAD
+  mainThread = pthread_self();
+#endif
+}
+
+
+/***************************************************/
+int IsMainThread(void)
+{
+  /* returns '1' if called from the main thread.  Things that draw (status
+     strings, the wait cursor, etc.) quietly do nothing otherwise */
+
+#ifdef HAVE_PTHREAD
+  return pthread_equal(pthread_self(), mainThread);
+#else
+  return 1;
+#endif
+}
+
+
+/***************************************************/
+int NumThreads(void)
+{
+  /* returns the number of threads (including the main one) that image
+     processing jobs get split across.  Set with '-threads', otherwise
+     one per online CPU */
+
+  static int nt = 0;
+
+  if (nt) return nt;
+
+#ifdef HAVE_PTHREAD
+  if (nthreads > 0) nt = nthreads;
+  else {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nt = (ncpu > 0) ? (int) ncpu : 1;
+  }
+  if (nt > MAXTHREADS) nt = MAXTHREADS;
+#else
+  nt = 1;
+#endif
+
+  if (DEBUG) fprintf(stderr,"NumThreads: using %d thread%s\n",
+		     nt, (nt==1) ? "" : "s");
+  return nt;
+}
+
+
+/***************************************************/
+void DoRowBands(int nrows, void (*func)(void *, int, int), void *data)
+{
+  /* calls func(data, y0, y1) for a set of bands [y0,y1) that together
+   * cover rows 0 through nrows-1, using the worker threads if there are
+   * any, and returns once they're all done.  The bands may be done in any
+   * order, and at the same time, so 'func' must only write to its own rows,
+   * and must be careful about any other shared state.  In particular, it
+   * can't call anything that talks to the X server.  The exception is the
+   * band with y0==0, which is always done by the calling thread, and so may
+   * call WaitCursor() and ProgressMeter().
+   */
+
+#ifdef HAVE_PTHREAD
+  int i, nbands, band;
+
+  nbands = NumThreads() * BANDSPER;
+  if (nbands > nrows / MINBANDROWS) nbands = nrows / MINBANDROWS;
+
+  pthread_mutex_lock(&poolLock);
+
+  if (nbands < 2 || poolBusy) {   /* small job, or called from inside one */
+    pthread_mutex_unlock(&poolLock);
+    if (nrows > 0) (*func)(data, 0, nrows);
+    return;
+  }
+
+  if (poolSize < 0) {             /* first time:  start up the workers */
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    for (i=poolSize=0; i<NumThreads()-1; i++) {
+      pthread_t tid;
+      if (pthread_create(&tid, &attr, workerMain, NULL)) break;
+      poolSize++;
+    }
+
+    pthread_attr_destroy(&attr);
+    if (DEBUG) fprintf(stderr,"DoRowBands: started %d workers\n", poolSize);
+  }
+
+  poolBusy  = 1;
+  jobFunc   = func;
+  jobData   = data;
+  jobRows   = nrows;
+  jobBands  = bandsLeft = nbands;
+  nextBand  = 1;                  /* band 0 is ours */
+  pthread_cond_broadcast(&workCond);
+  pthread_mutex_unlock(&poolLock);
+
+  /* do band 0, then help out with whatever's left */
+  band = 0;
+  do { doBand(band); } while ((band = takeBand()) >= 0);
+
+  pthread_mutex_lock(&poolLock);
+  while (bandsLeft > 0) pthread_cond_wait(&doneCond, &poolLock);
+  poolBusy = 0;
+  pthread_mutex_unlock(&poolLock);
+
+#else  /* !HAVE_PTHREAD */
+
+  if (nrows > 0) (*func)(data, 0, nrows);
+
+#endif /* HAVE_PTHREAD */
+}
+
+
+
+#ifdef HAVE_PTHREAD
+
+/***************************************************/
+static void *workerMain(void *arg)
+{
+  int band;
+
+  XV_UNUSED(arg);
+
+  while (1) {
+    pthread_mutex_lock(&poolLock);
+    while (!poolBusy || nextBand >= jobBands)
+      pthread_cond_wait(&workCond, &poolLock);
+    band = nextBand++;
+    pthread_mutex_unlock(&poolLock);
+
+    doBand(band);
+  }
+
+  return NULL;   /* never gets here */
+}
+
+
+/***************************************************/
+static int takeBand(void)
+{
+  /* returns the number of a band that nobody has started on, or -1 */
+
+  int band;
+
+  pthread_mutex_lock(&poolLock);
+  band = (nextBand < jobBands) ? nextBand++ : -1;
+  pthread_mutex_unlock(&poolLock);
+
+  return band;
+}
+
+
+/***************************************************/
+static void doBand(int band)
+{
+  int y0, y1;
+
+  y0 = (int) (((double) band     * jobRows) / jobBands);
+  y1 = (int) (((double) (band+1) * jobRows) / jobBands);
+  if (y1 > y0) (*jobFunc)(jobData, y0, y1);
+
+  pthread_mutex_lock(&poolLock);
+  if (--bandsLeft == 0) pthread_cond_signal(&doneCond);
+  pthread_mutex_unlock(&poolLock);
+}
+
+#endif /* HAVE_PTHREAD */
+
+
+/***************************************************/
+void DoRowWave(int nrows, int ncols, int window, void (*func)(void *, int, int, int), void *data)
+{
+  /* for error diffusion, where each row needs the errors from the row
+   * above it.  Calls func(data, y, x0, x1) on pieces of each row, in
+   * order from left to right.  Row y's piece [x0,x1) isn't started until
+   * row y-1 has finished up to x1 (plus a couple of columns, for the
+   * errors it spreads down and to the left), so all 'func' has to worry
+   * about is its own row, and the one below it.  The rows run down the
+   * image in a diagonal wave, one per thread.
+   *
+   * Row y isn't started until row y-window is completely done, so 'func'
+   * can keep its rows in a ring of window+1 buffers.  (window must be at
+   * least 1.)  As with DoRowBands(), any thread might do any row, though
+   * 'func' may call WaitCursor() and ProgressMeter(), which don't do
+   * anything from the other threads.
+   *
+   * The result is the same as doing the rows one after another, as long
+   * as 'func' keeps to that.  (Serpentine scanning doesn't.)
+   */
+
+#ifdef HAVE_PTHREAD
+  WAVEJOB wj;
+
+  if (NumThreads() > 1 && nrows > 1 && window > 1) {
+    wj.done = (int *) calloc((size_t) nrows, sizeof(int));
+    if (wj.done) {
+      wj.func  = func;   wj.data  = data;
+      wj.nrows = nrows;  wj.ncols = ncols;
+      wj.window  = window;
+      wj.nextrow = 0;
+      pthread_mutex_init(&wj.lock, NULL);
+      pthread_cond_init (&wj.cond, NULL);
+
+      /* one band per thread.  Each one just takes the next row, until
+	 they're gone.  Rows are taken in order, by threads that are
+	 already running, so the rows a row waits on are always being
+	 worked on by someone */
+      DoRowBands(NumThreads() * MINBANDROWS, waveBand, (void *) &wj);
+
+      pthread_cond_destroy (&wj.cond);
+      pthread_mutex_destroy(&wj.lock);
+      free(wj.done);
+      return;
+    }
+  }
+#else
+  XV_UNUSED(window);
+#endif
+
+  {
+    int y;
+    for (y=0; y<nrows; y++) (*func)(data, y, 0, ncols);
+  }
+}
+
+
+
+#ifdef HAVE_PTHREAD
+
+/***************************************************/
+static void waveBand(void *data, int y0, int y1)
+{
+  WAVEJOB *wj = (WAVEJOB *) data;
+  int      y, x0, x1, need;
+
+  XV_UNUSED(y0);  XV_UNUSED(y1);
+
+  while (1) {
+    pthread_mutex_lock(&wj->lock);
+    y = wj->nextrow++;
+    pthread_mutex_unlock(&wj->lock);
+    if (y >= wj->nrows) break;
+
+    if (y >= wj->window) waveWaitFor(wj, y - wj->window, wj->ncols);
+
+    for (x0=0; x0<wj->ncols; x0=x1) {
+      x1 = x0 + WAVECHUNK;
+      if (x1 > wj->ncols) x1 = wj->ncols;
+
+      if (y > 0) {
+	need = x1 + WAVELAG;
+	waveWaitFor(wj, y-1, (need > wj->ncols) ? wj->ncols : need);
+      }
+
+      (*wj->func)(wj->data, y, x0, x1);
+
+      pthread_mutex_lock(&wj->lock);
+      wj->done[y] = x1;
+      pthread_cond_broadcast(&wj->cond);
+      pthread_mutex_unlock(&wj->lock);
+    }
+  }
+}
+
+
+/***************************************************/
+static void waveWaitFor(WAVEJOB *wj, int y, int ncols)
+{
+  /* waits until row 'y' has finished its first 'ncols' columns */
+
+  pthread_mutex_lock(&wj->lock);
+  while (wj->done[y] < ncols) pthread_cond_wait(&wj->cond, &wj->lock);
+  pthread_mutex_unlock(&wj->lock);
+}
+
+#endif /* HAVE_PTHREAD */
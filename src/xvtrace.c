@@ -0,0 +1,199 @@
+/*
+ * xvtrace.c - records how long each stage of loading and displaying an
+ *             image takes, as a Chrome trace-event file
+ *
+ *  Contains:
+ *            void TraceInit(fname)
+ *            int  Tracing()
+ *            void TraceBegin(name, detail)
+ *            void TraceEnd(name)
+ *            void TraceDone()
+ *
+ * Tracing is off unless it's turned on with the '-trace file' option, or by
+ * setting XV_TRACE to the name of a file.  Every TraceBegin()/TraceEnd()
+ * pair then becomes a 'B' and an 'E' event in that file, which can be
+ * loaded into chrome://tracing, or ui.perfetto.dev, to see which step is
+ * taking the time.  When it's off, the calls just return.
+ *
+ * The pairs have to nest properly on each thread.  Each thread gets its
+ * own row (the 'tid') in the output, in the order they first say something.
+ */
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#include <sys/time.h>
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+
+#define MAXTRACETIDS 64
+
+
+static FILE   *traceFP    = (FILE *) NULL;
+static int     traceCount = 0;      /* # of events written so far */
+static double  traceStart;          /* when TraceInit() was called, in usec */
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t       traceTids[MAXTRACETIDS];
+static int             numTraceTids = 0;
+#endif
+
+static double traceNow   PARM((void));
+static int    traceTid   PARM((void));
+static void   traceStr   PARM((const char *));
+static void   traceEvent PARM((int, const char *, const char *));
+
+
+/***************************************************/
+void TraceInit(const char *fname)
+{
+  /* starts writing a trace to 'fname', or to $XV_TRACE, if 'fname' is NULL.
+     Does nothing if neither is set, or if it's already tracing */
+
+  if (traceFP) return;
+
+  if (!fname || !*fname) fname = (const char *) getenv("XV_TRACE");
+  if (!fname || !*fname) return;
+
+  traceFP = fopen(fname, "w");
+  if (!traceFP) {
+    fprintf(stderr, "%s: can't write trace file '%s'\n", cmd, fname);
+    return;
+  }
+
+  traceStart = traceNow();
+  traceCount = 0;
+  fprintf(traceFP, "[");
+  atexit(TraceDone);
+}
+
+
+/***************************************************/
+int Tracing(void)
+{
+  return (traceFP != NULL);
+}
+
+
+/***************************************************/
+void TraceBegin(const char *name, const char *detail)
+{
+  /* marks the start of 'name'.  'detail' (which can be NULL) shows up as
+     the event's argument; the file being loaded, or some such */
+
+  if (!traceFP) return;
+  traceEvent('B', name, detail);
+}
+
+
+/***************************************************/
+void TraceEnd(const char *name)
+{
+  if (!traceFP) return;
+  traceEvent('E', name, (const char *) NULL);
+}
+
+
+/***************************************************/
+void TraceDone(void)
+{
+  /* finishes off the file.  Registered with atexit() by TraceInit() */
+
+  if (!traceFP) return;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&traceLock);
+#endif
+
+  fprintf(traceFP, "\n]\n");
+  fclose(traceFP);
+  traceFP = (FILE *) NULL;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&traceLock);
+#endif
+}
+
+
+/***************************************************/
+static double traceNow(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, (struct timezone *) NULL);
+  return (double) tv.tv_sec * 1000000.0 + (double) tv.tv_usec;
+}
+
+
+/***************************************************/
+static int traceTid(void)
+{
+  /* returns a small number for the calling thread.  called with traceLock
+     held */
+
+#ifdef HAVE_PTHREAD
+  pthread_t self = pthread_self();
+  int       i;
+
+  for (i=0; i<numTraceTids; i++)
+    if (pthread_equal(traceTids[i], self)) return i+1;
+
+  if (numTraceTids < MAXTRACETIDS) {
+    traceTids[numTraceTids++] = self;
+    return numTraceTids;
+  }
+  return MAXTRACETIDS + 1;     /* lump the rest together */
+#else
+  return 1;
+#endif
+}
+
+
+/***************************************************/
+static void traceStr(const char *str)
+{
+  /* writes 'str' as a quoted JSON string */
+
+  putc('"', traceFP);
+  for ( ; *str; str++) {
+    if (*str == '"' || *str == '\\') fprintf(traceFP, "\\%c", *str);
+    else if ((byte) *str < 0x20) fprintf(traceFP, "\\u%04x", (byte) *str);
+    else putc(*str, traceFP);
+  }
+  putc('"', traceFP);
+}
+
+
+/***************************************************/
+static void traceEvent(int ph, const char *name, const char *detail)
+{
+  double ts;
+
+  ts = traceNow();
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&traceLock);
+#endif
+
+  if (traceFP) {     /* might've been closed while we were waiting */
+    fprintf(traceFP, "%s\n{\"name\":", (traceCount++) ? "," : "");
+    traceStr(name);
+    fprintf(traceFP, ",\"ph\":\"%c\",\"ts\":%.0f,\"pid\":1,\"tid\":%d",
+	    ph, ts - traceStart, traceTid());
+    if (detail) {
+      fprintf(traceFP, ",\"args\":{\"detail\":");
+      traceStr(detail);
+      putc('}', traceFP);
+    }
+    putc('}', traceFP);
+  }
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&traceLock);
+#endif
+}
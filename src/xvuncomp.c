@@ -0,0 +1,729 @@
+/*
+ * xvuncomp.c - uncompresses gzip'd, bzip2'd and xz'd files in-process
+ *
+ *  Contains:
+ *            int   MemUncompress(name, uncompname)
+ *            FILE *MemFileOpen(name)
+ *
+ * UncompressFile() calls MemUncompress() first, and only falls back on
+ * running gzip, bzip2 or xz if it fails (or if xv was built without the
+ * library in question, or for 'compress'd files, which zlib can't do).
+ *
+ * The file is uncompressed into memory, and the result is given the name
+ * of an (empty) temp file, like the one UncompressFile() would've made.
+ * Anything that opens that name through xv_fopen() gets a FILE that reads
+ * from memory instead (see MemFileOpen()).  Most loaders only ever read
+ * their files through xv_fopen(), so for those nothing ever gets written to
+ * disk.  For the rest (and for things that aren't images, which get shown
+ * by TextView()), the data is written out to the temp file, which is still
+ * a good deal cheaper than a fork/exec and reading it all back in.
+ *
+ * The callers still unlink() the temp file when they're done with it, as
+ * they always have.  A memory file is only used as long as its temp file is
+ * still there, and is the same file, and is thrown out the next time we
+ * notice that it isn't.  Only the last few are kept, and no more than
+ * MEMFILEBYTES between them.  Anything bigger than that is written to the
+ * temp file as it's uncompressed, so it's never all in memory at once.
+ *
+ * A memory file's data is refcounted, and every FILE reading it holds a
+ * reference, so throwing it out while something (ReadFileType()'s held
+ * FILE, say) is still reading it only frees the data once that's closed.
+ * That takes a FILE that says when it's closed, which only glibc's
+ * fopencookie() gives us.  Elsewhere, everything goes to the temp file.
+ */
+
+/* for fopencookie() */
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+#endif
+
+#include "copyright.h"
+
+#include "xv.h"
+
+#ifdef __GLIBC__
+#  define MEMSTREAMS
+#endif
+
+#ifdef HAVE_ZLIB
+#  include <zlib.h>
+#endif
+#ifdef HAVE_BZLIB
+#  include <bzlib.h>
+#endif
+#ifdef HAVE_LZMA
+#  include <lzma.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+static pthread_mutex_t memLock = PTHREAD_MUTEX_INITIALIZER;
+#  define LOCK_MEM()    pthread_mutex_lock(&memLock)
+#  define UNLOCK_MEM()  pthread_mutex_unlock(&memLock)
+#else
+#  define LOCK_MEM()
+#  define UNLOCK_MEM()
+#endif
+
+
+#define MAXMEMFILES  4           /* # of uncompressed files kept around */
+#define MEMFILEBYTES ((size_t) 64*1024*1024)   /* ... and their total size */
+#define INBUFSIZE    (64*1024)
+
+
+#if defined(HAVE_ZLIB) || defined(HAVE_BZLIB) || defined(HAVE_LZMA)
+
+/* the uncompressed data */
+typedef struct { byte   *data;
+		 size_t  len;
+		 int     refs;               /* memfiles[] slot + open FILEs */
+	       } MEMBUF;
+
+typedef struct { char    name[MAXPATHLEN];   /* temp file name.  "" = unused */
+		 dev_t   dev;                /* ... and what it was */
+		 ino_t   ino;
+		 MEMBUF *buf;
+		 unsigned long age;
+	       } MEMFILE;
+
+/* an output buffer that grows as needed, up to MEMFILEBYTES.  After that,
+   it's written to 'fd' whenever it fills up */
+typedef struct { byte   *data;
+		 size_t  len, size;
+		 int     fd;
+		 size_t  flushed;            /* # of bytes written to fd */
+	       } OUTBUF;
+
+static MEMFILE        memfiles[MAXMEMFILES];
+static unsigned long  memAge = 0;
+static size_t         memBytes = 0;
+
+static int      memUncomp    PARM((const char *, OUTBUF *));
+static byte    *outSpace     PARM((OUTBUF *, size_t *));
+static int      direct       PARM((int));
+static MEMBUF  *addMemFile   PARM((const char *, byte *, size_t));
+static void     dropMemFile  PARM((MEMBUF *));
+static void     freeMemFile  PARM((MEMFILE *));
+static void     pruneMemFiles PARM((void));
+static void     unrefBuf     PARM((MEMBUF *));
+static void     releaseBuf   PARM((MEMBUF *));
+static FILE    *memStream    PARM((MEMBUF *));
+static int      writeAll     PARM((int, byte *, size_t));
+
+#ifdef MEMSTREAMS
+typedef struct { MEMBUF *buf;
+		 size_t  pos;
+	       } MEMSTREAM;
+
+static ssize_t  msRead       PARM((void *, char *, size_t));
+static int      msSeek       PARM((void *, off64_t *, int));
+static int      msClose      PARM((void *));
+#endif
+
+#ifdef HAVE_ZLIB
+static int      gunzip       PARM((FILE *, OUTBUF *));
+#endif
+#ifdef HAVE_BZLIB
+static int      bunzip2      PARM((FILE *, OUTBUF *));
+#endif
+#ifdef HAVE_LZMA
+static int      unxz         PARM((FILE *, OUTBUF *));
+#endif
+
+#endif /* HAVE_ZLIB || HAVE_BZLIB || HAVE_LZMA */
+
+
+/***************************************************/
+int MemUncompress(char *name, char *uncompname)
+{
+  /* uncompresses 'name', if it's in a format we know how to deal with.
+     returns '1' on success, with the name of the uncompressed file in
+     'uncompname' (as UncompressFile() does).  returns '0' if it couldn't
+     do it, without complaining about it */
+
+#if defined(HAVE_ZLIB) || defined(HAVE_BZLIB) || defined(HAVE_LZMA)
+  OUTBUF  ob;
+  MEMBUF *mb;
+  int     fd, ftype, ok, inmem;
+
+#ifndef VMS
+  sprintf(uncompname, "%s/xvuXXXXXX", tmpdir);
+#else
+  strcpy(uncompname, "[]xvuXXXXXX");
+#endif
+
+#ifdef USE_MKSTEMP
+  fd = mkstemp(uncompname);
+#else
+  mktemp(uncompname);
+  fd = open(uncompname,O_WRONLY|O_CREAT|O_EXCL,S_IRWUSR);
+#endif
+  if (fd < 0) return 0;
+
+  ob.fd = fd;
+  if (!memUncomp(name, &ob)) { close(fd);  unlink(uncompname);  return 0; }
+
+  /* NULL if it's too big to keep in memory.  Otherwise it has ob.data now,
+     and we have a reference to it */
+  mb = (ob.flushed) ? (MEMBUF *) NULL
+                    : addMemFile(uncompname, ob.data, ob.len);
+
+  inmem = 0;
+  if (mb) {
+    /* if whatever's going to read it needs a real file, give it one */
+    ftype = ReadFileType(uncompname);
+    inmem = direct(ftype);
+
+    ok = 1;
+    if (!inmem) {
+      ProbeRelease();         /* ReadFileType() may be holding it open */
+      ok = writeAll(fd, mb->data, mb->len);
+      dropMemFile(mb);
+    }
+    releaseBuf(mb);
+  }
+  else {
+    ok = writeAll(fd, ob.data, ob.len);
+    free(ob.data);
+  }
+
+  close(fd);
+  if (!ok) { unlink(uncompname);  return 0; }
+
+  if (DEBUG) fprintf(stderr,"MemUncompress(%s): %lu bytes, %s\n", name,
+		     (unsigned long) (ob.flushed + ob.len),
+		     (inmem) ? "in memory" : "written to temp file");
+  return 1;
+
+#else
+  XV_UNUSED(name);  XV_UNUSED(uncompname);
+  return 0;
+#endif
+}
+
+
+/***************************************************/
+FILE *MemFileOpen(const char *name)
+{
+  /* called by xv_fopen().  If 'name' is the temp file of something
+     MemUncompress() uncompressed into memory, returns a FILE that reads it
+     from there.  Otherwise returns NULL */
+
+#if defined(HAVE_ZLIB) || defined(HAVE_BZLIB) || defined(HAVE_LZMA)
+  MEMBUF *mb;
+  FILE   *fp;
+  int     i;
+
+  if (!memAge) return (FILE *) NULL;     /* haven't done anything yet */
+
+  mb = (MEMBUF *) NULL;
+  LOCK_MEM();
+
+  /* this also makes sure that what's left is still our temp file, and not
+     something new that happens to have the same name */
+  pruneMemFiles();
+
+  for (i=0; i<MAXMEMFILES; i++) {
+    MEMFILE *mf = &memfiles[i];
+    if (mf->name[0] && strcmp(mf->name, name) == 0) {
+      mb = mf->buf;
+      mb->refs++;             /* the FILE's */
+      break;
+    }
+  }
+
+  UNLOCK_MEM();
+
+  if (!mb) return (FILE *) NULL;
+
+  fp = memStream(mb);
+  if (!fp) releaseBuf(mb);
+  return fp;
+
+#else
+  XV_UNUSED(name);
+  return (FILE *) NULL;
+#endif
+}
+
+
+
+#if defined(HAVE_ZLIB) || defined(HAVE_BZLIB) || defined(HAVE_LZMA)
+
+/***************************************************/
+static int memUncomp(const char *name, OUTBUF *ob)
+{
+  FILE *fp;
+  byte  magic[6];
+  int   rv, n;
+
+  fp = xv_fopen(name, "r");
+  if (!fp) return 0;
+
+  n = fread(magic, (size_t) 1, sizeof(magic), fp);
+  rewind(fp);
+
+  ob->data = (byte *) NULL;  ob->len = ob->size = ob->flushed = 0;
+  rv = 0;
+
+#ifdef HAVE_ZLIB
+  if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    rv = gunzip(fp, ob);
+#endif
+#ifdef HAVE_BZLIB
+  if (n >= 3 && magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h')
+    rv = bunzip2(fp, ob);
+#endif
+#ifdef HAVE_LZMA
+  if (n >= 6 && magic[0] == 0xfd && strncmp((char *) magic+1, "7zXZ", 4) == 0
+      && magic[5] == 0)
+    rv = unxz(fp, ob);
+#endif
+
+  fclose(fp);
+
+  if (!rv || ob->flushed + ob->len == 0) {
+    if (ob->data) free(ob->data);
+    ob->data = (byte *) NULL;
+    return 0;
+  }
+
+  return 1;
+}
+
+
+/***************************************************/
+static byte *outSpace(OUTBUF *ob, size_t *avail)
+{
+  /* returns where the next output should go, and how much room there is,
+     growing the buffer if it's full, or, if it's as big as it gets,
+     writing it out to ob->fd.  returns NULL if out of memory, or the write
+     failed */
+
+  if (ob->len == ob->size && ob->size >= MEMFILEBYTES) {
+    if (!writeAll(ob->fd, ob->data, ob->len)) return (byte *) NULL;
+    ob->flushed += ob->len;
+    ob->len = 0;
+  }
+
+  if (ob->len == ob->size) {
+    size_t nsize;
+    byte  *ndata;
+
+    nsize = (ob->size) ? ob->size * 2 : (size_t) 4 * INBUFSIZE;
+    if (nsize > MEMFILEBYTES) nsize = MEMFILEBYTES;
+
+    ndata = (byte *) realloc(ob->data, nsize);
+    if (!ndata) return (byte *) NULL;
+    ob->data = ndata;  ob->size = nsize;
+  }
+
+  *avail = ob->size - ob->len;
+  return ob->data + ob->len;
+}
+
+
+#ifdef HAVE_ZLIB
+/***************************************************/
+static int gunzip(FILE *fp, OUTBUF *ob)
+{
+  z_stream zs;
+  byte     inbuf[INBUFSIZE], *out;
+  size_t   avail;
+  int      zrv, ok;
+
+  xvbzero((char *) &zs, sizeof(zs));
+  if (inflateInit2(&zs, 15+16) != Z_OK) return 0;      /* gzip header */
+
+  ok = 0;
+  while (1) {
+    if (zs.avail_in == 0) {
+      zs.next_in  = inbuf;
+      zs.avail_in = fread(inbuf, (size_t) 1, sizeof(inbuf), fp);
+      if (zs.avail_in == 0) break;        /* ran out, hopefully at the end */
+    }
+
+    out = outSpace(ob, &avail);
+    if (!out) { ok = 0;  break; }
+    if (avail > (size_t) 0x40000000) avail = 0x40000000;  /* uInt */
+    zs.next_out  = out;
+    zs.avail_out = (uInt) avail;
+
+    zrv = inflate(&zs, Z_NO_FLUSH);
+    ob->len += avail - zs.avail_out;
+
+    if (zrv == Z_STREAM_END) {
+      /* there may be more gzip members after this one (as 'gzip -d' would
+	 handle), or just some padding */
+      ok = 1;
+      if (zs.avail_in == 0) {
+	zs.next_in  = inbuf;
+	zs.avail_in = fread(inbuf, (size_t) 1, sizeof(inbuf), fp);
+      }
+      if (zs.avail_in < 2 || zs.next_in[0] != 0x1f || zs.next_in[1] != 0x8b)
+	break;
+      if (inflateReset(&zs) != Z_OK) { ok = 0;  break; }
+      ok = 0;
+    }
+    else if (zrv != Z_OK && zrv != Z_BUF_ERROR) { ok = 0;  break; }
+  }
+
+  inflateEnd(&zs);
+  return ok;
+}
+#endif /* HAVE_ZLIB */
+
+
+#ifdef HAVE_BZLIB
+/***************************************************/
+static int bunzip2(FILE *fp, OUTBUF *ob)
+{
+  bz_stream bs;
+  char      inbuf[INBUFSIZE];
+  byte     *out;
+  size_t    avail;
+  int       bzrv, ok;
+
+  xvbzero((char *) &bs, sizeof(bs));
+  if (BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK) return 0;
+
+  ok = 0;
+  while (1) {
+    if (bs.avail_in == 0) {
+      bs.next_in  = inbuf;
+      bs.avail_in = fread(inbuf, (size_t) 1, sizeof(inbuf), fp);
+      if (bs.avail_in == 0) break;
+    }
+
+    out = outSpace(ob, &avail);
+    if (!out) { ok = 0;  break; }
+    if (avail > (size_t) 0x40000000) avail = 0x40000000;
+    bs.next_out  = (char *) out;
+    bs.avail_out = (unsigned int) avail;
+
+    bzrv = BZ2_bzDecompress(&bs);
+    ob->len += avail - bs.avail_out;
+
+    if (bzrv == BZ_STREAM_END) {
+      /* 'bzip2 -d' handles concatenated streams, too */
+      ok = 1;
+      if (bs.avail_in == 0) {
+	bs.next_in  = inbuf;
+	bs.avail_in = fread(inbuf, (size_t) 1, sizeof(inbuf), fp);
+      }
+      if (bs.avail_in < 3 || strncmp(bs.next_in, "BZh", (size_t) 3) != 0)
+	break;
+
+      {
+	char    *next_in  = bs.next_in;
+	unsigned avail_in = bs.avail_in;
+
+	BZ2_bzDecompressEnd(&bs);
+	xvbzero((char *) &bs, sizeof(bs));
+	if (BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK) return 0;
+	bs.next_in = next_in;  bs.avail_in = avail_in;
+      }
+      ok = 0;
+    }
+    else if (bzrv != BZ_OK) { ok = 0;  break; }
+  }
+
+  BZ2_bzDecompressEnd(&bs);
+  return ok;
+}
+#endif /* HAVE_BZLIB */
+
+
+#ifdef HAVE_LZMA
+/***************************************************/
+static int unxz(FILE *fp, OUTBUF *ob)
+{
+  lzma_stream ls = LZMA_STREAM_INIT;
+  lzma_action action;
+  lzma_ret    lrv;
+  byte        inbuf[INBUFSIZE], *out;
+  size_t      avail;
+  int         ok;
+
+  if (lzma_stream_decoder(&ls, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+    return 0;
+
+  action = LZMA_RUN;
+  ok = 0;
+  while (1) {
+    if (ls.avail_in == 0 && action == LZMA_RUN) {
+      ls.next_in  = inbuf;
+      ls.avail_in = fread(inbuf, (size_t) 1, sizeof(inbuf), fp);
+      if (ls.avail_in == 0) action = LZMA_FINISH;
+    }
+
+    out = outSpace(ob, &avail);
+    if (!out) break;
+    ls.next_out  = out;
+    ls.avail_out = avail;
+
+    lrv = lzma_code(&ls, action);
+    ob->len += avail - ls.avail_out;
+
+    if (lrv == LZMA_STREAM_END) { ok = 1;  break; }
+    if (lrv != LZMA_OK) break;
+  }
+
+  lzma_end(&ls);
+  return ok;
+}
+#endif /* HAVE_LZMA */
+
+
+/***************************************************/
+static int direct(int ftype)
+{
+  /* returns '1' if the loader for ftype only reads the file through
+     xv_fopen(), and so can read it from memory */
+
+  switch (ftype) {
+  case RFT_GIF:     case RFT_PM:      case RFT_PBM:     case RFT_XBM:
+  case RFT_SUNRAS:  case RFT_BMP:     case RFT_UTAHRLE: case RFT_IRIS:
+  case RFT_PCX:     case RFT_IFF:     case RFT_TARGA:   case RFT_XWD:
+  case RFT_FITS:    case RFT_ZX:
+#ifdef HAVE_JPEG
+  case RFT_JFIF:
+#endif
+#ifdef HAVE_PNG
+  case RFT_PNG:
+#endif
+#ifdef HAVE_WEBP
+  case RFT_WEBP:
+#endif
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/***************************************************/
+static MEMBUF *addMemFile(const char *name, byte *data, size_t len)
+{
+  /* remembers that the temp file 'name' is really 'data', which it takes
+     over.  Throws out the memory files whose temp files are gone, and then
+     the oldest ones until there's room, if need be.  Returns the MEMBUF,
+     with a reference for the caller (see releaseBuf()), or NULL (and
+     leaves 'data' alone) if 'data' is too big, or there's no way to read
+     it from memory */
+
+#ifdef MEMSTREAMS
+  struct stat st;
+  MEMFILE    *mf;
+  MEMBUF     *mb;
+  int         i;
+
+  if (strlen(name) >= sizeof(mf->name) || len > MEMFILEBYTES ||
+      stat(name, &st) != 0) return (MEMBUF *) NULL;
+
+  mb = (MEMBUF *) malloc(sizeof(MEMBUF));
+  if (!mb) return mb;
+  mb->data = data;
+  mb->len  = len;
+  mb->refs = 2;               /* the slot's, and the caller's */
+
+  LOCK_MEM();
+
+  pruneMemFiles();
+
+  while (memBytes + len > MEMFILEBYTES) {
+    for (i=0, mf=(MEMFILE *) NULL; i<MAXMEMFILES; i++) {
+      if (memfiles[i].name[0] && (!mf || memfiles[i].age < mf->age))
+	mf = &memfiles[i];
+    }
+    freeMemFile(mf);
+  }
+
+  for (i=0, mf=(MEMFILE *) NULL; i<MAXMEMFILES; i++) {
+    if (!memfiles[i].name[0]) { mf = &memfiles[i];  break; }
+    if (!mf || memfiles[i].age < mf->age) mf = &memfiles[i];
+  }
+
+  if (mf->name[0]) freeMemFile(mf);
+
+  strcpy(mf->name, name);
+  mf->dev  = st.st_dev;
+  mf->ino  = st.st_ino;
+  mf->buf  = mb;
+  mf->age  = ++memAge;
+  memBytes += len;
+
+  UNLOCK_MEM();
+  return mb;
+
+#else
+  XV_UNUSED(name);  XV_UNUSED(data);  XV_UNUSED(len);
+  return (MEMBUF *) NULL;
+#endif
+}
+
+
+/***************************************************/
+static void dropMemFile(MEMBUF *mb)
+{
+  /* throws out the memory file for 'mb', if it's still around.  The
+     caller's reference to it is still good */
+
+  int i;
+
+  LOCK_MEM();
+  for (i=0; i<MAXMEMFILES; i++) {
+    if (memfiles[i].name[0] && memfiles[i].buf == mb)
+      freeMemFile(&memfiles[i]);
+  }
+  UNLOCK_MEM();
+}
+
+
+/***************************************************/
+static void freeMemFile(MEMFILE *mf)
+{
+  /* empties memfiles[] slot 'mf'.  The data goes once nothing's reading
+     it.  memLock must be held */
+
+  memBytes -= mf->buf->len;
+  unrefBuf(mf->buf);
+  mf->buf     = (MEMBUF *) NULL;
+  mf->name[0] = '\0';
+}
+
+
+/***************************************************/
+static void pruneMemFiles(void)
+{
+  /* throws out the memory files whose temp files have been unlink()ed (or
+     replaced by something else, or written to).  memLock must be held */
+
+  struct stat st;
+  MEMFILE    *mf;
+  int         i;
+
+  for (i=0; i<MAXMEMFILES; i++) {
+    mf = &memfiles[i];
+    if (!mf->name[0]) continue;
+
+    if (stat(mf->name, &st) != 0 || st.st_dev != mf->dev ||
+	st.st_ino != mf->ino || st.st_size != 0) freeMemFile(mf);
+  }
+}
+
+
+/***************************************************/
+static void unrefBuf(MEMBUF *mb)
+{
+  /* memLock must be held */
+
+  if (--mb->refs > 0) return;
+  free(mb->data);
+  free(mb);
+}
+
+
+/***************************************************/
+static void releaseBuf(MEMBUF *mb)
+{
+  LOCK_MEM();
+  unrefBuf(mb);
+  UNLOCK_MEM();
+}
+
+
+/***************************************************/
+static FILE *memStream(MEMBUF *mb)
+{
+  /* returns a FILE that reads 'mb', and gives up a reference to it when
+     it's closed, or NULL if it can't */
+
+#ifdef MEMSTREAMS
+  cookie_io_functions_t funcs;
+  MEMSTREAM *ms;
+  FILE      *fp;
+
+  ms = (MEMSTREAM *) malloc(sizeof(MEMSTREAM));
+  if (!ms) return (FILE *) NULL;
+  ms->buf = mb;
+  ms->pos = 0;
+
+  funcs.read  = msRead;
+  funcs.write = NULL;
+  funcs.seek  = msSeek;
+  funcs.close = msClose;
+
+  fp = fopencookie((void *) ms, "r", funcs);
+  if (!fp) free(ms);
+  return fp;
+
+#else
+  XV_UNUSED(mb);
+  return (FILE *) NULL;
+#endif
+}
+
+
+#ifdef MEMSTREAMS
+/***************************************************/
+static ssize_t msRead(void *cookie, char *buf, size_t size)
+{
+  MEMSTREAM *ms = (MEMSTREAM *) cookie;
+  size_t     left;
+
+  left = ms->buf->len - ms->pos;
+  if (size > left) size = left;
+  xvbcopy((char *) ms->buf->data + ms->pos, buf, size);
+  ms->pos += size;
+  return (ssize_t) size;
+}
+
+
+/***************************************************/
+static int msSeek(void *cookie, off64_t *offset, int whence)
+{
+  MEMSTREAM *ms = (MEMSTREAM *) cookie;
+  off64_t    pos;
+
+  switch (whence) {
+  case SEEK_SET:  pos = *offset;                             break;
+  case SEEK_CUR:  pos = (off64_t) ms->pos + *offset;         break;
+  case SEEK_END:  pos = (off64_t) ms->buf->len + *offset;    break;
+  default:        return -1;
+  }
+
+  if (pos < 0 || pos > (off64_t) ms->buf->len) return -1;
+  ms->pos = (size_t) pos;
+  *offset = pos;
+  return 0;
+}
+
+
+/***************************************************/
+static int msClose(void *cookie)
+{
+  MEMSTREAM *ms = (MEMSTREAM *) cookie;
+
+  releaseBuf(ms->buf);
+  free(ms);
+  return 0;
+}
+#endif /* MEMSTREAMS */
+
+
+/***************************************************/
+static int writeAll(int fd, byte *data, size_t len)
+{
+  ssize_t n;
+
+  while (len > 0) {
+    n = write(fd, data, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return 0;
+    data += n;  len -= (size_t) n;
+  }
+  return 1;
+}
+
+#endif /* HAVE_ZLIB || HAVE_BZLIB || HAVE_LZMA */
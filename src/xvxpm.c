@@ -56,6 +56,12 @@ static int     hash_insert   PARM((hentry *));
 static hentry *hash_search   PARM((char *));
 static void    hash_destroy  PARM((void));
 
+#ifdef XV_HEADLESS
+/* no X server to look colors up in */
+static int     parseColor    PARM((const char *, XColor *));
+#  define XParseColor(disp, cmap, spec, col)  parseColor(spec, col)
+#endif
+
 
 /**************************************/
 int LoadXPM(char *fname, PICINFO *pinfo)
@@ -354,6 +360,52 @@ int LoadXPM(char *fname, PICINFO *pinfo)
 }
 
 
+#ifdef XV_HEADLESS
+/***************************************/
+static int parseColor(const char *spec, XColor *col)
+{
+  /* understands the '#rgb', '#rrggbb', ... forms of color spec, and the
+     handful of names that turn up in most XPMs.  Returns '0' otherwise */
+
+  static struct { const char *name;  int rgb; } names[] = {
+    { "black",   0x000000 },  { "white",  0xffffff },
+    { "red",     0xff0000 },  { "green",  0x00ff00 },
+    { "blue",    0x0000ff },  { "yellow", 0xffff00 },
+    { "cyan",    0x00ffff },  { "magenta",0xff00ff },
+    { "gray",    0xbebebe },  { "grey",   0xbebebe } };
+  int i, j, n, len, v[3];
+
+  if (*spec != '#') {
+    for (i=0; i < (int) (sizeof(names) / sizeof(names[0])); i++) {
+      if (strcasecmp(spec, names[i].name) == 0) {
+	col->red   = ((names[i].rgb >> 16) & 0xff) * 0x101;
+	col->green = ((names[i].rgb >>  8) & 0xff) * 0x101;
+	col->blue  = ((names[i].rgb      ) & 0xff) * 0x101;
+	return 1;
+      }
+    }
+    return 0;
+  }
+
+  spec++;
+  len = strlen(spec);
+  if (len < 3 || len > 12 || len % 3) return 0;
+  n = len / 3;                           /* hex digits per component */
+
+  for (i=0; i<3; i++) {
+    for (j=0, v[i]=0; j<n; j++, spec++) {
+      if (!isxdigit((unsigned char) *spec)) return 0;
+      v[i] = (v[i] << 4) | hex[(unsigned char) *spec];
+    }
+    v[i] <<= 4 * (4 - n);                /* scale up to 16 bits */
+  }
+
+  col->red = v[0];  col->green = v[1];  col->blue = v[2];
+  return 1;
+}
+#endif /* XV_HEADLESS */
+
+
 /***************************************/
 static int XpmLoadError(const char *fname, const char *st)
 {
@@ -76,6 +76,7 @@ typedef byte pixel;
 static int    getinit         PARM((FILE *, int*, int*, int*, CARD32 *,
 			                          CARD32, PICINFO *));
 static CARD32 getpixnum       PARM((FILE *));
+static void   getpixrow       PARM((FILE *, BULKIN *, CARD32 *, int));
 static int    xwdError        PARM((const char *));
 static void   xwdWarning      PARM((const char *));
 static int    bs_short        PARM((int));
@@ -117,9 +118,10 @@ int LoadXWD(char *fname, PICINFO *pinfo)
 
   pixel *xP;
   int    col;
-  int    rows=0, cols=0, padright=0, row, npixels, bufsize;
-  CARD32 maxval=0, visualclass=0;
+  int    rows=0, cols=0, padright=0, row, npixels, bufsize, rowpix;
+  CARD32 maxval=0, visualclass=0, *rowbuf;
   FILE  *ifp;
+  BULKIN bi, *bip;
 
   bname          = BaseName(fname);
   pinfo->pic     = (byte *) NULL;
@@ -143,6 +145,19 @@ int LoadXWD(char *fname, PICINFO *pinfo)
     return 0;
   }
 
+  /* if each pixel is a whole byte, short or long (as they almost always
+     are), the pixels are read a row at a time */
+  rowpix = cols + ((padright > 0) ? padright : 0);
+  bip    = (BULKIN *) NULL;
+  if (bits_per_pixel == bits_per_item && padright >= 0 &&
+      (bits_per_pixel == 8 || bits_per_pixel == 16 || bits_per_pixel == 32)) {
+    bip = &bi;
+    BulkInit(bip, ifp, (size_t) rows * rowpix * (bits_per_pixel/8), 0xff);
+  }
+
+  rowbuf = (CARD32 *) malloc((size_t) rowpix * sizeof(CARD32));
+  if (!rowbuf) FatalError("couldn't malloc 'rowbuf' in LoadXWD()");
+
 
   switch (visualclass) {
   case StaticGray:
@@ -150,15 +165,16 @@ int LoadXWD(char *fname, PICINFO *pinfo)
     pinfo->colType = F_GREYSCALE;
     pic8 = (byte *) calloc((size_t) npixels, (size_t) 1);
     if (!pic8) {
+      if (bip) BulkDone(bip);
+      free(rowbuf);
       xwdError("couldn't malloc 'pic'");
       return 0;
     }
 
     for (row=0; row<rows; row++) {
+      getpixrow(ifp, bip, rowbuf, rowpix);
       for (col=0, xP=pic8+(row*cols); col<cols; col++, xP++)
-	*xP = getpixnum(ifp);
-
-      for (col=0; col<padright; col++) getpixnum(ifp);
+	*xP = rowbuf[col];
     }
 
     pinfo->type = PIC8;
@@ -170,14 +186,16 @@ int LoadXWD(char *fname, PICINFO *pinfo)
     pinfo->colType = F_FULLCOLOR;
     pic8 = (byte *) calloc((size_t) npixels, (size_t) 1);
     if (!pic8) {
+      if (bip) BulkDone(bip);
+      free(rowbuf);
       xwdError("couldn't malloc 'pic'");
       return 0;
     }
 
     for (row=0; row<rows; row++) {
+      getpixrow(ifp, bip, rowbuf, rowpix);
       for (col=0, xP=pic8+(row*cols); col<cols; col++, xP++)
-	*xP = getpixnum(ifp);
-      for (col=0; col<padright; col++) getpixnum(ifp);
+	*xP = rowbuf[col];
     }
 
     pinfo->type = PIC8;
@@ -189,43 +207,54 @@ int LoadXWD(char *fname, PICINFO *pinfo)
     pinfo->colType = F_FULLCOLOR;
     bufsize = 3*npixels;
     if (bufsize/3 != npixels) {
+      if (bip) BulkDone(bip);
+      free(rowbuf);
       xwdError("Image dimensions out of range");
       return 0;
     }
+
+    if (bits_per_pixel != 16 && bits_per_pixel != 24 && bits_per_pixel != 32) {
+      if (bip) BulkDone(bip);
+      free(rowbuf);
+      xwdError("True/Direct supports only 16, 24, and 32 bits");
+      return 0;
+    }
+
     pic24 = (byte *) calloc((size_t) bufsize, (size_t) 1);
     if (!pic24) {
+      if (bip) BulkDone(bip);
+      free(rowbuf);
       xwdError("couldn't malloc 'pic24'");
       return 0;
     }
 
     for (row=0; row<rows; row++) {
-      for (col=0, xP=pic24+(row*cols*3); col<cols; col++) {
+      xP = pic24 + ((size_t) row*cols*3);
+
+      /* the usual 8/8/8 layouts just need their bytes shuffled */
+      if (bip && bits_per_pixel == 32 && red_mask == 0xff0000 &&
+	  grn_mask == 0xff00 && blu_mask == 0xff) {
+	UnpackRGB24(BulkRow(bip, (size_t) rowpix * 4), xP, cols,
+		    (byte_order == MSBFirst) ? UNPACK_XRGB32 : UNPACK_BGRX32);
+	continue;
+      }
+
+      getpixrow(ifp, bip, rowbuf, rowpix);
+      for (col=0; col<cols; col++) {
 	CARD32 ul;
 
-	ul = getpixnum(ifp);
-	switch (bits_per_pixel) {
-        case 16:
-        case 24:
-        case 32:
-          /* SJT: shift all the way to the right and then shift left. The
-             pairs of shifts could be combined. There will be two right and
-             one left shift, but it's unknown which will be which. It seems
-             easier to do the shifts (which might be 0) separately than to
-             have a complex set of tests. I believe this is independent of
-             byte order but I have no way to test.
-           */
-          *xP++ = ((ul & red_mask) >> red_shift_right) << red_justify_left;
-          *xP++ = ((ul & grn_mask) >> grn_shift_right) << grn_justify_left;
-          *xP++ = ((ul & blu_mask) >> blu_shift_right) << blu_justify_left;
-          break;
-
-	default:
-	  xwdError("True/Direct supports only 16, 24, and 32 bits");
-	  return 0;
-	}
+	ul = rowbuf[col];
+	/* SJT: shift all the way to the right and then shift left. The
+	   pairs of shifts could be combined. There will be two right and
+	   one left shift, but it's unknown which will be which. It seems
+	   easier to do the shifts (which might be 0) separately than to
+	   have a complex set of tests. I believe this is independent of
+	   byte order but I have no way to test.
+	 */
+	*xP++ = ((ul & red_mask) >> red_shift_right) << red_justify_left;
+	*xP++ = ((ul & grn_mask) >> grn_shift_right) << grn_justify_left;
+	*xP++ = ((ul & blu_mask) >> blu_shift_right) << blu_justify_left;
       }
-
-      for (col=0; col<padright; col++) getpixnum(ifp);
     }
 
     pinfo->type = PIC24;
@@ -233,10 +262,18 @@ int LoadXWD(char *fname, PICINFO *pinfo)
     break;
 
   default:
+    if (bip) BulkDone(bip);
+    free(rowbuf);
     xwdError("unknown visual class");
     return 0;
   }
 
+  if (bip) {
+    if (bip->missing) xwdWarning("unexpected EOF");
+    BulkDone(bip);
+  }
+  free(rowbuf);
+
   sprintf(pinfo->fullInfo, "XWD, %d-bit %s.  (%d bytes)",
 	  bits_per_pixel,
 	  ((visualclass == StaticGray ) ? "StaticGray"  :
@@ -574,6 +611,48 @@ static CARD32 getpixnum(FILE *file)
 }
 
 
+/******************************/
+static void getpixrow(FILE *file, BULKIN *bi, CARD32 *pix, int n)
+{
+  /* does 'pix[i] = getpixnum(file)' for the next 'n' pixels.  If 'bi' is
+     set, each pixel is a whole item, and the whole row is read from it */
+
+  byte *p;
+  int   i;
+
+  if (!bi) {
+    for (i=0; i<n; i++) pix[i] = getpixnum(file);
+    return;
+  }
+
+  p = BulkRow(bi, (size_t) n * (bits_per_pixel/8));
+
+  switch (bits_per_pixel) {
+  case 8:
+    for (i=0; i<n; i++) pix[i] = p[i];
+    break;
+
+  case 16:
+    if (byte_order == MSBFirst)
+      for (i=0; i<n; i++, p+=2) pix[i] = ((CARD32) p[0] << 8) | p[1];
+    else
+      for (i=0; i<n; i++, p+=2) pix[i] = ((CARD32) p[1] << 8) | p[0];
+    break;
+
+  case 32:
+    if (byte_order == MSBFirst)
+      for (i=0; i<n; i++, p+=4)
+	pix[i] = ((CARD32) p[0] << 24) | ((CARD32) p[1] << 16) |
+	         ((CARD32) p[2] <<  8) |  (CARD32) p[3];
+    else
+      for (i=0; i<n; i++, p+=4)
+	pix[i] = ((CARD32) p[3] << 24) | ((CARD32) p[2] << 16) |
+	         ((CARD32) p[1] <<  8) |  (CARD32) p[0];
+    break;
+  }
+}
+
+
 /***************************/
 static int xwdError(const char *st)
 {